@@ -54,6 +54,7 @@
 #include "include/NuCachedSource2.h"
 #include <media/stagefright/AudioPlayer.h>
 #include <media/stagefright/DataSource.h>
+#include <media/stagefright/FileSource.h>
 #include <media/stagefright/JPEGSource.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaErrors.h>
@@ -180,6 +181,41 @@ static void dumpSource(const sp<MediaSource> &source, const String8 &filename) {
     out = NULL;
 }
 
+static void extractSource(const sp<MediaSource> &source) {
+    CHECK_EQ((status_t)OK, source->start());
+
+    int64_t startTimeUs = getNowUs();
+
+    status_t err;
+    int64_t numBytes = 0;
+    int64_t numBuffers = 0;
+    for (;;) {
+        MediaBuffer *mbuf;
+        err = source->read(&mbuf);
+
+        if (err == INFO_FORMAT_CHANGED) {
+            continue;
+        } else if (err != OK) {
+            break;
+        }
+
+        numBytes += mbuf->range_length();
+        ++numBuffers;
+
+        mbuf->release();
+        mbuf = NULL;
+    }
+
+    int64_t delayUs = getNowUs() - startTimeUs;
+
+    CHECK_EQ((status_t)OK, source->stop());
+
+    printf("extracted %" PRId64 " access units, %" PRId64 " bytes in %.2f secs "
+           "(%.2f MB/s)\n",
+           numBuffers, numBytes, delayUs / 1E6,
+           delayUs > 0 ? numBytes / (double)delayUs : 0.0);
+}
+
 static void playSource(OMXClient *client, sp<MediaSource> &source) {
     sp<MetaData> meta = source->getFormat();
 
@@ -628,6 +664,10 @@ static void usage(const char *me) {
     fprintf(stderr, "       -T allocate buffers from a surface texture\n");
     fprintf(stderr, "       -d(ump) output_filename (raw stream data to a file)\n");
     fprintf(stderr, "       -D(ump) output_filename (decoded PCM data to a file)\n");
+    fprintf(stderr, "       -e(xtract) read the track without decoding and "
+                    "report extractor throughput\n");
+    fprintf(stderr, "       -c(ache) size_kb read local files through a block "
+                    "cache of this size\n");
 }
 
 static void dumpCodecProfiles(const sp<IOMX>& omx, bool queryDecoders) {
@@ -691,6 +731,8 @@ int main(int argc, char **argv) {
     bool useSurfaceTexAlloc = false;
     bool dumpStream = false;
     bool dumpPCMStream = false;
+    bool extractOnly = false;
+    size_t fileCacheSize = 0;
     String8 dumpStreamFilename;
     gNumRepetitions = 1;
     gMaxNumFrames = 0;
@@ -704,7 +746,7 @@ int main(int argc, char **argv) {
     sp<ALooper> looper;
 
     int res;
-    while ((res = getopt(argc, argv, "han:lm:b:ptsrow:kxSTd:D:")) >= 0) {
+    while ((res = getopt(argc, argv, "han:lm:b:ptsrow:kxSTd:D:ec:")) >= 0) {
         switch (res) {
             case 'a':
             {
@@ -727,6 +769,25 @@ int main(int argc, char **argv) {
                 break;
             }
 
+            case 'e':
+            {
+                extractOnly = true;
+                break;
+            }
+
+            case 'c':
+            {
+                char *end;
+                long x = strtol(optarg, &end, 10);
+
+                if (*end != '\0' || end == optarg || x < 0) {
+                    x = 0;
+                }
+
+                fileCacheSize = x * 1024;
+                break;
+            }
+
             case 'l':
             {
                 listComponents = true;
@@ -987,8 +1048,27 @@ int main(int argc, char **argv) {
 
         const char *filename = argv[k];
 
-        sp<DataSource> dataSource =
-            DataSource::CreateFromURI(NULL /* httpService */, filename);
+        // Local files are opened here rather than through CreateFromURI()
+        // so that the block cache can be set up and the I/O counted.
+        bool isFileURI = !strncasecmp("file://", filename, 7);
+        bool isLocalFile = isFileURI
+                || (strstr(filename, "://") == NULL
+                        && strncasecmp("data:", filename, 5)
+                        && strncasecmp("sine:", filename, 5));
+
+        sp<FileSource> fileSource;
+        sp<DataSource> dataSource;
+        if (isLocalFile) {
+            fileSource = new FileSource(isFileURI ? filename + 7 : filename);
+            if (fileSource->initCheck() == OK) {
+                if (fileCacheSize > 0) {
+                    CHECK_EQ(fileSource->setBlockCache(fileCacheSize), (status_t)OK);
+                }
+                dataSource = fileSource;
+            }
+        } else {
+            dataSource = DataSource::CreateFromURI(NULL /* httpService */, filename);
+        }
 
         if (strncasecmp(filename, "sine:", 5) && dataSource == NULL) {
             fprintf(stderr, "Unable to create data source.\n");
@@ -1129,9 +1209,20 @@ int main(int argc, char **argv) {
             dumpSource(decSource, dumpStreamFilename);
         } else if (seekTest) {
             performSeekTest(mediaSource);
+        } else if (extractOnly) {
+            extractSource(mediaSource);
         } else {
             playSource(&client, mediaSource);
         }
+
+        if (fileSource != NULL) {
+            FileSource::Stats stats;
+            fileSource->getStats(&stats);
+            printf("file: %" PRId64 " reads, %" PRId64 " syscalls, %" PRId64
+                   " bytes read, %" PRId64 " cache hits\n",
+                   stats.mNumReads, stats.mNumSyscalls, stats.mBytesRead,
+                   stats.mNumCacheHits);
+        }
     }
 
     if ((useSurfaceAlloc || useSurfaceTexAlloc) && !audioOnly) {
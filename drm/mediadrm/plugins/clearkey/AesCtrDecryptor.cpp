@@ -26,19 +26,35 @@ namespace clearkeydrm {
 
 static const size_t kBlockBitCount = kBlockSize * 8;
 
+// static
+void AesCtrDecryptor::setKey(const android::Vector<uint8_t>& key,
+        AES_KEY* out) {
+    AES_set_encrypt_key(key.array(), kBlockBitCount, out);
+}
+
 android::status_t AesCtrDecryptor::decrypt(const android::Vector<uint8_t>& key,
         const Iv iv, const uint8_t* source,
         uint8_t* destination,
         const SubSample* subSamples,
         size_t numSubSamples,
         size_t* bytesDecryptedOut) {
+    AES_KEY opensslKey;
+    setKey(key, &opensslKey);
+    return decrypt(opensslKey, iv, source, destination, subSamples,
+            numSubSamples, bytesDecryptedOut);
+}
+
+android::status_t AesCtrDecryptor::decrypt(const AES_KEY& opensslKey,
+        const Iv iv, const uint8_t* source,
+        uint8_t* destination,
+        const SubSample* subSamples,
+        size_t numSubSamples,
+        size_t* bytesDecryptedOut) {
     uint32_t blockOffset = 0;
     uint8_t previousEncryptedCounter[kBlockSize];
     memset(previousEncryptedCounter, 0, kBlockSize);
 
     size_t offset = 0;
-    AES_KEY opensslKey;
-    AES_set_encrypt_key(key.array(), kBlockBitCount, &opensslKey);
     Iv opensslIv;
     memcpy(opensslIv, iv, sizeof(opensslIv));
 
@@ -46,8 +62,10 @@ android::status_t AesCtrDecryptor::decrypt(const android::Vector<uint8_t>& key,
         const SubSample& subSample = subSamples[i];
 
         if (subSample.mNumBytesOfClearData > 0) {
-            memcpy(destination + offset, source + offset,
-                    subSample.mNumBytesOfClearData);
+            if (destination != source) {
+                memcpy(destination + offset, source + offset,
+                        subSample.mNumBytesOfClearData);
+            }
             offset += subSample.mNumBytesOfClearData;
         }
 
@@ -35,6 +35,17 @@ public:
             const SubSample* subSamples, size_t numSubSamples,
             size_t* bytesDecryptedOut);
 
+    // Same as above, but with a key schedule that has already been expanded
+    // by setKey(), so callers that decrypt many samples with one key do not
+    // pay for the key expansion on every call. |source| and |destination|
+    // may be the same buffer, in which case clear data is left in place.
+    android::status_t decrypt(const AES_KEY& key, const Iv iv,
+            const uint8_t* source, uint8_t* destination,
+            const SubSample* subSamples, size_t numSubSamples,
+            size_t* bytesDecryptedOut);
+
+    static void setKey(const android::Vector<uint8_t>& key, AES_KEY* out);
+
 private:
     DISALLOW_EVIL_CONSTRUCTORS(AesCtrDecryptor);
 };
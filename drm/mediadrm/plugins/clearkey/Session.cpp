@@ -52,8 +52,9 @@ status_t Session::provideKeyResponse(const Vector<uint8_t>& response) {
     if (parser.extractKeysFromJsonWebKeySet(responseString, &keys)) {
         for (size_t i = 0; i < keys.size(); ++i) {
             const KeyMap::key_type& keyId = keys.keyAt(i);
-            const KeyMap::value_type& key = keys.valueAt(i);
-            mKeyMap.add(keyId, key);
+            AES_KEY keySchedule;
+            AesCtrDecryptor::setKey(keys.valueAt(i), &keySchedule);
+            mKeySchedules.add(keyId, keySchedule);
         }
         return android::OK;
     } else {
@@ -69,14 +70,15 @@ status_t Session::decrypt(
 
     Vector<uint8_t> keyIdVector;
     keyIdVector.appendArray(keyId, kBlockSize);
-    if (mKeyMap.indexOfKey(keyIdVector) < 0) {
+    ssize_t index = mKeySchedules.indexOfKey(keyIdVector);
+    if (index < 0) {
         return android::ERROR_DRM_NO_LICENSE;
     }
 
-    const Vector<uint8_t>& key = mKeyMap.valueFor(keyIdVector);
+    const AES_KEY& keySchedule = mKeySchedules.valueAt(index);
     AesCtrDecryptor decryptor;
     return decryptor.decrypt(
-            key, iv,
+            keySchedule, iv,
             reinterpret_cast<const uint8_t*>(source),
             reinterpret_cast<uint8_t*>(destination), subSamples,
             numSubSamples, bytesDecryptedOut);
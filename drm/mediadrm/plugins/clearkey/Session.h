@@ -55,8 +55,13 @@ private:
 
     const android::Vector<uint8_t> mSessionId;
 
+    // Expanded AES key schedules, keyed by key ID and built once when the
+    // key response is provided rather than on every decrypt() call.
+    typedef android::KeyedVector<android::Vector<uint8_t>, AES_KEY>
+            KeyScheduleMap;
+
     android::Mutex mMapLock;
-    KeyMap mKeyMap;
+    KeyScheduleMap mKeySchedules;
 };
 
 } // namespace clearkeydrm
@@ -15,7 +15,11 @@
  */
 
 #include <gtest/gtest.h>
+#include <stdio.h>
 #include <string.h>
+#include <vector>
+
+#include <utils/Timers.h>
 
 #include <utils/String8.h>
 #include <utils/Vector.h>
@@ -418,4 +422,115 @@ TEST_F(AesCtrDecryptorTest, DecryptsComplexMixedSubSamples) {
                                                subSamples, kNumSubsamples);
 }
 
+TEST_F(AesCtrDecryptorTest, DecryptsInPlaceWithExpandedKey) {
+    const size_t kTotalSize = 32;
+    const size_t kNumSubsamples = 2;
+
+    // Based on test vectors from NIST-800-38A
+    Key key = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+
+    Iv iv = {
+        0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+        0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+    };
+
+    uint8_t buffer[kTotalSize] = {
+        // 8 clear bytes
+        0xf0, 0x13, 0xca, 0xc7, 0x1d, 0x11, 0x22, 0x33,
+        // 16 encrypted bytes
+        0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+        0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+        // 8 clear bytes
+        0x94, 0xba, 0x88, 0x2e, 0x0e, 0x12, 0x11, 0x55
+    };
+
+    uint8_t decrypted[kTotalSize] = {
+        0xf0, 0x13, 0xca, 0xc7, 0x1d, 0x11, 0x22, 0x33,
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+        0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0x94, 0xba, 0x88, 0x2e, 0x0e, 0x12, 0x11, 0x55
+    };
+
+    SubSample subSamples[kNumSubsamples] = {
+        {8, 16},
+        {8, 0}
+    };
+
+    Vector<uint8_t> keyVector;
+    keyVector.appendArray(key, kBlockSize);
+    AES_KEY keySchedule;
+    AesCtrDecryptor::setKey(keyVector, &keySchedule);
+
+    AesCtrDecryptor decryptor;
+    size_t bytesDecrypted = 0;
+    ASSERT_EQ(android::OK, decryptor.decrypt(keySchedule, iv, buffer, buffer,
+                                             subSamples, kNumSubsamples,
+                                             &bytesDecrypted));
+    EXPECT_EQ(kTotalSize, bytesDecrypted);
+    EXPECT_EQ(0, memcmp(buffer, decrypted, kTotalSize));
+}
+
+// Not a correctness test: reports decrypt throughput for a typical video
+// access unit layout, with the key expanded per call (as before keys were
+// cached per session) and once up front. Run it with
+// --gtest_also_run_disabled_tests.
+TEST_F(AesCtrDecryptorTest, DISABLED_BenchmarkDecryptThroughput) {
+    const size_t kSampleSize = 64 * 1024;
+    const size_t kNumSubsamples = 4;
+    const size_t kIterations = 2000;
+
+    Key key = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    Iv iv = {};
+
+    SubSample subSamples[kNumSubsamples];
+    for (size_t i = 0; i < kNumSubsamples; ++i) {
+        subSamples[i].mNumBytesOfClearData = 16;
+        subSamples[i].mNumBytesOfEncryptedData =
+                kSampleSize / kNumSubsamples - 16;
+    }
+
+    Vector<uint8_t> keyVector;
+    keyVector.appendArray(key, kBlockSize);
+    AES_KEY keySchedule;
+    AesCtrDecryptor::setKey(keyVector, &keySchedule);
+
+    std::vector<uint8_t> source(kSampleSize, 0x5a);
+    std::vector<uint8_t> destination(kSampleSize);
+
+    AesCtrDecryptor decryptor;
+    size_t bytesDecrypted = 0;
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (size_t i = 0; i < kIterations; ++i) {
+        ASSERT_EQ(android::OK, decryptor.decrypt(keyVector, iv, source.data(),
+                                                 destination.data(), subSamples,
+                                                 kNumSubsamples,
+                                                 &bytesDecrypted));
+    }
+    nsecs_t perCallKeyNs = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (size_t i = 0; i < kIterations; ++i) {
+        ASSERT_EQ(android::OK, decryptor.decrypt(keySchedule, iv, source.data(),
+                                                 source.data(), subSamples,
+                                                 kNumSubsamples,
+                                                 &bytesDecrypted));
+    }
+    nsecs_t cachedKeyNs = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+    EXPECT_EQ(kSampleSize, bytesDecrypted);
+
+    double megabytes = (double)kSampleSize * kIterations / (1024 * 1024);
+    printf("per-call key, out of place: %.1f MB/s\n",
+           megabytes * 1E9 / (perCallKeyNs > 0 ? perCallKeyNs : 1));
+    printf("cached key, in place: %.1f MB/s\n",
+           megabytes * 1E9 / (cachedKeyNs > 0 ? cachedKeyNs : 1));
+}
+
 }  // namespace clearkeydrm
@@ -85,17 +85,27 @@ struct MediaScanner {
 protected:
     const char *locale() const;
 
+    // Called by processDirectory() for regular files shortly before they are
+    // reported to the client, so that their metadata can be extracted in the
+    // background before the client asks for it through processFile().
+    virtual void prefetchFile(
+            const char * /* path */, long long /* lastModified */,
+            long long /* fileSize */) {}
+
 private:
+    struct DirectoryEntry;
+
     // current locale (like "ja_JP"), created/destroyed with strdup()/free()
     char *mLocale;
     char *mSkipList;
     int *mSkipIndex;
+    size_t mNumFilesScanned;
 
     MediaScanResult doProcessDirectory(
             char *path, int pathRemaining, MediaScannerClient &client, bool noMedia);
     MediaScanResult doProcessDirectoryEntry(
             char *path, int pathRemaining, MediaScannerClient &client, bool noMedia,
-            struct dirent* entry, char* fileSpot);
+            const DirectoryEntry &entry, char* fileSpot);
     void loadSkipList();
     bool shouldSkipDirectory(char *path);
 
@@ -40,6 +40,7 @@ enum Event {
     EVENT_RESERVED,
     EVENT_STRING,               // ASCII string, not NUL-terminated
     EVENT_TIMESTAMP,            // clock_gettime(CLOCK_MONOTONIC)
+    EVENT_FORMAT,               // binary logFormat() entry, formatted by Reader::dump()
 };
 
 // ---------------------------------------------------------------------------
@@ -69,6 +70,15 @@ private:
 //  byte[2+mLength-1]   mData[mLength-1]
 //  byte[2+mLength]     duplicate copy of mLength to permit reverse scan
 //  byte[3+mLength]     start of next log entry
+//
+// mData of an EVENT_FORMAT entry
+//  struct timespec     clock_gettime(CLOCK_MONOTONIC) at the time of the call
+//  byte                length of the format string
+//  char[]              format string, not NUL-terminated
+//  ...                 one value per conversion, in order: integer, character and pointer
+//                      conversions as int64_t, floating point as double, and strings as a
+//                      length byte followed by the characters.  Values that do not fit in
+//                      the entry are dropped, and their conversions are dumped as is.
 
 // located in shared memory
 struct Shared {
@@ -128,6 +138,13 @@ public:
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
 
+    // Binary counterparts of logf() and logvf() for real-time threads: these record a
+    // timestamp, the format string and the raw argument values, and leave the formatting
+    // to Reader::dump().  Supports integer, character, floating point, string and pointer
+    // conversions; a '*' width or precision falls back to logvf().
+    virtual void    logFormat(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+    virtual void    logvFormat(const char *fmt, va_list ap);
+
     virtual bool    isEnabled() const;
 
     // return value for all of these is the previous isEnabled()
@@ -140,6 +157,8 @@ public:
 private:
     void    log(Event event, const void *data, size_t length);
     void    log(const Entry *entry, bool trusted = false);
+    // copies length bytes to the circular buffer at index rear, and returns the new rear
+    size_t  copyToShared(size_t rear, const void *data, size_t length);
 
     const size_t    mSize;      // circular buffer size in bytes, must be a power of 2
     Shared* const   mShared;    // raw pointer to shared memory
@@ -161,6 +180,8 @@ public:
     virtual void    logvf(const char *fmt, va_list ap);
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
+    virtual void    logFormat(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+    virtual void    logvFormat(const char *fmt, va_list ap);
 
     virtual bool    isEnabled() const;
     virtual bool    setEnabled(bool enabled);
@@ -194,6 +215,11 @@ private:
 
     void    dumpLine(const String8& timestamp, String8& body);
 
+    // Expands an EVENT_FORMAT entry into body and returns its timestamp in *ts.
+    // Returns false if the entry is malformed.
+    static bool formatEntry(const uint8_t *data, size_t length, struct timespec *ts,
+                            String8& body);
+
     static const size_t kSquashTimestamp = 5; // squash this many or more adjacent timestamps
 };
 
@@ -28,11 +28,28 @@
 namespace android {
 
 struct ColorConverter {
+    // OpenMAX has no 32bpp format with R, G, B, A byte order, so this
+    // vendor-range value selects it as the destination format.
+    static const OMX_COLOR_FORMATTYPE kColorFormatRGBA8888 =
+        (OMX_COLOR_FORMATTYPE)0x7F00A000;
+
+    enum ColorMatrix {
+        kColorMatrixBT601,
+        kColorMatrixBT709
+    };
+
     ColorConverter(OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to);
     ~ColorConverter();
 
     bool isValid() const;
 
+    // Defaults to BT.601 with video (16..235) range.
+    void setColorMatrix(ColorMatrix matrix, bool fullRange);
+
+    // Frames large enough to be worth it are split into bands of rows
+    // that are converted on up to |numThreads| threads. Defaults to 1.
+    void setNumThreads(size_t numThreads);
+
     status_t convert(
             const void *srcBits,
             size_t srcWidth, size_t srcHeight,
@@ -59,25 +76,21 @@ private:
         size_t mCropLeft, mCropTop, mCropRight, mCropBottom;
     };
 
+    struct Band;
+
     OMX_COLOR_FORMATTYPE mSrcFormat, mDstFormat;
+    ColorMatrix mColorMatrix;
+    bool mFullRange;
+    size_t mNumThreads;
     uint8_t *mClip;
 
     uint8_t *initClip();
 
-    status_t convertCbYCrY(
-            const BitmapParams &src, const BitmapParams &dst);
-
-    status_t convertYUV420Planar(
-            const BitmapParams &src, const BitmapParams &dst);
-
-    status_t convertQCOMYUV420SemiPlanar(
-            const BitmapParams &src, const BitmapParams &dst);
-
-    status_t convertYUV420SemiPlanar(
-            const BitmapParams &src, const BitmapParams &dst);
+    void convertRows(
+            const BitmapParams &src, const BitmapParams &dst,
+            size_t rowStart, size_t rowEnd);
 
-    status_t convertTIYUV420PackedSemiPlanar(
-            const BitmapParams &src, const BitmapParams &dst);
+    static void *ThreadWrapper(void *me);
 
     ColorConverter(const ColorConverter &);
     ColorConverter &operator=(const ColorConverter &);
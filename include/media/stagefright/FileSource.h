@@ -22,7 +22,9 @@
 
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaErrors.h>
+#include <utils/KeyedVector.h>
 #include <utils/threads.h>
+#include <utils/Vector.h>
 #include <drm/DrmManagerClient.h>
 
 namespace android {
@@ -47,6 +49,27 @@ public:
 
     virtual void getDrmInfo(sp<DecryptHandle> &handle, DrmManagerClient **client);
 
+    enum {
+        kDefaultCacheBlockSize = 16 * 1024,
+    };
+
+    // Serve reads from up to cacheSize bytes of file blocks of blockSize
+    // bytes, aligned to the start of the file, instead of issuing one
+    // system call per readAt(). Sequential reads fetch the following
+    // blocks ahead with a single pread(); reads of whole blocks bypass the
+    // cache. A cacheSize of 0, the default, reads the file directly.
+    status_t setBlockCache(
+            size_t cacheSize, size_t blockSize = kDefaultCacheBlockSize);
+
+    struct Stats {
+        int64_t mNumReads;      // readAt() calls
+        int64_t mNumSyscalls;   // pread() calls on the file
+        int64_t mBytesRead;     // bytes returned by pread()
+        int64_t mNumCacheHits;  // blocks found in the block cache
+    };
+
+    void getStats(Stats *stats);
+
 protected:
     virtual ~FileSource();
 
@@ -64,7 +87,25 @@ private:
     size_t mDrmBufSize;
     unsigned char *mDrmBuf;
 
+    // Block cache, see setBlockCache(). Blocks are fetched into a ring of
+    // slots so that a readahead of several blocks is a single pread().
+    uint8_t *mCache;
+    size_t mCacheBlockSize;
+    size_t mCacheNumBlocks;
+    size_t mCacheNextSlot;
+    Vector<int64_t> mCacheSlotBlock;    // block held by each slot, -1 if none
+    Vector<size_t> mCacheSlotSize;      // valid bytes in each slot
+    KeyedVector<int64_t, size_t> mCacheIndex;  // block -> slot
+    off64_t mLastReadEnd;
+    size_t mReadaheadBlocks;
+
+    Stats mStats;
+
     ssize_t readAtDRM(off64_t offset, void *data, size_t size);
+    ssize_t readAtCached_l(off64_t offset, void *data, size_t size);
+    ssize_t fetchBlocks_l(int64_t block, size_t count);
+    ssize_t readFile_l(off64_t offset, void *data, size_t size);
+    void freeBlockCache_l();
     void fetchUriFromFd(int fd);
 
     FileSource(const FileSource &);
@@ -19,6 +19,7 @@
 #define MPEG4_WRITER_H_
 
 #include <stdio.h>
+#include <sys/uio.h>
 
 #include <media/stagefright/MediaWriter.h>
 #include <utils/List.h>
@@ -181,6 +182,24 @@ private:
     void lock();
     void unlock();
 
+    // Batched file output. Small writes are coalesced in mWriteBuffer and
+    // handed to the kernel together with the next large write, at chunk
+    // boundaries, or before seeking, so a sample and its length prefix
+    // cost at most one syscall.
+    enum {
+        kDefaultWriteBufferSize = 256 * 1024,
+        kMaxWriteIoVecs = 2,
+    };
+    uint8_t *mWriteBuffer;
+    size_t mWriteBufferSize;
+    size_t mWriteBufferOffset;
+    int64_t mNumWriteSyscalls;
+    int64_t mNumBytesWritten;
+
+    void writeToFile(const struct iovec *iov, int iovcnt);
+    void flushWriteBuffer();
+    void seekFile(off64_t offset);
+
     // Acquire lock before calling these methods
     off64_t addSample_l(MediaBuffer *buffer);
     off64_t addLengthPrefixedSample_l(MediaBuffer *buffer);
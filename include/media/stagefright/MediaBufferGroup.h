@@ -20,6 +20,8 @@
 
 #include <media/stagefright/MediaBuffer.h>
 #include <utils/Errors.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
 #include <utils/threads.h>
 
 namespace android {
@@ -41,16 +43,44 @@ public:
     // buffer is set to NULL and it returns WOULD_BLOCK.
     status_t acquire_buffer(MediaBuffer **buffer, bool nonBlocking = false);
 
+    // As above, but if requestedSize is non-zero the smallest free buffer
+    // of at least that size is returned. If none is large enough, the
+    // largest free buffer is replaced by a new one of requestedSize rounded
+    // up to a multiple of 4 KB. A group can thus serve mixed sample sizes
+    // without sizing every buffer for the largest one.
+    status_t acquire_buffer(
+            MediaBuffer **buffer, bool nonBlocking, size_t requestedSize);
+
+    // Prints the buffer counts and the acquire statistics.
+    status_t dump(int fd, const Vector<String16>& args) const;
+
 protected:
     virtual void signalBufferReturned(MediaBuffer *buffer);
 
 private:
     friend class MediaBuffer;
 
-    Mutex mLock;
+    mutable Mutex mLock;
     Condition mCondition;
 
-    MediaBuffer *mFirstBuffer, *mLastBuffer;
+    // All buffers owned by the group, and the subset with a refcount of 0
+    // used as a stack so that acquire and return are O(1). mFreeBuffers has
+    // a slot per buffer and only its first mNumFree entries are valid, so
+    // acquire and return never reallocate it.
+    Vector<MediaBuffer *> mBuffers;
+    Vector<MediaBuffer *> mFreeBuffers;
+    size_t mNumFree;
+
+    // Acquire statistics, reported by dump().
+    int64_t mNumAcquired;
+    int64_t mNumWaits;
+    int64_t mNumReallocs;
+    int64_t mTotalWaitUs;
+    int64_t mMaxWaitUs;
+    size_t mHighWaterMark;
+
+    size_t findFreeBuffer_l(size_t requestedSize) const;
+    MediaBuffer *reallocBuffer_l(MediaBuffer *buffer, size_t size);
 
     MediaBufferGroup(const MediaBufferGroup &);
     MediaBufferGroup &operator=(const MediaBufferGroup &);
@@ -20,25 +20,94 @@
 
 #include <media/mediascanner.h>
 
+#include <pthread.h>
+
+#include <utils/KeyedVector.h>
+#include <utils/List.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
 namespace android {
 
 struct StagefrightMediaScanner : public MediaScanner {
     StagefrightMediaScanner();
     virtual ~StagefrightMediaScanner();
 
+    // Loads the scan results persisted at "path" and saves them back there
+    // after every processDirectory(), so that files whose modification time
+    // and size are unchanged are not parsed again on the next scan. The
+    // media.stagefright.scan-index property sets the path used by default.
+    status_t setIndexPath(const char *path);
+
+    virtual MediaScanResult processDirectory(
+            const char *path, MediaScannerClient &client);
+
     virtual MediaScanResult processFile(
             const char *path, const char *mimeType,
             MediaScannerClient &client);
 
     virtual MediaAlbumArt *extractAlbumArt(int fd);
 
+protected:
+    virtual void prefetchFile(
+            const char *path, long long lastModified, long long fileSize);
+
 private:
+    enum {
+        kMaxScanThreads = 4,
+    };
+
+    // The metadata of one file, as reported to the client.
+    struct ScanEntry {
+        enum State {
+            NEW,        // not parsed, only the fingerprint is known
+            QUEUED,     // waiting for a scan thread
+            PARSING,    // being parsed, wait for mEntryParsed
+            DONE,
+        };
+
+        State mState;
+        bool mSeen;     // visited by the current processDirectory()
+        long long mLastModified;
+        long long mFileSize;
+        MediaScanResult mResult;
+        String8 mMimeType;
+        Vector<String8> mTags;  // name, value, name, value, ...
+    };
+
+    Mutex mLock;
+    Condition mQueueChanged;
+    Condition mEntryParsed;
+
+    KeyedVector<String8, ScanEntry *> mIndex;
+    List<String8> mQueue;
+    String8 mIndexPath;
+    bool mIndexDirty;
+
+    pthread_t mThreads[kMaxScanThreads];
+    size_t mNumThreads;
+    bool mDone;
+
+    size_t mNumParsed;
+    size_t mNumIndexHits;
+
     StagefrightMediaScanner(const StagefrightMediaScanner &);
     StagefrightMediaScanner &operator=(const StagefrightMediaScanner &);
 
     MediaScanResult processFileInternal(
             const char *path, const char *mimeType,
             MediaScannerClient &client);
+
+    ScanEntry *findEntry_l(
+            const char *path, long long lastModified, long long fileSize, bool *changed);
+    void startThreads_l();
+    void clearIndex_l();
+    status_t loadIndex_l();
+    status_t saveIndex_l();
+
+    static void *ThreadWrapper(void *me);
+    void threadFunc();
 };
 
 }  // namespace android
@@ -24,6 +24,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/List.h>
 #include <utils/RefBase.h>
+#include <utils/Vector.h>
 #include <utils/threads.h>
 
 namespace android {
@@ -59,9 +60,14 @@ protected:
 private:
     friend struct ALooperRoster;
 
+    // Events are kept in a binary min-heap ordered by (mWhenUs, mSeq), so
+    // posting is O(log n) and events due at the same time are delivered in
+    // the order they were posted. mMessage holds a strong reference that is
+    // managed by hand so that sifting the heap doesn't touch refcounts.
     struct Event {
         int64_t mWhenUs;
-        sp<AMessage> mMessage;
+        uint64_t mSeq;
+        AMessage *mMessage;
     };
 
     Mutex mLock;
@@ -69,7 +75,12 @@ private:
 
     AString mName;
 
-    List<Event> mEventQueue;
+    // The heap is the first mNumEvents entries of mEventQueue. Slots past
+    // the end are kept rather than removed, so the Vector never shrinks and
+    // only reallocates when the queue grows past its largest size so far.
+    Vector<Event> mEventQueue;
+    size_t mNumEvents;
+    uint64_t mNextEventSeq;
 
     struct LooperThread;
     sp<LooperThread> mThread;
@@ -78,6 +89,10 @@ private:
     void post(const sp<AMessage> &msg, int64_t delayUs);
     bool loop();
 
+    static bool EventBefore(const Event &a, const Event &b);
+    void pushEvent_l(const Event &event);
+    void popEvent_l(Event *event);
+
     DISALLOW_EVIL_CONSTRUCTORS(ALooper);
 };
 
@@ -20,6 +20,7 @@
 
 #include <media/stagefright/foundation/ALooper.h>
 #include <utils/KeyedVector.h>
+#include <utils/RWLock.h>
 
 namespace android {
 
@@ -48,14 +49,21 @@ private:
         wp<AHandler> mHandler;
     };
 
-    Mutex mLock;
+    // Guards mHandlers and mNextHandlerID. Message delivery and posting
+    // only take it for reading, so loopers don't serialize on each other.
+    RWLock mHandlersLock;
     KeyedVector<ALooper::handler_id, HandlerInfo> mHandlers;
     ALooper::handler_id mNextHandlerID;
+
+    // Guards the reply bookkeeping below.
+    Mutex mLock;
     uint32_t mNextReplyID;
     Condition mRepliesCondition;
 
     KeyedVector<uint32_t, sp<AMessage> > mReplies;
 
+    void removeStaleHandler(ALooper::handler_id handlerID);
+
     DISALLOW_EVIL_CONSTRUCTORS(ALooperRoster);
 };
 
@@ -136,10 +136,15 @@ private:
             AString *stringValue;
             Rect rectValue;
         } u;
-        const char *mName;
+        enum {
+            kMaxInlineNameLength = 15
+        };
+        const char *mName;          // mNameInline or a heap copy
         size_t      mNameLength;
         Type mType;
+        char        mNameInline[kMaxInlineNameLength + 1];
         void setName(const char *name, size_t len);
+        void freeName();
     };
 
     enum {
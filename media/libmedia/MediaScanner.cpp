@@ -20,14 +20,26 @@
 #include <utils/Log.h>
 
 #include <media/mediascanner.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
 
 #include <sys/stat.h>
 #include <dirent.h>
 
 namespace android {
 
+// How many files ahead of the one being reported are handed to prefetchFile().
+static const size_t kPrefetchWindow = 32;
+
+struct MediaScanner::DirectoryEntry {
+    String8 mName;
+    int mType;
+    long long mLastModified;
+    long long mFileSize;
+};
+
 MediaScanner::MediaScanner()
-    : mLocale(NULL), mSkipList(NULL), mSkipIndex(NULL) {
+    : mLocale(NULL), mSkipList(NULL), mSkipIndex(NULL), mNumFilesScanned(0) {
     loadSkipList();
 }
 
@@ -99,8 +111,15 @@ MediaScanResult MediaScanner::processDirectory(
 
     client.setLocale(locale());
 
+    mNumFilesScanned = 0;
+    nsecs_t startTime = systemTime();
+
     MediaScanResult result = doProcessDirectory(pathBuffer, pathRemaining, client, false);
 
+    double secs = (systemTime() - startTime) / 1E9;
+    ALOGI("Scanned %zu files in '%s' in %.2f secs (%.1f files/s)",
+            mNumFilesScanned, path, secs, secs > 0 ? mNumFilesScanned / secs : 0.0);
+
     free(pathBuffer);
 
     return result;
@@ -157,52 +176,84 @@ MediaScanResult MediaScanner::doProcessDirectory(
         return MEDIA_SCAN_RESULT_SKIPPED;
     }
 
-    MediaScanResult result = MEDIA_SCAN_RESULT_OK;
+    // Read the whole directory first, so that the files can be handed to
+    // prefetchFile() ahead of the client asking for them.
+    Vector<DirectoryEntry> entries;
     while ((entry = readdir(dir))) {
-        if (doProcessDirectoryEntry(path, pathRemaining, client, noMedia, entry, fileSpot)
+        const char* name = entry->d_name;
+
+        // ignore "." and ".."
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+            continue;
+        }
+
+        int nameLength = strlen(name);
+        if (nameLength + 1 > pathRemaining) {
+            // path too long!
+            continue;
+        }
+        strcpy(fileSpot, name);
+
+        DirectoryEntry dirEntry;
+        dirEntry.mName.setTo(name);
+        dirEntry.mType = entry->d_type;
+        dirEntry.mLastModified = 0;
+        dirEntry.mFileSize = 0;
+
+        struct stat statbuf;
+        if (dirEntry.mType == DT_UNKNOWN || dirEntry.mType == DT_REG) {
+            // If the type is unknown, stat() the file instead.
+            // This is sometimes necessary when accessing NFS mounted filesystems, but
+            // could be needed in other cases well.
+            if (stat(path, &statbuf) == 0) {
+                if (S_ISREG(statbuf.st_mode)) {
+                    dirEntry.mType = DT_REG;
+                    dirEntry.mLastModified = statbuf.st_mtime;
+                    dirEntry.mFileSize = statbuf.st_size;
+                } else if (S_ISDIR(statbuf.st_mode)) {
+                    dirEntry.mType = DT_DIR;
+                }
+            } else {
+                ALOGD("stat() failed for %s: %s", path, strerror(errno) );
+            }
+        }
+        entries.push(dirEntry);
+    }
+    closedir(dir);
+    fileSpot[0] = 0;
+
+    MediaScanResult result = MEDIA_SCAN_RESULT_OK;
+    size_t numPrefetched = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        // The client does not ask for the metadata of files in .nomedia directories.
+        for (; !noMedia && numPrefetched < entries.size()
+                && numPrefetched < i + kPrefetchWindow; ++numPrefetched) {
+            const DirectoryEntry &next = entries[numPrefetched];
+            if (next.mType == DT_REG) {
+                strcpy(fileSpot, next.mName.string());
+                prefetchFile(path, next.mLastModified, next.mFileSize);
+            }
+        }
+
+        if (doProcessDirectoryEntry(path, pathRemaining, client, noMedia, entries[i], fileSpot)
                 == MEDIA_SCAN_RESULT_ERROR) {
             result = MEDIA_SCAN_RESULT_ERROR;
             break;
         }
     }
-    closedir(dir);
     return result;
 }
 
 MediaScanResult MediaScanner::doProcessDirectoryEntry(
         char *path, int pathRemaining, MediaScannerClient &client, bool noMedia,
-        struct dirent* entry, char* fileSpot) {
+        const DirectoryEntry &entry, char* fileSpot) {
     struct stat statbuf;
-    const char* name = entry->d_name;
-
-    // ignore "." and ".."
-    if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
-        return MEDIA_SCAN_RESULT_SKIPPED;
-    }
+    const char* name = entry.mName.string();
+    int nameLength = entry.mName.length();
 
-    int nameLength = strlen(name);
-    if (nameLength + 1 > pathRemaining) {
-        // path too long!
-        return MEDIA_SCAN_RESULT_SKIPPED;
-    }
     strcpy(fileSpot, name);
 
-    int type = entry->d_type;
-    if (type == DT_UNKNOWN) {
-        // If the type is unknown, stat() the file instead.
-        // This is sometimes necessary when accessing NFS mounted filesystems, but
-        // could be needed in other cases well.
-        if (stat(path, &statbuf) == 0) {
-            if (S_ISREG(statbuf.st_mode)) {
-                type = DT_REG;
-            } else if (S_ISDIR(statbuf.st_mode)) {
-                type = DT_DIR;
-            }
-        } else {
-            ALOGD("stat() failed for %s: %s", path, strerror(errno) );
-        }
-    }
-    if (type == DT_DIR) {
+    if (entry.mType == DT_DIR) {
         bool childNoMedia = noMedia;
         // set noMedia flag on directories with a name that starts with '.'
         // for example, the Mac ".Trashes" directory
@@ -225,9 +276,9 @@ MediaScanResult MediaScanner::doProcessDirectoryEntry(
         if (result == MEDIA_SCAN_RESULT_ERROR) {
             return MEDIA_SCAN_RESULT_ERROR;
         }
-    } else if (type == DT_REG) {
-        stat(path, &statbuf);
-        status_t status = client.scanFile(path, statbuf.st_mtime, statbuf.st_size,
+    } else if (entry.mType == DT_REG) {
+        ++mNumFilesScanned;
+        status_t status = client.scanFile(path, entry.mLastModified, entry.mFileSize,
                 false /*isDirectory*/, noMedia);
         if (status) {
             return MEDIA_SCAN_RESULT_ERROR;
@@ -17,11 +17,13 @@
 #define LOG_TAG "NBLog"
 //#define LOG_NDEBUG 0
 
+#include <ctype.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <sys/types.h>
 #include <new>
 #include <cutils/atomic.h>
 #include <media/nbaio/NBLog.h>
@@ -47,6 +49,141 @@ int NBLog::Entry::readAt(size_t offset) const
 
 // ---------------------------------------------------------------------------
 
+// Argument classes of the printf conversions supported by the binary EVENT_FORMAT entries
+enum ArgType {
+    ARG_NONE,           // "%%", consumes no argument
+    ARG_CHAR,
+    ARG_SHORT,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_STRING,
+    ARG_POINTER,
+    ARG_INVALID,        // unsupported or malformed; stops encoding and decoding
+};
+
+struct Conversion {
+    ArgType type;
+    size_t  length;         // length of the whole conversion, including '%'
+    size_t  prefixLength;   // length of '%', flags, width and precision
+    char    specifier;      // conversion character, e.g. 'd'
+};
+
+// Largest width or precision accepted; the format of a dumped entry comes from
+// shared memory, so a larger one is treated as malformed rather than padded.
+static const size_t kMaxFieldWidth = 64;
+
+// Parses the decimal number at fmt[*i], advancing *i past it.
+// Returns false if the number is larger than kMaxFieldWidth.
+static bool parseFieldWidth(const char *fmt, size_t *i)
+{
+    size_t width = 0;
+    while (isdigit(fmt[*i])) {
+        if (width <= kMaxFieldWidth) {
+            width = width * 10 + (fmt[*i] - '0');
+        }
+        ++*i;
+    }
+    return width <= kMaxFieldWidth;
+}
+
+// Parses the conversion that starts with the '%' at fmt[0].
+static Conversion parseConversion(const char *fmt)
+{
+    Conversion c;
+    c.type = ARG_INVALID;
+    c.specifier = '\0';
+    size_t i = 1;
+    if (fmt[i] == '%') {
+        c.type = ARG_NONE;
+        c.length = c.prefixLength = 2;
+        c.specifier = '%';
+        return c;
+    }
+    while (fmt[i] != '\0' && strchr("-+ #0", fmt[i]) != NULL) {
+        ++i;
+    }
+    bool fieldsValid = parseFieldWidth(fmt, &i);
+    if (fmt[i] == '.') {
+        ++i;
+        fieldsValid = parseFieldWidth(fmt, &i) && fieldsValid;
+    }
+    c.prefixLength = i;
+    ArgType integer = ARG_INT;
+    bool longDouble = false;
+    switch (fmt[i]) {
+    case 'h':
+        ++i;
+        integer = ARG_SHORT;
+        if (fmt[i] == 'h') {
+            ++i;
+            integer = ARG_CHAR;
+        }
+        break;
+    case 'l':
+        ++i;
+        integer = ARG_LONG;
+        if (fmt[i] == 'l') {
+            ++i;
+            integer = ARG_LONG_LONG;
+        }
+        break;
+    case 'j':
+    case 'q':
+        ++i;
+        integer = ARG_LONG_LONG;
+        break;
+    case 'z':
+        ++i;
+        integer = ARG_SIZE;
+        break;
+    case 't':
+        ++i;
+        integer = ARG_PTRDIFF;
+        break;
+    case 'L':
+        ++i;
+        longDouble = true;
+        break;
+    default:
+        break;
+    }
+    c.specifier = fmt[i];
+    c.length = i + 1;
+    switch (c.specifier) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        c.type = integer;
+        break;
+    case 'c':
+        c.type = i == c.prefixLength ? ARG_INT : ARG_INVALID;    // no wide characters
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        c.type = longDouble ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+        break;
+    case 's':
+        c.type = i == c.prefixLength ? ARG_STRING : ARG_INVALID;  // no wide strings
+        break;
+    case 'p':
+        c.type = ARG_POINTER;
+        break;
+    default:
+        // includes '*' width or precision, '%n' and the end of the string
+        c.type = ARG_INVALID;
+        c.length = i;
+        break;
+    }
+    if (!fieldsValid) {
+        c.type = ARG_INVALID;
+    }
+    return c;
+}
+
+// ---------------------------------------------------------------------------
+
 #if 0   // FIXME see note in NBLog.h
 NBLog::Timeline::Timeline(size_t size, void *shared)
     : mSize(roundup(size)), mOwn(shared == NULL),
@@ -147,6 +284,115 @@ void NBLog::Writer::logTimestamp(const struct timespec& ts)
     log(EVENT_TIMESTAMP, &ts, sizeof(struct timespec));
 }
 
+void NBLog::Writer::logFormat(const char *fmt, ...)
+{
+    if (!mEnabled) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    Writer::logvFormat(fmt, ap);    // the Writer:: is needed to avoid virtual dispatch
+    va_end(ap);
+}
+
+void NBLog::Writer::logvFormat(const char *fmt, va_list ap)
+{
+    if (!mEnabled) {
+        return;
+    }
+    uint8_t buffer[255];
+    const size_t kHeaderSize = sizeof(struct timespec) + 1;
+    size_t fmtLength = strlen(fmt);
+    if (fmtLength > sizeof(buffer) - kHeaderSize || strchr(fmt, '*') != NULL) {
+        // can't be represented in binary, so take the formatting hit
+        Writer::logvf(fmt, ap);
+        return;
+    }
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        memset(&ts, 0, sizeof(ts));
+    }
+    memcpy(buffer, &ts, sizeof(ts));
+    buffer[sizeof(ts)] = fmtLength;
+    memcpy(&buffer[kHeaderSize], fmt, fmtLength);
+    size_t length = kHeaderSize + fmtLength;
+
+    for (const char *p = strchr(fmt, '%'); p != NULL; ) {
+        const Conversion c = parseConversion(p);
+        // unsigned values are zero-extended so that the reader's "ll" conversion matches
+        const bool isUnsigned = strchr("ouxX", c.specifier) != NULL;
+        int64_t integer = 0;
+        double real = 0;
+        switch (c.type) {
+        case ARG_NONE:
+            p = strchr(p + c.length, '%');
+            continue;
+        case ARG_CHAR:
+            integer = isUnsigned ? (int64_t) (unsigned char) va_arg(ap, int)
+                    : (int64_t) (signed char) va_arg(ap, int);
+            break;
+        case ARG_SHORT:
+            integer = isUnsigned ? (int64_t) (unsigned short) va_arg(ap, int)
+                    : (int64_t) (short) va_arg(ap, int);
+            break;
+        case ARG_INT:
+            integer = isUnsigned ? (int64_t) va_arg(ap, unsigned) : va_arg(ap, int);
+            break;
+        case ARG_LONG:
+            integer = isUnsigned ? (int64_t) va_arg(ap, unsigned long) : va_arg(ap, long);
+            break;
+        case ARG_LONG_LONG:
+            integer = va_arg(ap, long long);
+            break;
+        case ARG_SIZE:
+            integer = isUnsigned ? (int64_t) va_arg(ap, size_t) : va_arg(ap, ssize_t);
+            break;
+        case ARG_PTRDIFF:
+            integer = va_arg(ap, ptrdiff_t);
+            break;
+        case ARG_POINTER:
+            integer = (uintptr_t) va_arg(ap, void *);
+            break;
+        case ARG_DOUBLE:
+            real = va_arg(ap, double);
+            break;
+        case ARG_LONG_DOUBLE:
+            real = va_arg(ap, long double);
+            break;
+        case ARG_STRING: {
+            const char *string = va_arg(ap, const char *);
+            if (string == NULL) {
+                string = "(null)";
+            }
+            if (length >= sizeof(buffer)) {
+                goto done;
+            }
+            size_t stringLength = strnlen(string, sizeof(buffer) - length - 1);
+            buffer[length++] = stringLength;
+            memcpy(&buffer[length], string, stringLength);
+            length += stringLength;
+            p = strchr(p + c.length, '%');
+            continue;
+            }
+        case ARG_INVALID:
+        default:
+            goto done;
+        }
+        if (length + sizeof(int64_t) > sizeof(buffer)) {
+            goto done;
+        }
+        if (c.type == ARG_DOUBLE || c.type == ARG_LONG_DOUBLE) {
+            memcpy(&buffer[length], &real, sizeof(real));
+        } else {
+            memcpy(&buffer[length], &integer, sizeof(integer));
+        }
+        length += sizeof(int64_t);
+        p = strchr(p + c.length, '%');
+    }
+done:
+    log(EVENT_FORMAT, buffer, length);
+}
+
 void NBLog::Writer::log(Event event, const void *data, size_t length)
 {
     if (!mEnabled) {
@@ -158,6 +404,7 @@ void NBLog::Writer::log(Event event, const void *data, size_t length)
     switch (event) {
     case EVENT_STRING:
     case EVENT_TIMESTAMP:
+    case EVENT_FORMAT:
         break;
     case EVENT_RESERVED:
     default:
@@ -176,26 +423,27 @@ void NBLog::Writer::log(const NBLog::Entry *entry, bool trusted)
         log(entry->mEvent, entry->mData, entry->mLength);
         return;
     }
-    size_t rear = mRear & (mSize - 1);
-    size_t written = mSize - rear;      // written = number of bytes that have been written so far
-    size_t need = entry->mLength + 3;   // mEvent, mLength, data[length], mLength
-                                        // need = number of bytes remaining to write
-    if (written > need) {
-        written = need;
-    }
-    size_t i;
-    // FIXME optimize this using memcpy for the data part of the Entry.
-    // The Entry could have a method copyTo(ptr, offset, size) to optimize the copy.
-    for (i = 0; i < written; ++i) {
-        mShared->mBuffer[rear + i] = entry->readAt(i);
-    }
-    if (rear + written == mSize && (need -= written) > 0)  {
-        for (i = 0; i < need; ++i) {
-            mShared->mBuffer[i] = entry->readAt(written + i);
-        }
-        written += need;
+    const uint8_t header[2] = { (uint8_t) entry->mEvent, (uint8_t) entry->mLength };
+    size_t rear = mRear;
+    rear = copyToShared(rear, header, sizeof(header));
+    rear = copyToShared(rear, entry->mData, entry->mLength);
+    rear = copyToShared(rear, &header[1], 1);  // duplicate copy of mLength
+    android_atomic_release_store(mRear = rear, &mShared->mRear);
+}
+
+size_t NBLog::Writer::copyToShared(size_t rear, const void *data, size_t length)
+{
+    size_t offset = rear & (mSize - 1);
+    size_t first = mSize - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&mShared->mBuffer[offset], data, first);
+    if (length > first) {
+        // wrap around to the start of the circular buffer
+        memcpy(mShared->mBuffer, (const uint8_t *) data + first, length - first);
     }
-    android_atomic_release_store(mRear += written, &mShared->mRear);
+    return rear + length;
 }
 
 bool NBLog::Writer::isEnabled() const
@@ -258,6 +506,21 @@ void NBLog::LockedWriter::logTimestamp(const struct timespec& ts)
     Writer::logTimestamp(ts);
 }
 
+void NBLog::LockedWriter::logFormat(const char *fmt, ...)
+{
+    Mutex::Autolock _l(mLock);
+    va_list ap;
+    va_start(ap, fmt);
+    Writer::logvFormat(fmt, ap);
+    va_end(ap);
+}
+
+void NBLog::LockedWriter::logvFormat(const char *fmt, va_list ap)
+{
+    Mutex::Autolock _l(mLock);
+    Writer::logvFormat(fmt, ap);
+}
+
 bool NBLog::LockedWriter::isEnabled() const
 {
     Mutex::Autolock _l(mLock);
@@ -326,8 +589,9 @@ void NBLog::Reader::dump(int fd, size_t indent)
             break;
         }
         event = (Event) copy[i - length - 3];
-        if (event == EVENT_TIMESTAMP) {
-            if (length != sizeof(struct timespec)) {
+        if (event == EVENT_TIMESTAMP || event == EVENT_FORMAT) {
+            if (event == EVENT_TIMESTAMP ? length != sizeof(struct timespec)
+                    : length < sizeof(struct timespec) + 1) {
                 // corrupt
                 break;
             }
@@ -416,6 +680,19 @@ void NBLog::Reader::dump(int fd, size_t indent)
                     (int) (ts.tv_nsec / 1000000));
             deferredTimestamp = true;
             } break;
+        case EVENT_FORMAT:
+            if (deferredTimestamp) {
+                dumpLine(timestamp, body);
+                deferredTimestamp = false;
+            }
+            if (!formatEntry((const uint8_t *) data, length, &ts, body)) {
+                body.appendFormat("warning: malformed format event");
+                break;
+            }
+            timestamp.clear();
+            timestamp.appendFormat("[%d.%03d]", (int) ts.tv_sec,
+                    (int) (ts.tv_nsec / 1000000));
+            break;
         case EVENT_RESERVED:
         default:
             body.appendFormat("warning: unknown event %d", event);
@@ -445,6 +722,92 @@ void NBLog::Reader::dumpLine(const String8& timestamp, String8& body)
     body.clear();
 }
 
+/*static*/
+bool NBLog::Reader::formatEntry(const uint8_t *data, size_t length, struct timespec *ts,
+        String8& body)
+{
+    const size_t kHeaderSize = sizeof(struct timespec) + 1;
+    if (length < kHeaderSize || length < kHeaderSize + data[sizeof(struct timespec)]) {
+        return false;
+    }
+    memcpy(ts, data, sizeof(struct timespec));
+    const char *fmt = (const char *) &data[kHeaderSize];
+    const size_t fmtLength = data[sizeof(struct timespec)];
+    const uint8_t *arg = &data[kHeaderSize + fmtLength];
+    const uint8_t *end = &data[length];
+
+    // fmt is not NUL-terminated in the entry, and conversions are formatted one at a time
+    char format[256];
+    memcpy(format, fmt, fmtLength);
+    format[fmtLength] = '\0';
+    size_t i = 0;
+    while (i < fmtLength) {
+        const char *percent = strchr(&format[i], '%');
+        if (percent == NULL) {
+            body.append(&format[i]);
+            break;
+        }
+        body.append(&format[i], percent - &format[i]);
+        i = percent - format;
+        const Conversion c = parseConversion(percent);
+        if (c.type == ARG_NONE) {
+            body.append("%");
+            i += c.length;
+            continue;
+        }
+        size_t need = c.type == ARG_STRING ? 1 : sizeof(int64_t);
+        if (c.type == ARG_INVALID || (size_t) (end - arg) < need
+                || (c.type == ARG_STRING && (size_t) (end - arg) < 1u + arg[0])) {
+            // the value was not recorded, so dump the rest of the format as is
+            body.append(&format[i]);
+            break;
+        }
+        // rebuild the conversion with the length modifier of the recorded value
+        String8 spec(percent, c.prefixLength);
+        switch (c.type) {
+        case ARG_STRING: {
+            char string[256];
+            memcpy(string, &arg[1], arg[0]);
+            string[arg[0]] = '\0';
+            arg += 1 + arg[0];
+            spec.append("s");
+            body.appendFormat(spec.string(), string);
+            } break;
+        case ARG_DOUBLE:
+        case ARG_LONG_DOUBLE: {
+            double real;
+            memcpy(&real, arg, sizeof(real));
+            arg += sizeof(real);
+            spec.append(&c.specifier, 1);
+            body.appendFormat(spec.string(), real);
+            } break;
+        case ARG_POINTER: {
+            int64_t integer;
+            memcpy(&integer, arg, sizeof(integer));
+            arg += sizeof(integer);
+            spec.append("llx");
+            body.append("0x");
+            body.appendFormat(spec.string(), (unsigned long long) integer);
+            } break;
+        default: {
+            int64_t integer;
+            memcpy(&integer, arg, sizeof(integer));
+            arg += sizeof(integer);
+            if (c.specifier == 'c') {
+                spec.append("c");
+                body.appendFormat(spec.string(), (int) integer);
+            } else {
+                spec.append("ll");
+                spec.append(&c.specifier, 1);
+                body.appendFormat(spec.string(), (long long) integer);
+            }
+            } break;
+        }
+        i += c.length;
+    }
+    return true;
+}
+
 bool NBLog::Reader::isIMemory(const sp<IMemory>& iMemory) const
 {
     return iMemory != 0 && mIMemory != 0 && iMemory->pointer() == mIMemory->pointer();
@@ -3548,7 +3548,14 @@ bool AwesomePlayer::isWidevineContent() const {
 }
 
 status_t AwesomePlayer::dump(
-        int fd, const Vector<String16> & /* args */) const {
+        int fd, const Vector<String16> &args) const {
+    // mLock may be held for a long time while preparing, don't wait for it
+    sp<NuCachedSource2> cachedSource;
+    if (mLock.tryLock() == OK) {
+        cachedSource = mCachedSource;
+        mLock.unlock();
+    }
+
     Mutex::Autolock autoLock(mStatsLock);
 
     FILE *out = fdopen(dup(fd), "w");
@@ -3615,6 +3622,10 @@ status_t AwesomePlayer::dump(
     fclose(out);
     out = NULL;
 
+    if (cachedSource != NULL) {
+        cachedSource->dump(fd, args);
+    }
+
     return OK;
 }
 
@@ -33,7 +33,15 @@ FileSource::FileSource(const char *filename)
       mDrmManagerClient(NULL),
       mDrmBufOffset(0),
       mDrmBufSize(0),
-      mDrmBuf(NULL){
+      mDrmBuf(NULL),
+      mCache(NULL),
+      mCacheBlockSize(0),
+      mCacheNumBlocks(0),
+      mCacheNextSlot(0),
+      mLastReadEnd(-1),
+      mReadaheadBlocks(1) {
+    memset(&mStats, 0, sizeof(mStats));
+
 
     mFd = open(filename, O_LARGEFILE | O_RDONLY);
 
@@ -52,7 +60,15 @@ FileSource::FileSource(int fd, int64_t offset, int64_t length)
       mDrmManagerClient(NULL),
       mDrmBufOffset(0),
       mDrmBufSize(0),
-      mDrmBuf(NULL){
+      mDrmBuf(NULL),
+      mCache(NULL),
+      mCacheBlockSize(0),
+      mCacheNumBlocks(0),
+      mCacheNextSlot(0),
+      mLastReadEnd(-1),
+      mReadaheadBlocks(1) {
+    memset(&mStats, 0, sizeof(mStats));
+
     CHECK(offset >= 0);
     CHECK(length >= 0);
     fetchUriFromFd(fd);
@@ -69,6 +85,8 @@ FileSource::~FileSource() {
         mDrmBuf = NULL;
     }
 
+    freeBlockCache_l();
+
     if (mDecryptHandle != NULL) {
         // To release mDecryptHandle
         CHECK(mDrmManagerClient);
@@ -93,6 +111,8 @@ ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
 
     Mutex::Autolock autoLock(mLock);
 
+    ++mStats.mNumReads;
+
     if (mLength >= 0) {
         if (offset >= mLength) {
             return 0;  // read beyond EOF.
@@ -106,15 +126,202 @@ ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
     if (mDecryptHandle != NULL && DecryptApiType::CONTAINER_BASED
             == mDecryptHandle->decryptApiType) {
         return readAtDRM(offset, data, size);
-   } else {
-        off64_t result = lseek64(mFd, offset + mOffset, SEEK_SET);
-        if (result == -1) {
-            ALOGE("seek to %lld failed", offset + mOffset);
-            return UNKNOWN_ERROR;
+    } else if (mCache != NULL) {
+        return readAtCached_l(offset, data, size);
+    } else {
+        return readFile_l(offset + mOffset, data, size);
+    }
+}
+
+status_t FileSource::setBlockCache(size_t cacheSize, size_t blockSize) {
+    Mutex::Autolock autoLock(mLock);
+
+    freeBlockCache_l();
+
+    if (cacheSize == 0) {
+        return OK;
+    }
+
+    if (blockSize == 0 || cacheSize < blockSize) {
+        return BAD_VALUE;
+    }
+
+    size_t numBlocks = cacheSize / blockSize;
+    mCache = new uint8_t[numBlocks * blockSize];
+    if (mCache == NULL) {
+        return NO_MEMORY;
+    }
+
+    mCacheBlockSize = blockSize;
+    mCacheNumBlocks = numBlocks;
+    mCacheNextSlot = 0;
+    mCacheSlotBlock.insertAt(-1, 0, numBlocks);
+    mCacheSlotSize.insertAt(0, 0, numBlocks);
+    mLastReadEnd = -1;
+    mReadaheadBlocks = 1;
+
+    return OK;
+}
+
+void FileSource::getStats(Stats *stats) {
+    Mutex::Autolock autoLock(mLock);
+
+    *stats = mStats;
+}
+
+void FileSource::freeBlockCache_l() {
+    delete[] mCache;
+    mCache = NULL;
+    mCacheBlockSize = 0;
+    mCacheNumBlocks = 0;
+    mCacheSlotBlock.clear();
+    mCacheSlotSize.clear();
+    mCacheIndex.clear();
+}
+
+ssize_t FileSource::readAtCached_l(off64_t offset, void *data, size_t size) {
+    off64_t pos = offset + mOffset;
+
+    // Small forward skips, such as over the samples of another track in an
+    // interleaved file, still count as sequential.
+    bool sequential = mLastReadEnd >= 0 && pos >= mLastReadEnd
+            && pos - mLastReadEnd < (off64_t)mCacheBlockSize;
+    if (!sequential) {
+        mReadaheadBlocks = 1;
+    }
+
+    size_t copied = 0;
+    while (copied < size) {
+        int64_t block = (pos + copied) / mCacheBlockSize;
+        size_t blockOffset = (pos + copied) % mCacheBlockSize;
+        size_t remaining = size - copied;
+
+        ssize_t slot;
+        ssize_t index = mCacheIndex.indexOfKey(block);
+        if (index >= 0) {
+            slot = mCacheIndex.valueAt(index);
+            ++mStats.mNumCacheHits;
+        } else if (blockOffset == 0 && remaining >= mCacheBlockSize) {
+            // Whole blocks gain nothing from the cache, read them directly.
+            size_t n = remaining - remaining % mCacheBlockSize;
+            ssize_t result = readFile_l(pos + copied, (uint8_t *)data + copied, n);
+            if (result < 0) {
+                return copied > 0 ? (ssize_t)copied : result;
+            }
+            copied += result;
+            if ((size_t)result < n) {
+                break;
+            }
+            continue;
+        } else {
+            slot = fetchBlocks_l(block, sequential ? mReadaheadBlocks : 1);
+            if (slot < 0) {
+                return copied > 0 ? (ssize_t)copied : slot;
+            }
+            if (sequential && mReadaheadBlocks < mCacheNumBlocks / 2) {
+                mReadaheadBlocks *= 2;
+            }
         }
 
-        return ::read(mFd, data, size);
+        size_t slotSize = mCacheSlotSize[slot];
+        if (blockOffset >= slotSize) {
+            break;  // end of file
+        }
+        size_t n = slotSize - blockOffset;
+        if (n > remaining) {
+            n = remaining;
+        }
+        memcpy((uint8_t *)data + copied,
+               mCache + slot * mCacheBlockSize + blockOffset, n);
+        copied += n;
+
+        if (slotSize < mCacheBlockSize && copied < size) {
+            break;  // end of file
+        }
+    }
+
+    mLastReadEnd = pos + copied;
+
+    return copied;
+}
+
+// Reads up to count blocks starting at block into consecutive cache slots
+// with a single pread() and returns the slot holding the first one.
+ssize_t FileSource::fetchBlocks_l(int64_t block, size_t count) {
+    if (count > mCacheNumBlocks / 2) {
+        count = mCacheNumBlocks / 2;
     }
+    if (count < 1) {
+        count = 1;
+    }
+
+    // Stop at the end of the source and at blocks that are already cached.
+    if (mLength >= 0) {
+        int64_t numBlocks = (mOffset + mLength + mCacheBlockSize - 1) / mCacheBlockSize;
+        if (block + (int64_t)count > numBlocks) {
+            count = numBlocks > block ? numBlocks - block : 1;
+        }
+    }
+    for (size_t i = 1; i < count; ++i) {
+        if (mCacheIndex.indexOfKey(block + i) >= 0) {
+            count = i;
+            break;
+        }
+    }
+
+    if (mCacheNextSlot + count > mCacheNumBlocks) {
+        mCacheNextSlot = 0;
+    }
+    size_t first = mCacheNextSlot;
+    mCacheNextSlot = (first + count) % mCacheNumBlocks;
+
+    for (size_t i = first; i < first + count; ++i) {
+        if (mCacheSlotBlock[i] >= 0) {
+            mCacheIndex.removeItem(mCacheSlotBlock[i]);
+            mCacheSlotBlock.editItemAt(i) = -1;
+        }
+    }
+
+    ssize_t n = readFile_l(
+            block * mCacheBlockSize, mCache + first * mCacheBlockSize,
+            count * mCacheBlockSize);
+    if (n < 0) {
+        return n;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t slotSize = 0;
+        if ((size_t)n > i * mCacheBlockSize) {
+            slotSize = n - i * mCacheBlockSize;
+            if (slotSize > mCacheBlockSize) {
+                slotSize = mCacheBlockSize;
+            }
+        } else if (i > 0) {
+            break;
+        }
+        mCacheSlotSize.editItemAt(first + i) = slotSize;
+        if (slotSize < mCacheBlockSize) {
+            // A short block at the end of the file only serves this read, so
+            // that data appended to a growing file is seen by later reads.
+            break;
+        }
+        mCacheSlotBlock.editItemAt(first + i) = block + i;
+        mCacheIndex.add(block + i, first + i);
+    }
+
+    return first;
+}
+
+ssize_t FileSource::readFile_l(off64_t offset, void *data, size_t size) {
+    ssize_t n = pread64(mFd, data, size, offset);
+    ++mStats.mNumSyscalls;
+    if (n < 0) {
+        ALOGE("read at %lld failed (%s)", (long long)offset, strerror(errno));
+        return n;
+    }
+    mStats.mBytesRead += n;
+
+    return n;
 }
 
 status_t FileSource::getSize(off64_t *size) {
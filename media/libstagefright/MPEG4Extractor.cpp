@@ -163,6 +163,7 @@ private:
     uint8_t *mSrcBuffer;
 
     size_t parseNALSize(const uint8_t *data) const;
+    bool startCodesGrowSamples() const;
     status_t parseChunk(off64_t *offset);
     status_t parseTrackFragmentHeader(off64_t offset, off64_t size);
     status_t parseTrackFragmentRun(off64_t offset, off64_t size);
@@ -316,6 +317,9 @@ status_t MPEG4DataSource::setCachedRange(off64_t offset, size_t size) {
 
 static const bool kUseHexDump = false;
 
+// Initial size of an MPEG4Source sample buffer, it grows to fit the samples.
+static const size_t kInitialSampleBufferSize = 64 * 1024;
+
 static void hexdump(const void *_data, size_t size) {
     const uint8_t *data = (const uint8_t *)_data;
     size_t offset = 0;
@@ -3393,7 +3397,13 @@ status_t MPEG4Source::start(MetaData *params) {
     int32_t max_size;
     CHECK(mFormat->findInt32(kKeyMaxInputSize, &max_size));
 
-    mGroup->add_buffer(new MediaBuffer(max_size));
+    // The sample buffer starts small and grows to the samples actually read,
+    // max_size is only an estimate for fragmented files.
+    size_t bufferSize = max_size;
+    if (!startCodesGrowSamples() && bufferSize > kInitialSampleBufferSize) {
+        bufferSize = kInitialSampleBufferSize;
+    }
+    mGroup->add_buffer(new MediaBuffer(bufferSize));
 
     mSrcBuffer = new (std::nothrow) uint8_t[max_size];
     if (mSrcBuffer == NULL) {
@@ -3990,6 +4000,13 @@ size_t MPEG4Source::parseNALSize(const uint8_t *data) const {
     return 0;
 }
 
+// Replacing NAL length prefixes shorter than 4 bytes with start codes makes a
+// sample longer than it is in the file, so it needs a buffer of the full
+// kKeyMaxInputSize instead of one that fits the sample.
+bool MPEG4Source::startCodesGrowSamples() const {
+    return (mIsAVC || mIsHEVC) && !mWantsNALFragments && mNALLengthSize < 4;
+}
+
 status_t MPEG4Source::read(
         MediaBuffer **out, const ReadOptions *options) {
     Mutex::Autolock autoLock(mLock);
@@ -4102,7 +4119,8 @@ status_t MPEG4Source::read(
             return err;
         }
 
-        err = mGroup->acquire_buffer(&mBuffer);
+        err = mGroup->acquire_buffer(
+                &mBuffer, false /* nonBlocking */, startCodesGrowSamples() ? 0 : size);
 
         if (err != OK) {
             CHECK(mBuffer == NULL);
@@ -4361,7 +4379,8 @@ status_t MPEG4Source::fragmentedRead(
         mCurrentTime += smpl->duration;
         isSyncSample = (mCurrentSampleIndex == 0); // XXX
 
-        status_t err = mGroup->acquire_buffer(&mBuffer);
+        status_t err = mGroup->acquire_buffer(
+                &mBuffer, false /* nonBlocking */, startCodesGrowSamples() ? 0 : size);
 
         if (err != OK) {
             CHECK(mBuffer == NULL);
@@ -18,12 +18,14 @@
 #define LOG_TAG "MPEG4Writer"
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <pthread.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <utils/Log.h>
@@ -369,7 +371,12 @@ MPEG4Writer::MPEG4Writer(const char *filename)
       mStartTimeOffsetMs(-1),
       mHFRRatio(1),
       mIsVideoHEVC(false),
-      mIsAudioAMR(false) {
+      mIsAudioAMR(false),
+      mWriteBuffer(NULL),
+      mWriteBufferSize(0),
+      mWriteBufferOffset(0),
+      mNumWriteSyscalls(0),
+      mNumBytesWritten(0) {
 
     mFd = open(filename, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
     if (mFd >= 0) {
@@ -397,7 +404,12 @@ MPEG4Writer::MPEG4Writer(int fd)
       mStartTimeOffsetMs(-1),
       mHFRRatio(1),
       mIsVideoHEVC(false),
-      mIsAudioAMR(false) {
+      mIsAudioAMR(false),
+      mWriteBuffer(NULL),
+      mWriteBufferSize(0),
+      mWriteBufferOffset(0),
+      mNumWriteSyscalls(0),
+      mNumBytesWritten(0) {
 }
 
 MPEG4Writer::~MPEG4Writer() {
@@ -421,6 +433,11 @@ status_t MPEG4Writer::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     mStarted: %s\n", mStarted? "true": "false");
     result.append(buffer);
+    snprintf(buffer, SIZE, "     write batch size: %zu bytes\n", mWriteBufferSize);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     write syscalls: %" PRId64 ", bytes written: %" PRId64 "\n",
+            mNumWriteSyscalls, mNumBytesWritten);
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
     for (List<Track *>::iterator it = mTracks.begin();
          it != mTracks.end(); ++it) {
@@ -654,6 +671,23 @@ status_t MPEG4Writer::start(MetaData *param) {
 
     mStartTimestampUs = -1;
 
+    // Sample payloads and box data are coalesced into batches of this size
+    // before being handed to the kernel; 0 disables batching.
+    char value[PROPERTY_VALUE_MAX];
+    mWriteBufferSize = kDefaultWriteBufferSize;
+    if (property_get("media.mp4.write-batch-kb", value, NULL)) {
+        mWriteBufferSize = atoi(value) * 1024;
+    }
+    mWriteBufferOffset = 0;
+    mNumWriteSyscalls = 0;
+    mNumBytesWritten = 0;
+    if (mWriteBufferSize > 0) {
+        mWriteBuffer = (uint8_t *)malloc(mWriteBufferSize);
+        if (mWriteBuffer == NULL) {
+            mWriteBufferSize = 0;
+        }
+    }
+
     if (!param ||
         !param->findInt32(kKeyTimeScale, &mTimeScale)) {
         mTimeScale = 1000;
@@ -725,7 +759,7 @@ status_t MPEG4Writer::start(MetaData *param) {
     CHECK_GE(mEstimatedMoovBoxSize, 8);
     if (mStreamableFile) {
         // Reserve a 'free' box only for streamable file
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+        seekFile(mFreeBoxOffset);
         writeInt32(mEstimatedMoovBoxSize);
         write("free", 4);
         mMdatOffset = mFreeBoxOffset + mEstimatedMoovBoxSize;
@@ -734,7 +768,7 @@ status_t MPEG4Writer::start(MetaData *param) {
     }
 
     mOffset = mMdatOffset;
-    lseek64(mFd, mMdatOffset, SEEK_SET);
+    seekFile(mMdatOffset);
     if (mUse32BitOffset) {
         write("????mdat", 8);
     } else {
@@ -847,6 +881,11 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    flushWriteBuffer();
+    free(mWriteBuffer);
+    mWriteBuffer = NULL;
+    mWriteBufferSize = 0;
+
     close(mFd);
     mFd = -1;
     mInitCheck = NO_INIT;
@@ -901,16 +940,16 @@ status_t MPEG4Writer::reset() {
 
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
-        lseek64(mFd, mMdatOffset, SEEK_SET);
+        seekFile(mMdatOffset);
         uint32_t size = htonl(static_cast<uint32_t>(mOffset - mMdatOffset));
         ::write(mFd, &size, 4);
     } else {
-        lseek64(mFd, mMdatOffset + 8, SEEK_SET);
+        seekFile(mMdatOffset + 8);
         uint64_t size = mOffset - mMdatOffset;
         size = hton64(size);
         ::write(mFd, &size, 8);
     }
-    lseek64(mFd, mOffset, SEEK_SET);
+    seekFile(mOffset);
 
     // Construct moov box now
     mMoovBoxBufferOffset = 0;
@@ -934,12 +973,12 @@ status_t MPEG4Writer::reset() {
         CHECK_LE(mMoovBoxBufferOffset + 8, mEstimatedMoovBoxSize);
 
         // Moov box
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+        seekFile(mFreeBoxOffset);
         mOffset = mFreeBoxOffset;
         write(mMoovBoxBuffer, 1, mMoovBoxBufferOffset);
 
         // Free box
-        lseek64(mFd, mOffset, SEEK_SET);
+        seekFile(mOffset);
         writeInt32(mEstimatedMoovBoxSize - mMoovBoxBufferOffset);
         write("free", 4);
     } else {
@@ -1073,12 +1112,79 @@ void MPEG4Writer::unlock() {
     mLock.unlock();
 }
 
+void MPEG4Writer::writeToFile(const struct iovec *iov, int iovcnt) {
+    size_t bytes = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        bytes += iov[i].iov_len;
+    }
+
+    if (bytes == 0) {
+        return;
+    }
+
+    if (mWriteBufferOffset + bytes <= mWriteBufferSize) {
+        for (int i = 0; i < iovcnt; ++i) {
+            memcpy(mWriteBuffer + mWriteBufferOffset,
+                    iov[i].iov_base, iov[i].iov_len);
+            mWriteBufferOffset += iov[i].iov_len;
+        }
+        return;
+    }
+
+    // Too large to batch: write out whatever is pending together with the
+    // new data in a single call.
+    struct iovec vecs[kMaxWriteIoVecs + 1];
+    CHECK_LE(iovcnt, kMaxWriteIoVecs);
+
+    int n = 0;
+    if (mWriteBufferOffset > 0) {
+        vecs[n].iov_base = mWriteBuffer;
+        vecs[n].iov_len = mWriteBufferOffset;
+        bytes += mWriteBufferOffset;
+        ++n;
+    }
+    for (int i = 0; i < iovcnt; ++i) {
+        vecs[n++] = iov[i];
+    }
+
+    ssize_t written = ::writev(mFd, vecs, n);
+    if (written != (ssize_t)bytes) {
+        ALOGE("writev of %zu bytes returned %zd (%s)",
+                bytes, written, strerror(errno));
+    }
+    ++mNumWriteSyscalls;
+    mNumBytesWritten += bytes;
+    mWriteBufferOffset = 0;
+}
+
+void MPEG4Writer::flushWriteBuffer() {
+    if (mWriteBufferOffset == 0) {
+        return;
+    }
+
+    ssize_t written = ::write(mFd, mWriteBuffer, mWriteBufferOffset);
+    if (written != (ssize_t)mWriteBufferOffset) {
+        ALOGE("write of %zu bytes returned %zd (%s)",
+                mWriteBufferOffset, written, strerror(errno));
+    }
+    ++mNumWriteSyscalls;
+    mNumBytesWritten += mWriteBufferOffset;
+    mWriteBufferOffset = 0;
+}
+
+void MPEG4Writer::seekFile(off64_t offset) {
+    // Batched data belongs at the current file position.
+    flushWriteBuffer();
+    lseek64(mFd, offset, SEEK_SET);
+}
+
 off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
     off64_t old_offset = mOffset;
 
-    ::write(mFd,
-          (const uint8_t *)buffer->data() + buffer->range_offset(),
-          buffer->range_length());
+    struct iovec iov;
+    iov.iov_base = (uint8_t *)buffer->data() + buffer->range_offset();
+    iov.iov_len = buffer->range_length();
+    writeToFile(&iov, 1);
 
     mOffset += buffer->range_length();
 
@@ -1104,32 +1210,31 @@ off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
 
     size_t length = buffer->range_length();
 
+    uint8_t prefix[4];
+    size_t prefixLength;
     if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
-
-        mOffset += length + 4;
+        prefix[0] = length >> 24;
+        prefix[1] = (length >> 16) & 0xff;
+        prefix[2] = (length >> 8) & 0xff;
+        prefix[3] = length & 0xff;
+        prefixLength = 4;
     } else {
         CHECK_LT(length, 65536);
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
-        mOffset += length + 2;
+        prefix[0] = length >> 8;
+        prefix[1] = length & 0xff;
+        prefixLength = 2;
     }
 
+    struct iovec iov[2];
+    iov[0].iov_base = prefix;
+    iov[0].iov_len = prefixLength;
+    iov[1].iov_base = (uint8_t *)buffer->data() + buffer->range_offset();
+    iov[1].iov_len = length;
+    writeToFile(iov, 2);
+
+    mOffset += length + prefixLength;
+
     return old_offset;
 }
 
@@ -1152,7 +1257,7 @@ size_t MPEG4Writer::write(
                  it != mBoxes.end(); ++it) {
                 (*it) += mOffset;
             }
-            lseek64(mFd, mOffset, SEEK_SET);
+            seekFile(mOffset);
             ::write(mFd, mMoovBoxBuffer, mMoovBoxBufferOffset);
             ::write(mFd, ptr, bytes);
             mOffset += (bytes + mMoovBoxBufferOffset);
@@ -1165,7 +1270,10 @@ size_t MPEG4Writer::write(
             mMoovBoxBufferOffset += bytes;
         }
     } else {
-        ::write(mFd, ptr, size * nmemb);
+        struct iovec iov;
+        iov.iov_base = const_cast<void *>(ptr);
+        iov.iov_len = bytes;
+        writeToFile(&iov, 1);
         mOffset += bytes;
     }
     return bytes;
@@ -1191,10 +1299,10 @@ void MPEG4Writer::endBox() {
        int32_t x = htonl(mMoovBoxBufferOffset - offset);
        memcpy(mMoovBoxBuffer + offset, &x, 4);
     } else {
-        lseek64(mFd, offset, SEEK_SET);
+        seekFile(offset);
         writeInt32(mOffset - offset);
         mOffset -= 4;
-        lseek64(mFd, mOffset, SEEK_SET);
+        seekFile(mOffset);
     }
 }
 
@@ -1637,6 +1745,8 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
         chunk->mSamples.erase(it);
     }
     chunk->mSamples.clear();
+
+    flushWriteBuffer();
 }
 
 void MPEG4Writer::writeAllChunks() {
@@ -17,22 +17,33 @@
 #define LOG_TAG "MediaBufferGroup"
 #include <utils/Log.h>
 
+#include <unistd.h>
+
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
+#include <utils/String8.h>
 
 namespace android {
 
+// Sized acquires grow buffers to a multiple of this many bytes, so that
+// samples of about the same size share a size class.
+static const size_t kBucketSize = 4096;
+
 MediaBufferGroup::MediaBufferGroup()
-    : mFirstBuffer(NULL),
-      mLastBuffer(NULL) {
+    : mNumFree(0),
+      mNumAcquired(0),
+      mNumWaits(0),
+      mNumReallocs(0),
+      mTotalWaitUs(0),
+      mMaxWaitUs(0),
+      mHighWaterMark(0) {
 }
 
 MediaBufferGroup::~MediaBufferGroup() {
-    MediaBuffer *next;
-    for (MediaBuffer *buffer = mFirstBuffer; buffer != NULL;
-         buffer = next) {
-        next = buffer->nextBuffer();
+    for (size_t i = 0; i < mBuffers.size(); ++i) {
+        MediaBuffer *buffer = mBuffers[i];
 
         CHECK_EQ(buffer->refcount(), 0);
 
@@ -46,13 +57,13 @@ void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
 
     buffer->setObserver(this);
 
-    if (mLastBuffer) {
-        mLastBuffer->setNextBuffer(buffer);
-    } else {
-        mFirstBuffer = buffer;
-    }
+    mBuffers.push(buffer);
 
-    mLastBuffer = buffer;
+    // Add a slot up front so that returning buffers never allocates.
+    mFreeBuffers.push(NULL);
+    if (buffer->refcount() == 0) {
+        mFreeBuffers.editItemAt(mNumFree++) = buffer;
+    }
 }
 
 #ifdef ADD_LEGACY_ACQUIRE_BUFFER_SYMBOL
@@ -64,36 +75,149 @@ extern "C" status_t _ZN7android16MediaBufferGroup14acquire_bufferEPPNS_11MediaBu
 
 status_t MediaBufferGroup::acquire_buffer(
         MediaBuffer **out, bool nonBlocking) {
-    Mutex::Autolock autoLock(mLock);
+    return acquire_buffer(out, nonBlocking, 0 /* requestedSize */);
+}
 
-    for (;;) {
-        for (MediaBuffer *buffer = mFirstBuffer;
-             buffer != NULL; buffer = buffer->nextBuffer()) {
-            if (buffer->refcount() == 0) {
-                buffer->add_ref();
-                buffer->reset();
+status_t MediaBufferGroup::acquire_buffer(
+        MediaBuffer **out, bool nonBlocking, size_t requestedSize) {
+    Mutex::Autolock autoLock(mLock);
 
-                *out = buffer;
-                goto exit;
-            }
-        }
+    int64_t waitStartUs = -1;
 
+    while (mNumFree == 0) {
         if (nonBlocking) {
             *out = NULL;
             return WOULD_BLOCK;
         }
 
+        if (waitStartUs < 0) {
+            waitStartUs = ALooper::GetNowUs();
+            ++mNumWaits;
+        }
+
         // All buffers are in use. Block until one of them is returned to us.
         mCondition.wait(mLock);
     }
 
-exit:
+    if (waitStartUs >= 0) {
+        int64_t waitUs = ALooper::GetNowUs() - waitStartUs;
+        mTotalWaitUs += waitUs;
+        if (waitUs > mMaxWaitUs) {
+            mMaxWaitUs = waitUs;
+        }
+    }
+
+    // The most recently returned buffer is the most likely to still be
+    // warm in the cache, unless the caller needs a minimum size.
+    size_t index = mNumFree - 1;
+    if (requestedSize > 0) {
+        index = findFreeBuffer_l(requestedSize);
+    }
+
+    MediaBuffer *buffer = mFreeBuffers[index];
+    mFreeBuffers.editItemAt(index) = mFreeBuffers[--mNumFree];
+
+    if (buffer->size() < requestedSize) {
+        size_t size = requestedSize;
+        if (size <= SIZE_MAX - kBucketSize) {
+            size = (size + kBucketSize - 1) / kBucketSize * kBucketSize;
+        }
+        buffer = reallocBuffer_l(buffer, size);
+    }
+
+    buffer->add_ref();
+    buffer->reset();
+
+    ++mNumAcquired;
+    size_t numInUse = mBuffers.size() - mNumFree;
+    if (numInUse > mHighWaterMark) {
+        mHighWaterMark = numInUse;
+    }
+
+    *out = buffer;
+
     return OK;
 }
 
-void MediaBufferGroup::signalBufferReturned(MediaBuffer *) {
+size_t MediaBufferGroup::findFreeBuffer_l(size_t requestedSize) const {
+    // Pick the smallest free buffer that fits, or else the largest one so
+    // that it is the one that gets grown.
+    ssize_t bestFit = -1;
+    size_t largest = 0;
+    for (size_t i = 0; i < mNumFree; ++i) {
+        size_t size = mFreeBuffers[i]->size();
+        if (size >= requestedSize
+                && (bestFit < 0 || size < mFreeBuffers[bestFit]->size())) {
+            bestFit = i;
+        }
+        if (size > mFreeBuffers[largest]->size()) {
+            largest = i;
+        }
+    }
+
+    return bestFit >= 0 ? (size_t)bestFit : largest;
+}
+
+MediaBuffer *MediaBufferGroup::reallocBuffer_l(
+        MediaBuffer *buffer, size_t size) {
+    ALOGV("growing buffer %p from %zu to %zu bytes", buffer, buffer->size(), size);
+
+    MediaBuffer *newBuffer = new MediaBuffer(size);
+    newBuffer->setObserver(this);
+
+    for (size_t i = 0; i < mBuffers.size(); ++i) {
+        if (mBuffers[i] == buffer) {
+            mBuffers.editItemAt(i) = newBuffer;
+            break;
+        }
+    }
+
+    buffer->setObserver(NULL);
+    buffer->release();
+
+    ++mNumReallocs;
+
+    return newBuffer;
+}
+
+void MediaBufferGroup::signalBufferReturned(MediaBuffer *buffer) {
     Mutex::Autolock autoLock(mLock);
+
+    // A buffer returned twice would be handed out to two owners.
+    for (size_t i = 0; i < mNumFree; ++i) {
+        if (mFreeBuffers[i] == buffer) {
+            ALOGE("buffer %p returned twice, ignoring", buffer);
+            return;
+        }
+    }
+    CHECK_LT(mNumFree, mFreeBuffers.size());
+
+    mFreeBuffers.editItemAt(mNumFree++) = buffer;
     mCondition.signal();
 }
 
+status_t MediaBufferGroup::dump(
+        int fd, const Vector<String16>& /* args */) const {
+    Mutex::Autolock autoLock(mLock);
+
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+    snprintf(buffer, SIZE, "   MediaBufferGroup %p\n", this);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     buffers: %zu (%zu free, high-water mark %zu)\n",
+            mBuffers.size(), mNumFree, mHighWaterMark);
+    result.append(buffer);
+    snprintf(buffer, SIZE,
+            "     acquired: %lld, starved: %lld, reallocated: %lld\n",
+            (long long)mNumAcquired, (long long)mNumWaits,
+            (long long)mNumReallocs);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     wait: total %lld us, max %lld us\n",
+            (long long)mTotalWaitUs, (long long)mMaxWaitUs);
+    result.append(buffer);
+    ::write(fd, result.string(), result.size());
+    return OK;
+}
+
 }  // namespace android
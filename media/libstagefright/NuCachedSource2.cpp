@@ -15,6 +15,7 @@
  */
 
 #include <inttypes.h>
+#include <unistd.h>
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "NuCachedSource2"
@@ -24,9 +25,11 @@
 #include "include/HTTPBase.h"
 
 #include <cutils/properties.h>
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaErrors.h>
+#include <utils/String8.h>
 
 namespace android {
 
@@ -34,9 +37,25 @@ struct PageCache {
     PageCache(size_t pageSize);
     ~PageCache();
 
-    struct Page {
+    // Pages are refcounted so that readAtShared() can hand out buffers
+    // referencing cached data without copying. The cache holds one strong
+    // reference to each page it owns; a page that is still referenced by
+    // such a buffer when released is dropped rather than recycled.
+    struct Page : public RefBase {
+        Page(size_t size);
+
         void *mData;
         size_t mSize;
+
+        // Offset of the first byte of this page in the stream of all data
+        // ever appended to the cache.
+        off64_t mOffset;
+
+    protected:
+        virtual ~Page();
+
+    private:
+        DISALLOW_EVIL_CONSTRUCTORS(Page);
     };
 
     Page *acquirePage();
@@ -51,21 +70,43 @@ struct PageCache {
 
     void copy(size_t from, void *data, size_t size);
 
+    // Returns a buffer referencing the cache from offset from up to the end
+    // of the page holding it, at most size bytes, or NULL if from is not
+    // cached.
+    sp<ABuffer> share(size_t from, size_t size);
+
 private:
     size_t mPageSize;
     size_t mTotalSize;
 
-    List<Page *> mActivePages;
-    List<Page *> mFreePages;
+    // Sum of the sizes of all pages released from the start of the cache,
+    // i.e. the mOffset of the first active page.
+    off64_t mReleasedSize;
+
+    Vector<Page *> mActivePages;
+    Vector<Page *> mFreePages;
 
-    void freePages(List<Page *> *list);
+    size_t findPage(size_t from) const;
+    void freePages(Vector<Page *> *pages);
 
     DISALLOW_EVIL_CONSTRUCTORS(PageCache);
 };
 
+PageCache::Page::Page(size_t size)
+    : mData(malloc(size)),
+      mSize(0),
+      mOffset(0) {
+}
+
+PageCache::Page::~Page() {
+    free(mData);
+    mData = NULL;
+}
+
 PageCache::PageCache(size_t pageSize)
     : mPageSize(pageSize),
-      mTotalSize(0) {
+      mTotalSize(0),
+      mReleasedSize(0) {
 }
 
 PageCache::~PageCache() {
@@ -73,110 +114,144 @@ PageCache::~PageCache() {
     freePages(&mFreePages);
 }
 
-void PageCache::freePages(List<Page *> *list) {
-    List<Page *>::iterator it = list->begin();
-    while (it != list->end()) {
-        Page *page = *it;
-
-        free(page->mData);
-        delete page;
-        page = NULL;
-
-        ++it;
+void PageCache::freePages(Vector<Page *> *pages) {
+    for (size_t i = 0; i < pages->size(); ++i) {
+        pages->itemAt(i)->decStrong(this);
     }
+    pages->clear();
 }
 
 PageCache::Page *PageCache::acquirePage() {
     if (!mFreePages.empty()) {
-        List<Page *>::iterator it = mFreePages.begin();
-        Page *page = *it;
-        mFreePages.erase(it);
+        Page *page = mFreePages.top();
+        mFreePages.pop();
 
         return page;
     }
 
-    Page *page = new Page;
-    page->mData = malloc(mPageSize);
-    page->mSize = 0;
+    Page *page = new Page(mPageSize);
+    page->incStrong(this);
 
     return page;
 }
 
 void PageCache::releasePage(Page *page) {
+    if (page->getStrongCount() > 1) {
+        // Still referenced by a shared buffer, let the last holder free it.
+        page->decStrong(this);
+        return;
+    }
+
     page->mSize = 0;
-    mFreePages.push_back(page);
+    mFreePages.push(page);
 }
 
 void PageCache::appendPage(Page *page) {
+    page->mOffset = mReleasedSize + mTotalSize;
     mTotalSize += page->mSize;
-    mActivePages.push_back(page);
+    mActivePages.push(page);
 }
 
 size_t PageCache::releaseFromStart(size_t maxBytes) {
     size_t bytesReleased = 0;
+    size_t numPages = 0;
 
-    while (maxBytes > 0 && !mActivePages.empty()) {
-        List<Page *>::iterator it = mActivePages.begin();
-
-        Page *page = *it;
+    while (numPages < mActivePages.size()) {
+        Page *page = mActivePages[numPages];
 
         if (maxBytes < page->mSize) {
             break;
         }
 
-        mActivePages.erase(it);
-
         maxBytes -= page->mSize;
         bytesReleased += page->mSize;
+        ++numPages;
 
         releasePage(page);
     }
 
+    mActivePages.removeItemsAt(0, numPages);
+
     mTotalSize -= bytesReleased;
+    mReleasedSize += bytesReleased;
     return bytesReleased;
 }
 
-void PageCache::copy(size_t from, void *data, size_t size) {
-    ALOGV("copy from %zu size %zu", from, size);
+size_t PageCache::findPage(size_t from) const {
+    off64_t target = mReleasedSize + from;
 
-    if (size == 0) {
-        return;
+    // Pages are almost always full, so try the direct mapping first and
+    // fall back to a binary search if short reads left partial pages.
+    size_t index = from / mPageSize;
+    if (index < mActivePages.size()) {
+        const Page *page = mActivePages[index];
+        if (target >= page->mOffset
+                && target < page->mOffset + (off64_t)page->mSize) {
+            return index;
+        }
     }
 
-    CHECK_LE(from + size, mTotalSize);
-
-    size_t offset = 0;
-    List<Page *>::iterator it = mActivePages.begin();
-    while (from >= offset + (*it)->mSize) {
-        offset += (*it)->mSize;
-        ++it;
+    size_t lo = 0;
+    size_t hi = mActivePages.size();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mActivePages[mid]->mOffset <= target) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
     }
 
-    size_t delta = from - offset;
-    size_t avail = (*it)->mSize - delta;
+    return lo;
+}
+
+void PageCache::copy(size_t from, void *data, size_t size) {
+    ALOGV("copy from %zu size %zu", from, size);
 
-    if (avail >= size) {
-        memcpy(data, (const uint8_t *)(*it)->mData + delta, size);
+    if (size == 0) {
         return;
     }
 
-    memcpy(data, (const uint8_t *)(*it)->mData + delta, avail);
-    ++it;
-    data = (uint8_t *)data + avail;
-    size -= avail;
+    CHECK_LE(from + size, mTotalSize);
+
+    size_t index = findPage(from);
+    const Page *page = mActivePages[index];
+    size_t delta = mReleasedSize + from - page->mOffset;
 
     while (size > 0) {
-        size_t copy = (*it)->mSize;
+        size_t copy = page->mSize - delta;
         if (copy > size) {
             copy = size;
         }
-        memcpy(data, (*it)->mData, copy);
+        memcpy(data, (const uint8_t *)page->mData + delta, copy);
         data = (uint8_t *)data + copy;
         size -= copy;
-        ++it;
+
+        if (size > 0) {
+            page = mActivePages[++index];
+            delta = 0;
+        }
     }
 }
 
+sp<ABuffer> PageCache::share(size_t from, size_t size) {
+    if (size == 0 || from >= mTotalSize) {
+        return NULL;
+    }
+
+    Page *page = mActivePages[findPage(from)];
+    size_t delta = mReleasedSize + from - page->mOffset;
+
+    if (delta + size > page->mSize) {
+        size = page->mSize - delta;
+    }
+
+    sp<ABuffer> buffer = new ABuffer((uint8_t *)page->mData + delta, size);
+    buffer->meta()->setObject("page", page);
+
+    return buffer;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 NuCachedSource2::NuCachedSource2(
@@ -198,7 +273,11 @@ NuCachedSource2::NuCachedSource2(
       mLowwaterThresholdBytes(kDefaultLowWaterThreshold),
       mKeepAliveIntervalUs(kDefaultKeepAliveIntervalUs),
       mDisconnectAtHighwatermark(disconnectAtHighwatermark),
-      mSuspended(false) {
+      mSuspended(false),
+      mNumCacheHits(0),
+      mNumCacheMisses(0),
+      mTotalReadLatencyUs(0),
+      mMaxReadLatencyUs(0) {
     // We are NOT going to support disconnect-at-highwatermark indefinitely
     // and we are not guaranteeing support for client-specified cache
     // parameters. Both of these are temporary measures to solve a specific
@@ -234,6 +313,14 @@ NuCachedSource2::~NuCachedSource2() {
     mLooper->stop();
     mLooper->unregisterHandler(mReflector->id());
 
+    ALOGI("cache hits: %lld, misses: %lld, avg read latency: %lld us, "
+          "max read latency: %lld us",
+          (long long)mNumCacheHits, (long long)mNumCacheMisses,
+          (long long)(mTotalReadLatencyUs
+                / (mNumCacheHits + mNumCacheMisses > 0
+                    ? mNumCacheHits + mNumCacheMisses : 1)),
+          (long long)mMaxReadLatencyUs);
+
     delete mCache;
     mCache = NULL;
 }
@@ -347,7 +434,11 @@ void NuCachedSource2::fetchInternal() {
         }
     }
 
-    PageCache::Page *page = mCache->acquirePage();
+    PageCache::Page *page;
+    {
+        Mutex::Autolock autoLock(mLock);
+        page = mCache->acquirePage();
+    }
 
     ssize_t n = mSource->readAt(
             mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
@@ -512,6 +603,8 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
 
     ALOGV("readAt offset %lld, size %zu", offset, size);
 
+    int64_t startTimeUs = ALooper::GetNowUs();
+
     Mutex::Autolock autoLock(mLock);
     if (mDisconnecting) {
         return ERROR_END_OF_STREAM;
@@ -526,9 +619,14 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
 
         mLastAccessPos = offset + size;
 
+        ++mNumCacheHits;
+        updateReadLatency_l(startTimeUs);
+
         return size;
     }
 
+    ++mNumCacheMisses;
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector->id());
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -555,9 +653,88 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         mLastAccessPos = offset + result;
     }
 
+    updateReadLatency_l(startTimeUs);
+
     return (ssize_t)result;
 }
 
+ssize_t NuCachedSource2::readAtShared(
+        off64_t offset, size_t size, sp<ABuffer> *buffer) {
+    {
+        Mutex::Autolock autoSerializer(mSerializer);
+
+        int64_t startTimeUs = ALooper::GetNowUs();
+
+        Mutex::Autolock autoLock(mLock);
+        if (mDisconnecting) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        if (offset >= mCacheOffset
+                && offset < mCacheOffset + (off64_t)mCache->totalSize()) {
+            *buffer = mCache->share(offset - mCacheOffset, size);
+
+            if (*buffer != NULL) {
+                size_t n = (*buffer)->size();
+                mLastAccessPos = offset + n;
+
+                ++mNumCacheHits;
+                updateReadLatency_l(startTimeUs);
+
+                return n;
+            }
+        }
+    }
+
+    // Not cached, fall back to a copying read.
+    sp<ABuffer> copy = new ABuffer(size);
+    ssize_t n = readAt(offset, copy->data(), size);
+    if (n < 0) {
+        buffer->clear();
+        return n;
+    }
+
+    copy->setRange(0, n);
+    *buffer = copy;
+
+    return n;
+}
+
+void NuCachedSource2::updateReadLatency_l(int64_t startTimeUs) {
+    int64_t latencyUs = ALooper::GetNowUs() - startTimeUs;
+
+    mTotalReadLatencyUs += latencyUs;
+    if (latencyUs > mMaxReadLatencyUs) {
+        mMaxReadLatencyUs = latencyUs;
+    }
+}
+
+status_t NuCachedSource2::dump(
+        int fd, const Vector<String16>& /* args */) const {
+    Mutex::Autolock autoLock(mLock);
+
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+    snprintf(buffer, SIZE, "   NuCachedSource2 %p\n", this);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     cached: %lld - %lld, last access: %lld\n",
+            (long long)mCacheOffset,
+            (long long)(mCacheOffset + mCache->totalSize()),
+            (long long)mLastAccessPos);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     hits: %lld, misses: %lld\n",
+            (long long)mNumCacheHits, (long long)mNumCacheMisses);
+    result.append(buffer);
+    int64_t numReads = mNumCacheHits + mNumCacheMisses;
+    snprintf(buffer, SIZE, "     read latency: avg %lld us, max %lld us\n",
+            (long long)(numReads > 0 ? mTotalReadLatencyUs / numReads : 0),
+            (long long)mMaxReadLatencyUs);
+    result.append(buffer);
+    ::write(fd, result.string(), result.size());
+    return OK;
+}
+
 size_t NuCachedSource2::cachedSize() {
     Mutex::Autolock autoLock(mLock);
     return mCacheOffset + mCache->totalSize();
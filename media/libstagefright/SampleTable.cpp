@@ -24,6 +24,7 @@
 #include <arpa/inet.h>
 
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/Utils.h>
 
@@ -119,6 +120,8 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
       mSampleTimeEntries(NULL),
+      mTimeToSampleRuns(NULL),
+      mNumTimeToSampleRuns(0),
       mCompositionTimeDeltaEntries(NULL),
       mNumCompositionTimeDeltaEntries(0),
       mCompositionDeltaLookup(new CompositionDeltaLookup),
@@ -146,6 +149,9 @@ SampleTable::~SampleTable() {
     delete[] mSampleTimeEntries;
     mSampleTimeEntries = NULL;
 
+    delete[] mTimeToSampleRuns;
+    mTimeToSampleRuns = NULL;
+
     delete[] mTimeToSample;
     mTimeToSample = NULL;
 
@@ -504,10 +510,82 @@ int SampleTable::CompareIncreasingTime(const void *_a, const void *_b) {
     return 0;
 }
 
+bool SampleTable::buildTimeToSampleRuns_l() {
+    for (size_t i = 0; i < mNumCompositionTimeDeltaEntries; ++i) {
+        if (mCompositionTimeDeltaEntries[2 * i + 1] != 0) {
+            // Reordered frames, sample times are not monotonic.
+            return false;
+        }
+    }
+
+    // With about one time-to-sample entry per sample, the runs take more
+    // memory than the per-sample table.
+    if ((uint64_t)mTimeToSampleCount * sizeof(TimeToSampleRun)
+            > (uint64_t)mNumSampleSizes * sizeof(SampleTimeEntry)) {
+        return false;
+    }
+
+    TimeToSampleRun *runs =
+        new (std::nothrow) TimeToSampleRun[mTimeToSampleCount];
+    if (runs == NULL) {
+        return false;
+    }
+
+    uint32_t numRuns = 0;
+    uint32_t sampleIndex = 0;
+    uint64_t sampleTime = 0;
+
+    for (uint32_t i = 0;
+            i < mTimeToSampleCount && sampleIndex < mNumSampleSizes; ++i) {
+        uint32_t n = mTimeToSample[2 * i];
+        uint32_t delta = mTimeToSample[2 * i + 1];
+
+        if (n > mNumSampleSizes - sampleIndex) {
+            n = mNumSampleSizes - sampleIndex;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        TimeToSampleRun *run = &runs[numRuns++];
+        run->mFirstSample = sampleIndex;
+        run->mNumSamples = n;
+        run->mFirstTime = (uint32_t)sampleTime;
+        run->mDelta = delta;
+
+        sampleIndex += n;
+        sampleTime += (uint64_t)n * delta;
+    }
+
+    // Sample times are 32-bit and would wrap around in the per-sample
+    // table as well; only use the runs when they cover every sample
+    // without wrapping.
+    if (sampleIndex < mNumSampleSizes || sampleTime > UINT32_MAX) {
+        delete[] runs;
+        return false;
+    }
+
+    mTimeToSampleRuns = runs;
+    mNumTimeToSampleRuns = numRuns;
+
+    return true;
+}
+
 void SampleTable::buildSampleEntriesTable() {
     Mutex::Autolock autoLock(mLock);
 
-    if (mSampleTimeEntries != NULL) {
+    if (mSampleTimeEntries != NULL || mTimeToSampleRuns != NULL) {
+        return;
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+
+    if (buildTimeToSampleRuns_l()) {
+        ALOGI("sample time index: %u runs for %u samples, %zu bytes, "
+                "built in %lld us",
+                mNumTimeToSampleRuns, mNumSampleSizes,
+                mNumTimeToSampleRuns * sizeof(TimeToSampleRun),
+                (long long)(ALooper::GetNowUs() - startUs));
         return;
     }
 
@@ -517,6 +595,7 @@ void SampleTable::buildSampleEntriesTable() {
 
     uint32_t sampleIndex = 0;
     uint32_t sampleTime = 0;
+    bool sorted = true;
 
     for (uint32_t i = 0; i < mTimeToSampleCount; ++i) {
         uint32_t n = mTimeToSample[2 * i];
@@ -536,6 +615,11 @@ void SampleTable::buildSampleEntriesTable() {
 
                 mSampleTimeEntries[sampleIndex].mCompositionTime =
                     sampleTime + compTimeDelta;
+
+                if (sampleIndex > 0 && mSampleTimeEntries[sampleIndex].mCompositionTime
+                        < mSampleTimeEntries[sampleIndex - 1].mCompositionTime) {
+                    sorted = false;
+                }
             }
 
             ++sampleIndex;
@@ -543,33 +627,113 @@ void SampleTable::buildSampleEntriesTable() {
         }
     }
 
-    qsort(mSampleTimeEntries, mNumSampleSizes, sizeof(SampleTimeEntry),
-          CompareIncreasingTime);
+    // Without reordered frames the table is already in time order.
+    if (!sorted || sampleIndex < mNumSampleSizes) {
+        qsort(mSampleTimeEntries, mNumSampleSizes, sizeof(SampleTimeEntry),
+              CompareIncreasingTime);
+    }
+
+    ALOGI("sample time index: sorted table for %u samples, %zu bytes, "
+            "built in %lld us",
+            mNumSampleSizes, mNumSampleSizes * sizeof(SampleTimeEntry),
+            (long long)(ALooper::GetNowUs() - startUs));
 }
 
-status_t SampleTable::findSampleAtTime(
-        uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
-        uint32_t *sample_index, uint32_t flags) {
-    buildSampleEntriesTable();
+uint32_t SampleTable::findTimeToSampleRun(uint32_t pos) const {
+    // Last run starting at or before pos.
+    uint32_t lo = 0;
+    uint32_t hi = mNumTimeToSampleRuns;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (mTimeToSampleRuns[mid].mFirstSample <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+uint32_t SampleTable::getMediaTimeAt(uint32_t pos) const {
+    if (mTimeToSampleRuns == NULL) {
+        return mSampleTimeEntries[pos].mCompositionTime;
+    }
+
+    const TimeToSampleRun &run = mTimeToSampleRuns[findTimeToSampleRun(pos)];
+    return run.mFirstTime + (pos - run.mFirstSample) * run.mDelta;
+}
+
+uint32_t SampleTable::getSampleIndexAt(uint32_t pos) const {
+    if (mTimeToSampleRuns == NULL) {
+        return mSampleTimeEntries[pos].mSampleIndex;
+    }
+    return pos;
+}
+
+uint32_t SampleTable::findFirstAtOrAfter(uint64_t mediaTime) const {
+    if (mTimeToSampleRuns == NULL) {
+        uint32_t left = 0;
+        uint32_t right_plus_one = mNumSampleSizes;
+        while (left < right_plus_one) {
+            uint32_t center = left + (right_plus_one - left) / 2;
+            if (mSampleTimeEntries[center].mCompositionTime < mediaTime) {
+                left = center + 1;
+            } else {
+                right_plus_one = center;
+            }
+        }
+        return left;
+    }
 
+    // Last run whose first sample is earlier than mediaTime; the answer is
+    // in that run or is the first sample of the next one.
     uint32_t left = 0;
-    uint32_t right_plus_one = mNumSampleSizes;
+    uint32_t right_plus_one = mNumTimeToSampleRuns;
     while (left < right_plus_one) {
         uint32_t center = left + (right_plus_one - left) / 2;
-        uint64_t centerTime =
-            getSampleTime(center, scale_num, scale_den);
-
-        if (req_time < centerTime) {
-            right_plus_one = center;
-        } else if (req_time > centerTime) {
+        if (mTimeToSampleRuns[center].mFirstTime < mediaTime) {
             left = center + 1;
         } else {
-            *sample_index = mSampleTimeEntries[center].mSampleIndex;
-            return OK;
+            right_plus_one = center;
         }
     }
 
-    uint32_t closestIndex = left;
+    if (left == 0) {
+        return 0;
+    }
+
+    const TimeToSampleRun &run = mTimeToSampleRuns[left - 1];
+    uint64_t offset = mediaTime - run.mFirstTime;
+    uint64_t k = run.mNumSamples;
+    if (run.mDelta > 0) {
+        k = (offset + run.mDelta - 1) / run.mDelta;
+        if (k > run.mNumSamples) {
+            k = run.mNumSamples;
+        }
+    }
+    return run.mFirstSample + (uint32_t)k;
+}
+
+status_t SampleTable::findSampleAtTime(
+        uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+        uint32_t *sample_index, uint32_t flags) {
+    buildSampleEntriesTable();
+
+    // getSampleTime(i) >= req_time exactly when the sample's media time is
+    // at least req_time * scale_den / scale_num rounded up, so the search
+    // can compare raw media times instead of rescaling every probe.
+    uint64_t reqMediaTime = UINT64_MAX;
+    if (scale_den == 0 || req_time <= (UINT64_MAX - scale_num) / scale_den) {
+        reqMediaTime = (req_time * scale_den + scale_num - 1) / scale_num;
+    }
+
+    uint32_t closestIndex = findFirstAtOrAfter(reqMediaTime);
+
+    if (closestIndex < mNumSampleSizes
+            && getSampleTime(closestIndex, scale_num, scale_den) == req_time) {
+        *sample_index = getSampleIndexAt(closestIndex);
+        return OK;
+    }
 
     if (closestIndex == mNumSampleSizes) {
         if (flags == kFlagAfter) {
@@ -613,7 +777,7 @@ status_t SampleTable::findSampleAtTime(
         }
     }
 
-    *sample_index = mSampleTimeEntries[closestIndex].mSampleIndex;
+    *sample_index = getSampleIndexAt(closestIndex);
     return OK;
 }
 
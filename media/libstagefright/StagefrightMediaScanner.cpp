@@ -20,12 +20,17 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
 
 #include <media/stagefright/StagefrightMediaScanner.h>
 
+#include <cutils/properties.h>
 #include <media/IMediaHTTPService.h>
 #include <media/mediametadataretriever.h>
+#include <media/stagefright/MediaErrors.h>
 #include <private/media/VideoFrame.h>
 
 // Sonivox includes
@@ -33,9 +38,56 @@
 
 namespace android {
 
-StagefrightMediaScanner::StagefrightMediaScanner() {}
+// Upper bound of files waiting for a scan thread, prefetchFile() drops the
+// rest and leaves them to processFile().
+static const size_t kMaxQueuedFiles = 64;
+
+// Where the index is kept unless media.stagefright.scan-index says otherwise,
+// a value of "none" turns it off. The media provider has write access to
+// /data/media through the media_rw group.
+static const char *kDefaultIndexPath = "/data/media/.media_scan_index";
+
+// "SFMX", followed by the version and the number of entries.
+static const uint32_t kIndexMagic = 0x53464d58;
+static const uint32_t kIndexVersion = 2;
+
+// Stored as the scan result of files that were seen but never parsed.
+static const int32_t kResultNotParsed = -1;
+
+// Sanity limits for reading the index.
+static const uint32_t kMaxIndexStringLength = 65536;
+static const uint32_t kMaxIndexTagStrings = 256;
+
+StagefrightMediaScanner::StagefrightMediaScanner()
+    : mIndexDirty(false),
+      mNumThreads(0),
+      mDone(false),
+      mNumParsed(0),
+      mNumIndexHits(0) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.scan-index", value, kDefaultIndexPath) > 0
+            && strcmp(value, "none")) {
+        setIndexPath(value);
+    }
+}
+
+StagefrightMediaScanner::~StagefrightMediaScanner() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mDone = true;
+        mQueueChanged.broadcast();
+    }
+
+    for (size_t i = 0; i < mNumThreads; ++i) {
+        pthread_join(mThreads[i], NULL);
+    }
 
-StagefrightMediaScanner::~StagefrightMediaScanner() {}
+    Mutex::Autolock autoLock(mLock);
+    if (mIndexDirty && !mIndexPath.isEmpty()) {
+        saveIndex_l();
+    }
+    clearIndex_l();
+}
 
 static bool FileHasAcceptableExtension(const char *extension) {
     static const char *kValidExtensions[] = {
@@ -61,6 +113,18 @@ static bool FileHasAcceptableExtension(const char *extension) {
     return false;
 }
 
+static bool IsMIDI(const char *extension) {
+    return !strcasecmp(extension, ".mid")
+            || !strcasecmp(extension, ".smf")
+            || !strcasecmp(extension, ".imy")
+            || !strcasecmp(extension, ".midi")
+            || !strcasecmp(extension, ".xmf")
+            || !strcasecmp(extension, ".rtttl")
+            || !strcasecmp(extension, ".rtx")
+            || !strcasecmp(extension, ".ota")
+            || !strcasecmp(extension, ".mxmf");
+}
+
 static MediaScanResult HandleMIDI(
         const char *filename, MediaScannerClient *client) {
     // get the library configuration and do sanity check
@@ -109,6 +173,178 @@ static MediaScanResult HandleMIDI(
     return MEDIA_SCAN_RESULT_OK;
 }
 
+struct KeyMap {
+    const char *tag;
+    int key;
+};
+static const KeyMap kKeyMap[] = {
+    { "tracknumber", METADATA_KEY_CD_TRACK_NUMBER },
+    { "discnumber", METADATA_KEY_DISC_NUMBER },
+    { "album", METADATA_KEY_ALBUM },
+    { "artist", METADATA_KEY_ARTIST },
+    { "albumartist", METADATA_KEY_ALBUMARTIST },
+    { "composer", METADATA_KEY_COMPOSER },
+    { "genre", METADATA_KEY_GENRE },
+    { "title", METADATA_KEY_TITLE },
+    { "year", METADATA_KEY_YEAR },
+    { "date", METADATA_KEY_DATE },
+    { "duration", METADATA_KEY_DURATION },
+    { "writer", METADATA_KEY_WRITER },
+    { "compilation", METADATA_KEY_COMPILATION },
+    { "isdrm", METADATA_KEY_IS_DRM },
+    { "width", METADATA_KEY_VIDEO_WIDTH },
+    { "height", METADATA_KEY_VIDEO_HEIGHT },
+};
+static const size_t kNumEntries = sizeof(kKeyMap) / sizeof(kKeyMap[0]);
+
+// Reads the metadata of a media file through the media server, so that the
+// extractors never run on untrusted files in the scanner process. The server
+// only reads the container headers and does not instantiate a decoder for it.
+static MediaScanResult ExtractMetadata(
+        const char *path, String8 *mimeType, Vector<String8> *tags) {
+    mimeType->clear();
+    tags->clear();
+
+    sp<MediaMetadataRetriever> mRetriever(new MediaMetadataRetriever);
+
+    int fd = open(path, O_RDONLY | O_LARGEFILE);
+    status_t status;
+    if (fd < 0) {
+        // couldn't open it locally, maybe the media server can?
+        status = mRetriever->setDataSource(NULL /* httpService */, path);
+    } else {
+        status = mRetriever->setDataSource(fd, 0, 0x7ffffffffffffffL);
+        close(fd);
+    }
+
+    if (status) {
+        return MEDIA_SCAN_RESULT_ERROR;
+    }
+
+    const char *value;
+    if ((value = mRetriever->extractMetadata(METADATA_KEY_MIMETYPE)) != NULL) {
+        mimeType->setTo(value);
+    }
+
+    for (size_t i = 0; i < kNumEntries; ++i) {
+        if ((value = mRetriever->extractMetadata(kKeyMap[i].key)) != NULL) {
+            tags->push(String8(kKeyMap[i].tag));
+            tags->push(String8(value));
+        }
+    }
+
+    return MEDIA_SCAN_RESULT_OK;
+}
+
+static MediaScanResult ReportMetadata(
+        MediaScanResult result, const String8 &mimeType, const Vector<String8> &tags,
+        MediaScannerClient &client) {
+    if (result != MEDIA_SCAN_RESULT_OK) {
+        return result;
+    }
+
+    if (!mimeType.isEmpty()) {
+        status_t status = client.setMimeType(mimeType.string());
+        if (status) {
+            return MEDIA_SCAN_RESULT_ERROR;
+        }
+    }
+
+    for (size_t i = 0; i + 1 < tags.size(); i += 2) {
+        status_t status = client.addStringTag(tags[i].string(), tags[i + 1].string());
+        if (status != OK) {
+            return MEDIA_SCAN_RESULT_ERROR;
+        }
+    }
+
+    return MEDIA_SCAN_RESULT_OK;
+}
+
+status_t StagefrightMediaScanner::setIndexPath(const char *path) {
+    Mutex::Autolock autoLock(mLock);
+
+    mIndexPath.setTo(path);
+
+    status_t err = loadIndex_l();
+    if (err == -ENOENT) {
+        // Nothing saved yet.
+        return OK;
+    }
+    return err;
+}
+
+MediaScanResult StagefrightMediaScanner::processDirectory(
+        const char *path, MediaScannerClient &client) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        for (size_t i = 0; i < mIndex.size(); ++i) {
+            mIndex.valueAt(i)->mSeen = false;
+        }
+        mNumParsed = 0;
+        mNumIndexHits = 0;
+    }
+
+    MediaScanResult result = MediaScanner::processDirectory(path, client);
+
+    Mutex::Autolock autoLock(mLock);
+
+    ALOGI("Parsed %zu files, %zu unchanged files skipped", mNumParsed, mNumIndexHits);
+
+    if (result == MEDIA_SCAN_RESULT_OK) {
+        // Forget the files that were not found in the directory anymore.
+        String8 prefix(path);
+        if (prefix.isEmpty() || prefix.string()[prefix.length() - 1] != '/') {
+            prefix.append("/");
+        }
+
+        for (size_t i = mIndex.size(); i-- > 0;) {
+            ScanEntry *entry = mIndex.valueAt(i);
+            if (!entry->mSeen
+                    && (entry->mState == ScanEntry::NEW || entry->mState == ScanEntry::DONE)
+                    && !strncmp(mIndex.keyAt(i).string(), prefix.string(), prefix.length())) {
+                delete entry;
+                mIndex.removeItemsAt(i);
+                mIndexDirty = true;
+            }
+        }
+    }
+
+    if (mIndexDirty && !mIndexPath.isEmpty()) {
+        saveIndex_l();
+    }
+
+    return result;
+}
+
+void StagefrightMediaScanner::prefetchFile(
+        const char *path, long long lastModified, long long fileSize) {
+    const char *extension = strrchr(path, '.');
+
+    // MIDI files are cheap to parse and reported by HandleMIDI() directly.
+    if (!extension || !FileHasAcceptableExtension(extension) || IsMIDI(extension)) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    bool changed;
+    ScanEntry *entry = findEntry_l(path, lastModified, fileSize, &changed);
+    entry->mSeen = true;
+
+    // The client only asks for files that are new or have changed since the
+    // last scan. An unchanged file that was never parsed was not asked for
+    // last time and won't be this time either, so it is left alone.
+    if (entry->mState == ScanEntry::DONE) {
+        ++mNumIndexHits;
+    } else if (changed && entry->mState == ScanEntry::NEW
+            && mQueue.size() < kMaxQueuedFiles) {
+        entry->mState = ScanEntry::QUEUED;
+        mQueue.push_back(String8(path));
+        startThreads_l();
+        mQueueChanged.signal();
+    }
+}
+
 MediaScanResult StagefrightMediaScanner::processFile(
         const char *path, const char *mimeType,
         MediaScannerClient &client) {
@@ -134,78 +370,312 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
         return MEDIA_SCAN_RESULT_SKIPPED;
     }
 
-    if (!strcasecmp(extension, ".mid")
-            || !strcasecmp(extension, ".smf")
-            || !strcasecmp(extension, ".imy")
-            || !strcasecmp(extension, ".midi")
-            || !strcasecmp(extension, ".xmf")
-            || !strcasecmp(extension, ".rtttl")
-            || !strcasecmp(extension, ".rtx")
-            || !strcasecmp(extension, ".ota")
-            || !strcasecmp(extension, ".mxmf")) {
+    if (IsMIDI(extension)) {
         return HandleMIDI(path, &client);
     }
 
-    sp<MediaMetadataRetriever> mRetriever(new MediaMetadataRetriever);
+    MediaScanResult result;
+    String8 mimeType;
+    Vector<String8> tags;
 
-    int fd = open(path, O_RDONLY | O_LARGEFILE);
-    status_t status;
-    if (fd < 0) {
-        // couldn't open it locally, maybe the media server can?
-        status = mRetriever->setDataSource(NULL /* httpService */, path);
+    struct stat statbuf;
+    if (stat(path, &statbuf) != 0) {
+        // Not a local file, nothing to remember about it.
+        result = ExtractMetadata(path, &mimeType, &tags);
+        return ReportMetadata(result, mimeType, tags, client);
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        ScanEntry *entry;
+        for (;;) {
+            entry = findEntry_l(path, statbuf.st_mtime, statbuf.st_size, NULL);
+            if (entry->mState != ScanEntry::PARSING) {
+                break;
+            }
+            mEntryParsed.wait(mLock);
+        }
+        entry->mSeen = true;
+
+        if (entry->mState != ScanEntry::DONE) {
+            // Not picked up by a scan thread yet, parse it right here.
+            entry->mState = ScanEntry::PARSING;
+
+            mLock.unlock();
+            result = ExtractMetadata(path, &entry->mMimeType, &entry->mTags);
+            mLock.lock();
+
+            entry->mResult = result;
+            entry->mState = ScanEntry::DONE;
+            mIndexDirty = true;
+            ++mNumParsed;
+            mEntryParsed.broadcast();
+        }
+
+        result = entry->mResult;
+        mimeType = entry->mMimeType;
+        tags = entry->mTags;
+    }
+
+    // The client calls back into Java, don't hold the lock for it.
+    return ReportMetadata(result, mimeType, tags, client);
+}
+
+StagefrightMediaScanner::ScanEntry *StagefrightMediaScanner::findEntry_l(
+        const char *path, long long lastModified, long long fileSize, bool *changed) {
+    ScanEntry *entry;
+
+    ssize_t index = mIndex.indexOfKey(String8(path));
+    if (index < 0) {
+        entry = new ScanEntry;
+        entry->mSeen = false;
+        mIndex.add(String8(path), entry);
     } else {
-        status = mRetriever->setDataSource(fd, 0, 0x7ffffffffffffffL);
-        close(fd);
+        entry = mIndex.valueAt(index);
+        if (entry->mState == ScanEntry::PARSING
+                || (entry->mLastModified == lastModified && entry->mFileSize == fileSize)) {
+            if (changed != NULL) {
+                *changed = false;
+            }
+            return entry;
+        }
+        // The file has changed since it was seen last.
     }
 
-    if (status) {
-        return MEDIA_SCAN_RESULT_ERROR;
+    if (changed != NULL) {
+        *changed = true;
     }
+    mIndexDirty = true;
 
-    const char *value;
-    if ((value = mRetriever->extractMetadata(
-                    METADATA_KEY_MIMETYPE)) != NULL) {
-        status = client.setMimeType(value);
-        if (status) {
-            return MEDIA_SCAN_RESULT_ERROR;
+    entry->mState = ScanEntry::NEW;
+    entry->mLastModified = lastModified;
+    entry->mFileSize = fileSize;
+    entry->mResult = MEDIA_SCAN_RESULT_SKIPPED;
+    entry->mMimeType.clear();
+    entry->mTags.clear();
+
+    return entry;
+}
+
+void StagefrightMediaScanner::startThreads_l() {
+    if (mNumThreads > 0) {
+        return;
+    }
+
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t numThreads = numCpus > 1 ? numCpus : 1;
+    if (numThreads > kMaxScanThreads) {
+        numThreads = kMaxScanThreads;
+    }
+
+    // If no thread can be started, processFile() parses the queued files.
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    while (mNumThreads < numThreads
+            && pthread_create(&mThreads[mNumThreads], &attr, ThreadWrapper, this) == 0) {
+        ++mNumThreads;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// static
+void *StagefrightMediaScanner::ThreadWrapper(void *me) {
+    // Scanning must not get in the way of playback.
+    androidSetThreadPriority(0, ANDROID_PRIORITY_BACKGROUND);
+
+    static_cast<StagefrightMediaScanner *>(me)->threadFunc();
+    return NULL;
+}
+
+void StagefrightMediaScanner::threadFunc() {
+    Mutex::Autolock autoLock(mLock);
+
+    for (;;) {
+        while (!mDone && mQueue.empty()) {
+            mQueueChanged.wait(mLock);
+        }
+        if (mDone) {
+            break;
         }
+
+        String8 path = *mQueue.begin();
+        mQueue.erase(mQueue.begin());
+
+        ssize_t index = mIndex.indexOfKey(path);
+        if (index < 0) {
+            continue;
+        }
+
+        ScanEntry *entry = mIndex.valueAt(index);
+        if (entry->mState != ScanEntry::QUEUED) {
+            // Already taken over by processFile().
+            continue;
+        }
+        entry->mState = ScanEntry::PARSING;
+
+        mLock.unlock();
+        MediaScanResult result = ExtractMetadata(
+                path.string(), &entry->mMimeType, &entry->mTags);
+        mLock.lock();
+
+        entry->mResult = result;
+        entry->mState = ScanEntry::DONE;
+        mIndexDirty = true;
+        ++mNumParsed;
+        mEntryParsed.broadcast();
     }
+}
 
-    struct KeyMap {
-        const char *tag;
-        int key;
-    };
-    static const KeyMap kKeyMap[] = {
-        { "tracknumber", METADATA_KEY_CD_TRACK_NUMBER },
-        { "discnumber", METADATA_KEY_DISC_NUMBER },
-        { "album", METADATA_KEY_ALBUM },
-        { "artist", METADATA_KEY_ARTIST },
-        { "albumartist", METADATA_KEY_ALBUMARTIST },
-        { "composer", METADATA_KEY_COMPOSER },
-        { "genre", METADATA_KEY_GENRE },
-        { "title", METADATA_KEY_TITLE },
-        { "year", METADATA_KEY_YEAR },
-        { "date", METADATA_KEY_DATE },
-        { "duration", METADATA_KEY_DURATION },
-        { "writer", METADATA_KEY_WRITER },
-        { "compilation", METADATA_KEY_COMPILATION },
-        { "isdrm", METADATA_KEY_IS_DRM },
-        { "width", METADATA_KEY_VIDEO_WIDTH },
-        { "height", METADATA_KEY_VIDEO_HEIGHT },
-    };
-    static const size_t kNumEntries = sizeof(kKeyMap) / sizeof(kKeyMap[0]);
+void StagefrightMediaScanner::clearIndex_l() {
+    for (size_t i = 0; i < mIndex.size(); ++i) {
+        delete mIndex.valueAt(i);
+    }
+    mIndex.clear();
+    mQueue.clear();
+}
 
-    for (size_t i = 0; i < kNumEntries; ++i) {
-        const char *value;
-        if ((value = mRetriever->extractMetadata(kKeyMap[i].key)) != NULL) {
-            status = client.addStringTag(kKeyMap[i].tag, value);
-            if (status != OK) {
-                return MEDIA_SCAN_RESULT_ERROR;
-            }
+static bool ReadIndexString(FILE *file, String8 *s) {
+    uint32_t length;
+    if (fread(&length, sizeof(length), 1, file) != 1 || length > kMaxIndexStringLength) {
+        return false;
+    }
+
+    char *buffer = s->lockBuffer(length);
+    if (buffer == NULL) {
+        return false;
+    }
+    bool ok = fread(buffer, 1, length, file) == length;
+    s->unlockBuffer(ok ? length : 0);
+
+    return ok;
+}
+
+static bool WriteIndexString(FILE *file, const String8 &s) {
+    uint32_t length = s.length();
+    return fwrite(&length, sizeof(length), 1, file) == 1
+            && fwrite(s.string(), 1, length, file) == length;
+}
+
+// The index starts with kIndexMagic, kIndexVersion and the number of entries,
+// all uint32_t in host byte order. Each entry holds the path, the modification
+// time and size as int64_t, the scan result as int32_t (kResultNotParsed for
+// files that were only seen), the MIME type, the
+// number of tag strings and the tag names and values. Strings are stored as
+// their uint32_t length followed by the characters.
+status_t StagefrightMediaScanner::loadIndex_l() {
+    FILE *file = fopen(mIndexPath.string(), "rb");
+    if (file == NULL) {
+        return -errno;
+    }
+
+    uint32_t header[3];
+    bool ok = fread(header, sizeof(header), 1, file) == 1
+            && header[0] == kIndexMagic && header[1] == kIndexVersion;
+
+    size_t numLoaded = 0;
+    for (uint32_t i = 0; ok && i < header[2]; ++i) {
+        String8 path;
+        int64_t fingerprint[2];
+        int32_t result;
+        uint32_t numTags;
+        ScanEntry *entry = new ScanEntry;
+
+        ok = ReadIndexString(file, &path)
+                && fread(fingerprint, sizeof(fingerprint), 1, file) == 1
+                && fread(&result, sizeof(result), 1, file) == 1
+                && ReadIndexString(file, &entry->mMimeType)
+                && fread(&numTags, sizeof(numTags), 1, file) == 1
+                && numTags <= kMaxIndexTagStrings;
+
+        for (uint32_t j = 0; ok && j < numTags; ++j) {
+            String8 tag;
+            ok = ReadIndexString(file, &tag);
+            entry->mTags.push(tag);
+        }
+
+        // Files seen by this scanner already are more recent.
+        if (!ok || mIndex.indexOfKey(path) >= 0) {
+            delete entry;
+            continue;
         }
+
+        if (result == kResultNotParsed) {
+            entry->mState = ScanEntry::NEW;
+            entry->mResult = MEDIA_SCAN_RESULT_SKIPPED;
+        } else {
+            entry->mState = ScanEntry::DONE;
+            entry->mResult = (MediaScanResult)result;
+        }
+        entry->mSeen = false;
+        entry->mLastModified = fingerprint[0];
+        entry->mFileSize = fingerprint[1];
+        mIndex.add(path, entry);
+        ++numLoaded;
     }
 
-    return MEDIA_SCAN_RESULT_OK;
+    fclose(file);
+
+    ALOGV("Loaded %zu entries from '%s'", numLoaded, mIndexPath.string());
+
+    if (!ok) {
+        ALOGW("Scan index '%s' is corrupt", mIndexPath.string());
+        mIndexDirty = true;
+        return ERROR_MALFORMED;
+    }
+
+    return OK;
+}
+
+status_t StagefrightMediaScanner::saveIndex_l() {
+    // Write a new file and rename it, so that the index is never left
+    // half written. Scanners in other processes may save it at the same time.
+    String8 tmpPath(mIndexPath);
+    tmpPath.appendFormat(".%d.tmp", getpid());
+
+    FILE *file = fopen(tmpPath.string(), "wb");
+    if (file == NULL) {
+        ALOGW("Unable to create '%s': %s", tmpPath.string(), strerror(errno));
+        return -errno;
+    }
+
+    // Files that were not parsed keep their fingerprint, so that they are not
+    // taken for new files on the next scan.
+    uint32_t header[3] = { kIndexMagic, kIndexVersion, (uint32_t)mIndex.size() };
+
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < mIndex.size(); ++i) {
+        const ScanEntry *entry = mIndex.valueAt(i);
+        bool parsed = entry->mState == ScanEntry::DONE;
+
+        int64_t fingerprint[2] = { entry->mLastModified, entry->mFileSize };
+        int32_t result = parsed ? (int32_t)entry->mResult : kResultNotParsed;
+        uint32_t numTags = parsed ? entry->mTags.size() : 0;
+
+        ok = WriteIndexString(file, mIndex.keyAt(i))
+                && fwrite(fingerprint, sizeof(fingerprint), 1, file) == 1
+                && fwrite(&result, sizeof(result), 1, file) == 1
+                && WriteIndexString(file, parsed ? entry->mMimeType : String8())
+                && fwrite(&numTags, sizeof(numTags), 1, file) == 1;
+
+        for (uint32_t j = 0; ok && j < numTags; ++j) {
+            ok = WriteIndexString(file, entry->mTags[j]);
+        }
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+
+    if (!ok || rename(tmpPath.string(), mIndexPath.string()) != 0) {
+        ALOGW("Unable to save scan index '%s'", mIndexPath.string());
+        unlink(tmpPath.string());
+        return UNKNOWN_ERROR;
+    }
+
+    mIndexDirty = false;
+    return OK;
 }
 
 MediaAlbumArt *StagefrightMediaScanner::extractAlbumArt(int fd) {
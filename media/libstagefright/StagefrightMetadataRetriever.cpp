@@ -18,6 +18,7 @@
 #define LOG_TAG "StagefrightMetadataRetriever"
 
 #include <inttypes.h>
+#include <unistd.h>
 
 #include <utils/Log.h>
 
@@ -39,12 +40,14 @@
 namespace android {
 
 StagefrightMetadataRetriever::StagefrightMetadataRetriever()
-    : mParsedMetaData(false),
+    : mClientConnected(false),
+      mParsedMetaData(false),
       mAlbumArt(NULL) {
     ALOGV("StagefrightMetadataRetriever()");
 
+    // The OMX client is only needed to decode frames, metadata is read from
+    // the container alone. It is connected in getFrameAtTime().
     DataSource::RegisterDefaultSniffers();
-    CHECK_EQ(mClient.connect(), (status_t)OK);
 }
 
 StagefrightMetadataRetriever::~StagefrightMetadataRetriever() {
@@ -53,7 +56,9 @@ StagefrightMetadataRetriever::~StagefrightMetadataRetriever() {
     delete mAlbumArt;
     mAlbumArt = NULL;
 
-    mClient.disconnect();
+    if (mClientConnected) {
+        mClient.disconnect();
+    }
 }
 
 status_t StagefrightMetadataRetriever::setDataSource(
@@ -102,15 +107,20 @@ status_t StagefrightMetadataRetriever::setDataSource(
     delete mAlbumArt;
     mAlbumArt = NULL;
 
-    mSource = new FileSource(fd, offset, length);
+    sp<FileSource> fileSource = new FileSource(fd, offset, length);
 
     status_t err;
-    if ((err = mSource->initCheck()) != OK) {
+    if ((err = fileSource->initCheck()) != OK) {
         mSource.clear();
 
         return err;
     }
 
+    // Extractors read headers and index tables in many small, mostly
+    // sequential chunks.
+    fileSource->setBlockCache(kCacheSize);
+    mSource = fileSource;
+
     mExtractor = MediaExtractor::Create(mSource);
 
     if (mExtractor == NULL) {
@@ -315,6 +325,7 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
 
     ColorConverter converter(
             (OMX_COLOR_FORMATTYPE)srcFormat, OMX_COLOR_Format16bitRGB565);
+    converter.setNumThreads(sysconf(_SC_NPROCESSORS_ONLN));
 
     if (converter.isValid()) {
         err = converter.convert(
@@ -393,6 +404,14 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
         return NULL;
     }
 
+    if (!mClientConnected) {
+        if (mClient.connect() != OK) {
+            ALOGE("unable to connect to the OMX service.");
+            return NULL;
+        }
+        mClientConnected = true;
+    }
+
     sp<MetaData> trackMeta = mExtractor->getTrackMetaData(
             i, MediaExtractor::kIncludeExtensiveMetaData);
 
@@ -16,6 +16,15 @@
  * -------------------------------------------------------------------
  */
 #include "avcenc_lib.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SUBPEL_SIMD
+#elif defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#define SUBPEL_SIMD
+#endif
 /* 3/29/01 fast half-pel search based on neighboring guess */
 /* value ranging from 0 to 4, high complexity (more accurate) to
    low complexity (less accurate) */
@@ -143,6 +152,297 @@ int AVCFindHalfPelMB(AVCEncObject *encvid, uint8 *cur, AVCMV *mot, uint8 *ncand,
 Each sub-pel position array is 20 pixel wide (for word-alignment) and 17 pixel tall. */
 /** The sub-pel position is labeled in spiral manner from the center. */
 
+#if defined(SUBPEL_SIMD)
+
+/* The vector kernels below each produce 16 outputs of one row; the
+ * 17th/18th columns are left to scalar code. Every kernel is bit-exact
+ * with the scalar code it replaces, including the borrow between packed
+ * lanes in the SWAR vertical filter, since motion search decisions (and
+ * so the bitstream) depend on the exact predictions. */
+
+#if defined(__SSE2__)
+
+/* 6-tap filter of p[0..20] into 16 intermediate values, optionally also
+   rounded and clipped to pixels */
+static inline void HorzInterp16(uint8 *p, int16 *dst_16, uint8 *dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k5 = _mm_set1_epi16(5);
+    const __m128i k20 = _mm_set1_epi16(20);
+    __m128i x0 = _mm_loadu_si128((const __m128i*)p);
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(p + 1));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(p + 2));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(p + 3));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(p + 4));
+    __m128i x5 = _mm_loadu_si128((const __m128i*)(p + 5));
+    __m128i lo, hi;
+
+    lo = _mm_add_epi16(_mm_unpacklo_epi8(x0, zero), _mm_unpacklo_epi8(x5, zero));
+    lo = _mm_sub_epi16(lo, _mm_mullo_epi16(k5, _mm_add_epi16(_mm_unpacklo_epi8(x1, zero), _mm_unpacklo_epi8(x4, zero))));
+    lo = _mm_add_epi16(lo, _mm_mullo_epi16(k20, _mm_add_epi16(_mm_unpacklo_epi8(x2, zero), _mm_unpacklo_epi8(x3, zero))));
+    hi = _mm_add_epi16(_mm_unpackhi_epi8(x0, zero), _mm_unpackhi_epi8(x5, zero));
+    hi = _mm_sub_epi16(hi, _mm_mullo_epi16(k5, _mm_add_epi16(_mm_unpackhi_epi8(x1, zero), _mm_unpackhi_epi8(x4, zero))));
+    hi = _mm_add_epi16(hi, _mm_mullo_epi16(k20, _mm_add_epi16(_mm_unpackhi_epi8(x2, zero), _mm_unpackhi_epi8(x3, zero))));
+
+    _mm_storeu_si128((__m128i*)dst_16, lo);
+    _mm_storeu_si128((__m128i*)(dst_16 + 8), hi);
+
+    if (dst)
+    {
+        const __m128i k16 = _mm_set1_epi16(16);
+        lo = _mm_srai_epi16(_mm_add_epi16(lo, k16), 5);
+        hi = _mm_srai_epi16(_mm_add_epi16(hi, k16), 5);
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+    }
+}
+
+/* 6-tap filter of 8 columns of the intermediate values, pitch 18 */
+static inline __m128i MiddleInterp8(int16 *src_16)
+{
+    const __m128i k1m5 = _mm_set_epi16(-5, 1, -5, 1, -5, 1, -5, 1);
+    const __m128i k20 = _mm_set1_epi16(20);
+    const __m128i km51 = _mm_set_epi16(1, -5, 1, -5, 1, -5, 1, -5);
+    const __m128i k512 = _mm_set1_epi32(512);
+    __m128i r0 = _mm_loadu_si128((const __m128i*)src_16);
+    __m128i r1 = _mm_loadu_si128((const __m128i*)(src_16 + 18));
+    __m128i r2 = _mm_loadu_si128((const __m128i*)(src_16 + 36));
+    __m128i r3 = _mm_loadu_si128((const __m128i*)(src_16 + 54));
+    __m128i r4 = _mm_loadu_si128((const __m128i*)(src_16 + 72));
+    __m128i r5 = _mm_loadu_si128((const __m128i*)(src_16 + 90));
+    __m128i lo, hi;
+
+    lo = _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), k1m5);
+    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r2, r3), k20));
+    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r4, r5), km51));
+    hi = _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), k1m5);
+    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r2, r3), k20));
+    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r4, r5), km51));
+
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, k512), 10);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, k512), 10);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+static inline void MiddleInterp16(int16 *src_16, uint8 *dst)
+{
+    _mm_storeu_si128((__m128i*)dst,
+                     _mm_packus_epi16(MiddleInterp8(src_16), MiddleInterp8(src_16 + 8)));
+}
+
+/* Vertical 6-tap filter of 16 columns, pitch 24. The scalar code packs
+   columns (0,2) and (1,3) of every 4 into two 16-bit halves of a word, so
+   a negative sum in column 0 (1) borrows one from column 2 (3). */
+static inline __m128i VertInterp8(uint8 *ref, int hi_half)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i borrow = _mm_set_epi16(-1, -1, 0, 0, -1, -1, 0, 0);
+    __m128i x[6], v;
+    int k;
+
+    for (k = 0; k < 6; k++)
+    {
+        x[k] = _mm_loadu_si128((const __m128i*)(ref + 24 * k));
+        x[k] = hi_half ? _mm_unpackhi_epi8(x[k], zero) : _mm_unpacklo_epi8(x[k], zero);
+    }
+
+    v = _mm_add_epi16(x[0], x[5]);
+    v = _mm_sub_epi16(v, _mm_mullo_epi16(_mm_set1_epi16(5), _mm_add_epi16(x[1], x[4])));
+    v = _mm_add_epi16(v, _mm_mullo_epi16(_mm_set1_epi16(20), _mm_add_epi16(x[2], x[3])));
+    v = _mm_add_epi16(v, _mm_set1_epi16(16));
+
+    v = _mm_add_epi16(v, _mm_and_si128(_mm_cmplt_epi16(_mm_slli_si128(v, 4), zero), borrow));
+
+    return _mm_srai_epi16(v, 5);
+}
+
+static inline void VertInterp16(uint8 *ref, uint8 *dst)
+{
+    _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(VertInterp8(ref, 0), VertInterp8(ref, 1)));
+}
+
+static inline void Average16(uint8 *dst, uint8 *a, uint8 *b)
+{
+    _mm_storeu_si128((__m128i*)dst, _mm_avg_epu8(_mm_loadu_si128((const __m128i*)a),
+                     _mm_loadu_si128((const __m128i*)b)));
+}
+
+#else /* NEON */
+
+static inline void HorzInterp16(uint8 *p, int16 *dst_16, uint8 *dst)
+{
+    uint8x16_t x0 = vld1q_u8(p);
+    uint8x16_t x1 = vld1q_u8(p + 1);
+    uint8x16_t x2 = vld1q_u8(p + 2);
+    uint8x16_t x3 = vld1q_u8(p + 3);
+    uint8x16_t x4 = vld1q_u8(p + 4);
+    uint8x16_t x5 = vld1q_u8(p + 5);
+    uint16x8_t lo, hi;
+
+    /* wraps around in 16 bits, the results fit in int16 */
+    lo = vaddl_u8(vget_low_u8(x0), vget_low_u8(x5));
+    lo = vmlsq_n_u16(lo, vaddl_u8(vget_low_u8(x1), vget_low_u8(x4)), 5);
+    lo = vmlaq_n_u16(lo, vaddl_u8(vget_low_u8(x2), vget_low_u8(x3)), 20);
+    hi = vaddl_u8(vget_high_u8(x0), vget_high_u8(x5));
+    hi = vmlsq_n_u16(hi, vaddl_u8(vget_high_u8(x1), vget_high_u8(x4)), 5);
+    hi = vmlaq_n_u16(hi, vaddl_u8(vget_high_u8(x2), vget_high_u8(x3)), 20);
+
+    vst1q_s16(dst_16, vreinterpretq_s16_u16(lo));
+    vst1q_s16(dst_16 + 8, vreinterpretq_s16_u16(hi));
+
+    if (dst)
+    {
+        vst1q_u8(dst, vcombine_u8(vqrshrun_n_s16(vreinterpretq_s16_u16(lo), 5),
+                                  vqrshrun_n_s16(vreinterpretq_s16_u16(hi), 5)));
+    }
+}
+
+static inline uint16x4_t MiddleInterp4(int16 *src_16)
+{
+    int32x4_t v;
+
+    v = vaddl_s16(vld1_s16(src_16), vld1_s16(src_16 + 90));
+    v = vmlsq_n_s32(v, vaddl_s16(vld1_s16(src_16 + 18), vld1_s16(src_16 + 72)), 5);
+    v = vmlaq_n_s32(v, vaddl_s16(vld1_s16(src_16 + 36), vld1_s16(src_16 + 54)), 20);
+
+    return vqrshrun_n_s32(v, 10);
+}
+
+static inline void MiddleInterp16(int16 *src_16, uint8 *dst)
+{
+    uint16x8_t lo = vcombine_u16(MiddleInterp4(src_16), MiddleInterp4(src_16 + 4));
+    uint16x8_t hi = vcombine_u16(MiddleInterp4(src_16 + 8), MiddleInterp4(src_16 + 12));
+
+    vst1q_u8(dst, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+}
+
+/* see the SSE2 version for the borrow */
+static inline uint8x8_t VertInterp8(uint16x8_t x05, uint16x8_t x14, uint16x8_t x23)
+{
+    static const uint16 kBorrow[8] = { 0, 0, 0xFFFF, 0xFFFF, 0, 0, 0xFFFF, 0xFFFF };
+    int16x8_t v;
+    uint16x8_t neg;
+
+    v = vreinterpretq_s16_u16(vmlaq_n_u16(vmlsq_n_u16(x05, x14, 5), x23, 20));
+    v = vaddq_s16(v, vdupq_n_s16(16));
+    neg = vcltq_s16(vextq_s16(vdupq_n_s16(0), v, 6), vdupq_n_s16(0));
+    v = vaddq_s16(v, vreinterpretq_s16_u16(vandq_u16(neg, vld1q_u16(kBorrow))));
+
+    return vqshrun_n_s16(v, 5);
+}
+
+static inline void VertInterp16(uint8 *ref, uint8 *dst)
+{
+    uint8x16_t x0 = vld1q_u8(ref);
+    uint8x16_t x1 = vld1q_u8(ref + 24);
+    uint8x16_t x2 = vld1q_u8(ref + 48);
+    uint8x16_t x3 = vld1q_u8(ref + 72);
+    uint8x16_t x4 = vld1q_u8(ref + 96);
+    uint8x16_t x5 = vld1q_u8(ref + 120);
+
+    vst1q_u8(dst, vcombine_u8(
+                 VertInterp8(vaddl_u8(vget_low_u8(x0), vget_low_u8(x5)),
+                             vaddl_u8(vget_low_u8(x1), vget_low_u8(x4)),
+                             vaddl_u8(vget_low_u8(x2), vget_low_u8(x3))),
+                 VertInterp8(vaddl_u8(vget_high_u8(x0), vget_high_u8(x5)),
+                             vaddl_u8(vget_high_u8(x1), vget_high_u8(x4)),
+                             vaddl_u8(vget_high_u8(x2), vget_high_u8(x3)))));
+}
+
+static inline void Average16(uint8 *dst, uint8 *a, uint8 *b)
+{
+    vst1q_u8(dst, vrhaddq_u8(vld1q_u8(a), vld1q_u8(b)));
+}
+
+#endif /* __SSE2__ */
+
+static inline int Interp6Tap(uint8 *p, int pitch)
+{
+    return p[0] + p[5 * pitch] - 5 * (p[pitch] + p[4 * pitch]) + 20 * (p[2 * pitch] + p[3 * pitch]);
+}
+
+void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
+{
+    uint8 *ref;
+    uint8 *dst;
+    int32 tmp32;
+    int16 tmp_horz[18*22], *dst_16, *src_16;
+    int i, j;
+
+    /* first copy full-pel to the first array, 24x22 */
+    ref = ncand - 3 - lx - (lx << 1); /* move back (-3,-3) */
+    dst = subpel_pred;
+    for (j = 0; j < 22; j++)
+    {
+        memcpy(dst, ref, 24);
+        dst += 24;
+        ref += lx;
+    }
+
+    /* horizontal interp of all 22 lines into tmp_horz (17 x 22), the
+       middle 18 lines also go to the 14th array 17x18 */
+    ref = subpel_pred;
+    dst_16 = tmp_horz;
+    dst = subpel_pred + V0Q_H2Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 22; j++)
+    {
+        if (j < 2 || j >= 20)
+        {
+            HorzInterp16(ref, dst_16, NULL);
+            dst_16[16] = Interp6Tap(ref + 16, 1);
+        }
+        else
+        {
+            HorzInterp16(ref, dst_16, dst);
+            tmp32 = dst_16[16] = Interp6Tap(ref + 16, 1);
+            tmp32 = (tmp32 + 16) >> 5;
+            CLIP_RESULT(tmp32)
+            dst[16] = tmp32;
+            dst += 24;
+        }
+        dst_16 += 18;
+        ref += 24;
+    }
+
+    /* middle point filtering into the 12th array 17x17 */
+    src_16 = tmp_horz;
+    dst = subpel_pred + V2Q_H2Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 17; j++)
+    {
+        MiddleInterp16(src_16, dst);
+
+        tmp32 = src_16[16] + src_16[16 + 90] - 5 * (src_16[16 + 18] + src_16[16 + 72])
+                + 20 * (src_16[16 + 36] + src_16[16 + 54]);
+        tmp32 = (tmp32 + 512) >> 10;
+        CLIP_RESULT(tmp32)
+        dst[16] = tmp32;
+
+        src_16 += 18;
+        dst += 24;
+    }
+
+    /* vertical interp into the 10th array 18x17 */
+    ref = subpel_pred + 2;
+    dst = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 17; j++)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            tmp32 = (Interp6Tap(ref + i, 24) + 16) >> 5;
+            CLIP_RESULT(tmp32)
+            dst[i] = tmp32;
+        }
+        VertInterp16(ref + 2, dst + 2);
+
+        ref += 24;
+        dst += 24;
+    }
+
+    return ;
+}
+
+#else /* SUBPEL_SIMD */
+
 void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
 {
     /* let's do straightforward way first */
@@ -453,6 +753,8 @@ void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
     return ;
 }
 
+#endif /* SUBPEL_SIMD */
+
 void VertInterpWClip(uint8 *dst, uint8 *ref)
 {
     int i, j;
@@ -513,6 +815,66 @@ void VertInterpWClip(uint8 *dst, uint8 *ref)
 }
 
 
+#if defined(SUBPEL_SIMD)
+
+void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
+{
+    // for even value of hpel_pos, start with pattern 1, otherwise, start with pattern 2
+    int j;
+
+    uint8 *c1 = qpel_cand;
+    uint8 *tl = bilin_base[0];
+    uint8 *tr = bilin_base[1];
+    uint8 *bl = bilin_base[2];
+    uint8 *br = bilin_base[3];
+
+    if (!(hpel_pos&1)) // diamond pattern
+    {
+        for (j = 16; j > 0; j--)
+        {
+            Average16(c1, br, tr);
+            Average16(c1 + 384, bl + 1, tr);          /* c2 */
+            Average16(c1 + 384 * 2, bl + 1, br);      /* c3 */
+            Average16(c1 + 384 * 3, bl + 1, tr + 24); /* c4 */
+            Average16(c1 + 384 * 4, br, tr + 24);     /* c5 */
+            Average16(c1 + 384 * 5, bl, tr + 24);     /* c6 */
+            Average16(c1 + 384 * 6, bl, br);          /* c7 */
+            Average16(c1 + 384 * 7, bl, tr);          /* c8 */
+
+            // advance to the next line, pitch is 24
+            tr += 24;
+            bl += 24;
+            br += 24;
+            c1 += 24;
+        }
+    }
+    else // star pattern
+    {
+        for (j = 16; j > 0; j--)
+        {
+            Average16(c1, br, tr);
+            Average16(c1 + 384, br, tl + 1);          /* c2 */
+            Average16(c1 + 384 * 2, br, bl + 1);      /* c3 */
+            Average16(c1 + 384 * 3, br, tl + 25);     /* c4 */
+            Average16(c1 + 384 * 4, br, tr + 24);     /* c5 */
+            Average16(c1 + 384 * 5, br, tl + 24);     /* c6 */
+            Average16(c1 + 384 * 6, br, bl);          /* c7 */
+            Average16(c1 + 384 * 7, br, tl);          /* c8 */
+
+            // advance to the next line, pitch is 24
+            tl += 24;
+            tr += 24;
+            bl += 24;
+            br += 24;
+            c1 += 24;
+        }
+    }
+
+    return ;
+}
+
+#else /* SUBPEL_SIMD */
+
 void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
 {
     // for even value of hpel_pos, start with pattern 1, otherwise, start with pattern 2
@@ -601,6 +963,7 @@ void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
     return ;
 }
 
+#endif /* SUBPEL_SIMD */
 
 /* assuming cand always has a pitch of 24 */
 int SATD_MB(uint8 *cand, uint8 *cur, int dmin)
@@ -18,6 +18,12 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -75,6 +81,66 @@ extern "C"
 #define SHIFT 8
 #include "sad_mb_offset.h"
 
+#if defined(__SSE2__)
+
+    /* 16 pixels per row with unaligned loads, so no offset variants are
+     * needed. The running sum is checked against dmin after every row,
+     * exactly like the C version, so callers see the same partial SAD. */
+    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    {
+        __m128i sum = _mm_setzero_si128();
+        int32 sad;
+        int i;
+
+        for (i = 16; i > 0; i--)
+        {
+            __m128i r = _mm_loadu_si128((const __m128i*)ref);
+            __m128i b = _mm_loadu_si128((const __m128i*)blk);
+
+            sum = _mm_add_epi32(sum, _mm_sad_epu8(r, b));
+            sad = _mm_cvtsi128_si32(_mm_add_epi32(sum, _mm_srli_si128(sum, 8)));
+            if (sad > dmin)
+            {
+                break;
+            }
+            ref += lx;
+            blk += 16;
+        }
+
+        return sad;
+    }
+
+#elif defined(__ARM_NEON__) || defined(__aarch64__)
+
+    /* see the SSE2 version above */
+    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    {
+        uint16x8_t sum = vdupq_n_u16(0);
+        int32 sad;
+        int i;
+
+        for (i = 16; i > 0; i--)
+        {
+            uint8x16_t r = vld1q_u8(ref);
+            uint8x16_t b = vld1q_u8(blk);
+            uint64x2_t total;
+
+            sum = vabal_u8(sum, vget_low_u8(r), vget_low_u8(b));
+            sum = vabal_u8(sum, vget_high_u8(r), vget_high_u8(b));
+            total = vpaddlq_u32(vpaddlq_u16(sum));
+            sad = (int32)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+            if (sad > dmin)
+            {
+                break;
+            }
+            ref += lx;
+            blk += 16;
+        }
+
+        return sad;
+    }
+
+#else
 
     __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
     {
@@ -169,6 +235,8 @@ SadMBOffset1:
 
     }
 
+#endif /* __SSE2__ */
+
 #elif defined(__CC_ARM)  /* only work with arm v5 */
 
     __inline int32 SUB_SAD(int32 sad, int32 tmp, int32 tmp2)
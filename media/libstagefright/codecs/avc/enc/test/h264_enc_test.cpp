@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Encodes a raw YUV 4:2:0 planar file with the software AVC encoder and
+ * reports the encoding speed, bitrate and PSNR of the reconstruction, so
+ * that speed or quality regressions in the encoder are easy to spot on a
+ * fixed input.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "avcenc_api.h"
+
+#define MAX_DPB_BUFFERS 17
+
+struct EncoderContext {
+    uint8_t *dpb[MAX_DPB_BUFFERS];
+    unsigned int numDpb;
+};
+
+static void *MallocCb(void * /* userData */, int32_t size, int32_t /* attrs */) {
+    void *ptr = malloc(size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+static void FreeCb(void * /* userData */, void *ptr) {
+    free(ptr);
+}
+
+static int32_t DpbAllocCb(void *userData, unsigned int sizeInMbs, unsigned int numBuffers) {
+    EncoderContext *ctx = (EncoderContext *)userData;
+    if (numBuffers > MAX_DPB_BUFFERS) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < numBuffers; ++i) {
+        ctx->dpb[i] = (uint8_t *)malloc((sizeInMbs << 7) * 3);
+        if (ctx->dpb[i] == NULL) {
+            return 0;
+        }
+    }
+    ctx->numDpb = numBuffers;
+    return 1;
+}
+
+static int32_t BindFrameCb(void *userData, int32_t index, uint8_t **yuv) {
+    EncoderContext *ctx = (EncoderContext *)userData;
+    if (index < 0 || (unsigned int)index >= ctx->numDpb) {
+        return 0;
+    }
+    *yuv = ctx->dpb[index];
+    return 1;
+}
+
+static void UnbindFrameCb(void * /* userData */, int32_t /* index */) {
+}
+
+static int64_t nowUs() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000ll + t.tv_nsec / 1000;
+}
+
+// Returns the sum of squared differences of a width x height plane.
+static uint64_t sumSquaredError(
+        const uint8_t *a, int aStride, const uint8_t *b, int bStride,
+        int width, int height) {
+    uint64_t sse = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int d = a[x] - b[x];
+            sse += d * d;
+        }
+        a += aStride;
+        b += bStride;
+    }
+    return sse;
+}
+
+static double psnr(uint64_t sse, uint64_t numSamples) {
+    if (sse == 0) {
+        return 99.0;
+    }
+    return 10.0 * log10(255.0 * 255.0 * numSamples / sse);
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [options] input.yuv width height\n"
+            "  -o file    write the elementary stream to file\n"
+            "  -n frames  encode at most this many frames\n"
+            "  -r fps     frame rate (default 30)\n"
+            "  -b kbps    target bitrate (default 4 bits per pixel per second)\n"
+            "  -q qp      constant QP, disables rate control\n"
+            "  -i period  IDR period in frames (default 30)\n"
+            "  -s         enable sub-pel and sub-macroblock motion search\n",
+            me);
+}
+
+int main(int argc, char **argv) {
+    const char *outPath = NULL;
+    int maxFrames = -1;
+    int frameRate = 30;
+    int bitrateKbps = 0;
+    int qp = 0;
+    int idrPeriod = 30;
+    bool subPel = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "o:n:r:b:q:i:s")) >= 0) {
+        switch (res) {
+            case 'o': outPath = optarg; break;
+            case 'n': maxFrames = atoi(optarg); break;
+            case 'r': frameRate = atoi(optarg); break;
+            case 'b': bitrateKbps = atoi(optarg); break;
+            case 'q': qp = atoi(optarg); break;
+            case 'i': idrPeriod = atoi(optarg); break;
+            case 's': subPel = true; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (argc - optind != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *inPath = argv[optind];
+    int width = atoi(argv[optind + 1]);
+    int height = atoi(argv[optind + 2]);
+    if (width <= 0 || height <= 0 || (width & 15) || (height & 15)) {
+        fprintf(stderr, "width and height must be positive multiples of 16\n");
+        return 1;
+    }
+    if (frameRate <= 0) {
+        fprintf(stderr, "invalid frame rate %d\n", frameRate);
+        return 1;
+    }
+
+    FILE *in = fopen(inPath, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "unable to open %s\n", inPath);
+        return 1;
+    }
+    FILE *out = NULL;
+    if (outPath != NULL && (out = fopen(outPath, "wb")) == NULL) {
+        fprintf(stderr, "unable to open %s\n", outPath);
+        fclose(in);
+        return 1;
+    }
+
+    EncoderContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+
+    AVCHandle handle;
+    memset(&handle, 0, sizeof(handle));
+    handle.AVCObject = NULL;
+    handle.userData = &ctx;
+    handle.CBAVC_DPBAlloc = DpbAllocCb;
+    handle.CBAVC_FrameBind = BindFrameCb;
+    handle.CBAVC_FrameUnbind = UnbindFrameCb;
+    handle.CBAVC_Malloc = MallocCb;
+    handle.CBAVC_Free = FreeCb;
+
+    // Same configuration as SoftAVCEncoder, apart from the options above.
+    uint32_t *sliceGroup = (uint32_t *)calloc((width / 16) * (height / 16), sizeof(uint32_t));
+
+    AVCEncParams params;
+    memset(&params, 0, sizeof(params));
+    params.rate_control = qp > 0 ? AVC_OFF : AVC_ON;
+    params.initQP = qp;
+    params.init_CBP_removal_delay = 1600;
+    params.auto_scd = AVC_ON;
+    params.out_of_band_param_set = AVC_ON;
+    params.poc_type = 2;
+    params.log2_max_poc_lsb_minus_4 = 12;
+    params.num_ref_frame = 1;
+    params.num_slice_group = 1;
+    params.slice_group = sliceGroup;
+    params.db_filter = AVC_ON;
+    params.constrained_intra_pred = AVC_OFF;
+    params.fullsearch = AVC_OFF;
+    params.search_range = 16;
+    params.sub_pel = subPel ? AVC_ON : AVC_OFF;
+    params.submb_pred = subPel ? AVC_ON : AVC_OFF;
+    params.width = width;
+    params.height = height;
+    params.bitrate = bitrateKbps > 0 ? bitrateKbps * 1000 : width * height * 4;
+    params.CPB_size = params.bitrate >> 1;
+    params.frame_rate = frameRate * 1000;
+    params.idr_period = idrPeriod;
+    params.profile = AVC_BASELINE;
+    params.level = AVC_LEVEL5_1;
+
+    if (PVAVCEncInitialize(&handle, &params, NULL, NULL) != AVCENC_SUCCESS) {
+        fprintf(stderr, "failed to initialize the encoder\n");
+        return 1;
+    }
+
+    int outSize = 0;
+    PVAVCEncGetMaxOutputBufferSize(&handle, &outSize);
+    if (outSize < width * height * 3 / 2) {
+        outSize = width * height * 3 / 2;
+    }
+    uint8_t *outBuffer = (uint8_t *)malloc(outSize);
+
+    static const uint8_t kStartCode[4] = { 0x00, 0x00, 0x00, 0x01 };
+    uint64_t totalBytes = 0;
+    uint32_t nalSize;
+    int nalType;
+    AVCEnc_Status status;
+
+    // Parameter sets are produced before the first frame.
+    for (;;) {
+        nalSize = outSize;
+        status = PVAVCEncodeNAL(&handle, outBuffer, &nalSize, &nalType);
+        if (status != AVCENC_SUCCESS) {
+            break;
+        }
+        totalBytes += nalSize + sizeof(kStartCode);
+        if (out != NULL) {
+            fwrite(kStartCode, 1, sizeof(kStartCode), out);
+            fwrite(outBuffer, 1, nalSize, out);
+        }
+    }
+
+    const size_t frameSize = width * height * 3 / 2;
+    uint8_t *frame = (uint8_t *)malloc(frameSize);
+
+    int numFrames = 0, numEncoded = 0, numSkipped = 0;
+    uint64_t sse[3] = { 0, 0, 0 };
+    int64_t encodeUs = 0;
+    bool failed = false;
+
+    while ((maxFrames < 0 || numFrames < maxFrames)
+            && fread(frame, 1, frameSize, in) == frameSize) {
+        AVCFrameIO input;
+        memset(&input, 0, sizeof(input));
+        input.height = height;
+        input.pitch = width;
+        input.coding_timestamp = (numFrames * 1000ll) / frameRate;
+        input.disp_order = numFrames;
+        input.YCbCr[0] = frame;
+        input.YCbCr[1] = frame + width * height;
+        input.YCbCr[2] = input.YCbCr[1] + width * height / 4;
+        ++numFrames;
+
+        int64_t startUs = nowUs();
+
+        status = PVAVCEncSetInput(&handle, &input);
+        if (status == AVCENC_SKIPPED_PICTURE) {
+            // Dropped by rate control.
+            encodeUs += nowUs() - startUs;
+            ++numSkipped;
+            continue;
+        } else if (status != AVCENC_SUCCESS && status != AVCENC_NEW_IDR) {
+            fprintf(stderr, "PVAVCEncSetInput failed: %d\n", status);
+            failed = true;
+            break;
+        }
+
+        do {
+            nalSize = outSize;
+            status = PVAVCEncodeNAL(&handle, outBuffer, &nalSize, &nalType);
+            if (status != AVCENC_SUCCESS && status != AVCENC_PICTURE_READY) {
+                break;
+            }
+            totalBytes += nalSize + sizeof(kStartCode);
+            if (out != NULL) {
+                fwrite(kStartCode, 1, sizeof(kStartCode), out);
+                fwrite(outBuffer, 1, nalSize, out);
+            }
+        } while (status != AVCENC_PICTURE_READY);
+
+        encodeUs += nowUs() - startUs;
+
+        if (status != AVCENC_PICTURE_READY) {
+            fprintf(stderr, "PVAVCEncodeNAL failed: %d\n", status);
+            failed = true;
+            break;
+        }
+
+        AVCFrameIO recon;
+        if (PVAVCEncGetRecon(&handle, &recon) == AVCENC_SUCCESS) {
+            sse[0] += sumSquaredError(input.YCbCr[0], width,
+                    recon.YCbCr[0], recon.pitch, width, height);
+            for (int i = 1; i < 3; ++i) {
+                sse[i] += sumSquaredError(input.YCbCr[i], width / 2,
+                        recon.YCbCr[i], recon.pitch / 2, width / 2, height / 2);
+            }
+            PVAVCEncReleaseRecon(&handle, &recon);
+            ++numEncoded;
+        }
+    }
+
+    PVAVCCleanUpEncoder(&handle);
+
+    if (numEncoded > 0) {
+        uint64_t lumaSamples = (uint64_t)width * height * numEncoded;
+        double seconds = encodeUs / 1E6;
+
+        printf("%dx%d, %d frames (%d skipped) in %.3f s: %.2f fps\n",
+               width, height, numFrames, numSkipped, seconds,
+               seconds > 0 ? numFrames / seconds : 0.0);
+        printf("bitrate %.1f kbps\n",
+               totalBytes * 8.0 * frameRate / numFrames / 1000.0);
+        printf("PSNR Y %.3f U %.3f V %.3f dB\n",
+               psnr(sse[0], lumaSamples),
+               psnr(sse[1], lumaSamples / 4),
+               psnr(sse[2], lumaSamples / 4));
+    }
+
+    free(frame);
+    free(outBuffer);
+    free(sliceGroup);
+    for (unsigned int i = 0; i < ctx.numDpb; ++i) {
+        free(ctx.dpb[i]);
+    }
+    if (out != NULL) {
+        fclose(out);
+    }
+    fclose(in);
+
+    return failed ? 1 : 0;
+}
@@ -6,6 +6,7 @@ LOCAL_SRC_FILES := \
     src/combined_encode.cpp \
     src/datapart_encode.cpp \
     src/dct.cpp \
+    src/enc_threads.cpp \
     src/findhalfpel.cpp \
     src/fastcodemb.cpp \
     src/fastidct.cpp \
@@ -73,6 +73,7 @@ SoftMPEG4Encoder::SoftMPEG4Encoder(
             callbacks, appData, component),
       mEncodeMode(COMBINE_MODE_WITH_ERR_RES),
       mIDRFrameRefreshIntervalInSec(1),
+      mNumThreads(0),
       mNumInputFrames(-1),
       mStarted(false),
       mSawInputEOS(false),
@@ -166,6 +167,7 @@ OMX_ERRORTYPE SoftMPEG4Encoder::initEncParams() {
     mEncParams->gobHeaderInterval = 0;
     mEncParams->useACPred = PV_ON;
     mEncParams->intraDCVlcTh = 0;
+    mEncParams->numThreads = mNumThreads > 0 ? mNumThreads : GetCPUCoreCount();
 
     return OMX_ErrorNone;
 }
@@ -217,7 +219,9 @@ OMX_ERRORTYPE SoftMPEG4Encoder::releaseEncoder() {
 
 OMX_ERRORTYPE SoftMPEG4Encoder::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
-    switch (index) {
+    int32_t indexFull = index;
+
+    switch (indexFull) {
         case OMX_IndexParamVideoBitrate:
         {
             OMX_VIDEO_PARAM_BITRATETYPE *bitRate =
@@ -277,6 +281,18 @@ OMX_ERRORTYPE SoftMPEG4Encoder::internalGetParameter(
             return OMX_ErrorNone;
         }
 
+        case kThreadCountExtensionIndex:
+        {
+            OMX_PARAM_U32TYPE *threadCount = (OMX_PARAM_U32TYPE *)params;
+
+            if (threadCount->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            threadCount->nU32 = mNumThreads;
+            return OMX_ErrorNone;
+        }
+
         default:
             return SoftVideoEncoderOMXComponent::internalGetParameter(index, params);
     }
@@ -348,11 +364,34 @@ OMX_ERRORTYPE SoftMPEG4Encoder::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case kThreadCountExtensionIndex:
+        {
+            const OMX_PARAM_U32TYPE *threadCount =
+                (const OMX_PARAM_U32TYPE *)params;
+
+            if (threadCount->nPortIndex != 1 || (int32_t)threadCount->nU32 < 0) {
+                return OMX_ErrorUndefined;
+            }
+
+            // the encoder clamps it to the number of threads it supports
+            mNumThreads = threadCount->nU32;
+            return OMX_ErrorNone;
+        }
+
         default:
             return SoftVideoEncoderOMXComponent::internalSetParameter(index, params);
     }
 }
 
+OMX_ERRORTYPE SoftMPEG4Encoder::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.encoderThreadCount")) {
+        *(int32_t*)index = kThreadCountExtensionIndex;
+        return OMX_ErrorNone;
+    }
+    return SoftVideoEncoderOMXComponent::getExtensionIndex(name, index);
+}
+
 void SoftMPEG4Encoder::onQueueFilled(OMX_U32 /* portIndex */) {
     if (mSignalledError || mSawInputEOS) {
         return;
@@ -49,6 +49,8 @@ struct SoftMPEG4Encoder : public SoftVideoEncoderOMXComponent {
 
     virtual void onQueueFilled(OMX_U32 portIndex);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(const char *name, OMX_INDEXTYPE *index);
+
 protected:
     virtual ~SoftMPEG4Encoder();
 
@@ -57,6 +59,12 @@ private:
         kNumBuffers = 2,
     };
 
+    enum {
+        // OMX_PARAM_U32TYPE on the output port, the number of threads the encoder
+        // uses including the calling one, or 0 for one per CPU core
+        kThreadCountExtensionIndex = kPrepareForAdaptivePlaybackIndex + 1,
+    };
+
     // OMX input buffer's timestamp and flags
     typedef struct {
         int64_t mTimeUs;
@@ -65,6 +73,7 @@ private:
 
     MP4EncodingMode mEncodeMode;
     int32_t  mIDRFrameRefreshIntervalInSec;
+    int32_t  mNumThreads;
 
     int64_t  mNumInputFrames;
     bool     mStarted;
@@ -234,6 +234,12 @@ typedef struct tagvideoEncOptions
     /** @brief This flag turns on the use of AC prediction */
     Bool                useACPred;
 
+    /** @brief  Sets the number of threads used to encode a frame, the calling thread included.
+    *           Motion estimation runs on macroblock rows in wavefront order and macroblock coding
+    *           runs ahead of VLC encoding, the bitstream is identical for any number of threads.
+    *           0 or 1 encodes on the calling thread only (default). */
+    Int                 numThreads;
+
 } VideoEncOptions;
 
 #ifdef __cplusplus
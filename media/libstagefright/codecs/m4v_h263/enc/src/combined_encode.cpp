@@ -24,6 +24,15 @@
 
 PV_STATUS EncodeGOBHeader(VideoEncData *video, Int GOB_number, Int quant_scale, Int bs1stream);
 
+/* MB coding done by the worker threads ahead of the VLC encoding */
+typedef struct tagCodeMBJob
+{
+    PV_STATUS(*CodeMB)(VideoEncData *, approxDCT *, Int, Int[]);
+    PV_STATUS threadStatus[MAX_ENC_THREADS]; /* worst CodeMB status of each worker */
+} CodeMBJob;
+
+static void CodeMBRowsJob(VideoEncData *video, Int index, void *arg);
+
 /* ======================================================================== */
 /*  Function : EncodeFrameCombinedMode()                                    */
 /*  Date     : 09/01/2000                                                   */
@@ -57,6 +66,12 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
     PV_STATUS(*CodeMB)(VideoEncData *, approxDCT *, Int, Int[]);
     void (*MBVlcEncode)(VideoEncData*, Int[], void *);
     void (*BlockCodeCoeff)(RunLevelBlock*, BitstreamEncVideo*, Int, Int, UChar);
+    EncThreads *threads = video->threads;
+    MacroBlock *outputMB = video->outputMB;
+    CodedMB *coded = NULL;
+    CodeMBJob job;
+    PV_STATUS codeStatus = PV_SUCCESS; /* worst CodeMB status of the frame */
+    Int k;
 
     /* for H263 GOB changes */
 //MP4RateControlType rc_type = encParams->RC_Type;
@@ -104,11 +119,24 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
 
     video->usePrevQP = 0;
 
+    /* MC and CodeMB of the following rows run on the worker threads while */
+    /* this thread does the VLC encoding in MB order, see CodeMBRowsJob()  */
+    if (threads != NULL && currVol->nMBPerCol > 1)
+    {
+        job.CodeMB = CodeMB;
+        StartEncThreads(video, currVol->nMBPerCol, &CodeMBRowsJob, &job);
+    }
+    else
+        threads = NULL;
+
     for (ind_y = 0; ind_y < currVol->nMBPerCol; ind_y++)    /* Col MB Loop */
     {
 
         video->outputMB->mb_y = ind_y; /*  5/28/01 */
 
+        if (threads)
+            coded = threads->codedMB + (ind_y % threads->codedRows) * threads->codedRowSize;
+
         if (currVol->shortVideoHeader)  /* ShortVideoHeader Mode */
         {
 
@@ -136,7 +164,8 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
             /****************************************************************************************/
             /* MB Prediction:Put into MC macroblock, substract from currVop, put in predMB */
             /****************************************************************************************/
-            getMotionCompensatedMB(video, ind_x, ind_y, offset);
+            if (!threads)
+                getMotionCompensatedMB(video, ind_x, ind_y, offset);
 
 #ifndef H263_ONLY
             if (start_packet_header)
@@ -156,7 +185,16 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
             /* Code_MB:  DCT, Q, Q^(-1), IDCT, Motion Comp */
             /***********************************************/
 
-            status = (*CodeMB)(video, &fastDCTfunction, (offset << 5) + QP, ncoefblck);
+            if (threads)
+            {
+                /* already coded by a worker, pick up its output */
+                EncThreadsWaitRow(threads, ind_y, ind_x + 1);
+                video->outputMB = &coded[ind_x].outputMB;
+                M4VENC_MEMCPY(video->bitmapzz, coded[ind_x].bitmapzz, sizeof(video->bitmapzz));
+                M4VENC_MEMCPY(ncoefblck, coded[ind_x].ncoefblck, sizeof(ncoefblck));
+            }
+            else if ((*CodeMB)(video, &fastDCTfunction, (offset << 5) + QP, ncoefblck) != PV_SUCCESS)
+                codeStatus = PV_FAIL;
 
             /************************************/
             /* MB VLC Encode: VLC Encode MB     */
@@ -164,6 +202,9 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
 
             (*MBVlcEncode)(video, ncoefblck, (void*)BlockCodeCoeff);
 
+            /* the slot may be reused by a worker once the row is released */
+            video->outputMB = outputMB;
+
             /*************************************************************/
             /* Assemble Packets:  Assemble the MB VLC codes into Packets */
             /*************************************************************/
@@ -214,8 +255,22 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
             if (GOB_Header_Interval)  slice_counter++;
         }
 
+        if (threads)
+            EncThreadsSetConsumed(threads, ind_y + 1);
+
     } /* End of For ind_y */
 
+    if (threads)
+    {
+        WaitEncThreads(video);
+
+        for (k = 0; k < threads->numWorkers; k++)
+        {
+            if (job.threadStatus[k] != PV_SUCCESS)
+                codeStatus = PV_FAIL;
+        }
+    }
+
     if (currVol->shortVideoHeader) /* ShortVideoHeader = 1 */
     {
 
@@ -244,9 +299,59 @@ PV_STATUS EncodeFrameCombinedMode(VideoEncData *video)
     }
 #endif /* H263_ONLY */
 
+    if (codeStatus != PV_SUCCESS)
+        return codeStatus;
+
     return status; /* if status == PV_END_OF_BUF, this frame will be pre-skipped */
 }
 
+/* ======================================================================== */
+/*  Function : CodeMBRowsJob()                                              */
+/*  Purpose  : Worker side of EncodeFrameCombinedMode(). Runs MC and CodeMB */
+/*             on whole MB rows into the coded MB ring, so that the VLC     */
+/*             encoding only has to wait for the MB it is about to code.    */
+/*  In/out   : video, copy of the encoder state owned by this thread        */
+/*             index, slot of job->threadStatus written by this thread      */
+/* ======================================================================== */
+static void CodeMBRowsJob(VideoEncData *video, Int index, void *arg)
+{
+    CodeMBJob *job = (CodeMBJob *) arg;
+    EncThreads *threads = video->threads;
+    Vol *currVol = video->vol[video->currLayer];
+    Int lx = video->currVop->pitch;
+    Int ind_x, ind_y, mbnum, offset;
+    approxDCT fastDCTfunction;
+    CodedMB *coded;
+    PV_STATUS status = PV_SUCCESS;
+
+    while ((ind_y = EncThreadsNextRow(threads)) < currVol->nMBPerCol)
+    {
+        coded = EncThreadsWaitConsumed(threads, ind_y);
+        mbnum = ind_y * currVol->nMBPerRow;
+        offset = ind_y * (lx << 4);
+
+        for (ind_x = 0; ind_x < currVol->nMBPerRow; ind_x++)
+        {
+            video->outputMB = &coded[ind_x].outputMB;
+            video->outputMB->mb_x = ind_x;
+            video->outputMB->mb_y = ind_y;
+            video->mbnum = mbnum;
+
+            getMotionCompensatedMB(video, ind_x, ind_y, offset);
+            if ((*job->CodeMB)(video, &fastDCTfunction, (offset << 5) + video->QPMB[mbnum],
+                               coded[ind_x].ncoefblck) != PV_SUCCESS)
+                status = PV_FAIL;
+            M4VENC_MEMCPY(coded[ind_x].bitmapzz, video->bitmapzz, sizeof(video->bitmapzz));
+
+            EncThreadsSetRow(threads, ind_y, ind_x + 1);
+            mbnum++;
+            offset += 16;
+        }
+    }
+
+    job->threadStatus[index] = status;
+}
+
 #ifndef NO_SLICE_ENCODE
 /* ======================================================================== */
 /*  Function : EncodeSliceCombinedMode()                                    */
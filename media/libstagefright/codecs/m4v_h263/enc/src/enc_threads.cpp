@@ -0,0 +1,250 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include <sched.h>
+#include <string.h>
+
+#include "mp4def.h"
+#include "mp4enc_lib.h"
+#include "mp4lib_int.h"
+#include "m4venc_oscl.h"
+
+static void *EncThreadMain(void *arg);
+
+/* ======================================================================== */
+/*  Function : InitEncThreads()                                             */
+/*  Purpose  : Start the worker threads used by MotionEstimation() and      */
+/*             EncodeFrameCombinedMode(). numThreads counts the calling     */
+/*             thread, so numThreads - 1 workers are started. No workers    */
+/*             are needed and video->threads stays NULL for numThreads < 2. */
+/*  In/out   : mbPerRow, mbPerCol, largest frame size of all layers in MBs  */
+/*  Return   : PV_SUCCESS if successful else PV_FAIL                        */
+/* ======================================================================== */
+PV_STATUS InitEncThreads(VideoEncData *video, Int numThreads, Int mbPerRow, Int mbPerCol)
+{
+    EncThreads *threads;
+    Int i;
+
+    video->threads = NULL;
+
+    if (numThreads > MAX_ENC_THREADS)
+        numThreads = MAX_ENC_THREADS;
+    if (numThreads < 2)
+        return PV_SUCCESS;
+
+    threads = (EncThreads *) M4VENC_MALLOC(sizeof(EncThreads));
+    if (threads == NULL)
+        return PV_FAIL;
+    M4VENC_MEMSET(threads, 0, sizeof(EncThreads));
+
+    pthread_mutex_init(&threads->mutex, NULL);
+    pthread_cond_init(&threads->startCond, NULL);
+    pthread_cond_init(&threads->doneCond, NULL);
+    video->threads = threads;
+
+    threads->threadVideo = (VideoEncData *) M4VENC_MALLOC(numThreads * sizeof(VideoEncData));
+    threads->rowProgress = (Int *) M4VENC_MALLOC(mbPerCol * sizeof(Int));
+    threads->rowProgressSize = mbPerCol;
+
+    /* enough rows for every worker to code one row ahead of the VLC */
+    threads->codedRows = numThreads << 1;
+    threads->codedRowSize = mbPerRow;
+    threads->codedMB = (CodedMB *) M4VENC_MALLOC(threads->codedRows * mbPerRow * sizeof(CodedMB));
+
+    if (threads->threadVideo == NULL || threads->rowProgress == NULL || threads->codedMB == NULL)
+    {
+        CleanUpEncThreads(video);
+        return PV_FAIL;
+    }
+
+    /* RunLevel() resets the coefficients it reads, CodeMB relies on it */
+    M4VENC_MEMSET(threads->codedMB, 0, threads->codedRows * mbPerRow * sizeof(CodedMB));
+
+    for (i = 0; i < numThreads - 1; i++)
+    {
+        if (pthread_create(&threads->thread[i], NULL, EncThreadMain, threads))
+        {
+            CleanUpEncThreads(video);
+            return PV_FAIL;
+        }
+        threads->numWorkers++;
+    }
+
+    return PV_SUCCESS;
+}
+
+/* ======================================================================== */
+/*  Function : CleanUpEncThreads()                                          */
+/*  Purpose  : Stop and join the workers started by InitEncThreads() and    */
+/*             free the related memory.                                     */
+/* ======================================================================== */
+void CleanUpEncThreads(VideoEncData *video)
+{
+    EncThreads *threads = video->threads;
+    Int i;
+
+    if (threads == NULL)
+        return;
+
+    pthread_mutex_lock(&threads->mutex);
+    threads->quit = 1;
+    pthread_cond_broadcast(&threads->startCond);
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (i = 0; i < threads->numWorkers; i++)
+        pthread_join(threads->thread[i], NULL);
+
+    pthread_cond_destroy(&threads->doneCond);
+    pthread_cond_destroy(&threads->startCond);
+    pthread_mutex_destroy(&threads->mutex);
+
+    if (threads->codedMB) M4VENC_FREE(threads->codedMB);
+    if (threads->rowProgress) M4VENC_FREE(threads->rowProgress);
+    if (threads->threadVideo) M4VENC_FREE(threads->threadVideo);
+    M4VENC_FREE(threads);
+
+    video->threads = NULL;
+}
+
+/* ======================================================================== */
+/*  Function : StartEncThreads()                                            */
+/*  Purpose  : Reset the row wavefront and let every worker run            */
+/*             job(threadVideo, index, arg) on its own copy of *video.      */
+/*             The calling thread may run the job too with                  */
+/*             threadVideo[numWorkers], or do other work until             */
+/*             WaitEncThreads().                                            */
+/* ======================================================================== */
+void StartEncThreads(VideoEncData *video, Int numRows,
+                     void (*job)(VideoEncData *, Int, void *), void *arg)
+{
+    EncThreads *threads = video->threads;
+    Int i;
+
+    for (i = 0; i <= threads->numWorkers; i++)
+        threads->threadVideo[i] = *video;
+
+    M4VENC_MEMSET(threads->rowProgress, 0, numRows * sizeof(Int));
+    threads->nextRow = 0;
+    threads->rowsConsumed = 0;
+
+    pthread_mutex_lock(&threads->mutex);
+    threads->job = job;
+    threads->jobArg = arg;
+    threads->numRunning = threads->numWorkers;
+    threads->generation++;
+    pthread_cond_broadcast(&threads->startCond);
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+/* ======================================================================== */
+/*  Function : WaitEncThreads()                                             */
+/*  Purpose  : Wait until every worker has finished the current job.        */
+/* ======================================================================== */
+void WaitEncThreads(VideoEncData *video)
+{
+    EncThreads *threads = video->threads;
+
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->numRunning)
+        pthread_cond_wait(&threads->doneCond, &threads->mutex);
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+/* ======================================================================== */
+/*  Function : EncThreadsNextRow()                                          */
+/*  Purpose  : Claim the next MB row of the wavefront. Rows are handed out  */
+/*             in increasing order, so the row above is always owned by a   */
+/*             running thread.                                              */
+/* ======================================================================== */
+Int EncThreadsNextRow(EncThreads *threads)
+{
+    return __atomic_fetch_add(&threads->nextRow, 1, __ATOMIC_RELAXED);
+}
+
+/* ======================================================================== */
+/*  Function : EncThreadsWaitRow()                                          */
+/*  Purpose  : Wait until at least numMB MBs of row have been finished.     */
+/* ======================================================================== */
+void EncThreadsWaitRow(EncThreads *threads, Int row, Int numMB)
+{
+    while (__atomic_load_n(&threads->rowProgress[row], __ATOMIC_ACQUIRE) < numMB)
+        sched_yield();
+}
+
+/* ======================================================================== */
+/*  Function : EncThreadsSetRow()                                           */
+/*  Purpose  : Publish that the first numMB MBs of row are finished.        */
+/* ======================================================================== */
+void EncThreadsSetRow(EncThreads *threads, Int row, Int numMB)
+{
+    __atomic_store_n(&threads->rowProgress[row], numMB, __ATOMIC_RELEASE);
+}
+
+/* ======================================================================== */
+/*  Function : EncThreadsWaitConsumed()                                     */
+/*  Purpose  : Wait until the ring slot of row is no longer needed by the   */
+/*             VLC encoding, then return the coded MBs of that row.         */
+/* ======================================================================== */
+CodedMB *EncThreadsWaitConsumed(EncThreads *threads, Int row)
+{
+    while (__atomic_load_n(&threads->rowsConsumed, __ATOMIC_ACQUIRE) + threads->codedRows <= row)
+        sched_yield();
+
+    return threads->codedMB + (row % threads->codedRows) * threads->codedRowSize;
+}
+
+/* ======================================================================== */
+/*  Function : EncThreadsSetConsumed()                                      */
+/*  Purpose  : Release the ring slots of all rows before numRows.           */
+/* ======================================================================== */
+void EncThreadsSetConsumed(EncThreads *threads, Int numRows)
+{
+    __atomic_store_n(&threads->rowsConsumed, numRows, __ATOMIC_RELEASE);
+}
+
+/* ======================================================================== */
+/*  Function : EncThreadMain()                                              */
+/*  Purpose  : Worker thread, runs each job posted by StartEncThreads()     */
+/*             until CleanUpEncThreads() is called.                         */
+/* ======================================================================== */
+static void *EncThreadMain(void *arg)
+{
+    EncThreads *threads = (EncThreads *) arg;
+    UInt generation = 0;
+    Int index;
+
+    pthread_mutex_lock(&threads->mutex);
+    index = threads->numIndexed++;
+    for (;;)
+    {
+        while (!threads->quit && threads->generation == generation)
+            pthread_cond_wait(&threads->startCond, &threads->mutex);
+        if (threads->quit)
+            break;
+        generation = threads->generation;
+        pthread_mutex_unlock(&threads->mutex);
+
+        (*threads->job)(threads->threadVideo + index, index, threads->jobArg);
+
+        pthread_mutex_lock(&threads->mutex);
+        if (--threads->numRunning == 0)
+            pthread_cond_signal(&threads->doneCond);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    return NULL;
+}
@@ -211,14 +211,15 @@ void GetHalfPelBlkRegion(UChar *cand, UChar *hmem, Int lx)
 /*=====================================================================
     Function:   PaddingEdge
     Date:       09/16/2000
-    Purpose:    Pad edge of a Vop
+    Purpose:    Pad edge of a Vop, 16 pixels for luminance and 8 for
+                chrominance
     Modification: 09/20/05.
 =====================================================================*/
 
 void  PaddingEdge(Vop *refVop)
 {
     UChar *src, *dst;
-    Int i;
+    Int i, k;
     Int pitch, width, height;
     ULong temp1, temp2;
 
@@ -295,6 +296,45 @@ void  PaddingEdge(Vop *refVop)
         dst += pitch;
     }
 
+    /* pad chrominance by 8, so that the chroma prediction of any MV can  */
+    /* read the reference directly without padding it on the fly, which   */
+    /* is not safe when several threads run the motion compensation      */
+    width >>= 1;
+    height >>= 1;
+    pitch >>= 1;
+
+    for (k = 0; k < 2; k++)
+    {
+        src = (k == 0) ? refVop->uChan : refVop->vChan;
+
+        /* pad sides */
+        i = height;
+        while (i--)
+        {
+            M4VENC_MEMSET(src - 8, src[0], 8);
+            M4VENC_MEMSET(src + width, src[width-1], 8);
+            src += pitch;
+        }
+
+        /* pad bottom, including the corners */
+        dst = src - 8;
+        i = 8;
+        while (i--)
+        {
+            M4VENC_MEMCPY(dst, dst - pitch, width + 16);
+            dst += pitch;
+        }
+
+        /* pad top, including the corners */
+        src = ((k == 0) ? refVop->uChan : refVop->vChan) - 8;
+        dst = src - pitch;
+        i = 8;
+        while (i--)
+        {
+            M4VENC_MEMCPY(dst, src, width + 16);
+            dst -= pitch;
+        }
+    }
 
     return ;
 }
@@ -126,6 +126,32 @@ ULong num_hp_not_zero = 0;
 
 
 
+/* totals of the macroblocks searched by one thread */
+typedef struct tagMEStat
+{
+    Int numIntra;
+    Int totalSAD;   /* average SAD for rate control */
+    Int max_mag;
+    Int min_mag;
+#ifdef HTFM
+    HTFM_Stat htfm_stat;
+#endif
+} MEStat;
+
+/* one pass of MotionEstimation() run by all threads */
+typedef struct tagMEJob
+{
+    Int incr_i;
+    Int type_pred;
+    MEStat *stat;   /* totals of the pass are added to it */
+    MEStat threadStat[MAX_ENC_THREADS];
+} MEJob;
+
+static void MotionEstimationRow(VideoEncData *video, MEStat *stat, EncThreads *threads,
+                                Int j, Int start_i, Int incr_i, Int type_pred);
+static void MotionEstimationPass(VideoEncData *video, MEStat *stat, Int incr_i, Int type_pred);
+static void MotionEstimationJob(VideoEncData *video, Int index, void *arg);
+
 /*==================================================================
     Function:   MotionEstimation
     Date:       10/3/2000
@@ -135,52 +161,38 @@ ULong num_hp_not_zero = 0;
 
 void MotionEstimation(VideoEncData *video)
 {
-    UChar use_4mv = video->encParams->MV8x8_Enabled;
     Vol *currVol = video->vol[video->currLayer];
     Vop *currVop = video->currVop;
     VideoEncFrameIO *currFrame = video->input;
-    Int i, j, comp;
+    Int i, j;
     Int mbwidth = currVol->nMBPerRow;
     Int mbheight = currVol->nMBPerCol;
     Int totalMB = currVol->nTotalMB;
     Int width = currFrame->pitch;
-    UChar *mode_mb, *Mode = video->headerInfo.Mode;
+    UChar *Mode = video->headerInfo.Mode;
     MOT *mot_mb, **mot = video->mot;
     UChar *intraArray = video->intraArray;
-    Int FS_en = video->encParams->FullSearch_Enabled;
     void (*ComputeMBSum)(UChar *, Int, MOT *) = video->functionPointer->ComputeMBSum;
-    void (*ChooseMode)(UChar*, UChar*, Int, Int) = video->functionPointer->ChooseMode;
 
-    Int numIntra, start_i, numLoop, incr_i;
-    Int mbnum, offset;
-    UChar *cur, *best_cand[5];
-    Int sad8 = 0, sad16 = 0;
+    Int numLoop, incr_i;
+    Int mbnum;
+    UChar *cur;
     Int totalSAD = 0;   /* average SAD for rate control */
-    Int skip_halfpel_4mv;
-    Int f_code_p, f_code_n, max_mag = 0, min_mag = 0;
+    Int f_code_p, f_code_n, max_mag, min_mag;
     Int type_pred;
-    Int xh[5] = {0, 0, 0, 0, 0};
-    Int yh[5] = {0, 0, 0, 0, 0}; /* half-pel */
-    UChar hp_mem4MV[17*17*4];
+    MEStat stat;
 
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
     Int collect = 0;
-    HTFM_Stat htfm_stat;
     double newvar[16];
     double exp_lamda[15];
     /*********************************/
 #endif
-    Int hp_guess = 0;
-#ifdef PRINT_MV
-    FILE *fp_debug;
-#endif
 
 //  FILE *fstat;
 //  static int frame_num = 0;
 
-    offset = 0;
-
     if (video->currVop->predictionType == I_VOP)
     {   /* compute the SAV */
         mbnum = 0;
@@ -227,9 +239,11 @@ void MotionEstimation(VideoEncData *video)
 
     video->sad_extra_info = NULL;
 
+    M4VENC_MEMSET(&stat, 0, sizeof(MEStat));
+
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
-    InitHTFM(video, &htfm_stat, newvar, &collect);
+    InitHTFM(video, &stat.htfm_stat, newvar, &collect);
     /*********************************/
 #endif
 
@@ -239,229 +253,26 @@ void MotionEstimation(VideoEncData *video)
     {
         incr_i = 2;
         numLoop = 2;
-        start_i = 1;
         type_pred = 0; /* for initial candidate selection */
     }
     else
     {
         incr_i = 1;
         numLoop = 1;
-        start_i = 0;
         type_pred = 2;
     }
 
     /* First pass, loop thru half the macroblock */
     /* determine scene change */
     /* Second pass, for the rest of macroblocks */
-    numIntra = 0;
     while (numLoop--)
     {
-        for (j = 0; j < mbheight; j++)
-        {
-            if (incr_i > 1)
-                start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
-
-            offset = width * (j << 4) + (start_i << 4);
-
-            mbnum = j * mbwidth + start_i;
-
-            for (i = start_i; i < mbwidth; i += incr_i)
-            {
-                video->mbnum = mbnum;
-                mot_mb = mot[mbnum];
-                mode_mb = Mode + mbnum;
-
-                cur = currFrame->yChan + offset;
-
-
-                if (*mode_mb != MODE_INTRA)
-                {
-#if defined(HTFM)
-                    HTFMPrepareCurMB(video, &htfm_stat, cur);
-#else
-                    PrepareCurMB(video, cur);
-#endif
-                    /************************************************************/
-                    /******** full-pel 1MV and 4MVs search **********************/
-
-#ifdef _SAD_STAT
-                    num_MB++;
-#endif
-                    MBMotionSearch(video, cur, best_cand, i << 4, j << 4, type_pred,
-                                   FS_en, &hp_guess);
-
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "#%d (%d,%d,%d) : ", mbnum, mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
-                    fprintf(fp_debug, "(%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : ==>\n",
-                            mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
-                            mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
-                            mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
-                            mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
-                    fclose(fp_debug);
-#endif
-                    sad16 = mot_mb[0].sad;
-#ifdef NO_INTER4V
-                    sad8 = sad16;
-#else
-                    sad8 = mot_mb[1].sad + mot_mb[2].sad + mot_mb[3].sad + mot_mb[4].sad;
-#endif
-
-                    /* choose between INTRA or INTER */
-                    (*ChooseMode)(mode_mb, cur, width, ((sad8 < sad16) ? sad8 : sad16));
-                }
-                else    /* INTRA update, use for prediction 3/23/01 */
-                {
-                    mot_mb[0].x = mot_mb[0].y = 0;
-                }
-
-                if (*mode_mb == MODE_INTRA)
-                {
-                    numIntra++ ;
-
-                    /* compute SAV for rate control and fast DCT, 11/28/00 */
-                    (*ComputeMBSum)(cur, width, mot_mb);
-
-                    /* leave mot_mb[0] as it is for fast motion search */
-                    /* set the 4 MVs to zeros */
-                    for (comp = 1; comp <= 4; comp++)
-                    {
-                        mot_mb[comp].x = 0;
-                        mot_mb[comp].y = 0;
-                    }
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "\n");
-                    fclose(fp_debug);
-#endif
-                }
-                else /* *mode_mb = MODE_INTER;*/
-                {
-                    if (video->encParams->HalfPel_Enabled)
-                    {
-#ifdef _SAD_STAT
-                        num_HP_MB++;
-#endif
-                        /* find half-pel resolution motion vector */
-                        FindHalfPelMB(video, cur, mot_mb, best_cand[0],
-                                      i << 4, j << 4, xh, yh, hp_guess);
-#ifdef PRINT_MV
-                        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                        fprintf(fp_debug, "(%d,%d), %d\n", mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
-                        fclose(fp_debug);
-#endif
-                        skip_halfpel_4mv = ((sad16 - mot_mb[0].sad) <= (MB_Nb >> 1) + 1);
-                        sad16 = mot_mb[0].sad;
-
-#ifndef NO_INTER4V
-                        if (use_4mv && !skip_halfpel_4mv)
-                        {
-                            /* Also decide 1MV or 4MV !!!!!!!!*/
-                            sad8 = FindHalfPelBlk(video, cur, mot_mb, sad16,
-                                                  best_cand, mode_mb, i << 4, j << 4, xh, yh, hp_mem4MV);
-
-#ifdef PRINT_MV
-                            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                            fprintf(fp_debug, " (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) \n",
-                                    mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
-                                    mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
-                                    mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
-                                    mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
-                            fclose(fp_debug);
-#endif
-                        }
-#endif /* NO_INTER4V */
-                    }
-                    else    /* HalfPel_Enabled ==0  */
-                    {
-#ifndef NO_INTER4V
-                        //if(sad16 < sad8-PREF_16_VEC)
-                        if (sad16 - PREF_16_VEC > sad8)
-                        {
-                            *mode_mb = MODE_INTER4V;
-                        }
-#endif
-                    }
-#if (ZERO_MV_PREF==2)   /* use mot_mb[7].sad as d0 computed in MBMotionSearch*/
-                    /******************************************************/
-                    if (mot_mb[7].sad - PREF_NULL_VEC < sad16 && mot_mb[7].sad - PREF_NULL_VEC < sad8)
-                    {
-                        mot_mb[0].sad = mot_mb[7].sad - PREF_NULL_VEC;
-                        mot_mb[0].x = mot_mb[0].y = 0;
-                        *mode_mb = MODE_INTER;
-                    }
-                    /******************************************************/
-#endif
-                    if (*mode_mb == MODE_INTER)
-                    {
-                        if (mot_mb[0].x == 0 && mot_mb[0].y == 0)   /* use zero vector */
-                            mot_mb[0].sad += PREF_NULL_VEC; /* add back the bias */
-
-                        mot_mb[1].sad = mot_mb[2].sad = mot_mb[3].sad = mot_mb[4].sad = (mot_mb[0].sad + 2) >> 2;
-                        mot_mb[1].x = mot_mb[2].x = mot_mb[3].x = mot_mb[4].x = mot_mb[0].x;
-                        mot_mb[1].y = mot_mb[2].y = mot_mb[3].y = mot_mb[4].y = mot_mb[0].y;
-
-                    }
-                }
-
-                /* find maximum magnitude */
-                /* compute average SAD for rate control, 11/28/00 */
-                if (*mode_mb == MODE_INTER)
-                {
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "%d MODE_INTER\n", mbnum);
-                    fclose(fp_debug);
-#endif
-                    totalSAD += mot_mb[0].sad;
-                    if (mot_mb[0].x > max_mag)
-                        max_mag = mot_mb[0].x;
-                    if (mot_mb[0].y > max_mag)
-                        max_mag = mot_mb[0].y;
-                    if (mot_mb[0].x < min_mag)
-                        min_mag = mot_mb[0].x;
-                    if (mot_mb[0].y < min_mag)
-                        min_mag = mot_mb[0].y;
-                }
-                else if (*mode_mb == MODE_INTER4V)
-                {
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "%d MODE_INTER4V\n", mbnum);
-                    fclose(fp_debug);
-#endif
-                    totalSAD += sad8;
-                    for (comp = 1; comp <= 4; comp++)
-                    {
-                        if (mot_mb[comp].x > max_mag)
-                            max_mag = mot_mb[comp].x;
-                        if (mot_mb[comp].y > max_mag)
-                            max_mag = mot_mb[comp].y;
-                        if (mot_mb[comp].x < min_mag)
-                            min_mag = mot_mb[comp].x;
-                        if (mot_mb[comp].y < min_mag)
-                            min_mag = mot_mb[comp].y;
-                    }
-                }
-                else    /* MODE_INTRA */
-                {
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "%d MODE_INTRA\n", mbnum);
-                    fclose(fp_debug);
-#endif
-                    totalSAD += mot_mb[0].sad;
-                }
-                mbnum += incr_i;
-                offset += (incr_i << 4);
-
-            }
-        }
+        MotionEstimationPass(video, &stat, incr_i, type_pred);
 
         if (incr_i > 1 && numLoop) /* scene change on and first loop */
         {
             //if(numIntra > ((totalMB>>3)<<1) + (totalMB>>3)) /* 75% of 50%MBs */
-            if (numIntra > (0.30*(totalMB / 2.0))) /* 15% of 50%MBs */
+            if (stat.numIntra > (0.30*(totalMB / 2.0))) /* 15% of 50%MBs */
             {
                 /******** scene change detected *******************/
                 currVop->predictionType = I_VOP;
@@ -470,7 +281,6 @@ void MotionEstimation(VideoEncData *video)
 
                 /* compute the SAV for rate control & fast DCT */
                 totalSAD = 0;
-                offset = 0;
                 mbnum = 0;
                 cur = currFrame->yChan;
 
@@ -498,13 +308,15 @@ void MotionEstimation(VideoEncData *video)
             }
         }
         /******** no scene change, continue motion search **********************/
-        start_i = 0;
         type_pred++; /* second pass */
     }
 
-    video->sumMAD = (float)totalSAD / (float)NumPixelMB;    /* avg SAD */
+    video->sumMAD = (float)stat.totalSAD / (float)NumPixelMB;    /* avg SAD */
 
     /* find f_code , 10/27/2000 */
+    max_mag = stat.max_mag;
+    min_mag = stat.min_mag;
+
     f_code_p = 1;
     while ((max_mag >> (4 + f_code_p)) > 0)
         f_code_p++;
@@ -521,7 +333,7 @@ void MotionEstimation(VideoEncData *video)
     if (collect)
     {
         collect = 0;
-        UpdateHTFM(video, newvar, exp_lamda, &htfm_stat);
+        UpdateHTFM(video, newvar, exp_lamda, &stat.htfm_stat);
     }
     /*********************************/
 #endif
@@ -529,6 +341,339 @@ void MotionEstimation(VideoEncData *video)
     return ;
 }
 
+/*==================================================================
+    Function:   MotionEstimationPass
+    Purpose:    Search the macroblocks of one pass of MotionEstimation(),
+                all of them (incr_i = 1) or every other one in a
+                checkerboard pattern (incr_i = 2, type_pred = pass).
+                With worker threads the rows are searched in wavefront
+                order, see MotionEstimationRow().
+====================================================================*/
+static void MotionEstimationPass(VideoEncData *video, MEStat *stat, Int incr_i, Int type_pred)
+{
+    Int mbheight = video->vol[video->currLayer]->nMBPerCol;
+    EncThreads *threads = video->threads;
+    MEJob job;
+    MEStat *threadStat;
+    Int j, k;
+
+    if (threads == NULL || mbheight < 2)
+    {
+        for (j = 0; j < mbheight; j++)
+        {
+            MotionEstimationRow(video, stat, NULL, j,
+                                (incr_i > 1) ? ((j + type_pred) & 1) : 0, incr_i, type_pred);
+        }
+        return ;
+    }
+
+    job.incr_i = incr_i;
+    job.type_pred = type_pred;
+    job.stat = stat;
+
+    StartEncThreads(video, mbheight, &MotionEstimationJob, &job);
+    MotionEstimationJob(threads->threadVideo + threads->numWorkers, threads->numWorkers, &job);
+    WaitEncThreads(video);
+
+    /* all totals are order independent */
+    for (k = 0; k <= threads->numWorkers; k++)
+    {
+        threadStat = job.threadStat + k;
+        stat->numIntra += threadStat->numIntra;
+        stat->totalSAD += threadStat->totalSAD;
+        if (threadStat->max_mag > stat->max_mag)
+            stat->max_mag = threadStat->max_mag;
+        if (threadStat->min_mag < stat->min_mag)
+            stat->min_mag = threadStat->min_mag;
+#ifdef HTFM
+        stat->htfm_stat.abs_dif_mad_avg += threadStat->htfm_stat.abs_dif_mad_avg;
+        stat->htfm_stat.countbreak += threadStat->htfm_stat.countbreak;
+#endif
+    }
+
+    return ;
+}
+
+/*==================================================================
+    Function:   MotionEstimationJob
+    Purpose:    Worker side of MotionEstimationPass(), searches rows
+                until all of them have been claimed. video is the
+                private copy of the thread.
+====================================================================*/
+static void MotionEstimationJob(VideoEncData *video, Int index, void *arg)
+{
+    MEJob *job = (MEJob *)arg;
+    MEStat *stat = job->threadStat + index;
+    Int mbheight = video->vol[video->currLayer]->nMBPerCol;
+    Int j;
+
+    stat->numIntra = 0;
+    stat->totalSAD = 0;
+    stat->max_mag = 0;
+    stat->min_mag = 0;
+#ifdef HTFM
+    /* collect the HTFM statistics of this thread separately */
+    stat->htfm_stat = job->stat->htfm_stat;
+    stat->htfm_stat.abs_dif_mad_avg = 0;
+    stat->htfm_stat.countbreak = 0;
+    if (video->sad_extra_info == (void*)(&job->stat->htfm_stat))
+        video->sad_extra_info = (void*)(&stat->htfm_stat);
+#endif
+
+    while ((j = EncThreadsNextRow(video->threads)) < mbheight)
+    {
+        MotionEstimationRow(video, stat, video->threads, j,
+                            (job->incr_i > 1) ? ((j + job->type_pred) & 1) : 0,
+                            job->incr_i, job->type_pred);
+    }
+
+    return ;
+}
+
+/*==================================================================
+    Function:   MotionEstimationRow
+    Purpose:    Motion search of the macroblocks of row j starting at
+                start_i. The candidates of CandidateSelection() come
+                from the row above up to one MB to the right, so with
+                worker threads a MB waits until the row above is two
+                MBs ahead. Everything a row reads from the rows below
+                is from the previous frame or the previous pass, and
+                it is read before that row can get there.
+====================================================================*/
+static void MotionEstimationRow(VideoEncData *video, MEStat *stat, EncThreads *threads,
+                                Int j, Int start_i, Int incr_i, Int type_pred)
+{
+    UChar use_4mv = video->encParams->MV8x8_Enabled;
+    Vol *currVol = video->vol[video->currLayer];
+    VideoEncFrameIO *currFrame = video->input;
+    Int i, comp;
+    Int mbwidth = currVol->nMBPerRow;
+    Int width = currFrame->pitch;
+    UChar *mode_mb, *Mode = video->headerInfo.Mode;
+    MOT *mot_mb, **mot = video->mot;
+    Int FS_en = video->encParams->FullSearch_Enabled;
+    void (*ComputeMBSum)(UChar *, Int, MOT *) = video->functionPointer->ComputeMBSum;
+    void (*ChooseMode)(UChar*, UChar*, Int, Int) = video->functionPointer->ChooseMode;
+
+    Int mbnum, offset;
+    UChar *cur, *best_cand[5];
+    Int sad8 = 0, sad16 = 0;
+    Int skip_halfpel_4mv;
+    Int xh[5] = {0, 0, 0, 0, 0};
+    Int yh[5] = {0, 0, 0, 0, 0}; /* half-pel */
+    UChar hp_mem4MV[17*17*4];
+    Int hp_guess = 0;
+#ifdef PRINT_MV
+    FILE *fp_debug;
+#endif
+
+    offset = width * (j << 4) + (start_i << 4);
+
+    mbnum = j * mbwidth + start_i;
+
+    for (i = start_i; i < mbwidth; i += incr_i)
+    {
+        if (threads && j > 0)
+            EncThreadsWaitRow(threads, j - 1, PV_MIN(i + 2, mbwidth));
+
+        video->mbnum = mbnum;
+        mot_mb = mot[mbnum];
+        mode_mb = Mode + mbnum;
+
+        cur = currFrame->yChan + offset;
+
+
+        if (*mode_mb != MODE_INTRA)
+        {
+#if defined(HTFM)
+            HTFMPrepareCurMB(video, &stat->htfm_stat, cur);
+#else
+            PrepareCurMB(video, cur);
+#endif
+            /************************************************************/
+            /******** full-pel 1MV and 4MVs search **********************/
+
+#ifdef _SAD_STAT
+            num_MB++;
+#endif
+            MBMotionSearch(video, cur, best_cand, i << 4, j << 4, type_pred,
+                           FS_en, &hp_guess);
+
+#ifdef PRINT_MV
+            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+            fprintf(fp_debug, "#%d (%d,%d,%d) : ", mbnum, mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
+            fprintf(fp_debug, "(%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : ==>\n",
+                    mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
+                    mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
+                    mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
+                    mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
+            fclose(fp_debug);
+#endif
+            sad16 = mot_mb[0].sad;
+#ifdef NO_INTER4V
+            sad8 = sad16;
+#else
+            sad8 = mot_mb[1].sad + mot_mb[2].sad + mot_mb[3].sad + mot_mb[4].sad;
+#endif
+
+            /* choose between INTRA or INTER */
+            (*ChooseMode)(mode_mb, cur, width, ((sad8 < sad16) ? sad8 : sad16));
+        }
+        else    /* INTRA update, use for prediction 3/23/01 */
+        {
+            mot_mb[0].x = mot_mb[0].y = 0;
+        }
+
+        if (*mode_mb == MODE_INTRA)
+        {
+            stat->numIntra++ ;
+
+            /* compute SAV for rate control and fast DCT, 11/28/00 */
+            (*ComputeMBSum)(cur, width, mot_mb);
+
+            /* leave mot_mb[0] as it is for fast motion search */
+            /* set the 4 MVs to zeros */
+            for (comp = 1; comp <= 4; comp++)
+            {
+                mot_mb[comp].x = 0;
+                mot_mb[comp].y = 0;
+            }
+#ifdef PRINT_MV
+            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+            fprintf(fp_debug, "\n");
+            fclose(fp_debug);
+#endif
+        }
+        else /* *mode_mb = MODE_INTER;*/
+        {
+            if (video->encParams->HalfPel_Enabled)
+            {
+#ifdef _SAD_STAT
+                num_HP_MB++;
+#endif
+                /* find half-pel resolution motion vector */
+                FindHalfPelMB(video, cur, mot_mb, best_cand[0],
+                              i << 4, j << 4, xh, yh, hp_guess);
+#ifdef PRINT_MV
+                fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+                fprintf(fp_debug, "(%d,%d), %d\n", mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
+                fclose(fp_debug);
+#endif
+                skip_halfpel_4mv = ((sad16 - mot_mb[0].sad) <= (MB_Nb >> 1) + 1);
+                sad16 = mot_mb[0].sad;
+
+#ifndef NO_INTER4V
+                if (use_4mv && !skip_halfpel_4mv)
+                {
+                    /* Also decide 1MV or 4MV !!!!!!!!*/
+                    sad8 = FindHalfPelBlk(video, cur, mot_mb, sad16,
+                                          best_cand, mode_mb, i << 4, j << 4, xh, yh, hp_mem4MV);
+
+#ifdef PRINT_MV
+                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+                    fprintf(fp_debug, " (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) \n",
+                            mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
+                            mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
+                            mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
+                            mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
+                    fclose(fp_debug);
+#endif
+                }
+#endif /* NO_INTER4V */
+            }
+            else    /* HalfPel_Enabled ==0  */
+            {
+#ifndef NO_INTER4V
+                //if(sad16 < sad8-PREF_16_VEC)
+                if (sad16 - PREF_16_VEC > sad8)
+                {
+                    *mode_mb = MODE_INTER4V;
+                }
+#endif
+            }
+#if (ZERO_MV_PREF==2)   /* use mot_mb[7].sad as d0 computed in MBMotionSearch*/
+            /******************************************************/
+            if (mot_mb[7].sad - PREF_NULL_VEC < sad16 && mot_mb[7].sad - PREF_NULL_VEC < sad8)
+            {
+                mot_mb[0].sad = mot_mb[7].sad - PREF_NULL_VEC;
+                mot_mb[0].x = mot_mb[0].y = 0;
+                *mode_mb = MODE_INTER;
+            }
+            /******************************************************/
+#endif
+            if (*mode_mb == MODE_INTER)
+            {
+                if (mot_mb[0].x == 0 && mot_mb[0].y == 0)   /* use zero vector */
+                    mot_mb[0].sad += PREF_NULL_VEC; /* add back the bias */
+
+                mot_mb[1].sad = mot_mb[2].sad = mot_mb[3].sad = mot_mb[4].sad = (mot_mb[0].sad + 2) >> 2;
+                mot_mb[1].x = mot_mb[2].x = mot_mb[3].x = mot_mb[4].x = mot_mb[0].x;
+                mot_mb[1].y = mot_mb[2].y = mot_mb[3].y = mot_mb[4].y = mot_mb[0].y;
+
+            }
+        }
+
+        /* find maximum magnitude */
+        /* compute average SAD for rate control, 11/28/00 */
+        if (*mode_mb == MODE_INTER)
+        {
+#ifdef PRINT_MV
+            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+            fprintf(fp_debug, "%d MODE_INTER\n", mbnum);
+            fclose(fp_debug);
+#endif
+            stat->totalSAD += mot_mb[0].sad;
+            if (mot_mb[0].x > stat->max_mag)
+                stat->max_mag = mot_mb[0].x;
+            if (mot_mb[0].y > stat->max_mag)
+                stat->max_mag = mot_mb[0].y;
+            if (mot_mb[0].x < stat->min_mag)
+                stat->min_mag = mot_mb[0].x;
+            if (mot_mb[0].y < stat->min_mag)
+                stat->min_mag = mot_mb[0].y;
+        }
+        else if (*mode_mb == MODE_INTER4V)
+        {
+#ifdef PRINT_MV
+            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+            fprintf(fp_debug, "%d MODE_INTER4V\n", mbnum);
+            fclose(fp_debug);
+#endif
+            stat->totalSAD += sad8;
+            for (comp = 1; comp <= 4; comp++)
+            {
+                if (mot_mb[comp].x > stat->max_mag)
+                    stat->max_mag = mot_mb[comp].x;
+                if (mot_mb[comp].y > stat->max_mag)
+                    stat->max_mag = mot_mb[comp].y;
+                if (mot_mb[comp].x < stat->min_mag)
+                    stat->min_mag = mot_mb[comp].x;
+                if (mot_mb[comp].y < stat->min_mag)
+                    stat->min_mag = mot_mb[comp].y;
+            }
+        }
+        else    /* MODE_INTRA */
+        {
+#ifdef PRINT_MV
+            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+            fprintf(fp_debug, "%d MODE_INTRA\n", mbnum);
+            fclose(fp_debug);
+#endif
+            stat->totalSAD += mot_mb[0].sad;
+        }
+        mbnum += incr_i;
+        offset += (incr_i << 4);
+
+        if (threads)
+            EncThreadsSetRow(threads, j, i + 1);
+    }
+
+    if (threads)
+        EncThreadsSetRow(threads, j, mbwidth);
+
+    return ;
+}
+
 
 #ifdef HTFM
 void InitHTFM(VideoEncData *video, HTFM_Stat *htfm_stat, double *newvar, Int *collect)
@@ -106,7 +106,8 @@ extern "C"
                                Int width, Int round1);
 
     void EncPrediction_Chrom(Int xpred, Int ypred, UChar *cu_prev, UChar *cv_prev, UChar *cu_rec,
-                             UChar *cv_rec, Int pitch_uv, Int width_uv, Int height_uv, Int round1);
+                             UChar *cv_rec, Int pitch_uv, Int width_uv, Int height_uv, Int round1,
+                             Int padded);
 
     void get_MB(UChar *c_prev, UChar *c_prev_u  , UChar *c_prev_v,
                 Short mb[6][64], Int width, Int width_uv);
@@ -199,6 +200,18 @@ extern "C"
     void BlockCodeCoeff_RVLC(RunLevelBlock *RLB, BitstreamEncVideo *bs, Int j_start, Int j_stop, UChar Mode);
     void BlockCodeCoeff_Normal(RunLevelBlock *RLB, BitstreamEncVideo *bs, Int j_start, Int j_stop, UChar Mode);
 
+    /* defined in enc_threads.c */
+    PV_STATUS InitEncThreads(VideoEncData *video, Int numThreads, Int mbPerRow, Int mbPerCol);
+    void CleanUpEncThreads(VideoEncData *video);
+    void StartEncThreads(VideoEncData *video, Int numRows,
+                         void (*job)(VideoEncData *, Int, void *), void *arg);
+    void WaitEncThreads(VideoEncData *video);
+    Int  EncThreadsNextRow(EncThreads *threads);
+    void EncThreadsWaitRow(EncThreads *threads, Int row, Int numMB);
+    void EncThreadsSetRow(EncThreads *threads, Int row, Int numMB);
+    CodedMB *EncThreadsWaitConsumed(EncThreads *threads, Int row);
+    void EncThreadsSetConsumed(EncThreads *threads, Int numRows);
+
 #ifdef __cplusplus
 }
 #endif
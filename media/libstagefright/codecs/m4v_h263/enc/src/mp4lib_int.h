@@ -19,10 +19,14 @@
 #ifndef _MP4LIB_INT_H_
 #define _MP4LIB_INT_H_
 
+#include <pthread.h>
+
 #include "mp4def.h"
 #include "mp4enc_api.h"
 #include "rate_control.h"
 
+#define MAX_ENC_THREADS 16  /* upper limit of VideoEncOptions.numThreads */
+
 /* BitstreamEncVideo will be modified */
 typedef struct tagBitstream
 {
@@ -430,8 +434,52 @@ typedef struct tagVideoEncData
 
     MultiPass *pMP[4]; /* for multipass encoding, 4 represents 4 layer encoding */
 
+    /* worker threads, NULL when encoding on the calling thread only */
+    struct tagEncThreads *threads;
+
 } VideoEncData;
 
+/*************************************************************/
+/*                  Worker threads                           */
+/*************************************************************/
+
+/* output of CodeMB kept until the MB is VLC encoded */
+typedef struct tagCodedMB
+{
+    MacroBlock  outputMB;       /* quantized coefficients, mb_x and mb_y */
+    UInt    bitmapzz[6][2];     /* zigzag bitmap for RunLevel */
+    Int     ncoefblck[6];       /* number of coefficients to scan per block */
+} CodedMB;
+
+typedef struct tagEncThreads
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t  startCond;      /* a new job has been posted */
+    pthread_cond_t  doneCond;       /* all workers have finished the job */
+    pthread_t   thread[MAX_ENC_THREADS - 1];
+    Int     numWorkers;         /* threads besides the calling thread */
+    Int     numIndexed;         /* workers that have taken their index */
+    Int     numRunning;         /* workers still running the current job */
+    UInt    generation;         /* incremented for every job */
+    Int     quit;
+
+    /* current job, run by each worker on its own copy of VideoEncData */
+    void (*job)(VideoEncData *video, Int index, void *arg);
+    void    *jobArg;
+    VideoEncData *threadVideo;  /* numWorkers + 1 copies, the last one for the calling thread */
+
+    /* MB row wavefront */
+    Int     nextRow;            /* next row to be claimed by a thread */
+    Int     *rowProgress;       /* number of MBs finished in each row */
+    Int     rowProgressSize;
+    Int     rowsConsumed;       /* rows already VLC encoded by the calling thread */
+
+    /* ring of coded MB rows between CodeMB and VLC encoding */
+    CodedMB *codedMB;
+    Int     codedRows;          /* number of rows in the ring */
+    Int     codedRowSize;       /* MBs per row in the ring */
+} EncThreads;
+
 /*************************************************************/
 /*                  VLC structures                           */
 /*************************************************************/
@@ -97,6 +97,11 @@ ifeq ($(TARGET_ARCH),arm)
   endif
 endif
 
+ifneq ($(filter x86 x86_64,$(TARGET_ARCH)),)
+    LOCAL_CFLAGS     += -DH264DEC_SSE2
+    LOCAL_SRC_FILES  += ./source/x86_sse2/h264bsd_interpolate_sse2.c
+endif
+
 LOCAL_SHARED_LIBRARIES := \
 	libstagefright libstagefright_omx libstagefright_foundation libutils liblog \
 
@@ -125,3 +130,26 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_MODULE := decoder
 
 include $(BUILD_EXECUTABLE)
+
+#####################################################################
+# test utility: SSE2 kernels against their C reference
+#####################################################################
+ifneq ($(filter x86 x86_64,$(TARGET_ARCH)),)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	./source/x86_sse2/h264bsd_sse2_test.c \
+	./source/x86_sse2/h264bsd_sse2_test_ref.c \
+	./source/x86_sse2/h264bsd_sse2_test_sse2.c \
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/source \
+
+LOCAL_SHARED_LIBRARIES := libstagefright_soft_h264dec
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_MODULE := h264bsd_sse2_test
+
+include $(BUILD_EXECUTABLE)
+endif
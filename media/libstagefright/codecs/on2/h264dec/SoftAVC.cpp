@@ -63,7 +63,8 @@ SoftAVC::SoftAVC(
       mPicId(0),
       mHeadersDecoded(false),
       mEOSStatus(INPUT_DATA_AVAILABLE),
-      mSignalledError(false) {
+      mSignalledError(false),
+      mNumThreads(0) {
     const size_t kMinCompressionRatio = 2;
     const size_t kMaxOutputBufferSize = 2048 * 2048 * 3 / 2;
     initPorts(
@@ -93,10 +94,80 @@ SoftAVC::~SoftAVC() {
 
 status_t SoftAVC::initDecoder() {
     // Force decoder to output buffers in display order.
-    if (H264SwDecInit(&mHandle, 0) == H264SWDEC_OK) {
-        return OK;
+    if (H264SwDecInit(&mHandle, 0) != H264SWDEC_OK) {
+        return UNKNOWN_ERROR;
     }
-    return UNKNOWN_ERROR;
+
+    setDecoderThreads();
+    return OK;
+}
+
+void SoftAVC::setDecoderThreads() {
+    // Deblocking runs on all cores unless the client asked otherwise;
+    // decoding still works single-threaded if the worker threads cannot
+    // be started.
+    int numThreads = mNumThreads > 0 ? mNumThreads : GetCPUCoreCount();
+    if (H264SwDecSetThreads(mHandle, numThreads) != H264SWDEC_OK) {
+        ALOGW("Failed to start decoder threads, decoding single-threaded");
+    }
+}
+
+OMX_ERRORTYPE SoftAVC::internalGetParameter(
+        OMX_INDEXTYPE index, OMX_PTR params) {
+    const int32_t indexFull = index;
+
+    switch (indexFull) {
+        case kThreadCountExtensionIndex:
+        {
+            OMX_PARAM_U32TYPE *threadCount = (OMX_PARAM_U32TYPE *)params;
+
+            if (threadCount->nPortIndex != kOutputPortIndex) {
+                return OMX_ErrorUndefined;
+            }
+
+            threadCount->nU32 = mNumThreads;
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SoftVideoDecoderOMXComponent::internalGetParameter(index, params);
+    }
+}
+
+OMX_ERRORTYPE SoftAVC::internalSetParameter(
+        OMX_INDEXTYPE index, const OMX_PTR params) {
+    const int32_t indexFull = index;
+
+    switch (indexFull) {
+        case kThreadCountExtensionIndex:
+        {
+            const OMX_PARAM_U32TYPE *threadCount =
+                (const OMX_PARAM_U32TYPE *)params;
+
+            if (threadCount->nPortIndex != kOutputPortIndex
+                    || (int32_t)threadCount->nU32 < 0) {
+                return OMX_ErrorUndefined;
+            }
+
+            // only settable in the loaded state, so nothing is being decoded;
+            // the decoder clamps it to the number of threads it supports
+            mNumThreads = threadCount->nU32;
+            setDecoderThreads();
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SoftVideoDecoderOMXComponent::internalSetParameter(index, params);
+    }
+}
+
+OMX_ERRORTYPE SoftAVC::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.decoderThreadCount")) {
+        *(int32_t*)index = kThreadCountExtensionIndex;
+        return OMX_ErrorNone;
+    }
+    return SoftVideoDecoderOMXComponent::getExtensionIndex(name, index);
 }
 
 void SoftAVC::onQueueFilled(OMX_U32 /* portIndex */) {
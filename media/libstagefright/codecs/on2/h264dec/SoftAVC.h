@@ -39,12 +39,27 @@ protected:
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onReset();
 
+    virtual OMX_ERRORTYPE internalGetParameter(
+            OMX_INDEXTYPE index, OMX_PTR params);
+
+    virtual OMX_ERRORTYPE internalSetParameter(
+            OMX_INDEXTYPE index, const OMX_PTR params);
+
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
 private:
     enum {
         kNumInputBuffers  = 8,
         kNumOutputBuffers = 2,
     };
 
+    enum {
+        // OMX_PARAM_U32TYPE on the output port, the number of threads the decoder
+        // uses including the calling one, or 0 for one per CPU core
+        kThreadCountExtensionIndex = kPrepareForAdaptivePlaybackIndex + 1,
+    };
+
     enum EOSStatus {
         INPUT_DATA_AVAILABLE,
         INPUT_EOS_SEEN,
@@ -69,7 +84,10 @@ private:
 
     bool mSignalledError;
 
+    int32_t mNumThreads;
+
     status_t initDecoder();
+    void setDecoderThreads();
     void drainAllOutputBuffers(bool eos);
     void drainOneOutputBuffer(int32_t picId, uint8_t *data);
     void saveFirstOutputBuffer(int32_t pidId, uint8_t *data);
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*------------------------------------------------------------------------------
     Module defines
@@ -102,6 +103,9 @@ int main(int argc, char **argv)
     u32 numErrors = 0;
     u32 cropDisplay = 0;
     u32 disableOutputReordering = 0;
+    u32 numThreads = 1;
+    struct timespec startTime, endTime;
+    double decodeTime;
 
     FILE *finput;
 
@@ -123,7 +127,8 @@ int main(int argc, char **argv)
     if (argc < 2)
     {
         DEBUG((
-            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-T] file.h264\n",
+            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-Mn] [-T] "
+            "file.h264\n",
             argv[0]));
         DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
 #if defined(_NO_OUT)
@@ -136,6 +141,7 @@ int main(int argc, char **argv)
         DEBUG(("\t-U NAL unit stream mode\n"));
         DEBUG(("\t-C display cropped image (default decoded image)\n"));
         DEBUG(("\t-R disable DPB output reordering\n"));
+        DEBUG(("\t-Mn decode using n threads (default 1)\n"));
         DEBUG(("\t-T to print tag name and exit\n"));
         return 0;
     }
@@ -167,6 +173,10 @@ int main(int argc, char **argv)
         {
             disableOutputReordering = 1;
         }
+        else if ( strncmp(argv[i], "-M", 2) == 0 )
+        {
+            numThreads = (u32)atoi(argv[i]+2);
+        }
     }
 
     /* open input file for reading, file name given by user. If file open
@@ -204,6 +214,18 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if (numThreads > 1)
+    {
+        ret = H264SwDecSetThreads(decInst, numThreads);
+        if (ret != H264SWDEC_OK)
+        {
+            DEBUG(("UNABLE TO START DECODER THREADS\n"));
+            H264SwDecRelease(decInst);
+            free(byteStrmStart);
+            return -1;
+        }
+    }
+
     /* initialize H264SwDecDecode() input structure */
     streamStop = byteStrmStart + strmLen;
     decInput.pStream = byteStrmStart;
@@ -216,6 +238,7 @@ int main(int argc, char **argv)
         decInput.dataLen = tmp;
 
     picDecodeNumber = picDisplayNumber = 1;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
     /* main decoding loop */
     do
     {
@@ -408,6 +431,17 @@ int main(int argc, char **argv)
         }
     }
 
+    /* decoding speed, includes output file writing unless -Onone is used */
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    decodeTime = (endTime.tv_sec - startTime.tv_sec) +
+        (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+    if (decodeTime > 0)
+    {
+        DEBUG(("Decoded %d pictures in %.3f s using %d thread(s), %.2f fps\n",
+            picDecodeNumber - 1, decodeTime, numThreads > 1 ? numThreads : 1,
+            (picDecodeNumber - 1) / decodeTime));
+    }
+
     /* release decoder instance */
     H264SwDecRelease(decInst);
 
@@ -25,6 +25,7 @@
      5. Functions
           H264SwDecInit
           H264SwDecGetInfo
+          H264SwDecSetThreads
           H264SwDecRelease
           H264SwDecDecode
           H264SwDecGetAPIVersion
@@ -49,7 +50,7 @@
 ------------------------------------------------------------------------------*/
 
 #define H264SWDEC_MAJOR_VERSION 2
-#define H264SWDEC_MINOR_VERSION 3
+#define H264SWDEC_MINOR_VERSION 4
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -255,6 +256,66 @@ H264SwDecRet H264SwDecGetInfo(H264SwDecInst decInst, H264SwDecInfo *pDecInfo)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetThreads()
+
+        Functional description:
+            Set the number of threads used by the decoder instance. Macroblock
+            rows of each decoded picture are deblocking filtered in parallel
+            by numThreads threads, the thread calling H264SwDecDecode
+            included. Values 0 and 1 select single-threaded decoding, values
+            larger than 16 are clamped. Must not be called while
+            H264SwDecDecode is executing.
+
+        Inputs:
+            decInst     decoder instance
+            numThreads  number of threads
+
+        Outputs:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters
+            H264SWDEC_MEMFAIL       failed to create threads, decoder
+                                    continues single-threaded
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetThreads(H264SwDecInst decInst, u32 numThreads)
+{
+
+    decContainer_t *pDecCont;
+
+    DEC_API_TRC("H264SwDecSetThreads#");
+
+    if (decInst == NULL)
+    {
+        DEC_API_TRC("H264SwDecSetThreads# ERROR: decInst == NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pDecCont = (decContainer_t*)decInst;
+
+#ifdef H264DEC_TRACE
+    sprintf(pDecCont->str, "H264SwDecSetThreads# decInst %p numThreads %d",
+        decInst, numThreads);
+    DEC_API_TRC(pDecCont->str);
+#endif
+
+    if (h264bsdSetThreads(&pDecCont->storage, numThreads) != HANTRO_OK)
+    {
+        DEC_API_TRC("H264SwDecSetThreads# ERROR: thread creation failed");
+        return(H264SWDEC_MEMFAIL);
+    }
+
+    DEC_API_TRC("H264SwDecSetThreads# OK");
+
+    return(H264SWDEC_OK);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: H264SwDecRelease()
@@ -24,6 +24,11 @@
      4. Local function prototypes
      5. Functions
           h264bsdFilterPicture
+          h264bsdInitDeblockingThreads
+          h264bsdFreeDeblockingThreads
+          FilterMacroblock
+          FilterRows
+          DeblockingThreadMain
           FilterVerLumaEdge
           FilterHorLumaEdge
           FilterHorLuma
@@ -47,7 +52,10 @@
     1. Include headers
 ------------------------------------------------------------------------------*/
 
+#include <pthread.h>
+#include <sched.h>
 #include "basetype.h"
+#include "h264bsd_cfg.h"
 #include "h264bsd_util.h"
 #include "h264bsd_macroblock_layer.h"
 #include "h264bsd_deblocking.h"
@@ -59,10 +67,17 @@
 #include "armVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_SSE2
+#include <emmintrin.h>
+#endif /* H264DEC_SSE2 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
 
+H264DEC_SSE2            Use SSE2 to filter vertical luma edges, and horizontal
+                        luma edges when bS is equal for the whole 16-pixel edge
+
 --------------------------------------------------------------------------------
     3. Module defines
 ------------------------------------------------------------------------------*/
@@ -141,6 +156,31 @@ enum { TOP = 0, LEFT = 1, INNER = 2 };
 #define FILTER_TOP_EDGE     0x02
 #define FILTER_INNER_EDGE   0x01
 
+/* Rows of macroblocks are filtered as a wavefront: filtering of a macroblock
+ * modifies pixels of the macroblocks on the left and above, and the left edge
+ * of macroblock (row-1, col+1) modifies pixels of macroblock (row-1, col) that
+ * are used when the top edge of (row, col) is filtered. Macroblock (row, col)
+ * is therefore filtered only after (row-1, col+1) has been completed, which
+ * produces output identical to filtering in raster scan order. */
+struct deblockThreads
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+    pthread_t thread[MAX_NUM_THREADS];
+    u32 numThreads;     /* worker threads, calling thread filters as well */
+    u32 generation;     /* incremented for each picture to be filtered */
+    u32 numRunning;     /* workers still filtering current picture */
+    u32 quit;
+
+    /* picture being filtered */
+    image_t *image;
+    mbStorage_t *mb;
+    u32 nextRow;        /* next unclaimed macroblock row */
+    u32 *rowProgress;   /* number of filtered macroblocks for each row */
+    u32 rowProgressSize;
+};
+
 
 /* clipping table defined in intra_prediction.c */
 extern const u8 h264bsdClip[];
@@ -149,6 +189,14 @@ extern const u8 h264bsdClip[];
     4. Local function prototypes
 ------------------------------------------------------------------------------*/
 
+static void FilterMacroblock(image_t *image, mbStorage_t *pMb,
+    u32 mbRow, u32 mbCol);
+
+static void FilterRows(deblockThreads_t *threads, image_t *image,
+    mbStorage_t *mb);
+
+static void *DeblockingThreadMain(void *arg);
+
 static u32 InnerBoundaryStrength(mbStorage_t *mb1, u32 i1, u32 i2);
 
 #ifndef H264DEC_OMXDL
@@ -182,6 +230,10 @@ static void FilterHorLumaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
         i32 imageWidth);
 static void FilterHorLuma( u8 *data, u32 bS, edgeThreshold_t *thresholds,
         i32 imageWidth);
+#ifdef H264DEC_SSE2
+static void FilterHorLumaSse2(__m128i *pel, u32 bS,
+        edgeThreshold_t *thresholds);
+#endif /* H264DEC_SSE2 */
 
 static void FilterVerChromaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
   u32 imageWidth);
@@ -548,91 +600,63 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 #endif /* H264DEC_OMXDL */
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: FilterMacroblock
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
-
-        Inputs:
-          image         pointer to image to be filtered
-          mb            pointer to macroblock data structure of the top-left
-                        macroblock of the picture
-
-        Outputs:
-          image         filtered image stored here
-
-        Returns:
-          none
+            Perform deblocking filtering for the macroblock at (mbRow, mbCol).
+            Left and top edges of the macroblock modify pixels of the
+            macroblocks on the left and above, which therefore have to be
+            filtered before this one.
 
 ------------------------------------------------------------------------------*/
 #ifndef H264DEC_OMXDL
-void h264bsdFilterPicture(
+void FilterMacroblock(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *pMb,
+  u32 mbRow,
+  u32 mbCol)
 {
 
 /* Variables */
 
     u32 flags;
-    u32 picSizeInMbs, mbRow, mbCol;
+    u32 picSizeInMbs;
     u32 picWidthInMbs;
     u8 *data;
-    mbStorage_t *pMb;
     bS_t bS[16];
     edgeThreshold_t thresholds[3];
 
 /* Code */
 
     ASSERT(image);
-    ASSERT(mb);
-    ASSERT(image->data);
-    ASSERT(image->width);
-    ASSERT(image->height);
-
-    picWidthInMbs = image->width;
-    data = image->data;
-    picSizeInMbs = picWidthInMbs * image->height;
+    ASSERT(pMb);
 
-    pMb = mb;
+    flags = GetMbFilteringFlags(pMb);
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    if (flags)
     {
-        flags = GetMbFilteringFlags(pMb);
+        picWidthInMbs = image->width;
+        picSizeInMbs = picWidthInMbs * image->height;
 
-        if (flags)
+        /* GetBoundaryStrengths function returns non-zero value if any of
+         * the bS values for the macroblock being processed was non-zero */
+        if (GetBoundaryStrengths(pMb, bS, flags))
         {
-            /* GetBoundaryStrengths function returns non-zero value if any of
-             * the bS values for the macroblock being processed was non-zero */
-            if (GetBoundaryStrengths(pMb, bS, flags))
-            {
-                /* luma */
-                GetLumaEdgeThresholds(thresholds, pMb, flags);
-                data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
+            /* luma */
+            GetLumaEdgeThresholds(thresholds, pMb, flags);
+            data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
 
-                FilterLuma((u8*)data, bS, thresholds, picWidthInMbs*16);
+            FilterLuma((u8*)data, bS, thresholds, picWidthInMbs*16);
 
-                /* chroma */
-                GetChromaEdgeThresholds(thresholds, pMb, flags,
-                    pMb->chromaQpIndexOffset);
-                data = image->data + picSizeInMbs * 256 +
-                    mbRow * picWidthInMbs * 64 + mbCol * 8;
+            /* chroma */
+            GetChromaEdgeThresholds(thresholds, pMb, flags,
+                pMb->chromaQpIndexOffset);
+            data = image->data + picSizeInMbs * 256 +
+                mbRow * picWidthInMbs * 64 + mbCol * 8;
 
-                FilterChroma((u8*)data, data + 64*picSizeInMbs, bS,
-                        thresholds, picWidthInMbs*8);
+            FilterChroma((u8*)data, data + 64*picSizeInMbs, bS,
+                    thresholds, picWidthInMbs*8);
 
-            }
-        }
-
-        mbCol++;
-        if (mbCol == picWidthInMbs)
-        {
-            mbCol = 0;
-            mbRow++;
         }
     }
 
@@ -646,6 +670,7 @@ void h264bsdFilterPicture(
             Filter one vertical 4-pixel luma edge.
 
 ------------------------------------------------------------------------------*/
+#ifndef H264DEC_SSE2
 void FilterVerLumaEdge(
   u8 *data,
   u32 bS,
@@ -748,6 +773,7 @@ void FilterVerLumaEdge(
     }
 
 }
+#endif /* H264DEC_SSE2 */
 
 /*------------------------------------------------------------------------------
 
@@ -826,6 +852,7 @@ void FilterHorLumaEdge(
             be done when bS is equal to all four edges.
 
 ------------------------------------------------------------------------------*/
+#ifndef H264DEC_SSE2
 void FilterHorLuma(
   u8 *data,
   u32 bS,
@@ -931,6 +958,249 @@ void FilterHorLuma(
 
 }
 
+#else /* H264DEC_SSE2 */
+
+/* select a where mask is set, b elsewhere */
+#define SELECT(mask, a, b) \
+    _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b))
+
+#define ABS_DIFF(a, b) _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b))
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterHorLumaSse2
+
+        Functional description:
+            Filter eight lines across a luma edge, columns of a horizontal
+            edge or rows of a vertical one. pel[0..7] hold p3..q3 as 16-bit
+            values, filtered p2..q2 are written back to pel[1..6].
+
+------------------------------------------------------------------------------*/
+void FilterHorLumaSse2(
+  __m128i *pel,
+  u32 bS,
+  edgeThreshold_t *thresholds)
+{
+
+/* Variables */
+
+    __m128i p3, p2, p1, p0, q0, q1, q2, q3;
+    __m128i mask, ap, aq, tc, delta, tmp, tmpP, tmpQ, two, four;
+
+/* Code */
+
+    p3 = pel[0]; p2 = pel[1]; p1 = pel[2]; p0 = pel[3];
+    q0 = pel[4]; q1 = pel[5]; q2 = pel[6]; q3 = pel[7];
+
+    tmp = _mm_set1_epi16((i16)thresholds->beta);
+    mask = _mm_and_si128(
+        _mm_cmplt_epi16(ABS_DIFF(p0, q0),
+            _mm_set1_epi16((i16)thresholds->alpha)),
+        _mm_and_si128(_mm_cmplt_epi16(ABS_DIFF(p1, p0), tmp),
+                      _mm_cmplt_epi16(ABS_DIFF(q1, q0), tmp)));
+    ap = _mm_and_si128(mask, _mm_cmplt_epi16(ABS_DIFF(p2, p0), tmp));
+    aq = _mm_and_si128(mask, _mm_cmplt_epi16(ABS_DIFF(q2, q0), tmp));
+
+    two = _mm_set1_epi16(2);
+    four = _mm_set1_epi16(4);
+
+    if (bS < 4)
+    {
+        tc = _mm_set1_epi16((i16)thresholds->tc0[bS-1]);
+
+        /* (p0 + q0 + 1) >> 1 */
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p0, q0),
+            _mm_set1_epi16(1)), 1);
+
+        delta = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(p2, tmp),
+            _mm_slli_epi16(p1, 1)), 1);
+        delta = _mm_min_epi16(_mm_max_epi16(delta,
+            _mm_sub_epi16(_mm_setzero_si128(), tc)), tc);
+        pel[2] = SELECT(ap, _mm_add_epi16(p1, delta), p1);
+
+        delta = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(q2, tmp),
+            _mm_slli_epi16(q1, 1)), 1);
+        delta = _mm_min_epi16(_mm_max_epi16(delta,
+            _mm_sub_epi16(_mm_setzero_si128(), tc)), tc);
+        pel[5] = SELECT(aq, _mm_add_epi16(q1, delta), q1);
+
+        /* tc is incremented by one for each of ap and aq, masks are -1 */
+        tc = _mm_sub_epi16(_mm_sub_epi16(tc, ap), aq);
+        delta = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+            _mm_slli_epi16(_mm_sub_epi16(q0, p0), 2), _mm_sub_epi16(p1, q1)),
+            four), 3);
+        delta = _mm_min_epi16(_mm_max_epi16(delta,
+            _mm_sub_epi16(_mm_setzero_si128(), tc)), tc);
+        pel[3] = SELECT(mask, _mm_add_epi16(p0, delta), p0);
+        pel[4] = SELECT(mask, _mm_sub_epi16(q0, delta), q0);
+    }
+    else
+    {
+        /* strong filtering only if |p0 - q0| < (alpha >> 2) + 2 */
+        tmp = _mm_cmplt_epi16(ABS_DIFF(p0, q0),
+            _mm_set1_epi16((i16)((thresholds->alpha >> 2) + 2)));
+        ap = _mm_and_si128(ap, tmp);
+        aq = _mm_and_si128(aq, tmp);
+
+        tmpP = _mm_add_epi16(_mm_add_epi16(p1, p0), q0);
+        tmpQ = _mm_add_epi16(_mm_add_epi16(p0, q0), q1);
+
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p2,
+            _mm_slli_epi16(tmpP, 1)), _mm_add_epi16(q1, four)), 3);
+        pel[3] = SELECT(ap, tmp, SELECT(mask, _mm_srai_epi16(_mm_add_epi16(
+            _mm_add_epi16(_mm_slli_epi16(p1, 1), p0), _mm_add_epi16(q1, two)),
+            2), p0));
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p2, tmpP), two), 2);
+        pel[2] = SELECT(ap, tmp, p1);
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+            _mm_slli_epi16(p3, 1), _mm_add_epi16(_mm_slli_epi16(p2, 1), p2)),
+            _mm_add_epi16(tmpP, four)), 3);
+        pel[1] = SELECT(ap, tmp, p2);
+
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p1,
+            _mm_slli_epi16(tmpQ, 1)), _mm_add_epi16(q2, four)), 3);
+        pel[4] = SELECT(aq, tmp, SELECT(mask, _mm_srai_epi16(_mm_add_epi16(
+            _mm_add_epi16(_mm_slli_epi16(q1, 1), q0), _mm_add_epi16(p1, two)),
+            2), q0));
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(q2, tmpQ), two), 2);
+        pel[5] = SELECT(aq, tmp, q1);
+        tmp = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+            _mm_slli_epi16(q3, 1), _mm_add_epi16(_mm_slli_epi16(q2, 1), q2)),
+            _mm_add_epi16(tmpQ, four)), 3);
+        pel[6] = SELECT(aq, tmp, q2);
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterHorLuma
+
+        Functional description:
+            Filter all four successive horizontal 4-pixel luma edges. This can
+            be done when bS is equal to all four edges. SSE2 version, filters
+            the 16 columns in two halves of eight.
+
+------------------------------------------------------------------------------*/
+void FilterHorLuma(
+  u8 *data,
+  u32 bS,
+  edgeThreshold_t *thresholds,
+  i32 imageWidth)
+{
+
+/* Variables */
+
+    u32 i, first;
+    __m128i row[8], lo[8], hi[8];
+    const __m128i zero = _mm_setzero_si128();
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(bS <= 4);
+    ASSERT(thresholds);
+
+    for (i = 0; i < 8; i++)
+    {
+        row[i] = _mm_loadu_si128(
+            (const __m128i *)(data + ((i32)i - 4) * imageWidth));
+        lo[i] = _mm_unpacklo_epi8(row[i], zero);
+        hi[i] = _mm_unpackhi_epi8(row[i], zero);
+    }
+
+    FilterHorLumaSse2(lo, bS, thresholds);
+    FilterHorLumaSse2(hi, bS, thresholds);
+
+    /* rows p2 and q2 are only modified by the strong filter, results are
+     * within [0, 255] so the saturating pack is exact */
+    first = (bS < 4) ? 2 : 1;
+    for (i = first; i < 8 - first; i++)
+        _mm_storeu_si128((__m128i *)(data + ((i32)i - 4) * imageWidth),
+            _mm_packus_epi16(lo[i], hi[i]));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterVerLumaEdge
+
+        Functional description:
+            Filter one vertical 4-pixel luma edge. SSE2 version, transposes
+            the 8x4 pixels around the edge so that each of p3..q3 is one
+            register with the four rows in its low four lanes, filters them
+            with FilterHorLumaSse2 and transposes them back.
+
+------------------------------------------------------------------------------*/
+void FilterVerLumaEdge(
+  u8 *data,
+  u32 bS,
+  edgeThreshold_t *thresholds,
+  u32 imageWidth)
+{
+
+/* Variables */
+
+    __m128i pel[8];
+    __m128i r0, r1, r2, r3, t0, t1, t2, t3;
+    const __m128i zero = _mm_setzero_si128();
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(bS && bS <= 4);
+    ASSERT(thresholds);
+
+    /* pixels p3..q3 of the four rows as 16-bit values */
+    r0 = _mm_unpacklo_epi8(_mm_loadl_epi64(
+        (const __m128i *)(data - 4)), zero);
+    r1 = _mm_unpacklo_epi8(_mm_loadl_epi64(
+        (const __m128i *)(data - 4 + imageWidth)), zero);
+    r2 = _mm_unpacklo_epi8(_mm_loadl_epi64(
+        (const __m128i *)(data - 4 + 2*imageWidth)), zero);
+    r3 = _mm_unpacklo_epi8(_mm_loadl_epi64(
+        (const __m128i *)(data - 4 + 3*imageWidth)), zero);
+
+    /* transpose, the high lanes of pel[] are not used */
+    t0 = _mm_unpacklo_epi16(r0, r1);
+    t1 = _mm_unpacklo_epi16(r2, r3);
+    t2 = _mm_unpackhi_epi16(r0, r1);
+    t3 = _mm_unpackhi_epi16(r2, r3);
+    pel[0] = _mm_unpacklo_epi32(t0, t1);
+    pel[2] = _mm_unpackhi_epi32(t0, t1);
+    pel[4] = _mm_unpacklo_epi32(t2, t3);
+    pel[6] = _mm_unpackhi_epi32(t2, t3);
+    pel[1] = _mm_srli_si128(pel[0], 8);
+    pel[3] = _mm_srli_si128(pel[2], 8);
+    pel[5] = _mm_srli_si128(pel[4], 8);
+    pel[7] = _mm_srli_si128(pel[6], 8);
+
+    FilterHorLumaSse2(pel, bS, thresholds);
+
+    /* transpose back, p3 and q3 are stored unchanged */
+    t0 = _mm_unpacklo_epi16(pel[0], pel[1]);
+    t1 = _mm_unpacklo_epi16(pel[2], pel[3]);
+    t2 = _mm_unpacklo_epi16(pel[4], pel[5]);
+    t3 = _mm_unpacklo_epi16(pel[6], pel[7]);
+    r0 = _mm_unpacklo_epi32(t0, t1);
+    r1 = _mm_unpackhi_epi32(t0, t1);
+    r2 = _mm_unpacklo_epi32(t2, t3);
+    r3 = _mm_unpackhi_epi32(t2, t3);
+    t0 = _mm_packus_epi16(_mm_unpacklo_epi64(r0, r2),
+        _mm_unpackhi_epi64(r0, r2));
+    t1 = _mm_packus_epi16(_mm_unpacklo_epi64(r1, r3),
+        _mm_unpackhi_epi64(r1, r3));
+
+    _mm_storel_epi64((__m128i *)(data - 4), t0);
+    _mm_storel_epi64((__m128i *)(data - 4 + imageWidth),
+        _mm_srli_si128(t0, 8));
+    _mm_storel_epi64((__m128i *)(data - 4 + 2*imageWidth), t1);
+    _mm_storel_epi64((__m128i *)(data - 4 + 3*imageWidth),
+        _mm_srli_si128(t1, 8));
+
+}
+#endif /* H264DEC_SSE2 */
+
 /*------------------------------------------------------------------------------
 
     Function: FilterVerChromaEdge
@@ -1739,42 +2009,30 @@ void FilterChroma(
 
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: FilterMacroblock
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
-
-        Inputs:
-          image         pointer to image to be filtered
-          mb            pointer to macroblock data structure of the top-left
-                        macroblock of the picture
-
-        Outputs:
-          image         filtered image stored here
-
-        Returns:
-          none
+            Perform deblocking filtering for the macroblock at (mbRow, mbCol).
+            Left and top edges of the macroblock modify pixels of the
+            macroblocks on the left and above, which therefore have to be
+            filtered before this one.
 
 ------------------------------------------------------------------------------*/
 
 /*lint --e{550} Symbol not accessed */
-void h264bsdFilterPicture(
+void FilterMacroblock(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *pMb,
+  u32 mbRow,
+  u32 mbCol)
 {
 
 /* Variables */
 
     u32 flags;
-    u32 picSizeInMbs, mbRow, mbCol;
+    u32 picSizeInMbs;
     u32 picWidthInMbs;
     u8 *data;
-    mbStorage_t *pMb;
     u8 bS[2][16];
     u8 thresholdLuma[2][16];
     u8 thresholdChroma[2][8];
@@ -1785,85 +2043,69 @@ void h264bsdFilterPicture(
 /* Code */
 
     ASSERT(image);
-    ASSERT(mb);
-    ASSERT(image->data);
-    ASSERT(image->width);
-    ASSERT(image->height);
+    ASSERT(pMb);
 
-    picWidthInMbs = image->width;
-    data = image->data;
-    picSizeInMbs = picWidthInMbs * image->height;
+    flags = GetMbFilteringFlags(pMb);
 
-    pMb = mb;
-
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    if (flags)
     {
-        flags = GetMbFilteringFlags(pMb);
+        picWidthInMbs = image->width;
+        picSizeInMbs = picWidthInMbs * image->height;
 
-        if (flags)
+        /* GetBoundaryStrengths function returns non-zero value if any of
+         * the bS values for the macroblock being processed was non-zero */
+        if (GetBoundaryStrengths(pMb, bS, flags))
         {
-            /* GetBoundaryStrengths function returns non-zero value if any of
-             * the bS values for the macroblock being processed was non-zero */
-            if (GetBoundaryStrengths(pMb, bS, flags))
-            {
 
-                /* Luma */
-                GetLumaEdgeThresholds(pMb,alpha,beta,thresholdLuma,bS,flags);
-                data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
-
-                res = omxVCM4P10_FilterDeblockingLuma_VerEdge_I( data,
-                                                (OMX_S32)(picWidthInMbs*16),
-                                                (const OMX_U8*)alpha,
-                                                (const OMX_U8*)beta,
-                                                (const OMX_U8*)thresholdLuma,
-                                                (const OMX_U8*)bS );
-
-                res = omxVCM4P10_FilterDeblockingLuma_HorEdge_I( data,
-                                                (OMX_S32)(picWidthInMbs*16),
-                                                (const OMX_U8*)alpha+2,
-                                                (const OMX_U8*)beta+2,
-                                                (const OMX_U8*)thresholdLuma+16,
-                                                (const OMX_U8*)bS+16 );
-                /* Cb */
-                GetChromaEdgeThresholds(pMb, alpha, beta, thresholdChroma,
-                                        bS, flags, pMb->chromaQpIndexOffset);
-                data = image->data + picSizeInMbs * 256 +
-                    mbRow * picWidthInMbs * 64 + mbCol * 8;
-
-                res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha,
-                                              (const OMX_U8*)beta,
-                                              (const OMX_U8*)thresholdChroma,
-                                              (const OMX_U8*)bS );
-                res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha+2,
-                                              (const OMX_U8*)beta+2,
-                                              (const OMX_U8*)thresholdChroma+8,
-                                              (const OMX_U8*)bS+16 );
-                /* Cr */
-                data += (picSizeInMbs * 64);
-                res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha,
-                                              (const OMX_U8*)beta,
-                                              (const OMX_U8*)thresholdChroma,
-                                              (const OMX_U8*)bS );
-                res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
-                                              (OMX_S32)(picWidthInMbs*8),
-                                              (const OMX_U8*)alpha+2,
-                                              (const OMX_U8*)beta+2,
-                                              (const OMX_U8*)thresholdChroma+8,
-                                              (const OMX_U8*)bS+16 );
-            }
-        }
-
-        mbCol++;
-        if (mbCol == picWidthInMbs)
-        {
-            mbCol = 0;
-            mbRow++;
+            /* Luma */
+            GetLumaEdgeThresholds(pMb,alpha,beta,thresholdLuma,bS,flags);
+            data = image->data + mbRow * picWidthInMbs * 256 + mbCol * 16;
+
+            res = omxVCM4P10_FilterDeblockingLuma_VerEdge_I( data,
+                                            (OMX_S32)(picWidthInMbs*16),
+                                            (const OMX_U8*)alpha,
+                                            (const OMX_U8*)beta,
+                                            (const OMX_U8*)thresholdLuma,
+                                            (const OMX_U8*)bS );
+
+            res = omxVCM4P10_FilterDeblockingLuma_HorEdge_I( data,
+                                            (OMX_S32)(picWidthInMbs*16),
+                                            (const OMX_U8*)alpha+2,
+                                            (const OMX_U8*)beta+2,
+                                            (const OMX_U8*)thresholdLuma+16,
+                                            (const OMX_U8*)bS+16 );
+            /* Cb */
+            GetChromaEdgeThresholds(pMb, alpha, beta, thresholdChroma,
+                                    bS, flags, pMb->chromaQpIndexOffset);
+            data = image->data + picSizeInMbs * 256 +
+                mbRow * picWidthInMbs * 64 + mbCol * 8;
+
+            res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha,
+                                          (const OMX_U8*)beta,
+                                          (const OMX_U8*)thresholdChroma,
+                                          (const OMX_U8*)bS );
+            res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha+2,
+                                          (const OMX_U8*)beta+2,
+                                          (const OMX_U8*)thresholdChroma+8,
+                                          (const OMX_U8*)bS+16 );
+            /* Cr */
+            data += (picSizeInMbs * 64);
+            res = omxVCM4P10_FilterDeblockingChroma_VerEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha,
+                                          (const OMX_U8*)beta,
+                                          (const OMX_U8*)thresholdChroma,
+                                          (const OMX_U8*)bS );
+            res = omxVCM4P10_FilterDeblockingChroma_HorEdge_I( data,
+                                          (OMX_S32)(picWidthInMbs*8),
+                                          (const OMX_U8*)alpha+2,
+                                          (const OMX_U8*)beta+2,
+                                          (const OMX_U8*)thresholdChroma+8,
+                                          (const OMX_U8*)bS+16 );
         }
     }
 
@@ -2413,5 +2655,280 @@ void GetChromaEdgeThresholds(
 
 #endif /* H264DEC_OMXDL */
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterPicture
+
+        Functional description:
+          Perform deblocking filtering for a picture. Filter does not copy
+          the original picture anywhere but filtering is performed directly
+          on the original image. Parameters controlling the filtering process
+          are computed based on information in macroblock structures of the
+          filtered macroblock, macroblock above and macroblock on the left of
+          the filtered one.
+
+          When worker threads are given, macroblock rows are distributed
+          between the workers and the calling thread, and each row trails
+          the row above by two macroblocks.
+
+        Inputs:
+          image         pointer to image to be filtered
+          mb            pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+          threads       worker threads, NULL to filter in calling thread only
+
+        Outputs:
+          image         filtered image stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+void h264bsdFilterPicture(
+  image_t *image,
+  mbStorage_t *mb,
+  deblockThreads_t *threads)
+{
+
+/* Variables */
+
+    u32 mbRow, mbCol;
+    mbStorage_t *pMb;
+
+/* Code */
+
+    ASSERT(image);
+    ASSERT(mb);
+    ASSERT(image->data);
+    ASSERT(image->width);
+    ASSERT(image->height);
+
+    if (threads == NULL || image->height < 2)
+    {
+        pMb = mb;
+        for (mbRow = 0; mbRow < image->height; mbRow++)
+            for (mbCol = 0; mbCol < image->width; mbCol++, pMb++)
+                FilterMacroblock(image, pMb, mbRow, mbCol);
+        return;
+    }
+
+    if (threads->rowProgressSize < image->height)
+    {
+        FREE(threads->rowProgress);
+        ALLOCATE(threads->rowProgress, image->height, u32);
+        if (threads->rowProgress == NULL)
+        {
+            threads->rowProgressSize = 0;
+            h264bsdFilterPicture(image, mb, NULL);
+            return;
+        }
+        threads->rowProgressSize = image->height;
+    }
+    H264SwDecMemset(threads->rowProgress, 0, image->height * sizeof(u32));
+
+    pthread_mutex_lock(&threads->mutex);
+    threads->image = image;
+    threads->mb = mb;
+    threads->nextRow = 0;
+    threads->numRunning = threads->numThreads;
+    threads->generation++;
+    pthread_cond_broadcast(&threads->startCond);
+    pthread_mutex_unlock(&threads->mutex);
+
+    FilterRows(threads, image, mb);
+
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->numRunning)
+        pthread_cond_wait(&threads->doneCond, &threads->mutex);
+    pthread_mutex_unlock(&threads->mutex);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterRows
+
+        Functional description:
+            Claim unfiltered macroblock rows one at a time and filter them,
+            waiting for the row above to be far enough ahead before each
+            macroblock. Executed by the calling thread and all workers.
+
+------------------------------------------------------------------------------*/
+void FilterRows(deblockThreads_t *threads, image_t *image, mbStorage_t *mb)
+{
+
+/* Variables */
+
+    u32 mbRow, mbCol, needed;
+    u32 width = image->width;
+    u32 height = image->height;
+    u32 *progress = threads->rowProgress;
+
+/* Code */
+
+    while ((mbRow = __atomic_fetch_add(&threads->nextRow, 1,
+                    __ATOMIC_RELAXED)) < height)
+    {
+        for (mbCol = 0; mbCol < width; mbCol++)
+        {
+            if (mbRow)
+            {
+                needed = MIN(mbCol + 2, width);
+                while (__atomic_load_n(&progress[mbRow-1], __ATOMIC_ACQUIRE) <
+                       needed)
+                    sched_yield();
+            }
+
+            FilterMacroblock(image, mb + mbRow * width + mbCol, mbRow, mbCol);
+
+            __atomic_store_n(&progress[mbRow], mbCol + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: DeblockingThreadMain
+
+        Functional description:
+            Worker thread, filters rows of each picture signalled by
+            h264bsdFilterPicture until h264bsdFreeDeblockingThreads is called.
+
+------------------------------------------------------------------------------*/
+void *DeblockingThreadMain(void *arg)
+{
+
+/* Variables */
+
+    deblockThreads_t *threads = (deblockThreads_t *)arg;
+    u32 generation = 0;
+
+/* Code */
+
+    pthread_mutex_lock(&threads->mutex);
+    for (;;)
+    {
+        while (!threads->quit && threads->generation == generation)
+            pthread_cond_wait(&threads->startCond, &threads->mutex);
+        if (threads->quit)
+            break;
+        generation = threads->generation;
+        pthread_mutex_unlock(&threads->mutex);
+
+        FilterRows(threads, threads->image, threads->mb);
+
+        pthread_mutex_lock(&threads->mutex);
+        if (--threads->numRunning == 0)
+            pthread_cond_signal(&threads->doneCond);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    return NULL;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInitDeblockingThreads
+
+        Functional description:
+            Create worker threads for h264bsdFilterPicture. Filtering uses
+            numThreads threads in total, the calling thread included, so
+            (numThreads - 1) workers are started. No workers are needed and
+            *threads is set to NULL if numThreads is less than two.
+
+        Inputs:
+            numThreads  total number of threads, at most MAX_NUM_THREADS
+
+        Outputs:
+            threads     pointer to created worker threads stored here
+
+        Returns:
+            HANTRO_OK       success
+            HANTRO_NOK      memory allocation or thread creation failed
+
+------------------------------------------------------------------------------*/
+u32 h264bsdInitDeblockingThreads(deblockThreads_t **threads, u32 numThreads)
+{
+
+/* Variables */
+
+    u32 i;
+    deblockThreads_t *p;
+
+/* Code */
+
+    ASSERT(threads);
+
+    *threads = NULL;
+
+    numThreads = MIN(numThreads, MAX_NUM_THREADS);
+    if (numThreads < 2)
+        return(HANTRO_OK);
+
+    ALLOCATE(p, 1, deblockThreads_t);
+    if (p == NULL)
+        return(HANTRO_NOK);
+    H264SwDecMemset(p, 0, sizeof(deblockThreads_t));
+
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->startCond, NULL);
+    pthread_cond_init(&p->doneCond, NULL);
+
+    for (i = 0; i < numThreads - 1; i++)
+    {
+        if (pthread_create(&p->thread[i], NULL, DeblockingThreadMain, p))
+        {
+            h264bsdFreeDeblockingThreads(p);
+            return(HANTRO_NOK);
+        }
+        p->numThreads++;
+    }
+
+    *threads = p;
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFreeDeblockingThreads
+
+        Functional description:
+            Stop and join worker threads created by
+            h264bsdInitDeblockingThreads and free the related memory.
+
+------------------------------------------------------------------------------*/
+void h264bsdFreeDeblockingThreads(deblockThreads_t *threads)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    if (threads == NULL)
+        return;
+
+    pthread_mutex_lock(&threads->mutex);
+    threads->quit = HANTRO_TRUE;
+    pthread_cond_broadcast(&threads->startCond);
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (i = 0; i < threads->numThreads; i++)
+        pthread_join(threads->thread[i], NULL);
+
+    pthread_cond_destroy(&threads->doneCond);
+    pthread_cond_destroy(&threads->startCond);
+    pthread_mutex_destroy(&threads->mutex);
+
+    FREE(threads->rowProgress);
+    FREE(threads);
+
+}
+
 /*lint +e701 +e702 */
 
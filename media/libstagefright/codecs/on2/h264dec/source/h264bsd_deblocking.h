@@ -44,13 +44,21 @@
     3. Data types
 ------------------------------------------------------------------------------*/
 
+/* worker threads used to filter macroblock rows in parallel, contents are
+ * private to h264bsd_deblocking.c */
+typedef struct deblockThreads deblockThreads_t;
+
 /*------------------------------------------------------------------------------
     4. Function prototypes
 ------------------------------------------------------------------------------*/
 
 void h264bsdFilterPicture(
   image_t *image,
-  mbStorage_t *mb);
+  mbStorage_t *mb,
+  deblockThreads_t *threads);
+
+u32 h264bsdInitDeblockingThreads(deblockThreads_t **threads, u32 numThreads);
+void h264bsdFreeDeblockingThreads(deblockThreads_t *threads);
 
 #endif /* #ifdef H264SWDEC_DEBLOCKING_H */
 
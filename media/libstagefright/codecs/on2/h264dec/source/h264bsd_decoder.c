@@ -26,6 +26,7 @@
           h264bsdInit
           h264bsdDecode
           h264bsdShutdown
+          h264bsdSetThreads
           h264bsdCurrentImage
           h264bsdNextOutputPicture
           h264bsdPicWidth
@@ -471,7 +472,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
 
     if (picReady)
     {
-        h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
+        h264bsdFilterPicture(pStorage->currImage, pStorage->mb,
+            pStorage->deblockThreads);
 
         h264bsdResetStorage(pStorage);
 
@@ -567,10 +569,47 @@ void h264bsdShutdown(storage_t *pStorage)
     FREE(pStorage->mb);
     FREE(pStorage->sliceGroupMap);
 
+    h264bsdFreeDeblockingThreads(pStorage->deblockThreads);
+    pStorage->deblockThreads = NULL;
+
     h264bsdFreeDpb(pStorage->dpb);
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetThreads
+
+        Functional description:
+            Set number of threads used for decoding. Worker threads of the
+            previous setting are stopped before new ones are started.
+
+        Inputs:
+            pStorage    pointer to storage data structure
+            numThreads  total number of threads, 0 or 1 for single-threaded
+                        decoding
+
+        Returns:
+            HANTRO_OK       success
+            HANTRO_NOK      failed to start worker threads, decoding
+                            continues single-threaded
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdSetThreads(storage_t *pStorage, u32 numThreads)
+{
+
+/* Code */
+
+    ASSERT(pStorage);
+
+    h264bsdFreeDeblockingThreads(pStorage->deblockThreads);
+
+    return(h264bsdInitDeblockingThreads(&pStorage->deblockThreads,
+        numThreads));
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdNextOutputPicture
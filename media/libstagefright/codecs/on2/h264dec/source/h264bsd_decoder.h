@@ -61,6 +61,7 @@ u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering);
 u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
     u32 *readBytes);
 void h264bsdShutdown(storage_t *pStorage);
+u32 h264bsdSetThreads(storage_t *pStorage, u32 numThreads);
 
 u8* h264bsdNextOutputPicture(storage_t *pStorage, u32 *picId, u32 *isIdrPic,
     u32 *numErrMbs);
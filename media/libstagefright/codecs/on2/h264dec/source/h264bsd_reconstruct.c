@@ -106,7 +106,7 @@ extern const u8 h264bsdClip[];
           predPartChroma    pointer where predicted part is written
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_ARM11
+#if !defined(H264DEC_ARM11) && !defined(H264DEC_SSE2)
 void h264bsdInterpolateChromaHor(
   u8 *pRef,
   u8 *predPartChroma,
@@ -298,7 +298,7 @@ void h264bsdInterpolateChromaVer(
           is written to macroblock's chrominance (predPartChroma)
 
 ------------------------------------------------------------------------------*/
-
+#ifndef H264DEC_SSE2
 void h264bsdInterpolateChromaHorVer(
   u8 *ref,
   u8 *predPartChroma,
@@ -402,6 +402,7 @@ void h264bsdInterpolateChromaHorVer(
     }
 
 }
+#endif /* H264DEC_SSE2 */
 
 /*------------------------------------------------------------------------------
 
@@ -487,7 +488,7 @@ static void PredictChroma(
           is written to macroblock array (mb)
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_ARM11
+#if !defined(H264DEC_ARM11) && !defined(H264DEC_SSE2)
 void h264bsdInterpolateVerHalf(
   u8 *ref,
   u8 *mb,
@@ -0,0 +1,755 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+     1. Include headers
+     2. External compiler flags
+     3. Module defines
+     4. Local function prototypes
+     5. Functions
+          h264bsdInterpolateChromaHor
+          h264bsdInterpolateChromaVer
+          h264bsdInterpolateChromaHorVer
+          h264bsdInterpolateVerHalf
+          h264bsdInterpolateVerQuarter
+          h264bsdInterpolateHorHalf
+          h264bsdInterpolateHorQuarter
+          h264bsdInterpolateHorVerQuarter
+
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <emmintrin.h>
+#include "basetype.h"
+#include "h264bsd_reconstruct.h"
+#include "h264bsd_util.h"
+
+/*------------------------------------------------------------------------------
+    2. External compiler flags
+--------------------------------------------------------------------------------
+
+H264DEC_SSE2            SSE2 versions of the interpolation functions in this
+                        file replace the C versions in h264bsd_reconstruct.c.
+                        Results are bit-exact with the C versions.
+
+--------------------------------------------------------------------------------
+    3. Module defines
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    4. Local function prototypes
+------------------------------------------------------------------------------*/
+
+static __m128i LoadPels(const u8 *ptr, u32 count);
+static void StorePels(u8 *ptr, __m128i pels, u32 count);
+static __m128i Tap6(__m128i a, __m128i b, __m128i c, __m128i d,
+    __m128i e, __m128i f);
+static __m128i Bilinear(__m128i a, __m128i b, __m128i wa,
+    __m128i wb, u32 shift);
+
+static void HorHalfRows(const u8 *ref, u8 *mb, u32 width, u32 partWidth,
+    u32 partHeight);
+static void VerHalfRows(const u8 *ref, u8 *mb, u32 width, u32 partWidth,
+    u32 partHeight);
+
+/*------------------------------------------------------------------------------
+
+    Function: LoadPels, StorePels
+
+        Functional description:
+            Load or store 2, 4 or 8 consecutive pixels in the low bytes of
+            an SSE2 register. Only the given number of bytes is accessed.
+
+------------------------------------------------------------------------------*/
+__m128i LoadPels(const u8 *ptr, u32 count)
+{
+    u32 tmp = 0;
+
+    if (count == 8)
+        return _mm_loadl_epi64((const __m128i *)ptr);
+
+    memcpy(&tmp, ptr, count);
+    return _mm_cvtsi32_si128((int)tmp);
+}
+
+void StorePels(u8 *ptr, __m128i pels, u32 count)
+{
+    u32 tmp;
+
+    if (count == 8)
+    {
+        _mm_storel_epi64((__m128i *)ptr, pels);
+        return;
+    }
+
+    tmp = (u32)_mm_cvtsi128_si32(pels);
+    memcpy(ptr, &tmp, count);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Tap6
+
+        Functional description:
+            Six tap luma filter (1, -5, 20, 20, -5, 1) with rounding and
+            clipping for the eight pixels in the low bytes of a..f. Largest
+            intermediate value is 20*510+510+16, which fits into 16 bits.
+
+------------------------------------------------------------------------------*/
+__m128i Tap6(__m128i a, __m128i b, __m128i c, __m128i d, __m128i e, __m128i f)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i af, be, cd, sum;
+
+    af = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(f, zero));
+    be = _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(e, zero));
+    cd = _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero));
+
+    sum = _mm_add_epi16(af, _mm_set1_epi16(16));
+    sum = _mm_sub_epi16(sum, _mm_mullo_epi16(be, _mm_set1_epi16(5)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(cd, _mm_set1_epi16(20)));
+    sum = _mm_srai_epi16(sum, 5);
+
+    /* saturating pack equals clipping with h264bsdClip */
+    return _mm_packus_epi16(sum, sum);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Bilinear
+
+        Functional description:
+            Compute (wa*a + wb*b) for the eight pixels in the low bytes of a
+            and b. Result is left as 16-bit values if shift is zero,
+            otherwise rounded, shifted and packed back to bytes.
+
+------------------------------------------------------------------------------*/
+__m128i Bilinear(__m128i a, __m128i b, __m128i wa, __m128i wb, u32 shift)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum;
+
+    sum = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), wa),
+                        _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb));
+    if (!shift)
+        return sum;
+
+    sum = _mm_add_epi16(sum, _mm_set1_epi16((i16)(1 << (shift - 1))));
+    sum = _mm_srli_epi16(sum, (int)shift);
+    return _mm_packus_epi16(sum, sum);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: HorHalfRows
+
+        Functional description:
+            Horizontal half sample interpolation ('b') of partHeight rows,
+            ref points to the sample two positions left of G. Output is
+            written with a stride of 16.
+
+------------------------------------------------------------------------------*/
+void HorHalfRows(const u8 *ref, u8 *mb, u32 width, u32 partWidth,
+    u32 partHeight)
+{
+    u32 x, y, n;
+    __m128i pels;
+
+    n = partWidth < 8 ? partWidth : 8;
+
+    for (y = partHeight; y; y--)
+    {
+        for (x = 0; x < partWidth; x += n)
+        {
+            pels = Tap6(LoadPels(ref + x, n), LoadPels(ref + x + 1, n),
+                        LoadPels(ref + x + 2, n), LoadPels(ref + x + 3, n),
+                        LoadPels(ref + x + 4, n), LoadPels(ref + x + 5, n));
+            StorePels(mb + x, pels, n);
+        }
+        ref += width;
+        mb += 16;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: VerHalfRows
+
+        Functional description:
+            Vertical half sample interpolation ('h') of partHeight rows, ref
+            points to the sample two rows above G. Output is written with a
+            stride of 16.
+
+------------------------------------------------------------------------------*/
+void VerHalfRows(const u8 *ref, u8 *mb, u32 width, u32 partWidth,
+    u32 partHeight)
+{
+    u32 x, y, n;
+    __m128i r0, r1, r2, r3, r4, r5;
+
+    n = partWidth < 8 ? partWidth : 8;
+
+    for (x = 0; x < partWidth; x += n)
+    {
+        const u8 *ptr = ref + x;
+        u8 *out = mb + x;
+
+        r0 = LoadPels(ptr, n); ptr += width;
+        r1 = LoadPels(ptr, n); ptr += width;
+        r2 = LoadPels(ptr, n); ptr += width;
+        r3 = LoadPels(ptr, n); ptr += width;
+        r4 = LoadPels(ptr, n); ptr += width;
+
+        /* slide the six row window down one row per output row */
+        for (y = partHeight; y; y--)
+        {
+            r5 = LoadPels(ptr, n); ptr += width;
+            StorePels(out, Tap6(r0, r1, r2, r3, r4, r5), n);
+            out += 16;
+            r0 = r1; r1 = r2; r2 = r3; r3 = r4; r4 = r5;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateChromaHor
+
+        Functional description:
+          This function performs chroma interpolation in horizontal direction.
+          Overfilling is done only if needed. Reference image (pRef) is
+          read at correct position and the predicted part is written to
+          macroblock's chrominance (predPartChroma)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateChromaHor(
+  u8 *pRef,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 xFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+
+/* Variables */
+
+    u32 y, comp;
+    u8 *ptrA, *cbr;
+    u8 block[9*8*2];
+    __m128i wa, wb;
+
+/* Code */
+
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth);
+    ASSERT(chromaPartHeight);
+    ASSERT(xFrac < 8);
+    ASSERT(pRef);
+
+    if ((x0 < 0) || ((u32)x0+chromaPartWidth+1 > width) ||
+        (y0 < 0) || ((u32)y0+chromaPartHeight > height))
+    {
+        h264bsdFillBlock(pRef, block, x0, y0, width, height,
+            chromaPartWidth + 1, chromaPartHeight, chromaPartWidth + 1);
+        pRef += width * height;
+        h264bsdFillBlock(pRef, block + (chromaPartWidth+1)*chromaPartHeight,
+            x0, y0, width, height, chromaPartWidth + 1,
+            chromaPartHeight, chromaPartWidth + 1);
+
+        pRef = block;
+        x0 = 0;
+        y0 = 0;
+        width = chromaPartWidth+1;
+        height = chromaPartHeight;
+    }
+
+    /* weights are multiplied by 8 to share the rounding of the 2-D case */
+    wa = _mm_set1_epi16((i16)((8 - xFrac) << 3));
+    wb = _mm_set1_epi16((i16)(xFrac << 3));
+
+    for (comp = 0; comp <= 1; comp++)
+    {
+        ptrA = pRef + (comp * height + (u32)y0) * width + x0;
+        cbr = predPartChroma + comp * 8 * 8;
+
+        for (y = chromaPartHeight; y; y--)
+        {
+            StorePels(cbr, Bilinear(LoadPels(ptrA, chromaPartWidth),
+                                    LoadPels(ptrA + 1, chromaPartWidth),
+                                    wa, wb, 6), chromaPartWidth);
+            cbr += 8;
+            ptrA += width;
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateChromaVer
+
+        Functional description:
+          This function performs chroma interpolation in vertical direction.
+          Overfilling is done only if needed. Reference image (pRef) is
+          read at correct position and the predicted part is written to
+          macroblock's chrominance (predPartChroma)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateChromaVer(
+  u8 *pRef,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 yFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+
+/* Variables */
+
+    u32 y, comp;
+    u8 *ptrA, *cbr;
+    u8 block[9*8*2];
+    __m128i wa, wb, top, bottom;
+
+/* Code */
+
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth);
+    ASSERT(chromaPartHeight);
+    ASSERT(yFrac < 8);
+    ASSERT(pRef);
+
+    if ((x0 < 0) || ((u32)x0+chromaPartWidth > width) ||
+        (y0 < 0) || ((u32)y0+chromaPartHeight+1 > height))
+    {
+        h264bsdFillBlock(pRef, block, x0, y0, width, height, chromaPartWidth,
+            chromaPartHeight + 1, chromaPartWidth);
+        pRef += width * height;
+        h264bsdFillBlock(pRef, block + chromaPartWidth*(chromaPartHeight+1),
+            x0, y0, width, height, chromaPartWidth,
+            chromaPartHeight + 1, chromaPartWidth);
+
+        pRef = block;
+        x0 = 0;
+        y0 = 0;
+        width = chromaPartWidth;
+        height = chromaPartHeight+1;
+    }
+
+    wa = _mm_set1_epi16((i16)((8 - yFrac) << 3));
+    wb = _mm_set1_epi16((i16)(yFrac << 3));
+
+    for (comp = 0; comp <= 1; comp++)
+    {
+        ptrA = pRef + (comp * height + (u32)y0) * width + x0;
+        cbr = predPartChroma + comp * 8 * 8;
+
+        top = LoadPels(ptrA, chromaPartWidth);
+        for (y = chromaPartHeight; y; y--)
+        {
+            ptrA += width;
+            bottom = LoadPels(ptrA, chromaPartWidth);
+            StorePels(cbr, Bilinear(top, bottom, wa, wb, 6), chromaPartWidth);
+            cbr += 8;
+            top = bottom;
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateChromaHorVer
+
+        Functional description:
+          This function performs chroma interpolation in horizontal and
+          vertical direction. Overfilling is done only if needed. Reference
+          image (ref) is read at correct position and the predicted part
+          is written to macroblock's chrominance (predPartChroma)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateChromaHorVer(
+  u8 *ref,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 xFrac,
+  u32 yFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+
+/* Variables */
+
+    u8 block[9*9*2];
+    u32 y, comp;
+    u8 *ptrA, *cbr;
+    __m128i wx0, wx1, wy0, wy1, top, bottom, sum;
+
+/* Code */
+
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth);
+    ASSERT(chromaPartHeight);
+    ASSERT(xFrac < 8);
+    ASSERT(yFrac < 8);
+    ASSERT(ref);
+
+    if ((x0 < 0) || ((u32)x0+chromaPartWidth+1 > width) ||
+        (y0 < 0) || ((u32)y0+chromaPartHeight+1 > height))
+    {
+        h264bsdFillBlock(ref, block, x0, y0, width, height,
+            chromaPartWidth + 1, chromaPartHeight + 1, chromaPartWidth + 1);
+        ref += width * height;
+        h264bsdFillBlock(ref, block + (chromaPartWidth+1)*(chromaPartHeight+1),
+            x0, y0, width, height, chromaPartWidth + 1,
+            chromaPartHeight + 1, chromaPartWidth + 1);
+
+        ref = block;
+        x0 = 0;
+        y0 = 0;
+        width = chromaPartWidth+1;
+        height = chromaPartHeight+1;
+    }
+
+    wx0 = _mm_set1_epi16((i16)(8 - xFrac));
+    wx1 = _mm_set1_epi16((i16)xFrac);
+    wy0 = _mm_set1_epi16((i16)(8 - yFrac));
+    wy1 = _mm_set1_epi16((i16)yFrac);
+
+    for (comp = 0; comp <= 1; comp++)
+    {
+        ptrA = ref + (comp * height + (u32)y0) * width + x0;
+        cbr = predPartChroma + comp * 8 * 8;
+
+        /* horizontal sums of the row pair are at most 8*255, the weighted
+         * vertical sum is at most 64*255 and both fit into 16 bits */
+        top = Bilinear(LoadPels(ptrA, chromaPartWidth),
+                       LoadPels(ptrA + 1, chromaPartWidth), wx0, wx1, 0);
+        for (y = chromaPartHeight; y; y--)
+        {
+            ptrA += width;
+            bottom = Bilinear(LoadPels(ptrA, chromaPartWidth),
+                              LoadPels(ptrA + 1, chromaPartWidth),
+                              wx0, wx1, 0);
+            sum = _mm_add_epi16(_mm_mullo_epi16(top, wy0),
+                                _mm_mullo_epi16(bottom, wy1));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(32)), 6);
+            StorePels(cbr, _mm_packus_epi16(sum, sum), chromaPartWidth);
+            cbr += 8;
+            top = bottom;
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateVerHalf
+
+        Functional description:
+          Function to perform vertical interpolation of pixel position 'h'
+          for a block. Overfilling is done only if needed. Reference
+          image (ref) is read at correct position and the predicted part
+          is written to macroblock array (mb)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateVerHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth, partHeight+5, partWidth);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    VerHalfRows(ref, mb, width, partWidth, partHeight);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateVerQuarter
+
+        Functional description:
+          Function to perform vertical interpolation of pixel position 'd'
+          or 'n' for a block. Overfilling is done only if needed. Reference
+          image (ref) is read at correct position and the predicted part
+          is written to macroblock array (mb)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 verOffset)    /* 0 for pixel d, 1 for pixel n */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    u8 *ptrInt;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth, partHeight+5, partWidth);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    VerHalfRows(ref, mb, width, partWidth, partHeight);
+
+    /* average with integer sample position, either G or M */
+    ptrInt = ref + (2+verOffset)*width;
+    n = partWidth < 8 ? partWidth : 8;
+    for (y = partHeight; y; y--)
+    {
+        for (x = 0; x < partWidth; x += n)
+            StorePels(mb + x, _mm_avg_epu8(LoadPels(mb + x, n),
+                LoadPels(ptrInt + x, n)), n);
+        ptrInt += width;
+        mb += 16;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorHalf
+
+        Functional description:
+          Function to perform horizontal interpolation of pixel position 'b'
+          for a block. Overfilling is done only if needed. Reference
+          image (ref) is read at correct position and the predicted part
+          is written to macroblock array (mb)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateHorHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+    ASSERT((partWidth&0x3) == 0);
+    ASSERT((partHeight&0x3) == 0);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth + 5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    HorHalfRows(ref, mb, width, partWidth, partHeight);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorQuarter
+
+        Functional description:
+          Function to perform horizontal interpolation of pixel position 'a'
+          or 'c' for a block. Overfilling is done only if needed. Reference
+          image (ref) is read at correct position and the predicted part
+          is written to macroblock array (mb)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateHorQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horOffset) /* 0 for pixel a, 1 for pixel c */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    u8 *ptrInt;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth + 5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    HorHalfRows(ref, mb, width, partWidth, partHeight);
+
+    /* average with integer sample position, either G or H */
+    ptrInt = ref + 2 + horOffset;
+    n = partWidth < 8 ? partWidth : 8;
+    for (y = partHeight; y; y--)
+    {
+        for (x = 0; x < partWidth; x += n)
+            StorePels(mb + x, _mm_avg_epu8(LoadPels(mb + x, n),
+                LoadPels(ptrInt + x, n)), n);
+        ptrInt += width;
+        mb += 16;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorVerQuarter
+
+        Functional description:
+          Function to perform horizontal and vertical interpolation of pixel
+          position 'e', 'g', 'p' or 'r' for a block. Overfilling is done only
+          if needed. Reference image (ref) is read at correct position and
+          the predicted part is written to macroblock array (mb)
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateHorVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horVerOffset) /* 0 for pixel e, 1 for pixel g,
+                       2 for pixel p, 3 for pixel r */
+{
+    u32 p1[21*21/4+1];
+    u8 ver[16*16];
+    u32 x, y, n;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight+5, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth+5;
+    }
+
+    /* Ref points to G + (-2, -2) */
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* horizontal half sample 'b' or 's', depending on vertical offset */
+    HorHalfRows(ref + (((horVerOffset & 0x2) >> 1) + 2) * width, mb, width,
+        partWidth, partHeight);
+
+    /* vertical half sample 'h' or 'm', depending on horizontal offset */
+    VerHalfRows(ref + 2 + (horVerOffset & 0x1), ver, width, partWidth,
+        partHeight);
+
+    n = partWidth < 8 ? partWidth : 8;
+    for (y = 0; y < partHeight; y++)
+    {
+        for (x = 0; x < partWidth; x += n)
+            StorePels(mb + x, _mm_avg_epu8(LoadPels(mb + x, n),
+                LoadPels(ver + 16*y + x, n)), n);
+        mb += 16;
+    }
+
+}
+
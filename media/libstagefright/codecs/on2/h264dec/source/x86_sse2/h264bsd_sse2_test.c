@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Runs each SSE2 kernel and its C reference on the same random blocks and
+    reports any difference in the output. Usage: h264bsd_sse2_test [rounds]
+
+------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "h264bsd_util.h"
+#include "h264bsd_sse2_test.h"
+
+/*------------------------------------------------------------------------------
+    Module defines
+------------------------------------------------------------------------------*/
+
+#define PIC_WIDTH   64
+#define PIC_HEIGHT  48
+#define PIC_SIZE    (PIC_WIDTH * PIC_HEIGHT * 3 / 2)
+/* large enough for a 16x16 luma or 8x8 chroma prediction, plus guard bytes */
+#define PRED_SIZE   (16 * 16 + 64)
+
+#define REPORT_MAX  10
+
+static u32 failures = 0;
+
+/*------------------------------------------------------------------------------
+
+    Function name:  Fail
+
+    Purpose:
+        Count a mismatch and print the first few
+
+------------------------------------------------------------------------------*/
+static void Fail(const char *kernel, u32 round)
+{
+    if (failures++ < REPORT_MAX)
+        printf("%s: mismatch in round %u\n", kernel, round);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  FillPicture
+
+    Purpose:
+        Fill a picture with random pixels. Every other round uses only 0 and
+        255 so that the intermediate values of the filters reach their limits.
+
+------------------------------------------------------------------------------*/
+static void FillPicture(u8 *pic, u32 size, u32 round)
+{
+    u32 i;
+
+    for (i = 0; i < size; i++)
+        pic[i] = (round & 1) ? (u8)rand() : ((rand() & 1) ? 255 : 0);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  TestInterpolation
+
+    Purpose:
+        Compare one random luma or chroma interpolation, including blocks
+        partly or fully outside the picture
+
+------------------------------------------------------------------------------*/
+static void TestInterpolation(u8 *pic, u32 round)
+{
+    static const u32 lumaSizes[] = {4, 8, 16};
+    static const u32 chromaSizes[] = {2, 4, 8};
+    u8 ref[PRED_SIZE], sse2[PRED_SIZE];
+    u8 *chroma = pic + PIC_WIDTH * PIC_HEIGHT;
+    u32 partWidth = lumaSizes[rand() % 3];
+    u32 partHeight = lumaSizes[rand() % 3];
+    u32 chromaWidth = chromaSizes[rand() % 3];
+    u32 chromaHeight = chromaSizes[rand() % 3];
+    i32 x0 = rand() % (PIC_WIDTH + 32) - 16;
+    i32 y0 = rand() % (PIC_HEIGHT + 32) - 16;
+    u32 xFrac = rand() % 8;
+    u32 yFrac = rand() % 8;
+    u32 offset = rand() % 4;
+    const char *kernel = NULL;
+
+    memset(ref, 0x5a, sizeof(ref));
+    memset(sse2, 0x5a, sizeof(sse2));
+
+#define LUMA(f, ...) \
+    kernel = #f; \
+    Ref_kernels.f(pic, ref, x0, y0, PIC_WIDTH, PIC_HEIGHT, __VA_ARGS__); \
+    Sse2_kernels.f(pic, sse2, x0, y0, PIC_WIDTH, PIC_HEIGHT, __VA_ARGS__)
+#define CHROMA(f, ...) \
+    kernel = #f; \
+    Ref_kernels.f(chroma, ref, x0 / 2, y0 / 2, PIC_WIDTH / 2, \
+        PIC_HEIGHT / 2, __VA_ARGS__); \
+    Sse2_kernels.f(chroma, sse2, x0 / 2, y0 / 2, PIC_WIDTH / 2, \
+        PIC_HEIGHT / 2, __VA_ARGS__)
+
+    switch (rand() % 8)
+    {
+        case 0:
+            LUMA(interpolateHorHalf, partWidth, partHeight);
+            break;
+        case 1:
+            LUMA(interpolateVerHalf, partWidth, partHeight);
+            break;
+        case 2:
+            LUMA(interpolateHorQuarter, partWidth, partHeight, offset & 1);
+            break;
+        case 3:
+            LUMA(interpolateVerQuarter, partWidth, partHeight, offset & 1);
+            break;
+        case 4:
+            LUMA(interpolateHorVerQuarter, partWidth, partHeight, offset);
+            break;
+        case 5:
+            CHROMA(interpolateChromaHor, xFrac, chromaWidth, chromaHeight);
+            break;
+        case 6:
+            CHROMA(interpolateChromaVer, yFrac, chromaWidth, chromaHeight);
+            break;
+        default:
+            CHROMA(interpolateChromaHorVer, xFrac, yFrac, chromaWidth,
+                chromaHeight);
+            break;
+    }
+
+#undef LUMA
+#undef CHROMA
+
+    if (memcmp(ref, sse2, sizeof(ref)))
+        Fail(kernel, round);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  TestProcessBlock
+
+    Purpose:
+        Compare the dequantization and inverse transform of one random 4x4
+        block, including the range check of the result
+
+------------------------------------------------------------------------------*/
+static void TestProcessBlock(u32 round)
+{
+    i32 ref[16], sse2[16];
+    u32 i, qp, skip, coeffMap, refStatus, sse2Status;
+    /* small coefficients pass the range check, large ones may not */
+    i32 range = (round & 1) ? 64 : 2048;
+
+    qp = rand() % 52;
+    skip = rand() & 1;
+    coeffMap = 0;
+    for (i = 0; i < 16; i++)
+    {
+        ref[i] = (rand() % 4) ? 0 : rand() % (2 * range) - range;
+        if (ref[i])
+            coeffMap |= 1 << i;
+    }
+    memcpy(sse2, ref, sizeof(ref));
+
+    refStatus = Ref_kernels.processBlock(ref, qp, skip, coeffMap);
+    sse2Status = Sse2_kernels.processBlock(sse2, qp, skip, coeffMap);
+
+    /* the output is undefined if the block is rejected */
+    if (refStatus != sse2Status ||
+        (refStatus == HANTRO_OK && memcmp(ref, sse2, sizeof(ref))))
+        Fail("processBlock", round);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  TestFilter
+
+    Purpose:
+        Compare the luma edge filters on random edges. The pixels differ
+        only a little across the edge so that most of them are filtered.
+
+------------------------------------------------------------------------------*/
+static void TestFilter(u32 round)
+{
+    u8 ref[PIC_WIDTH * PIC_HEIGHT], sse2[PIC_WIDTH * PIC_HEIGHT];
+    u8 tc0[3];
+    u32 i, bS, alpha, beta, x, y;
+    u32 spread = (round & 2) ? 8 : 64;
+    u32 base = rand() % (256 - spread);
+    u8 *data;
+
+    for (i = 0; i < sizeof(ref); i++)
+        ref[i] = (u8)(base + rand() % spread);
+    memcpy(sse2, ref, sizeof(ref));
+
+    bS = rand() % 4 + 1;
+    alpha = rand() % 256;
+    beta = rand() % 19;
+    for (i = 0; i < 3; i++)
+        tc0[i] = (u8)(rand() % 26);
+
+    /* room for p3..q3 around the edge */
+    x = 4 + rand() % (PIC_WIDTH - 24);
+    y = 4 + rand() % (PIC_HEIGHT - 8);
+
+    if (round & 1)
+    {
+        data = ref + y * PIC_WIDTH + x;
+        Ref_kernels.filterHorLuma(data, bS, tc0, alpha, beta, PIC_WIDTH);
+        data = sse2 + y * PIC_WIDTH + x;
+        Sse2_kernels.filterHorLuma(data, bS, tc0, alpha, beta, PIC_WIDTH);
+        if (memcmp(ref, sse2, sizeof(ref)))
+            Fail("filterHorLuma", round);
+    }
+    else
+    {
+        data = ref + y * PIC_WIDTH + x;
+        Ref_kernels.filterVerLumaEdge(data, bS, tc0, alpha, beta, PIC_WIDTH);
+        data = sse2 + y * PIC_WIDTH + x;
+        Sse2_kernels.filterVerLumaEdge(data, bS, tc0, alpha, beta, PIC_WIDTH);
+        if (memcmp(ref, sse2, sizeof(ref)))
+            Fail("filterVerLumaEdge", round);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  main
+
+------------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    u8 *pic;
+    u32 round, rounds = 20000;
+
+    if (argc > 1)
+        rounds = (u32)atoi(argv[1]);
+
+    pic = (u8 *)malloc(PIC_SIZE);
+    if (pic == NULL)
+        return 1;
+
+    srand(1);
+    for (round = 0; round < rounds; round++)
+    {
+        FillPicture(pic, PIC_SIZE, round);
+        TestInterpolation(pic, round);
+        TestProcessBlock(round);
+        TestFilter(round);
+    }
+
+    free(pic);
+
+    printf("%u rounds, %u mismatches\n", rounds, failures);
+    return failures ? 1 : 0;
+}
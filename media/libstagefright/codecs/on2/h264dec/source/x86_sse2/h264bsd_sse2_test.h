@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+    1. Include headers
+    2. Module defines
+    3. Data types
+    4. Function prototypes
+
+------------------------------------------------------------------------------*/
+
+#ifndef H264SWDEC_SSE2_TEST_H
+#define H264SWDEC_SSE2_TEST_H
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include "basetype.h"
+
+/*------------------------------------------------------------------------------
+    2. Module defines
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    3. Data types
+------------------------------------------------------------------------------*/
+
+/* The kernels that have an SSE2 version, built once from the C sources and
+ * once with H264DEC_SSE2 by h264bsd_sse2_test_kernels.c */
+typedef struct
+{
+    void (*interpolateChromaHor)(u8 *pRef, u8 *predPartChroma, i32 x0,
+        i32 y0, u32 width, u32 height, u32 xFrac, u32 chromaPartWidth,
+        u32 chromaPartHeight);
+    void (*interpolateChromaVer)(u8 *pRef, u8 *predPartChroma, i32 x0,
+        i32 y0, u32 width, u32 height, u32 yFrac, u32 chromaPartWidth,
+        u32 chromaPartHeight);
+    void (*interpolateChromaHorVer)(u8 *ref, u8 *predPartChroma, i32 x0,
+        i32 y0, u32 width, u32 height, u32 xFrac, u32 yFrac,
+        u32 chromaPartWidth, u32 chromaPartHeight);
+    void (*interpolateVerHalf)(u8 *ref, u8 *mb, i32 x0, i32 y0, u32 width,
+        u32 height, u32 partWidth, u32 partHeight);
+    void (*interpolateVerQuarter)(u8 *ref, u8 *mb, i32 x0, i32 y0,
+        u32 width, u32 height, u32 partWidth, u32 partHeight,
+        u32 verOffset);
+    void (*interpolateHorHalf)(u8 *ref, u8 *mb, i32 x0, i32 y0, u32 width,
+        u32 height, u32 partWidth, u32 partHeight);
+    void (*interpolateHorQuarter)(u8 *ref, u8 *mb, i32 x0, i32 y0,
+        u32 width, u32 height, u32 partWidth, u32 partHeight,
+        u32 horOffset);
+    void (*interpolateHorVerQuarter)(u8 *ref, u8 *mb, i32 x0, i32 y0,
+        u32 width, u32 height, u32 partWidth, u32 partHeight,
+        u32 horVerOffset);
+    u32 (*processBlock)(i32 *data, u32 qp, u32 skip, u32 coeffMap);
+    void (*filterHorLuma)(u8 *data, u32 bS, const u8 *tc0, u32 alpha,
+        u32 beta, u32 width);
+    void (*filterVerLumaEdge)(u8 *data, u32 bS, const u8 *tc0, u32 alpha,
+        u32 beta, u32 width);
+} kernels_t;
+
+extern const kernels_t Ref_kernels;
+extern const kernels_t Sse2_kernels;
+
+/*------------------------------------------------------------------------------
+    4. Function prototypes
+------------------------------------------------------------------------------*/
+
+#endif /* #ifdef H264SWDEC_SSE2_TEST_H */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Included by h264bsd_sse2_test_ref.c and h264bsd_sse2_test_sse2.c, which
+    define KERNEL_PREFIX and whether H264DEC_SSE2 is set. The decoder sources
+    with the kernels are included here so that the static deblocking
+    functions can be called, and their external functions get KERNEL_PREFIX
+    so that both builds can be linked into one test.
+
+------------------------------------------------------------------------------*/
+
+#define NAME(x) NAME2(KERNEL_PREFIX, x)
+#define NAME2(p, x) NAME3(p, x)
+#define NAME3(p, x) p##_##x
+
+#define InnerBoundaryStrength2          NAME(InnerBoundaryStrength2)
+#define h264bsdFilterPicture            NAME(h264bsdFilterPicture)
+#define h264bsdFreeDeblockingThreads    NAME(h264bsdFreeDeblockingThreads)
+#define h264bsdInitDeblockingThreads    NAME(h264bsdInitDeblockingThreads)
+#define h264bsdFillBlock                NAME(h264bsdFillBlock)
+#define h264bsdFillRow7                 NAME(h264bsdFillRow7)
+#define h264bsdPredictSamples           NAME(h264bsdPredictSamples)
+#define h264bsdInterpolateChromaHor     NAME(h264bsdInterpolateChromaHor)
+#define h264bsdInterpolateChromaVer     NAME(h264bsdInterpolateChromaVer)
+#define h264bsdInterpolateChromaHorVer  NAME(h264bsdInterpolateChromaHorVer)
+#define h264bsdInterpolateVerHalf       NAME(h264bsdInterpolateVerHalf)
+#define h264bsdInterpolateVerQuarter    NAME(h264bsdInterpolateVerQuarter)
+#define h264bsdInterpolateHorHalf       NAME(h264bsdInterpolateHorHalf)
+#define h264bsdInterpolateHorQuarter    NAME(h264bsdInterpolateHorQuarter)
+#define h264bsdInterpolateHorVerQuarter NAME(h264bsdInterpolateHorVerQuarter)
+#define h264bsdInterpolateMidHalf       NAME(h264bsdInterpolateMidHalf)
+#define h264bsdInterpolateMidVerQuarter NAME(h264bsdInterpolateMidVerQuarter)
+#define h264bsdInterpolateMidHorQuarter NAME(h264bsdInterpolateMidHorQuarter)
+#define h264bsdProcessBlock             NAME(h264bsdProcessBlock)
+#define h264bsdProcessLumaDc            NAME(h264bsdProcessLumaDc)
+#define h264bsdProcessChromaDc          NAME(h264bsdProcessChromaDc)
+
+#include "../h264bsd_deblocking.c"
+#include "../h264bsd_reconstruct.c"
+#include "../h264bsd_transform.c"
+#ifdef H264DEC_SSE2
+#include "h264bsd_interpolate_sse2.c"
+#endif
+
+#include "h264bsd_sse2_test.h"
+
+static void NAME(FilterHorLumaTest)(u8 *data, u32 bS, const u8 *tc0,
+    u32 alpha, u32 beta, u32 width)
+{
+    edgeThreshold_t thresholds;
+
+    thresholds.tc0 = tc0;
+    thresholds.alpha = alpha;
+    thresholds.beta = beta;
+    FilterHorLuma(data, bS, &thresholds, (i32)width);
+}
+
+static void NAME(FilterVerLumaEdgeTest)(u8 *data, u32 bS, const u8 *tc0,
+    u32 alpha, u32 beta, u32 width)
+{
+    edgeThreshold_t thresholds;
+
+    thresholds.tc0 = tc0;
+    thresholds.alpha = alpha;
+    thresholds.beta = beta;
+    FilterVerLumaEdge(data, bS, &thresholds, width);
+}
+
+const kernels_t NAME(kernels) = {
+    h264bsdInterpolateChromaHor,
+    h264bsdInterpolateChromaVer,
+    h264bsdInterpolateChromaHorVer,
+    h264bsdInterpolateVerHalf,
+    h264bsdInterpolateVerQuarter,
+    h264bsdInterpolateHorHalf,
+    h264bsdInterpolateHorQuarter,
+    h264bsdInterpolateHorVerQuarter,
+    h264bsdProcessBlock,
+    NAME(FilterHorLumaTest),
+    NAME(FilterVerLumaEdgeTest)
+};
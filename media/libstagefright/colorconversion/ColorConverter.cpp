@@ -18,16 +18,315 @@
 #define LOG_TAG "ColorConverter"
 #include <utils/Log.h>
 
+#include <pthread.h>
+#include <string.h>
+
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/ColorConverter.h>
 #include <media/stagefright/MediaErrors.h>
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
 namespace android {
 
+// Each band converted on its own thread covers at least this many pixels,
+// smaller frames are not worth the thread startup.
+static const size_t kMinPixelsPerBand = 640 * 360;
+static const size_t kMaxThreads = 8;
+
+// YUV -> RGB with 8 fractional bits:
+//   R = cY * (Y - yOffset)                    + cRV * (V - 128)
+//   G = cY * (Y - yOffset) + cGU * (U - 128)  + cGV * (V - 128)
+//   B = cY * (Y - yOffset) + cBU * (U - 128)
+struct YUVCoeffs {
+    int16_t yOffset;
+    int16_t cY, cRV, cGU, cGV, cBU;
+};
+
+// Indexed by [ColorMatrix][fullRange].
+static const YUVCoeffs kYUVCoeffs[2][2] = {
+    {
+        // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
+        // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
+        // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
+        { 16, 298, 409, -100, -208, 517 },
+        { 0, 256, 359, -88, -183, 454 },
+    },
+    {
+        // B = 1.164 * (Y - 16) + 2.112 * (U - 128)
+        // G = 1.164 * (Y - 16) - 0.533 * (V - 128) - 0.213 * (U - 128)
+        // R = 1.164 * (Y - 16) + 1.793 * (V - 128)
+        { 16, 298, 459, -55, -136, 541 },
+        { 0, 256, 403, -48, -120, 475 },
+    },
+};
+
+// One row of source pixels: luma sample i is at mY[i * mYStep], the chroma
+// samples shared by pixels 2i and 2i + 1 at mU[i * mUVStep], mV[i * mUVStep].
+struct SrcRow {
+    const uint8_t *mY, *mU, *mV;
+    size_t mYStep, mUVStep;
+};
+
+static void convertRowC(
+        const YUVCoeffs &c, const uint8_t *clip, const SrcRow &row,
+        size_t x, size_t width, bool rgba, void *dst) {
+    for (; x < width; x += 2) {
+        signed u = (signed)row.mU[(x / 2) * row.mUVStep] - 128;
+        signed v = (signed)row.mV[(x / 2) * row.mUVStep] - 128;
+
+        signed r_v = v * c.cRV;
+        signed g_uv = u * c.cGU + v * c.cGV;
+        signed b_u = u * c.cBU;
+
+        for (size_t i = x; i < x + 2 && i < width; ++i) {
+            signed tmp = ((signed)row.mY[i * row.mYStep] - c.yOffset) * c.cY;
+
+            uint8_t r = clip[(tmp + r_v) / 256];
+            uint8_t g = clip[(tmp + g_uv) / 256];
+            uint8_t b = clip[(tmp + b_u) / 256];
+
+            if (rgba) {
+                uint8_t *out = (uint8_t *)dst + i * 4;
+                out[0] = r;
+                out[1] = g;
+                out[2] = b;
+                out[3] = 0xff;
+            } else {
+                ((uint16_t *)dst)[i] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+            }
+        }
+    }
+}
+
+// The SIMD row kernels below convert the leading multiple of 8 pixels of a
+// row and return how many they did, the C loop above finishes the row.
+// Their output is identical to convertRowC's.
+
+#if defined(USE_NEON)
+
+static inline void convertPixels8(
+        const YUVCoeffs &c, int16x8_t y, int16x8_t u, int16x8_t v,
+        bool rgba, void *dst) {
+    y = vsubq_s16(y, vdupq_n_s16(c.yOffset));
+    u = vsubq_s16(u, vdupq_n_s16(128));
+    v = vsubq_s16(v, vdupq_n_s16(128));
+
+    int32x4_t yLo = vmull_n_s16(vget_low_s16(y), c.cY);
+    int32x4_t yHi = vmull_n_s16(vget_high_s16(y), c.cY);
+
+    int32x4_t rLo = vmlal_n_s16(yLo, vget_low_s16(v), c.cRV);
+    int32x4_t rHi = vmlal_n_s16(yHi, vget_high_s16(v), c.cRV);
+
+    int32x4_t gLo = vmlal_n_s16(
+            vmlal_n_s16(yLo, vget_low_s16(u), c.cGU), vget_low_s16(v), c.cGV);
+    int32x4_t gHi = vmlal_n_s16(
+            vmlal_n_s16(yHi, vget_high_s16(u), c.cGU), vget_high_s16(v), c.cGV);
+
+    int32x4_t bLo = vmlal_n_s16(yLo, vget_low_s16(u), c.cBU);
+    int32x4_t bHi = vmlal_n_s16(yHi, vget_high_s16(u), c.cBU);
+
+    // Saturating to 0..255 does what the clip table does in convertRowC.
+    uint8x8_t r = vqmovun_s16(vcombine_s16(vshrn_n_s32(rLo, 8), vshrn_n_s32(rHi, 8)));
+    uint8x8_t g = vqmovun_s16(vcombine_s16(vshrn_n_s32(gLo, 8), vshrn_n_s32(gHi, 8)));
+    uint8x8_t b = vqmovun_s16(vcombine_s16(vshrn_n_s32(bLo, 8), vshrn_n_s32(bHi, 8)));
+
+    if (rgba) {
+        uint8x8x4_t pixels;
+        pixels.val[0] = r;
+        pixels.val[1] = g;
+        pixels.val[2] = b;
+        pixels.val[3] = vdup_n_u8(0xff);
+        vst4_u8((uint8_t *)dst, pixels);
+    } else {
+        uint16x8_t pixels = vshll_n_u8(r, 8);
+        pixels = vsriq_n_u16(pixels, vshll_n_u8(g, 8), 5);
+        pixels = vsriq_n_u16(pixels, vshll_n_u8(b, 8), 11);
+        vst1q_u16((uint16_t *)dst, pixels);
+    }
+}
+
+static inline int16x8_t widen(uint8x8_t x) {
+    return vreinterpretq_s16_u16(vmovl_u8(x));
+}
+
+static size_t convertRowSIMD(
+        const YUVCoeffs &c, const SrcRow &row,
+        size_t width, bool rgba, void *dst) {
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8_t y, u, v;
+        if (row.mYStep == 2) {
+            // Cb Y0 Cr Y1: the even bytes are the chroma pairs.
+            uint8x8x2_t pixels = vld2_u8(row.mU + x * 2);
+            uint8x8x2_t uv = vtrn_u8(pixels.val[0], pixels.val[0]);
+            y = pixels.val[1];
+            u = uv.val[0];
+            v = uv.val[1];
+        } else if (row.mUVStep == 1) {
+            uint32_t u4, v4;
+            memcpy(&u4, row.mU + x / 2, sizeof(u4));
+            memcpy(&v4, row.mV + x / 2, sizeof(v4));
+            uint8x8_t u8 = vreinterpret_u8_u32(vdup_n_u32(u4));
+            uint8x8_t v8 = vreinterpret_u8_u32(vdup_n_u32(v4));
+            y = vld1_u8(row.mY + x);
+            u = vzip_u8(u8, u8).val[0];
+            v = vzip_u8(v8, v8).val[0];
+        } else {
+            const uint8_t *first = row.mU < row.mV ? row.mU : row.mV;
+            uint8x8_t chroma = vld1_u8(first + x);
+            uint8x8x2_t uv = vtrn_u8(chroma, chroma);
+            y = vld1_u8(row.mY + x);
+            u = row.mU < row.mV ? uv.val[0] : uv.val[1];
+            v = row.mU < row.mV ? uv.val[1] : uv.val[0];
+        }
+
+        convertPixels8(
+                c, widen(y), widen(u), widen(v), rgba,
+                (uint8_t *)dst + x * (rgba ? 4 : 2));
+    }
+
+    return x;
+}
+
+#elif defined(USE_SSE2)
+
+// Packs |lo| into the low and |hi| into the high 16 bits of each 32 bit
+// lane, the layout _mm_madd_epi16 multiplies an interleaved pair by.
+static inline __m128i coeffPair(int16_t lo, int16_t hi) {
+    return _mm_set1_epi32((uint16_t)lo | ((uint32_t)(uint16_t)hi << 16));
+}
+
+static inline __m128i madd8(__m128i a, __m128i b, __m128i coeffs) {
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), coeffs);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), coeffs);
+    return _mm_packs_epi32(_mm_srai_epi32(lo, 8), _mm_srai_epi32(hi, 8));
+}
+
+static inline void convertPixels8(
+        const YUVCoeffs &c, __m128i y, __m128i u, __m128i v,
+        bool rgba, void *dst) {
+    const __m128i zero = _mm_setzero_si128();
+
+    y = _mm_sub_epi16(y, _mm_set1_epi16(c.yOffset));
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+    __m128i r = madd8(y, v, coeffPair(c.cY, c.cRV));
+    __m128i b = madd8(y, u, coeffPair(c.cY, c.cBU));
+
+    // G has three terms, so it takes a second multiply-add.
+    __m128i yuLo = _mm_madd_epi16(_mm_unpacklo_epi16(y, u), coeffPair(c.cY, c.cGU));
+    __m128i yuHi = _mm_madd_epi16(_mm_unpackhi_epi16(y, u), coeffPair(c.cY, c.cGU));
+    __m128i vLo = _mm_madd_epi16(_mm_unpacklo_epi16(v, zero), coeffPair(c.cGV, 0));
+    __m128i vHi = _mm_madd_epi16(_mm_unpackhi_epi16(v, zero), coeffPair(c.cGV, 0));
+    __m128i g = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(yuLo, vLo), 8),
+            _mm_srai_epi32(_mm_add_epi32(yuHi, vHi), 8));
+
+    // Saturating to 0..255 does what the clip table does in convertRowC.
+    __m128i rb = _mm_packus_epi16(r, b);
+    __m128i ga = _mm_packus_epi16(g, _mm_set1_epi16(0xff));
+
+    if (rgba) {
+        __m128i rg = _mm_unpacklo_epi8(rb, ga);
+        __m128i ba = _mm_unpackhi_epi8(rb, ga);
+        _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi16(rg, ba));
+    } else {
+        __m128i r16 = _mm_unpacklo_epi8(rb, zero);
+        __m128i g16 = _mm_unpacklo_epi8(ga, zero);
+        __m128i b16 = _mm_unpackhi_epi8(rb, zero);
+        __m128i pixels = _mm_or_si128(
+                _mm_slli_epi16(_mm_and_si128(r16, _mm_set1_epi16(0xf8)), 8),
+                _mm_or_si128(
+                    _mm_slli_epi16(_mm_and_si128(g16, _mm_set1_epi16(0xfc)), 3),
+                    _mm_srli_epi16(b16, 3)));
+        _mm_storeu_si128((__m128i *)dst, pixels);
+    }
+}
+
+// Splits 16 bit lanes c0 c1 c2 c3 ... into c0 c0 c2 c2 ... and c1 c1 c3 c3 ...
+static inline void splitChroma(__m128i c, __m128i *first, __m128i *second) {
+    const __m128i kLow = _mm_set1_epi32(0x0000ffff);
+    *first = _mm_or_si128(_mm_and_si128(c, kLow), _mm_slli_epi32(c, 16));
+    *second = _mm_or_si128(_mm_srli_epi32(c, 16), _mm_andnot_si128(kLow, c));
+}
+
+// Loads 4 chroma samples, each one repeated for the two pixels sharing it.
+static inline __m128i loadChroma4(const uint8_t *ptr) {
+    int32_t samples;
+    memcpy(&samples, ptr, sizeof(samples));
+    __m128i c = _mm_cvtsi32_si128(samples);
+    c = _mm_unpacklo_epi8(c, c);
+    return _mm_unpacklo_epi8(c, _mm_setzero_si128());
+}
+
+static size_t convertRowSIMD(
+        const YUVCoeffs &c, const SrcRow &row,
+        size_t width, bool rgba, void *dst) {
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i y, u, v;
+        if (row.mYStep == 2) {
+            // Cb Y0 Cr Y1: the luma is in the high byte of each 16 bit lane.
+            __m128i pixels = _mm_loadu_si128((const __m128i *)(row.mU + x * 2));
+            y = _mm_srli_epi16(pixels, 8);
+            splitChroma(_mm_and_si128(pixels, _mm_set1_epi16(0xff)), &u, &v);
+        } else if (row.mUVStep == 1) {
+            y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row.mY + x)), zero);
+            u = loadChroma4(row.mU + x / 2);
+            v = loadChroma4(row.mV + x / 2);
+        } else {
+            y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row.mY + x)), zero);
+            if (row.mU < row.mV) {
+                splitChroma(_mm_unpacklo_epi8(
+                        _mm_loadl_epi64((const __m128i *)(row.mU + x)), zero), &u, &v);
+            } else {
+                splitChroma(_mm_unpacklo_epi8(
+                        _mm_loadl_epi64((const __m128i *)(row.mV + x)), zero), &v, &u);
+            }
+        }
+
+        convertPixels8(c, y, u, v, rgba, (uint8_t *)dst + x * (rgba ? 4 : 2));
+    }
+
+    return x;
+}
+
+#else
+
+static size_t convertRowSIMD(
+        const YUVCoeffs & /* c */, const SrcRow & /* row */,
+        size_t /* width */, bool /* rgba */, void * /* dst */) {
+    return 0;
+}
+
+#endif
+
+struct ColorConverter::Band {
+    ColorConverter *mConverter;
+    const BitmapParams *mSrc, *mDst;
+    size_t mRowStart, mRowEnd;
+    pthread_t mThread;
+    bool mThreadStarted;
+};
+
 ColorConverter::ColorConverter(
         OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to)
     : mSrcFormat(from),
       mDstFormat(to),
+      mColorMatrix(kColorMatrixBT601),
+      mFullRange(false),
+      mNumThreads(1),
       mClip(NULL) {
 }
 
@@ -37,7 +336,8 @@ ColorConverter::~ColorConverter() {
 }
 
 bool ColorConverter::isValid() const {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+    if (mDstFormat != OMX_COLOR_Format16bitRGB565
+            && mDstFormat != kColorFormatRGBA8888) {
         return false;
     }
 
@@ -54,6 +354,21 @@ bool ColorConverter::isValid() const {
     }
 }
 
+void ColorConverter::setColorMatrix(ColorMatrix matrix, bool fullRange) {
+    mColorMatrix = matrix;
+    mFullRange = fullRange;
+}
+
+void ColorConverter::setNumThreads(size_t numThreads) {
+    if (numThreads < 1) {
+        numThreads = 1;
+    } else if (numThreads > kMaxThreads) {
+        numThreads = kMaxThreads;
+    }
+
+    mNumThreads = numThreads;
+}
+
 ColorConverter::BitmapParams::BitmapParams(
         void *bits,
         size_t width, size_t height,
@@ -85,7 +400,7 @@ status_t ColorConverter::convert(
         size_t dstWidth, size_t dstHeight,
         size_t dstCropLeft, size_t dstCropTop,
         size_t dstCropRight, size_t dstCropBottom) {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+    if (!isValid()) {
         return ERROR_UNSUPPORTED;
     }
 
@@ -99,416 +414,158 @@ status_t ColorConverter::convert(
             dstWidth, dstHeight,
             dstCropLeft, dstCropTop, dstCropRight, dstCropBottom);
 
-    status_t err;
-
-    switch (mSrcFormat) {
-        case OMX_COLOR_FormatYUV420Planar:
-            err = convertYUV420Planar(src, dst);
-            break;
-
-        case OMX_COLOR_FormatCbYCrY:
-            err = convertCbYCrY(src, dst);
-            break;
-
-        case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
-            err = convertQCOMYUV420SemiPlanar(src, dst);
-            break;
-
-        case OMX_COLOR_FormatYUV420SemiPlanar:
-            err = convertYUV420SemiPlanar(src, dst);
-            break;
-
-        case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
-            err = convertTIYUV420PackedSemiPlanar(src, dst);
-            break;
-
-        default:
-        {
-            CHECK(!"Should not be here. Unknown color conversion.");
-            break;
-        }
-    }
-
-    return err;
-}
-
-status_t ColorConverter::convertCbYCrY(
-        const BitmapParams &src, const BitmapParams &dst) {
-    // XXX Untested
-
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-        && src.cropWidth() == dst.cropWidth()
-        && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_ptr = (const uint8_t *)src.mBits
-        + (src.mCropTop * dst.mWidth + src.mCropLeft) * 2;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_ptr[2 * x + 1] - 16;
-            signed y2 = (signed)src_ptr[2 * x + 3] - 16;
-            signed u = (signed)src_ptr[2 * x] - 128;
-            signed v = (signed)src_ptr[2 * x + 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_ptr += src.mWidth * 2;
-        dst_ptr += dst.mWidth;
-    }
-
-    return OK;
-}
-
-status_t ColorConverter::convertYUV420Planar(
-        const BitmapParams &src, const BitmapParams &dst) {
     if (!((src.mCropLeft & 1) == 0
             && src.cropWidth() == dst.cropWidth()
             && src.cropHeight() == dst.cropHeight())) {
         return ERROR_UNSUPPORTED;
     }
 
-    uint8_t *kAdjustedClip = initClip();
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * (src.mWidth / 2) + src.mCropLeft / 2;
-
-    const uint8_t *src_v =
-        src_u + (src.mWidth / 2) * (src.mHeight / 2);
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
-            // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
-            // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
+    // Built here so the bands below only ever read it.
+    initClip();
 
-            // B = 298/256 * (Y - 16) + 517/256 * (U - 128)
-            // G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
-            // R = .................. + 409/256 * (V - 128)
+    size_t height = src.cropHeight();
 
-            // min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
-            // min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
-            // min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
-
-            // max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
-            // max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
-            // max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
-
-            // clip range -278 .. 535
-
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x / 2] - 128;
-            signed v = (signed)src_v[x / 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth / 2;
-            src_v += src.mWidth / 2;
-        }
-
-        dst_ptr += dst.mWidth;
+    size_t numBands = src.cropWidth() * height / kMinPixelsPerBand;
+    if (numBands > mNumThreads) {
+        numBands = mNumThreads;
     }
 
-    return OK;
-}
-
-status_t ColorConverter::convertQCOMYUV420SemiPlanar(
-        const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
+    if (numBands <= 1) {
+        convertRows(src, dst, 0, height);
+        return OK;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
+    Band bands[kMaxThreads];
+    for (size_t i = 1; i < numBands; ++i) {
+        Band *band = &bands[i];
+        band->mConverter = this;
+        band->mSrc = &src;
+        band->mDst = &dst;
+        band->mRowStart = height * i / numBands;
+        band->mRowEnd = height * (i + 1) / numBands;
+        band->mThreadStarted =
+            pthread_create(&band->mThread, NULL, ThreadWrapper, band) == 0;
+
+        if (!band->mThreadStarted) {
+            ALOGW("Unable to start conversion thread, converting inline.");
+            convertRows(src, dst, band->mRowStart, band->mRowEnd);
         }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
     }
 
-    return OK;
-}
-
-status_t ColorConverter::convertYUV420SemiPlanar(
-        const BitmapParams &src, const BitmapParams &dst) {
-    // XXX Untested
+    convertRows(src, dst, 0, height / numBands);
 
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed v = (signed)src_u[x & ~1] - 128;
-            signed u = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
+    for (size_t i = 1; i < numBands; ++i) {
+        if (bands[i].mThreadStarted) {
+            pthread_join(bands[i].mThread, NULL);
         }
-
-        dst_ptr += dst.mWidth;
     }
 
     return OK;
 }
 
-status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
-        const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y = (const uint8_t *)src.mBits;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+// static
+void *ColorConverter::ThreadWrapper(void *me) {
+    Band *band = static_cast<Band *>(me);
 
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
+    band->mConverter->convertRows(
+            *band->mSrc, *band->mDst, band->mRowStart, band->mRowEnd);
 
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    return NULL;
+}
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
+void ColorConverter::convertRows(
+        const BitmapParams &src, const BitmapParams &dst,
+        size_t rowStart, size_t rowEnd) {
+    const YUVCoeffs &c = kYUVCoeffs[mColorMatrix][mFullRange ? 1 : 0];
+    const uint8_t *kAdjustedClip = initClip();
+
+    bool rgba = mDstFormat == kColorFormatRGBA8888;
+    size_t bytesPerPixel = rgba ? 4 : 2;
+    size_t width = src.cropWidth();
+
+    const uint8_t *bits = (const uint8_t *)src.mBits;
+
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+        size_t srcRow = src.mCropTop + y;
+        size_t chromaRow = srcRow / 2;
+
+        SrcRow row;
+
+        switch (mSrcFormat) {
+            case OMX_COLOR_FormatYUV420Planar:
+            {
+                row.mY = bits + srcRow * src.mWidth + src.mCropLeft;
+                row.mU = bits + src.mWidth * src.mHeight
+                    + chromaRow * (src.mWidth / 2) + src.mCropLeft / 2;
+                row.mV = row.mU + (src.mWidth / 2) * (src.mHeight / 2);
+                row.mYStep = 1;
+                row.mUVStep = 1;
+                break;
+            }
 
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
+            case OMX_COLOR_FormatCbYCrY:
+            {
+                // XXX Untested
+                const uint8_t *pixels =
+                    bits + (srcRow * src.mWidth + src.mCropLeft) * 2;
+                row.mY = pixels + 1;
+                row.mU = pixels;
+                row.mV = pixels + 2;
+                row.mYStep = 2;
+                row.mUVStep = 4;
+                break;
+            }
 
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
+            case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
+            case OMX_COLOR_FormatYUV420SemiPlanar:
+            {
+                const uint8_t *chroma = bits + src.mWidth * src.mHeight
+                    + chromaRow * src.mWidth + src.mCropLeft;
+                row.mY = bits + srcRow * src.mWidth + src.mCropLeft;
+                if (mSrcFormat == OMX_QCOM_COLOR_FormatYVU420SemiPlanar) {
+                    row.mU = chroma + 1;
+                    row.mV = chroma;
+                } else {
+                    row.mU = chroma;
+                    row.mV = chroma + 1;
+                }
+                row.mYStep = 1;
+                row.mUVStep = 2;
+                break;
+            }
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
+            case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
+            {
+                row.mY = bits + y * src.mWidth;
+                row.mU = bits + src.mWidth * (src.mHeight - src.mCropTop / 2)
+                    + (y / 2) * src.mWidth;
+                row.mV = row.mU + 1;
+                row.mYStep = 1;
+                row.mUVStep = 2;
+                break;
+            }
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
+            default:
+            {
+                CHECK(!"Should not be here. Unknown color conversion.");
+                return;
             }
         }
 
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
+        void *dstRow = (uint8_t *)dst.mBits
+            + ((dst.mCropTop + y) * dst.mWidth + dst.mCropLeft) * bytesPerPixel;
 
-        dst_ptr += dst.mWidth;
+        size_t x = convertRowSIMD(c, row, width, rgba, dstRow);
+        convertRowC(c, kAdjustedClip, row, x, width, rgba, dstRow);
     }
-
-    return OK;
 }
 
 uint8_t *ColorConverter::initClip() {
-    static const signed kClipMin = -278;
-    static const signed kClipMax = 535;
+    // Covers the results of every matrix in kYUVCoeffs, e.g.
+    // min_B = (298 * (- 16) + 541 * (- 128)) / 256 = -289 for BT.709 and
+    // max_B = (298 * (255 - 16) + 541 * (255 - 128)) / 256 = 546.
+    static const signed kClipMin = -289;
+    static const signed kClipMax = 546;
 
     if (mClip == NULL) {
         mClip = new uint8_t[kClipMax - kClipMin + 1];
@@ -19,6 +19,8 @@
 
 #include "../include/SoftwareRenderer.h"
 
+#include <unistd.h>
+
 #include <cutils/properties.h> // for property_get
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
@@ -124,6 +126,7 @@ void SoftwareRenderer::resetFormatIfChanged(const sp<AMessage> &format) {
             mConverter = new ColorConverter(
                     mColorFormat, OMX_COLOR_Format16bitRGB565);
             CHECK(mConverter->isValid());
+            mConverter->setNumThreads(sysconf(_SC_NPROCESSORS_ONLN));
             break;
     }
 
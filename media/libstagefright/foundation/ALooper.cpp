@@ -67,15 +67,26 @@ int64_t ALooper::GetNowUs() {
 }
 
 ALooper::ALooper()
-    : mRunningLocally(false) {
+    : mNumEvents(0),
+      mNextEventSeq(0),
+      mRunningLocally(false) {
     // clean up stale AHandlers. Doing it here instead of in the destructor avoids
     // the side effect of objects being deleted from the unregister function recursively.
     gLooperRoster.unregisterStaleHandlers();
+
+    // Avoid growing the heap storage for the first few posts.
+    mEventQueue.setCapacity(16);
 }
 
 ALooper::~ALooper() {
     stop();
     // stale AHandlers are now cleaned up in the constructor of the next ALooper to come along
+
+    for (size_t i = 0; i < mNumEvents; ++i) {
+        mEventQueue[i].mMessage->decStrong(this);
+    }
+    mNumEvents = 0;
+    mEventQueue.clear();
 }
 
 void ALooper::setName(const char *name) {
@@ -158,6 +169,60 @@ status_t ALooper::stop() {
     return OK;
 }
 
+// static
+bool ALooper::EventBefore(const Event &a, const Event &b) {
+    if (a.mWhenUs != b.mWhenUs) {
+        return a.mWhenUs < b.mWhenUs;
+    }
+    return a.mSeq < b.mSeq;
+}
+
+void ALooper::pushEvent_l(const Event &event) {
+    size_t i = mNumEvents++;
+    if (i == mEventQueue.size()) {
+        mEventQueue.push();
+    }
+
+    // Sift up. Zero-delay posts usually carry the latest timestamp in the
+    // queue and stay at the bottom without any swaps.
+    Event *heap = mEventQueue.editArray();
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!EventBefore(event, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = event;
+}
+
+void ALooper::popEvent_l(Event *event) {
+    Event *heap = mEventQueue.editArray();
+    *event = heap[0];
+
+    const size_t n = --mNumEvents;
+    const Event last = heap[n];
+
+    // Sift down the former last element from the root.
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && EventBefore(heap[child + 1], heap[child])) {
+            ++child;
+        }
+        if (!EventBefore(heap[child], last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
 void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
     Mutex::Autolock autoLock(mLock);
 
@@ -168,35 +233,33 @@ void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
         whenUs = GetNowUs();
     }
 
-    List<Event>::iterator it = mEventQueue.begin();
-    while (it != mEventQueue.end() && (*it).mWhenUs <= whenUs) {
-        ++it;
-    }
-
     Event event;
     event.mWhenUs = whenUs;
-    event.mMessage = msg;
+    event.mSeq = mNextEventSeq++;
+    event.mMessage = msg.get();
+    event.mMessage->incStrong(this);
 
-    if (it == mEventQueue.begin()) {
+    pushEvent_l(event);
+
+    if (mEventQueue[0].mSeq == event.mSeq) {
         mQueueChangedCondition.signal();
     }
-
-    mEventQueue.insert(it, event);
 }
 
 bool ALooper::loop() {
     Event event;
+    sp<AMessage> msg;
 
     {
         Mutex::Autolock autoLock(mLock);
         if (mThread == NULL && !mRunningLocally) {
             return false;
         }
-        if (mEventQueue.empty()) {
+        if (mNumEvents == 0) {
             mQueueChangedCondition.wait(mLock);
             return true;
         }
-        int64_t whenUs = (*mEventQueue.begin()).mWhenUs;
+        int64_t whenUs = mEventQueue[0].mWhenUs;
         int64_t nowUs = GetNowUs();
 
         if (whenUs > nowUs) {
@@ -206,11 +269,13 @@ bool ALooper::loop() {
             return true;
         }
 
-        event = *mEventQueue.begin();
-        mEventQueue.erase(mEventQueue.begin());
+        popEvent_l(&event);
+
+        msg = event.mMessage;
+        event.mMessage->decStrong(this);
     }
 
-    gLooperRoster.deliverMessage(event.mMessage);
+    gLooperRoster.deliverMessage(msg);
 
     // NOTE: It's important to note that at this point our "ALooper" object
     // may no longer exist (its final reference may have gone away while
@@ -33,7 +33,7 @@ ALooperRoster::ALooperRoster()
 
 ALooper::handler_id ALooperRoster::registerHandler(
         const sp<ALooper> looper, const sp<AHandler> &handler) {
-    Mutex::Autolock autoLock(mLock);
+    RWLock::AutoWLock autoLock(mHandlersLock);
 
     if (handler->id() != 0) {
         CHECK(!"A handler must only be registered once.");
@@ -52,7 +52,7 @@ ALooper::handler_id ALooperRoster::registerHandler(
 }
 
 void ALooperRoster::unregisterHandler(ALooper::handler_id handlerID) {
-    Mutex::Autolock autoLock(mLock);
+    RWLock::AutoWLock autoLock(mHandlersLock);
 
     ssize_t index = mHandlers.indexOfKey(handlerID);
 
@@ -75,7 +75,7 @@ void ALooperRoster::unregisterStaleHandlers() {
 
     Vector<sp<ALooper> > activeLoopers;
     {
-        Mutex::Autolock autoLock(mLock);
+        RWLock::AutoWLock autoLock(mHandlersLock);
 
         for (size_t i = mHandlers.size(); i-- > 0;) {
             const HandlerInfo &info = mHandlers.valueAt(i);
@@ -113,7 +113,7 @@ void ALooperRoster::deliverMessage(const sp<AMessage> &msg) {
     sp<AHandler> handler;
 
     {
-        Mutex::Autolock autoLock(mLock);
+        RWLock::AutoRLock autoLock(mHandlersLock);
 
         ssize_t index = mHandlers.indexOfKey(msg->target());
 
@@ -124,39 +124,68 @@ void ALooperRoster::deliverMessage(const sp<AMessage> &msg) {
 
         const HandlerInfo &info = mHandlers.valueAt(index);
         handler = info.mHandler.promote();
+    }
 
-        if (handler == NULL) {
-            ALOGW("failed to deliver message. "
-                 "Target handler %d registered, but object gone.",
-                 msg->target());
+    if (handler == NULL) {
+        ALOGW("failed to deliver message. "
+             "Target handler %d registered, but object gone.",
+             msg->target());
 
-            mHandlers.removeItemsAt(index);
-            return;
-        }
+        removeStaleHandler(msg->target());
+        return;
     }
 
     handler->onMessageReceived(msg);
 }
 
 sp<ALooper> ALooperRoster::findLooper(ALooper::handler_id handlerID) {
-    Mutex::Autolock autoLock(mLock);
+    sp<ALooper> looper;
 
-    ssize_t index = mHandlers.indexOfKey(handlerID);
+    {
+        RWLock::AutoRLock autoLock(mHandlersLock);
 
-    if (index < 0) {
-        return NULL;
-    }
+        ssize_t index = mHandlers.indexOfKey(handlerID);
 
-    sp<ALooper> looper = mHandlers.valueAt(index).mLooper.promote();
+        if (index < 0) {
+            return NULL;
+        }
+
+        looper = mHandlers.valueAt(index).mLooper.promote();
+    }
 
     if (looper == NULL) {
-        mHandlers.removeItemsAt(index);
+        removeStaleHandler(handlerID);
         return NULL;
     }
 
     return looper;
 }
 
+void ALooperRoster::removeStaleHandler(ALooper::handler_id handlerID) {
+    // Declared outside the lock so that a promoted object going away
+    // doesn't run its destructor while mHandlersLock is held.
+    sp<ALooper> looper;
+    sp<AHandler> handler;
+
+    RWLock::AutoWLock autoLock(mHandlersLock);
+
+    ssize_t index = mHandlers.indexOfKey(handlerID);
+
+    if (index < 0) {
+        return;
+    }
+
+    // Another thread may have already removed the entry since the read
+    // lock was dropped, only remove it if it is still stale.
+    const HandlerInfo &info = mHandlers.valueAt(index);
+    looper = info.mLooper.promote();
+    handler = info.mHandler.promote();
+
+    if (looper == NULL || handler == NULL) {
+        mHandlers.removeItemsAt(index);
+    }
+}
+
 status_t ALooperRoster::postAndAwaitResponse(
         const sp<AMessage> &msg, sp<AMessage> *response) {
     sp<ALooper> looper = findLooper(msg->target());
@@ -65,8 +65,7 @@ ALooper::handler_id AMessage::target() const {
 void AMessage::clear() {
     for (size_t i = 0; i < mNumItems; ++i) {
         Item *item = &mItems[i];
-        delete[] item->mName;
-        item->mName = NULL;
+        item->freeName();
         freeItemValue(item);
     }
     mNumItems = 0;
@@ -157,10 +156,18 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
 // assumes item's name was uninitialized or NULL
 void AMessage::Item::setName(const char *name, size_t len) {
     mNameLength = len;
-    mName = new char[len + 1];
+    // short names, i.e. almost all of them, are stored in the item itself
+    mName = len <= kMaxInlineNameLength ? mNameInline : new char[len + 1];
     memcpy((void*)mName, name, len + 1);
 }
 
+void AMessage::Item::freeName() {
+    if (mName != mNameInline) {
+        delete[] mName;
+    }
+    mName = NULL;
+}
+
 AMessage::Item *AMessage::allocateItem(const char *name) {
     size_t len = strlen(name);
     size_t i = findItemIndex(name, len);
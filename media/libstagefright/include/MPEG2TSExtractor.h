@@ -25,6 +25,7 @@
 
 namespace android {
 
+struct ABuffer;
 struct AMessage;
 struct AnotherPacketSource;
 struct ATSParser;
@@ -54,10 +55,19 @@ private:
 
     Vector<sp<AnotherPacketSource> > mSourceImpls;
 
+    // Data source offset of the next packet to be fed to the parser.
     off64_t mOffset;
 
+    // Read-ahead block; its range covers the bytes starting at mOffset
+    // that have been read but not yet consumed.  It is either mReadBuffer
+    // or, with a caching data source, a buffer referencing the cache.
+    sp<ABuffer> mBlock;
+    sp<ABuffer> mReadBuffer;
+
     void init();
     status_t feedMore();
+    status_t fillBlock_l();
+    status_t nextPacket_l(const uint8_t **packet);
 
     DISALLOW_EVIL_CONSTRUCTORS(MPEG2TSExtractor);
 };
@@ -21,9 +21,12 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandlerReflector.h>
 #include <media/stagefright/DataSource.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
 
 namespace android {
 
+struct ABuffer;
 struct ALooper;
 struct PageCache;
 
@@ -53,6 +56,15 @@ struct NuCachedSource2 : public DataSource {
     size_t cachedSize();
     size_t approxDataRemaining(status_t *finalStatus) const;
 
+    // Like readAt(), but if offset is already cached the returned buffer
+    // references the cache page holding it instead of holding a copy. It
+    // then ends at the end of that page or of the cached data, so it may be
+    // shorter than size even before the end of the stream. Otherwise the
+    // data is read into a new buffer.
+    ssize_t readAtShared(off64_t offset, size_t size, sp<ABuffer> *buffer);
+
+    status_t dump(int fd, const Vector<String16>& args) const;
+
     void resumeFetchingIfNecessary();
 
     // The following methods are supported only if the
@@ -123,6 +135,13 @@ private:
 
     bool mDisconnectAtHighwatermark;
 
+    int64_t mNumCacheHits;
+    int64_t mNumCacheMisses;
+    int64_t mTotalReadLatencyUs;
+    int64_t mMaxReadLatencyUs;
+
+    void updateReadLatency_l(int64_t startTimeUs);
+
     void onMessageReceived(const sp<AMessage> &msg);
     void onFetch();
     void onRead(const sp<AMessage> &msg);
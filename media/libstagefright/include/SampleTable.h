@@ -119,6 +119,18 @@ private:
     };
     SampleTimeEntry *mSampleTimeEntries;
 
+    // Without reordered frames, sample times increase with the sample
+    // index and seeking only needs the first sample and start time of each
+    // time-to-sample run instead of a sorted per-sample table.
+    struct TimeToSampleRun {
+        uint32_t mFirstSample;
+        uint32_t mNumSamples;
+        uint32_t mFirstTime;
+        uint32_t mDelta;
+    };
+    TimeToSampleRun *mTimeToSampleRuns;
+    uint32_t mNumTimeToSampleRuns;
+
     uint32_t *mCompositionTimeDeltaEntries;
     size_t mNumCompositionTimeDeltaEntries;
     CompositionDeltaLookup *mCompositionDeltaLookup;
@@ -142,16 +154,23 @@ private:
     // normally we don't round
     inline uint64_t getSampleTime(
             size_t sample_index, uint64_t scale_num, uint64_t scale_den) const {
-        return (mSampleTimeEntries[sample_index].mCompositionTime
-            * scale_num) / scale_den;
+        return ((uint64_t)getMediaTimeAt(sample_index) * scale_num) / scale_den;
     }
 
+    // Accessors over the seek index, which is ordered by increasing
+    // composition time. "pos" is a position in that order.
+    uint32_t getMediaTimeAt(uint32_t pos) const;
+    uint32_t getSampleIndexAt(uint32_t pos) const;
+    uint32_t findFirstAtOrAfter(uint64_t mediaTime) const;
+    uint32_t findTimeToSampleRun(uint32_t pos) const;
+
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
     uint32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
     static int CompareIncreasingTime(const void *, const void *);
 
     void buildSampleEntriesTable();
+    bool buildTimeToSampleRuns_l();
 
     SampleTable(const SampleTable &);
     SampleTable &operator=(const SampleTable &);
@@ -95,6 +95,9 @@ protected:
 
     virtual OMX_ERRORTYPE getState(OMX_STATETYPE *state);
 
+    // Number of online CPU cores, the default thread count of multi-threaded codecs.
+    static int GetCPUCoreCount();
+
 private:
     AString mName;
     const OMX_CALLBACKTYPE *mCallbacks;
@@ -44,7 +44,12 @@ struct StagefrightMetadataRetriever : public MediaMetadataRetrieverInterface {
     virtual const char *extractMetadata(int keyCode);
 
 private:
+    enum {
+        kCacheSize = 256 * 1024,
+    };
+
     OMXClient mClient;
+    bool mClientConnected;
     sp<DataSource> mSource;
     sp<MediaExtractor> mExtractor;
 
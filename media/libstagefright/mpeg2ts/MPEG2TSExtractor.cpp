@@ -21,6 +21,7 @@
 #include "include/MPEG2TSExtractor.h"
 #include "include/NuCachedSource2.h"
 
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaDefs.h>
@@ -35,6 +36,11 @@
 namespace android {
 
 static const size_t kTSPacketSize = 188;
+static const uint8_t kTSSyncByte = 0x47;
+
+// Packets are read from the data source in blocks of this many packets
+// (~64 KB) instead of one readAt() per packet.
+static const size_t kNumPacketsPerBlock = 348;
 
 struct MPEG2TSSource : public MediaSource {
     MPEG2TSSource(
@@ -116,7 +122,10 @@ status_t MPEG2TSSource::read(
 MPEG2TSExtractor::MPEG2TSExtractor(const sp<DataSource> &source)
     : mDataSource(source),
       mParser(new ATSParser),
-      mOffset(0) {
+      mOffset(0),
+      mReadBuffer(new ABuffer(kTSPacketSize * kNumPacketsPerBlock)) {
+    mReadBuffer->setRange(0, 0);
+    mBlock = mReadBuffer;
     init();
 }
 
@@ -200,20 +209,109 @@ void MPEG2TSExtractor::init() {
 status_t MPEG2TSExtractor::feedMore() {
     Mutex::Autolock autoLock(mLock);
 
-    uint8_t packet[kTSPacketSize];
-    ssize_t n = mDataSource->readAt(mOffset, packet, kTSPacketSize);
+    const uint8_t *packet;
+    status_t err = nextPacket_l(&packet);
 
-    if (n < (ssize_t)kTSPacketSize) {
-        if (n >= 0) {
+    if (err != OK) {
+        if (err == ERROR_END_OF_STREAM) {
             mParser->signalEOS(ERROR_END_OF_STREAM);
         }
-        return (n < 0) ? (status_t)n : ERROR_END_OF_STREAM;
+        return err;
     }
 
-    mOffset += n;
     return mParser->feedTSPacket(packet, kTSPacketSize);
 }
 
+status_t MPEG2TSExtractor::fillBlock_l() {
+    size_t remaining = mBlock->size();
+    size_t size = mReadBuffer->capacity() - remaining;
+    bool caching = mDataSource->flags() & DataSource::kIsCachingDataSource;
+
+    if (caching) {
+        // Parse straight out of the cache pages.  Only a packet that
+        // straddles two pages is copied, so complete just that one.
+        if (remaining == 0) {
+            sp<ABuffer> block;
+            ssize_t n = static_cast<NuCachedSource2 *>(mDataSource.get())
+                    ->readAtShared(mOffset, size, &block);
+
+            if (n < 0) {
+                return (status_t)n;
+            }
+
+            if (n == 0) {
+                return ERROR_END_OF_STREAM;
+            }
+
+            mBlock = block;
+            return OK;
+        }
+
+        size = kTSPacketSize - remaining;
+    }
+
+    // Move the unconsumed tail to the front of the read buffer and top it up
+    // from the data source position right after it.
+    memmove(mReadBuffer->base(), mBlock->data(), remaining);
+    mBlock = mReadBuffer;
+    mBlock->setRange(0, remaining);
+
+    ssize_t n = mDataSource->readAt(
+            mOffset + remaining, mBlock->base() + remaining, size);
+
+    if (n < 0) {
+        return (status_t)n;
+    }
+
+    if (n == 0) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    mBlock->setRange(0, remaining + n);
+    return OK;
+}
+
+status_t MPEG2TSExtractor::nextPacket_l(const uint8_t **packet) {
+    for (;;) {
+        if (mBlock->size() < kTSPacketSize) {
+            status_t err = fillBlock_l();
+            if (err != OK) {
+                return err;
+            }
+            continue;
+        }
+
+        const uint8_t *data = mBlock->data();
+        size_t size = mBlock->size();
+
+        if (data[0] == kTSSyncByte) {
+            *packet = data;
+            mBlock->setRange(mBlock->offset() + kTSPacketSize,
+                    size - kTSPacketSize);
+            mOffset += kTSPacketSize;
+            return OK;
+        }
+
+        // Lost sync, skip to the next sync byte that is followed by another
+        // one a packet later, if that one is already in the block.
+        size_t skip = 1;
+        while (skip < size) {
+            if (data[skip] == kTSSyncByte
+                    && (skip + kTSPacketSize >= size
+                        || data[skip + kTSPacketSize] == kTSSyncByte)) {
+                break;
+            }
+            ++skip;
+        }
+
+        ALOGW("lost sync at offset %lld, skipping %zu bytes",
+                (long long)mOffset, skip);
+
+        mBlock->setRange(mBlock->offset() + skip, size - skip);
+        mOffset += skip;
+    }
+}
+
 uint32_t MPEG2TSExtractor::flags() const {
     return CAN_PAUSE;
 }
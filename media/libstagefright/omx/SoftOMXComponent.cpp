@@ -22,6 +22,8 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 
+#include <unistd.h>
+
 namespace android {
 
 SoftOMXComponent::SoftOMXComponent(
@@ -323,4 +325,18 @@ OMX_ERRORTYPE SoftOMXComponent::getState(OMX_STATETYPE * /* state */) {
     return OMX_ErrorUndefined;
 }
 
+// static
+int SoftOMXComponent::GetCPUCoreCount() {
+    int cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK_GE(cpuCoreCount, 1);
+    ALOGV("Number of CPU cores: %d", cpuCoreCount);
+    return cpuCoreCount;
+}
+
 }  // namespace android
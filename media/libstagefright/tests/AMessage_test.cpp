@@ -0,0 +1,153 @@
+/*
+ * Copyright 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AMessage_test"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+
+namespace android {
+
+class AMessageTest : public ::testing::Test {
+};
+
+// Keys typical of ACodec/NuPlayer format messages.
+static const char *kKeys[] = {
+    "mime", "width", "height", "stride", "slice-height", "color-format",
+    "frame-rate", "bitrate", "channel-count", "sample-rate", "max-input-size",
+    "timeUs", "durationUs", "csd-0", "csd-1", "crop-left", "crop-top",
+    "crop-right", "crop-bottom", "encoder-delay", "encoder-padding",
+};
+static const size_t kNumKeys = sizeof(kKeys) / sizeof(kKeys[0]);
+
+static void fillMessage(const sp<AMessage> &msg) {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+        msg->setInt32(kKeys[i], (int32_t)i);
+    }
+}
+
+TEST_F(AMessageTest, TestSetFind) {
+    sp<AMessage> msg = new AMessage;
+    fillMessage(msg);
+    msg->setString("mime", "video/avc");
+
+    ASSERT_EQ(msg->countEntries(), kNumKeys);
+
+    int32_t value;
+    ASSERT_TRUE(msg->findInt32("width", &value));
+    ASSERT_EQ(value, 1);
+
+    // Lookups with a name that is not the same pointer as the stored key.
+    char key[32];
+    strcpy(key, "crop-bottom");
+    ASSERT_TRUE(msg->findInt32(key, &value));
+    ASSERT_EQ(value, 18);
+
+    strcpy(key, "crop-botto");
+    ASSERT_FALSE(msg->contains(key));
+
+    AString mime;
+    ASSERT_FALSE(msg->findInt32("mime", &value));
+    ASSERT_TRUE(msg->findString("mime", &mime));
+    ASSERT_EQ(mime, "video/avc");
+}
+
+TEST_F(AMessageTest, TestDupAndClear) {
+    sp<AMessage> msg = new AMessage;
+    fillMessage(msg);
+
+    sp<AMessage> copy = msg->dup();
+    msg->clear();
+    ASSERT_EQ(msg->countEntries(), 0u);
+
+    ASSERT_EQ(copy->countEntries(), kNumKeys);
+    for (size_t i = 0; i < kNumKeys; ++i) {
+        AMessage::Type type;
+        ASSERT_STREQ(copy->getEntryNameAt(i, &type), kKeys[i]);
+        ASSERT_EQ(type, AMessage::kTypeInt32);
+
+        int32_t value;
+        ASSERT_TRUE(copy->findInt32(kKeys[i], &value));
+        ASSERT_EQ(value, (int32_t)i);
+    }
+}
+
+// Names too long to be stored inline in the item are copied to the heap.
+TEST_F(AMessageTest, TestLongNames) {
+    static const char *kLongKey = "android._num-input-buffers";
+
+    sp<AMessage> msg = new AMessage;
+    fillMessage(msg);
+    msg->setInt32(kLongKey, 42);
+
+    sp<AMessage> copy = msg->dup();
+    msg->clear();
+
+    int32_t value;
+    ASSERT_TRUE(copy->findInt32(kLongKey, &value));
+    ASSERT_EQ(value, 42);
+    ASSERT_FALSE(copy->contains("android._num-input-buffer"));
+
+    AMessage::Type type;
+    ASSERT_STREQ(copy->getEntryNameAt(kNumKeys, &type), kLongKey);
+}
+
+// Reports set/find/dup throughput so changes to item storage can be compared
+// by running this test before and after, with --gtest_also_run_disabled_tests.
+TEST_F(AMessageTest, DISABLED_BenchmarkSetFindDup) {
+    static const size_t kIterations = 20000;
+
+    int64_t startUs = ALooper::GetNowUs();
+    for (size_t n = 0; n < kIterations; ++n) {
+        sp<AMessage> msg = new AMessage;
+        fillMessage(msg);
+    }
+    int64_t setUs = ALooper::GetNowUs() - startUs;
+
+    sp<AMessage> msg = new AMessage;
+    fillMessage(msg);
+
+    int32_t sum = 0;
+    startUs = ALooper::GetNowUs();
+    for (size_t n = 0; n < kIterations; ++n) {
+        for (size_t i = 0; i < kNumKeys; ++i) {
+            int32_t value;
+            if (msg->findInt32(kKeys[i], &value)) {
+                sum += value;
+            }
+        }
+    }
+    int64_t findUs = ALooper::GetNowUs() - startUs;
+    ASSERT_EQ(sum, (int32_t)(kIterations * kNumKeys * (kNumKeys - 1) / 2));
+
+    startUs = ALooper::GetNowUs();
+    for (size_t n = 0; n < kIterations; ++n) {
+        sp<AMessage> copy = msg->dup();
+    }
+    int64_t dupUs = ALooper::GetNowUs() - startUs;
+
+    const double ops = (double)kIterations * kNumKeys;
+    printf("AMessage set: %.1f ns/item, find: %.1f ns/item, dup: %.1f ns/item\n",
+            setUs * 1000.0 / ops, findUs * 1000.0 / ops, dupUs * 1000.0 / ops);
+}
+
+} // namespace android
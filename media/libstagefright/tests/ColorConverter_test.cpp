@@ -0,0 +1,232 @@
+/*
+ * Copyright 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ColorConverter_test"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/ColorConverter.h>
+
+namespace android {
+
+static const OMX_COLOR_FORMATTYPE kSrcFormats[] = {
+    OMX_COLOR_FormatYUV420Planar,
+    OMX_COLOR_FormatCbYCrY,
+    OMX_QCOM_COLOR_FormatYVU420SemiPlanar,
+    OMX_COLOR_FormatYUV420SemiPlanar,
+    OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+};
+static const size_t kNumSrcFormats = sizeof(kSrcFormats) / sizeof(kSrcFormats[0]);
+
+class ColorConverterTest : public ::testing::Test {
+protected:
+    // Fills a buffer large enough for any of kSrcFormats at this size.
+    static void fillSource(uint8_t *src, size_t width, size_t height) {
+        for (size_t i = 0; i < width * height * 2; ++i) {
+            src[i] = rand();
+        }
+    }
+
+    static status_t convert(
+            ColorConverter *converter, const uint8_t *src,
+            size_t width, size_t height, void *dst) {
+        return converter->convert(
+                src, width, height, 0, 0, width - 1, height - 1,
+                dst, width, height, 0, 0, width - 1, height - 1);
+    }
+
+    static int64_t nowUs() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec * 1000000ll + t.tv_nsec / 1000;
+    }
+};
+
+static uint8_t clamp(int x) {
+    return x < 0 ? 0 : x > 255 ? 255 : x;
+}
+
+TEST_F(ColorConverterTest, YUV420PlanarMatchesBT601) {
+    // A width that is not a multiple of 8 leaves a tail after the
+    // vectorized part of each row.
+    static const size_t kWidth = 70, kHeight = 8;
+    const size_t chromaWidth = kWidth / 2;
+
+    uint8_t src[kWidth * kHeight * 2];
+    uint8_t dst[kWidth * kHeight * 4];
+    fillSource(src, kWidth, kHeight);
+
+    ColorConverter converter(
+            OMX_COLOR_FormatYUV420Planar, ColorConverter::kColorFormatRGBA8888);
+    ASSERT_TRUE(converter.isValid());
+    ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, dst));
+
+    const uint8_t *srcU = src + kWidth * kHeight;
+    const uint8_t *srcV = srcU + chromaWidth * (kHeight / 2);
+
+    for (size_t y = 0; y < kHeight; ++y) {
+        for (size_t x = 0; x < kWidth; ++x) {
+            int luma = (src[y * kWidth + x] - 16) * 298;
+            int u = srcU[(y / 2) * chromaWidth + x / 2] - 128;
+            int v = srcV[(y / 2) * chromaWidth + x / 2] - 128;
+
+            const uint8_t *pixel = &dst[(y * kWidth + x) * 4];
+            ASSERT_EQ(clamp((luma + 409 * v) / 256), pixel[0]);
+            ASSERT_EQ(clamp((luma - 100 * u - 208 * v) / 256), pixel[1]);
+            ASSERT_EQ(clamp((luma + 517 * u) / 256), pixel[2]);
+            ASSERT_EQ(0xff, pixel[3]);
+        }
+    }
+}
+
+TEST_F(ColorConverterTest, RGB565MatchesRGBA8888) {
+    static const size_t kWidth = 38, kHeight = 10;
+
+    uint8_t src[kWidth * kHeight * 2];
+    uint8_t rgba[kWidth * kHeight * 4];
+    uint16_t rgb565[kWidth * kHeight];
+    fillSource(src, kWidth, kHeight);
+
+    for (size_t i = 0; i < kNumSrcFormats; ++i) {
+        ColorConverter toRGBA(kSrcFormats[i], ColorConverter::kColorFormatRGBA8888);
+        ColorConverter toRGB565(kSrcFormats[i], OMX_COLOR_Format16bitRGB565);
+        toRGBA.setColorMatrix(ColorConverter::kColorMatrixBT709, false);
+        toRGB565.setColorMatrix(ColorConverter::kColorMatrixBT709, false);
+
+        ASSERT_EQ(OK, convert(&toRGBA, src, kWidth, kHeight, rgba));
+        ASSERT_EQ(OK, convert(&toRGB565, src, kWidth, kHeight, rgb565));
+
+        for (size_t j = 0; j < kWidth * kHeight; ++j) {
+            const uint8_t *pixel = &rgba[j * 4];
+            ASSERT_EQ(((pixel[0] >> 3) << 11) | ((pixel[1] >> 2) << 5) | (pixel[2] >> 3),
+                      rgb565[j]) << "format " << kSrcFormats[i] << " pixel " << j;
+        }
+    }
+}
+
+TEST_F(ColorConverterTest, ColorMatrixAndRange) {
+    static const size_t kWidth = 16, kHeight = 2;
+
+    uint8_t src[kWidth * kHeight * 2];
+    uint8_t dst[kWidth * kHeight * 4];
+
+    // Left half at the nominal black level of video range, right half at
+    // the nominal white level, all neutral chroma.
+    memset(src, 128, sizeof(src));
+    for (size_t y = 0; y < kHeight; ++y) {
+        memset(&src[y * kWidth], 16, kWidth / 2);
+        memset(&src[y * kWidth + kWidth / 2], 235, kWidth / 2);
+    }
+
+    ColorConverter converter(
+            OMX_COLOR_FormatYUV420Planar, ColorConverter::kColorFormatRGBA8888);
+    ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, dst));
+    EXPECT_EQ(0, dst[0]);
+    EXPECT_EQ(254, dst[(kWidth - 1) * 4]);  // (219 * 298) / 256
+
+    converter.setColorMatrix(ColorConverter::kColorMatrixBT601, true);
+    ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, dst));
+    EXPECT_EQ(16, dst[0]);
+    EXPECT_EQ(235, dst[(kWidth - 1) * 4]);
+
+    // Saturated red chroma maps to a different red level for each matrix.
+    memset(&src[kWidth * kHeight + kWidth / 2], 255, kWidth / 2);
+
+    uint8_t red601, red709;
+    converter.setColorMatrix(ColorConverter::kColorMatrixBT601, false);
+    ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, dst));
+    red601 = dst[0];
+    converter.setColorMatrix(ColorConverter::kColorMatrixBT709, false);
+    ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, dst));
+    red709 = dst[0];
+
+    EXPECT_EQ(202, red601);  // (409 * 127) / 256
+    EXPECT_EQ(227, red709);  // (459 * 127) / 256
+}
+
+TEST_F(ColorConverterTest, BandsMatchSingleThread) {
+    static const size_t kWidth = 1280, kHeight = 722;
+
+    uint8_t *src = new uint8_t[kWidth * kHeight * 2];
+    uint8_t *single = new uint8_t[kWidth * kHeight * 4];
+    uint8_t *banded = new uint8_t[kWidth * kHeight * 4];
+    fillSource(src, kWidth, kHeight);
+
+    for (size_t i = 0; i < kNumSrcFormats; ++i) {
+        ColorConverter converter(kSrcFormats[i], ColorConverter::kColorFormatRGBA8888);
+
+        converter.setNumThreads(1);
+        ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, single));
+
+        converter.setNumThreads(4);
+        ASSERT_EQ(OK, convert(&converter, src, kWidth, kHeight, banded));
+
+        ASSERT_EQ(0, memcmp(single, banded, kWidth * kHeight * 4))
+            << "format " << kSrcFormats[i];
+    }
+
+    delete[] banded;
+    delete[] single;
+    delete[] src;
+}
+
+// Reports timings rather than checking anything, so it is disabled by default.
+// Run it with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark.
+TEST_F(ColorConverterTest, DISABLED_Benchmark) {
+    static const size_t kSizes[][2] = {
+        { 320, 240 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 },
+    };
+    static const int kIterations = 20;
+
+    size_t numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    uint8_t *src = new uint8_t[1920 * 1080 * 2];
+    uint8_t *dst = new uint8_t[1920 * 1080 * 4];
+    fillSource(src, 1920, 1080);
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+        size_t width = kSizes[i][0];
+        size_t height = kSizes[i][1];
+
+        for (size_t j = 0; j < kNumSrcFormats; ++j) {
+            ColorConverter converter(kSrcFormats[j], OMX_COLOR_Format16bitRGB565);
+
+            for (size_t threads = 1; threads <= numCpus; threads *= 2) {
+                converter.setNumThreads(threads);
+
+                int64_t startUs = nowUs();
+                for (int k = 0; k < kIterations; ++k) {
+                    ASSERT_EQ(OK, convert(&converter, src, width, height, dst));
+                }
+                int64_t elapsedUs = nowUs() - startUs;
+
+                printf("%4zux%-4zu format 0x%08x %zu thread(s): %.2f ms/frame\n",
+                       width, height, kSrcFormats[j], threads,
+                       elapsedUs / 1000.0 / kIterations);
+            }
+        }
+    }
+
+    delete[] dst;
+    delete[] src;
+}
+
+}  // namespace android
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FileSource_test"
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/FileSource.h>
+
+namespace android {
+
+static const size_t kBlockSize = 4096;
+static const size_t kCacheSize = 16 * kBlockSize;
+
+class FileSourceTest : public ::testing::Test {
+protected:
+    FileSourceTest() : mFd(-1), mData(NULL), mSize(0) {}
+
+    virtual void SetUp() {
+        const char *dir = getenv("TMPDIR");
+        snprintf(mPath, sizeof(mPath), "%s/FileSource_test.XXXXXX",
+                 dir != NULL ? dir : "/data/local/tmp");
+        mFd = mkstemp(mPath);
+        ASSERT_GE(mFd, 0) << "cannot create " << mPath;
+    }
+
+    virtual void TearDown() {
+        if (mFd >= 0) {
+            close(mFd);
+            unlink(mPath);
+        }
+        delete[] mData;
+    }
+
+    // Writes size bytes of random data to the end of the file.
+    void append(size_t size) {
+        uint8_t *data = new uint8_t[mSize + size];
+        if (mData != NULL) {
+            memcpy(data, mData, mSize);
+            delete[] mData;
+        }
+        mData = data;
+        for (size_t i = 0; i < size; ++i) {
+            mData[mSize + i] = rand();
+        }
+        ASSERT_EQ((ssize_t)size, pwrite(mFd, mData + mSize, size, mSize));
+        mSize += size;
+    }
+
+    // Opens the file with the block cache enabled; length may exceed the
+    // current file size so that reads see the data appended later.
+    sp<FileSource> openSource(int64_t length) {
+        sp<FileSource> source = new FileSource(dup(mFd), 0, length);
+        EXPECT_EQ(OK, source->initCheck());
+        EXPECT_EQ(OK, source->setBlockCache(kCacheSize, kBlockSize));
+        return source;
+    }
+
+    // Reads size bytes at offset and checks them against the file contents.
+    void checkRead(const sp<FileSource> &source, off64_t offset, size_t size) {
+        uint8_t *buffer = new uint8_t[size];
+        ssize_t n = source->readAt(offset, buffer, size);
+        ssize_t expected = 0;
+        if (offset < (off64_t)mSize) {
+            expected = mSize - offset < size ? mSize - offset : size;
+        }
+        EXPECT_EQ(expected, n) << "offset " << offset << " size " << size;
+        if (n == expected && n > 0) {
+            EXPECT_EQ(0, memcmp(buffer, mData + offset, n))
+                << "offset " << offset << " size " << size;
+        }
+        delete[] buffer;
+    }
+
+    char mPath[256];
+    int mFd;
+    uint8_t *mData;
+    size_t mSize;
+};
+
+TEST_F(FileSourceTest, SequentialReads) {
+    append(100 * kBlockSize + 123);
+    sp<FileSource> source = openSource(mSize);
+
+    static const size_t kReadSizes[] = { 1, 8, 188, 1000, kBlockSize, 3 * kBlockSize + 5 };
+    for (size_t i = 0; i < sizeof(kReadSizes) / sizeof(kReadSizes[0]); ++i) {
+        for (off64_t offset = 0; offset < (off64_t)mSize; offset += kReadSizes[i]) {
+            checkRead(source, offset, kReadSizes[i]);
+        }
+    }
+
+    // Small sequential reads must be served from the readahead.
+    FileSource::Stats stats;
+    source->getStats(&stats);
+    EXPECT_LT(stats.mNumSyscalls, stats.mNumReads / 10);
+}
+
+TEST_F(FileSourceTest, RandomReads) {
+    append(100 * kBlockSize + 123);
+    sp<FileSource> source = openSource(mSize);
+
+    srand(1);
+    for (int i = 0; i < 10000; ++i) {
+        off64_t offset = rand() % (mSize + kBlockSize);
+        size_t size = rand() % 4 == 0 ? rand() % (4 * kBlockSize) + 1 : rand() % 256 + 1;
+        checkRead(source, offset, size);
+    }
+}
+
+TEST_F(FileSourceTest, ReadsAfterFileGrows) {
+    append(2 * kBlockSize + 100);
+    sp<FileSource> source = openSource(16 * kBlockSize);
+
+    // Read up to and past the end of the file, which ends within a block.
+    checkRead(source, 0, 64);
+    checkRead(source, 2 * kBlockSize, 64);
+    checkRead(source, 2 * kBlockSize + 64, 200);
+
+    append(kBlockSize);
+
+    // The block that held the end of the file must be read again.
+    checkRead(source, 2 * kBlockSize + 64, 200);
+    checkRead(source, 2 * kBlockSize, kBlockSize + 100);
+    checkRead(source, 3 * kBlockSize, 200);
+}
+
+}  // namespace android
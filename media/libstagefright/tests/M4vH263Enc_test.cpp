@@ -0,0 +1,151 @@
+/*
+ * Copyright 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "M4vH263Enc_test"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "mp4enc_api.h"
+
+namespace android {
+
+static const int kWidth = 352;
+static const int kHeight = 288;
+static const int kNumFrames = 12;
+
+class M4vH263EncTest : public ::testing::Test {
+protected:
+    // A noisy pattern that moves by a few pixels every frame, so that the
+    // P-VOPs have motion vectors, intra MBs and coded residuals.
+    static void fillFrame(uint8_t *frame, int index) {
+        uint8_t *y = frame;
+        uint8_t *uv = frame + kWidth * kHeight;
+
+        for (int j = 0; j < kHeight; ++j) {
+            for (int i = 0; i < kWidth; ++i) {
+                int x = i + index * 3;
+                int v = j - index * 2;
+                y[j * kWidth + i] = ((x * x + v * 7) >> 3) ^ (rand() & 7);
+            }
+        }
+        for (int i = 0; i < kWidth * kHeight / 2; ++i) {
+            uv[i] = 128 + ((i + index) & 15);
+        }
+    }
+
+    // Encodes the same frames with numThreads and returns the bitstream,
+    // VOL header included.
+    static void encode(MP4EncodingMode mode, int numThreads, std::vector<uint8_t> *out) {
+        VideoEncControls handle;
+        memset(&handle, 0, sizeof(handle));
+
+        VideoEncOptions options;
+        memset(&options, 0, sizeof(options));
+        ASSERT_TRUE(PVGetDefaultEncOption(&options, 0));
+
+        options.encMode = mode;
+        options.encWidth[0] = kWidth;
+        options.encHeight[0] = kHeight;
+        options.encFrameRate[0] = 30;
+        options.rcType = VBR_1;
+        options.vbvDelay = 5.0f;
+        options.profile_level = CORE_PROFILE_LEVEL2;
+        options.packetSize = 32;
+        options.rvlcEnable = PV_OFF;
+        options.numLayers = 1;
+        options.timeIncRes = 1000;
+        options.tickPerSrc = 1000 / 30;
+        options.bitRate[0] = kWidth * kHeight * 3;
+        options.iQuant[0] = 15;
+        options.pQuant[0] = 12;
+        options.quantType[0] = 0;
+        options.noFrameSkipped = PV_OFF;
+        options.intraPeriod = 5;
+        options.sceneDetect = PV_ON;
+        options.searchRange = 16;
+        options.mv8x8Enable = PV_OFF;
+        options.useACPred = PV_ON;
+        options.numThreads = numThreads;
+
+        ASSERT_TRUE(PVInitVideoEncoder(&handle, &options));
+
+        UChar header[256];
+        Int headerSize = sizeof(header);
+        if (mode != H263_MODE) {
+            ASSERT_TRUE(PVGetVolHeader(&handle, header, &headerSize, 0));
+            out->insert(out->end(), header, header + headerSize);
+        }
+
+        // the same source for every thread count
+        srand(1);
+
+        std::vector<uint8_t> frame(kWidth * kHeight * 3 / 2);
+        std::vector<uint8_t> buffer(kWidth * kHeight * 2);
+        for (int n = 0; n < kNumFrames; ++n) {
+            fillFrame(&frame[0], n);
+
+            VideoEncFrameIO in, recon;
+            memset(&in, 0, sizeof(in));
+            memset(&recon, 0, sizeof(recon));
+            in.height = kHeight;
+            in.pitch = kWidth;
+            in.timestamp = n * 33;
+            in.yChan = &frame[0];
+            in.uChan = in.yChan + kWidth * kHeight;
+            in.vChan = in.uChan + kWidth * kHeight / 4;
+
+            ULong modTime = 0;
+            Int numLayers = 0;
+            Int size = buffer.size();
+            ASSERT_TRUE(PVEncodeVideoFrame(
+                    &handle, &in, &recon, &modTime, &buffer[0], &size, &numLayers));
+            out->insert(out->end(), buffer.begin(), buffer.begin() + size);
+        }
+
+        PVCleanUpVideoEncoder(&handle);
+    }
+
+    static void expectSameOutput(MP4EncodingMode mode) {
+        std::vector<uint8_t> expected;
+        encode(mode, 1, &expected);
+        ASSERT_FALSE(expected.empty());
+
+        static const int kNumThreads[] = { 2, 3, 4, 8 };
+        for (size_t i = 0; i < sizeof(kNumThreads) / sizeof(kNumThreads[0]); ++i) {
+            std::vector<uint8_t> actual;
+            encode(mode, kNumThreads[i], &actual);
+            EXPECT_TRUE(expected == actual)
+                    << "mode " << mode << ", " << kNumThreads[i] << " threads";
+        }
+    }
+};
+
+// The worker threads only run motion estimation and CodeMB ahead of the VLC
+// encoding, so the bitstream must not depend on the number of threads.
+TEST_F(M4vH263EncTest, ThreadedOutputMatchesCombinedMode) {
+    expectSameOutput(COMBINE_MODE_WITH_ERR_RES);
+}
+
+TEST_F(M4vH263EncTest, ThreadedOutputMatchesH263) {
+    expectSameOutput(H263_MODE);
+}
+
+} // namespace android
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Builds synthetic sample tables for long tracks and reports the first seek
+ * latency (which includes building the seek index) and the average and
+ * maximum latency of later seeks. The size of each seek index is logged by
+ * SampleTable when it is built.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/Utils.h>
+#include <utils/Vector.h>
+
+#include "include/SampleTable.h"
+
+using namespace android;
+
+// Serves the synthetic stsz, stts and ctts boxes from memory.
+class MemorySource : public DataSource {
+public:
+    MemorySource() {}
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset < 0 || (size_t)offset >= mData.size()) {
+            return 0;
+        }
+        if (size > mData.size() - offset) {
+            size = mData.size() - offset;
+        }
+        memcpy(data, mData.array() + offset, size);
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mData.size();
+        return OK;
+    }
+
+    off64_t offset() const {
+        return mData.size();
+    }
+
+    void appendU32(uint32_t x) {
+        uint8_t bytes[4] = {
+            (uint8_t)(x >> 24), (uint8_t)(x >> 16), (uint8_t)(x >> 8), (uint8_t)x };
+        mData.appendArray(bytes, sizeof(bytes));
+    }
+
+protected:
+    virtual ~MemorySource() {}
+
+private:
+    Vector<uint8_t> mData;
+
+    MemorySource(const MemorySource &);
+    MemorySource &operator=(const MemorySource &);
+};
+
+struct TrackConfig {
+    const char *name;
+    uint32_t timescale;
+    uint32_t numSamples;
+    uint32_t delta;
+    // Alternate the duration of consecutive samples by one tick, which
+    // gives one stts entry per sample, as seen in some audio tracks.
+    bool jitter;
+    // Add IBBP style composition offsets for every sample.
+    bool reordered;
+};
+
+static const TrackConfig kTracks[] = {
+    { "video 30 fps, 1 h",            30000,  108000, 1001, false, false },
+    { "video 30 fps, 1 h, B-frames",  30000,  108000, 1001, false, true  },
+    { "video 30 fps, 10 h",           30000, 1080000, 1001, false, false },
+    { "video 30 fps, 10 h, B-frames", 30000, 1080000, 1001, false, true  },
+    { "audio 48 kHz, 10 h",           48000, 1687500, 1024, false, false },
+    { "audio 48 kHz, 10 h, jitter",   48000, 1687500, 1024, true,  false },
+};
+
+static sp<SampleTable> buildTable(const TrackConfig &config) {
+    sp<MemorySource> source = new MemorySource;
+
+    // stsz with a default sample size.
+    off64_t stszOffset = source->offset();
+    source->appendU32(0);
+    source->appendU32(1000);
+    source->appendU32(config.numSamples);
+    size_t stszSize = source->offset() - stszOffset;
+
+    off64_t sttsOffset = source->offset();
+    source->appendU32(0);
+    if (config.jitter) {
+        source->appendU32(config.numSamples);
+        for (uint32_t i = 0; i < config.numSamples; ++i) {
+            source->appendU32(1);
+            source->appendU32(config.delta + (i & 1));
+        }
+    } else {
+        source->appendU32(1);
+        source->appendU32(config.numSamples);
+        source->appendU32(config.delta);
+    }
+    size_t sttsSize = source->offset() - sttsOffset;
+
+    off64_t cttsOffset = source->offset();
+    if (config.reordered) {
+        // Decode order I P B B, presented as I B B P.
+        static const uint32_t kOffsets[] = { 1, 3, 0, 0 };
+        source->appendU32(0);
+        source->appendU32(config.numSamples);
+        for (uint32_t i = 0; i < config.numSamples; ++i) {
+            source->appendU32(1);
+            source->appendU32(kOffsets[i % 4] * config.delta);
+        }
+    }
+    size_t cttsSize = source->offset() - cttsOffset;
+
+    sp<SampleTable> table = new SampleTable(source);
+    CHECK_EQ(table->setSampleSizeParams(
+            FOURCC('s', 't', 's', 'z'), stszOffset, stszSize), (status_t)OK);
+    CHECK_EQ(table->setTimeToSampleParams(sttsOffset, sttsSize), (status_t)OK);
+    if (config.reordered) {
+        CHECK_EQ(table->setCompositionTimeToSampleParams(cttsOffset, cttsSize),
+                (status_t)OK);
+    }
+    return table;
+}
+
+int main(int argc, char **argv) {
+    int numSeeks = 10000;
+    if (argc > 1) {
+        numSeeks = atoi(argv[1]);
+    }
+    if (numSeeks <= 0) {
+        fprintf(stderr, "usage: %s [number of seeks per track]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-30s %9s %12s %10s %10s\n",
+            "track", "samples", "first (us)", "avg (us)", "max (us)");
+
+    srand(1);
+    for (size_t t = 0; t < sizeof(kTracks) / sizeof(kTracks[0]); ++t) {
+        const TrackConfig &config = kTracks[t];
+        sp<SampleTable> table = buildTable(config);
+
+        int64_t durationUs =
+            (int64_t)config.numSamples * config.delta * 1000000ll / config.timescale;
+        uint32_t sampleIndex;
+
+        int64_t startUs = ALooper::GetNowUs();
+        table->findSampleAtTime(durationUs / 2, 1000000, config.timescale,
+                &sampleIndex, SampleTable::kFlagClosest);
+        int64_t firstUs = ALooper::GetNowUs() - startUs;
+
+        int64_t totalUs = 0;
+        int64_t maxUs = 0;
+        for (int i = 0; i < numSeeks; ++i) {
+            int64_t seekTimeUs = (int64_t)(((double)rand() / RAND_MAX) * durationUs);
+            startUs = ALooper::GetNowUs();
+            table->findSampleAtTime(seekTimeUs, 1000000, config.timescale,
+                    &sampleIndex, SampleTable::kFlagClosest);
+            int64_t seekUs = ALooper::GetNowUs() - startUs;
+            totalUs += seekUs;
+            if (seekUs > maxUs) {
+                maxUs = seekUs;
+            }
+        }
+
+        printf("%-30s %9u %12lld %10.2f %10lld\n",
+                config.name, config.numSamples, (long long)firstUs,
+                (double)totalUs / numSeeks, (long long)maxUs);
+    }
+
+    return 0;
+}
@@ -403,6 +403,8 @@ void AudioFlinger::dumpInternals(int fd, const Vector<String16>& args __unused)
                             (uint32_t)(mStandbyTimeInNsecs / 1000000));
     result.append(buffer);
     write(fd, result.string(), result.size());
+
+    AudioResampler::dumpFilterCache(fd);
 }
 
 void AudioFlinger::dumpPermissionDenial(int fd, const Vector<String16>& args __unused)
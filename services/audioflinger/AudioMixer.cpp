@@ -379,20 +379,39 @@ void AudioMixer::ReformatBufferProvider::copyFrames(void *dst, const void *src,
 // ----------------------------------------------------------------------------
 
 // Ensure mConfiguredNames bitmask is initialized properly on all architectures.
-// The value of 1 << x is undefined in C when x >= 32.
+// The value of 1 << x is undefined in C when x >= 64.
 
 AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate, uint32_t maxNumTracks)
-    :   mTrackNames(0), mConfiguredNames((maxNumTracks >= 32 ? 0 : 1 << maxNumTracks) - 1),
+    :   mTrackNames(0),
+        mConfiguredNames((maxNumTracks >= 64 ? 0 : 1ULL << maxNumTracks) - 1),
         mSampleRate(sampleRate)
 {
     ALOG_ASSERT(maxNumTracks <= MAX_NUM_TRACKS, "maxNumTracks %u > MAX_NUM_TRACKS %u",
             maxNumTracks, MAX_NUM_TRACKS);
 
-    // AudioMixer is not yet capable of more than 32 active track inputs
-    ALOG_ASSERT(32 >= MAX_NUM_TRACKS, "bad MAX_NUM_TRACKS %d", MAX_NUM_TRACKS);
+    // AudioMixer is not yet capable of more than 64 active track inputs
+    ALOG_ASSERT(64 >= MAX_NUM_TRACKS, "bad MAX_NUM_TRACKS %d", MAX_NUM_TRACKS);
 
     pthread_once(&sOnceControl, &sInitRoutine);
 
+    // Have the resampler filters of the common track sample rates designed in the
+    // background, with the qualities chosen by track_t::setResampler().
+    static const uint32_t kCommonSampleRates[] = {
+        8000, 11025, 16000, 22050, 24000, 32000, 44100, 48000,
+    };
+    for (size_t i = 0; i < sizeof(kCommonSampleRates) / sizeof(kCommonSampleRates[0]); ++i) {
+        const uint32_t trackSampleRate = kCommonSampleRates[i];
+        if (trackSampleRate == sampleRate) {
+            continue;
+        }
+        const bool music = (trackSampleRate == 44100 && sampleRate == 48000)
+                || (trackSampleRate == 48000 && sampleRate == 44100);
+        AudioResampler::precomputeFilter(
+                kUseFloat && kUseNewMixer ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT,
+                trackSampleRate, sampleRate,
+                music ? AudioResampler::DEFAULT_QUALITY : AudioResampler::DYN_LOW_QUALITY);
+    }
+
     mState.enabledTracks= 0;
     mState.needsChanged = 0;
     mState.frameCount   = frameCount;
@@ -402,30 +421,22 @@ AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate, uint32_t maxNumTr
     mState.mLog         = &mDummyLog;
     // mState.reserved
 
-    // FIXME Most of the following initialization is probably redundant since
-    // tracks[i] should only be referenced if (mTrackNames & (1 << i)) != 0
-    // and mTrackNames is initially 0.  However, leave it here until that's verified.
-    track_t* t = mState.tracks;
-    for (unsigned i=0 ; i < MAX_NUM_TRACKS ; i++) {
-        t->resampler = NULL;
-        t->downmixerBufferProvider = NULL;
-        t->mReformatBufferProvider = NULL;
-#ifdef HW_ACC_EFFECTS
-        t->hwAcc = NULL;
-#endif
-        t++;
-    }
-
+    // Track slots are allocated on first use by getTrackName(), and then kept
+    // for reuse until the mixer is destroyed.
+    memset(mState.tracks, 0, sizeof(mState.tracks));
 }
 
 AudioMixer::~AudioMixer()
 {
-    track_t* t = mState.tracks;
     for (unsigned i=0 ; i < MAX_NUM_TRACKS ; i++) {
+        track_t* t = mState.tracks[i];
+        if (t == NULL) {
+            continue;
+        }
         delete t->resampler;
         delete t->downmixerBufferProvider;
         delete t->mReformatBufferProvider;
-        t++;
+        free(t);
     }
     delete [] mState.outputTemp;
     delete [] mState.resampleTemp;
@@ -443,12 +454,24 @@ int AudioMixer::getTrackName(audio_channel_mask_t channelMask,
         ALOGE("AudioMixer::getTrackName invalid format (%#x)", format);
         return -1;
     }
-    uint32_t names = (~mTrackNames) & mConfiguredNames;
+    uint64_t names = (~mTrackNames) & mConfiguredNames;
     if (names != 0) {
-        int n = __builtin_ctz(names);
+        int n = __builtin_ctzll(names);
         ALOGV("add track (%d)", n);
+        track_t* t = mState.tracks[n];
+        if (t == NULL) {
+            // Each slot gets its own cache line aligned allocation, so that
+            // tracks mixed on different threads never share a line.
+            void* slot = NULL;
+            if (posix_memalign(&slot, kTrackAlignment, sizeof(track_t)) != 0) {
+                ALOGE("AudioMixer::getTrackName cannot allocate track %d", n);
+                return -1;
+            }
+            memset(slot, 0, sizeof(track_t));
+            t = static_cast<track_t*>(slot);
+            mState.tracks[n] = t;
+        }
         // assume default parameters for the track, except where noted below
-        track_t* t = &mState.tracks[n];
         t->needs = 0;
 
         // Integer volume.
@@ -519,14 +542,14 @@ int AudioMixer::getTrackName(audio_channel_mask_t channelMask,
         // to integer because the downmixer requires integer to process.
         ALOGVV("mMixerFormat:%#x  mMixerInFormat:%#x\n", t->mMixerFormat, t->mMixerInFormat);
         prepareTrackForReformat(t, n);
-        mTrackNames |= 1 << n;
+        mTrackNames |= 1ULL << n;
         return TRACK0 + n;
     }
     ALOGE("AudioMixer::getTrackName out of available tracks");
     return -1;
 }
 
-void AudioMixer::invalidateState(uint32_t mask)
+void AudioMixer::invalidateState(uint64_t mask)
 {
     if (mask != 0) {
         mState.needsChanged |= mask;
@@ -539,7 +562,7 @@ void AudioMixer::invalidateState(uint32_t mask)
 // which will simplify this logic.
 bool AudioMixer::setChannelMasks(int name,
         audio_channel_mask_t trackChannelMask, audio_channel_mask_t mixerChannelMask) {
-    track_t &track = mState.tracks[name];
+    track_t &track = *mState.tracks[name];
 
     if (trackChannelMask == track.channelMask
             && mixerChannelMask == track.mMixerChannelMask) {
@@ -563,7 +586,7 @@ bool AudioMixer::setChannelMasks(int name,
     const audio_format_t prevMixerInFormat = track.mMixerInFormat;
     track.mMixerInFormat = kUseFloat && kUseNewMixer
             ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
-    const status_t status = initTrackDownmix(&mState.tracks[name], name);
+    const status_t status = initTrackDownmix(mState.tracks[name], name);
     ALOGE_IF(status != OK,
             "initTrackDownmix error %d, track channel mask %#x, mixer channel mask %#x",
             status, track.channelMask, track.mMixerChannelMask);
@@ -687,37 +710,37 @@ void AudioMixer::deleteTrackName(int name)
     name -= TRACK0;
     ALOG_ASSERT(uint32_t(name) < MAX_NUM_TRACKS, "bad track name %d", name);
     ALOGV("deleteTrackName(%d)", name);
-    track_t& track(mState.tracks[ name ]);
+    track_t& track(*mState.tracks[name]);
     if (track.enabled) {
         track.enabled = false;
-        invalidateState(1<<name);
+        invalidateState(1ULL << name);
     }
     // delete the resampler
     delete track.resampler;
     track.resampler = NULL;
     // delete the downmixer
-    unprepareTrackForDownmix(&mState.tracks[name], name);
+    unprepareTrackForDownmix(mState.tracks[name], name);
     // delete the reformatter
-    unprepareTrackForReformat(&mState.tracks[name], name);
+    unprepareTrackForReformat(mState.tracks[name], name);
     // delete the hwAcc effects
 #ifdef HW_ACC_EFFECTS
     delete track.hwAcc;
     track.hwAcc = NULL;
 #endif
 
-    mTrackNames &= ~(1<<name);
+    mTrackNames &= ~(1ULL << name);
 }
 
 void AudioMixer::enable(int name)
 {
     name -= TRACK0;
     ALOG_ASSERT(uint32_t(name) < MAX_NUM_TRACKS, "bad track name %d", name);
-    track_t& track = mState.tracks[name];
+    track_t& track = *mState.tracks[name];
 
     if (!track.enabled) {
         track.enabled = true;
         ALOGV("enable(%d)", name);
-        invalidateState(1 << name);
+        invalidateState(1ULL << name);
     }
 }
 
@@ -725,12 +748,12 @@ void AudioMixer::disable(int name)
 {
     name -= TRACK0;
     ALOG_ASSERT(uint32_t(name) < MAX_NUM_TRACKS, "bad track name %d", name);
-    track_t& track = mState.tracks[name];
+    track_t& track = *mState.tracks[name];
 
     if (track.enabled) {
         track.enabled = false;
         ALOGV("disable(%d)", name);
-        invalidateState(1 << name);
+        invalidateState(1ULL << name);
     }
 }
 
@@ -805,7 +828,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
 {
     name -= TRACK0;
     ALOG_ASSERT(uint32_t(name) < MAX_NUM_TRACKS, "bad track name %d", name);
-    track_t& track = mState.tracks[name];
+    track_t& track = *mState.tracks[name];
 
     int valueInt = static_cast<int>(reinterpret_cast<uintptr_t>(value));
     int32_t *valueBuf = reinterpret_cast<int32_t*>(value);
@@ -819,21 +842,21 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                 static_cast<audio_channel_mask_t>(valueInt);
             if (setChannelMasks(name, trackChannelMask, track.mMixerChannelMask)) {
                 ALOGV("setParameter(TRACK, CHANNEL_MASK, %x)", trackChannelMask);
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             } break;
         case MAIN_BUFFER:
             if (track.mainBuffer != valueBuf) {
                 track.mainBuffer = valueBuf;
                 ALOGV("setParameter(TRACK, MAIN_BUFFER, %p)", valueBuf);
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             break;
         case AUX_BUFFER:
             if (track.auxBuffer != valueBuf) {
                 track.auxBuffer = valueBuf;
                 ALOGV("setParameter(TRACK, AUX_BUFFER, %p)", valueBuf);
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             break;
         case FORMAT: {
@@ -843,7 +866,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                 track.mFormat = format;
                 ALOGV("setParameter(TRACK, FORMAT, %#x)", format);
                 prepareTrackForReformat(&track, name);
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             } break;
         // FIXME do we want to support setting the downmix type from AudioFlinger?
@@ -862,7 +885,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                     static_cast<audio_channel_mask_t>(valueInt);
             if (setChannelMasks(name, track.channelMask, mixerChannelMask)) {
                 ALOGV("setParameter(TRACK, MIXER_CHANNEL_MASK, %#x)", mixerChannelMask);
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             } break;
 #ifdef HW_ACC_EFFECTS
@@ -912,18 +935,18 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
             if (track.setResampler(uint32_t(valueInt), mSampleRate)) {
                 ALOGV("setParameter(RESAMPLE, SAMPLE_RATE, %u)",
                         uint32_t(valueInt));
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             break;
         case RESET:
             track.resetResampler();
-            invalidateState(1 << name);
+            invalidateState(1ULL << name);
             break;
         case REMOVE:
             delete track.resampler;
             track.resampler = NULL;
             track.sampleRate = mSampleRate;
-            invalidateState(1 << name);
+            invalidateState(1ULL << name);
             break;
         default:
             LOG_ALWAYS_FATAL("setParameter resample: bad param %d", param);
@@ -940,7 +963,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                     &track.mAuxLevel, &track.mPrevAuxLevel, &track.mAuxInc)) {
                 ALOGV("setParameter(%s, AUXLEVEL: %04x)",
                         target == VOLUME ? "VOLUME" : "RAMP_VOLUME", track.auxLevel);
-                invalidateState(1 << name);
+                invalidateState(1ULL << name);
             }
             break;
         default:
@@ -954,7 +977,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                     ALOGV("setParameter(%s, VOLUME%d: %04x)",
                             target == VOLUME ? "VOLUME" : "RAMP_VOLUME", param - VOLUME0,
                                     track.volume[param - VOLUME0]);
-                    invalidateState(1 << name);
+                    invalidateState(1ULL << name);
                 }
             } else {
                 LOG_ALWAYS_FATAL("setParameter volume: bad param %d", param);
@@ -1071,8 +1094,8 @@ inline void AudioMixer::track_t::adjustVolumeRamp(bool aux, bool useFloat)
 size_t AudioMixer::getUnreleasedFrames(int name) const
 {
     name -= TRACK0;
-    if (uint32_t(name) < MAX_NUM_TRACKS) {
-        return mState.tracks[name].getUnreleasedFrames();
+    if (uint32_t(name) < MAX_NUM_TRACKS && mState.tracks[name] != NULL) {
+        return mState.tracks[name]->getUnreleasedFrames();
     }
     return 0;
 }
@@ -1083,22 +1106,22 @@ void AudioMixer::setBufferProvider(int name, AudioBufferProvider* bufferProvider
     ALOG_ASSERT(uint32_t(name) < MAX_NUM_TRACKS, "bad track name %d", name);
 
 #ifdef HW_ACC_EFFECTS
-    if (mState.tracks[name].hwAcc->mEnabled) {
-        mState.tracks[name].hwAcc->setBufferProvider(&bufferProvider,
-                                                     &mState.tracks[name].bufferProvider);
+    if (mState.tracks[name]->hwAcc->mEnabled) {
+        mState.tracks[name]->hwAcc->setBufferProvider(&bufferProvider,
+                                                     &mState.tracks[name]->bufferProvider);
         return;
     }
 #endif
-    if (mState.tracks[name].mInputBufferProvider == bufferProvider) {
+    if (mState.tracks[name]->mInputBufferProvider == bufferProvider) {
         return; // don't reset any buffer providers if identical.
     }
-    if (mState.tracks[name].mReformatBufferProvider != NULL) {
-        mState.tracks[name].mReformatBufferProvider->reset();
-    } else if (mState.tracks[name].downmixerBufferProvider != NULL) {
+    if (mState.tracks[name]->mReformatBufferProvider != NULL) {
+        mState.tracks[name]->mReformatBufferProvider->reset();
+    } else if (mState.tracks[name]->downmixerBufferProvider != NULL) {
     }
 
-    mState.tracks[name].mInputBufferProvider = bufferProvider;
-    reconfigureBufferProviders(&mState.tracks[name]);
+    mState.tracks[name]->mInputBufferProvider = bufferProvider;
+    reconfigureBufferProviders(mState.tracks[name]);
 }
 
 
@@ -1113,17 +1136,17 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
     ALOGW_IF(!state->needsChanged,
         "in process__validate() but nothing's invalid");
 
-    uint32_t changed = state->needsChanged;
+    uint64_t changed = state->needsChanged;
     state->needsChanged = 0; // clear the validation flag
 
     // recompute which tracks are enabled / disabled
-    uint32_t enabled = 0;
-    uint32_t disabled = 0;
+    uint64_t enabled = 0;
+    uint64_t disabled = 0;
     while (changed) {
-        const int i = 31 - __builtin_clz(changed);
-        const uint32_t mask = 1<<i;
+        const int i = 63 - __builtin_clzll(changed);
+        const uint64_t mask = 1ULL << i;
         changed &= ~mask;
-        track_t& t = state->tracks[i];
+        track_t& t = *state->tracks[i];
         (t.enabled ? enabled : disabled) |= mask;
     }
     state->enabledTracks &= ~disabled;
@@ -1137,13 +1160,13 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
     bool all16BitsStereoNoResample = true;
     bool resampling = false;
     bool volumeRamp = false;
-    uint32_t en = state->enabledTracks;
+    uint64_t en = state->enabledTracks;
     while (en) {
-        const int i = 31 - __builtin_clz(en);
-        en &= ~(1<<i);
+        const int i = 63 - __builtin_clzll(en);
+        en &= ~(1ULL << i);
 
         countActiveTracks++;
-        track_t& t = state->tracks[i];
+        track_t& t = *state->tracks[i];
         uint32_t n = 0;
         // FIXME can overflow (mask is only 3 bits)
         n |= NEEDS_CHANNEL_1 + t.channelCount - 1;
@@ -1222,8 +1245,8 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
             state->hook = process__genericNoResampling;
             if (all16BitsStereoNoResample && !volumeRamp) {
                 if (countActiveTracks == 1) {
-                    const int i = 31 - __builtin_clz(state->enabledTracks);
-                    track_t& t = state->tracks[i];
+                    const int i = 63 - __builtin_clzll(state->enabledTracks);
+                    track_t& t = *state->tracks[i];
                     if ((t.needs & NEEDS_MUTE) == 0) {
                         // The check prevents a muted track from acquiring a process hook.
                         //
@@ -1238,9 +1261,9 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
         }
     }
 
-    ALOGV("mixer configuration change: %d activeTracks (%08x) "
+    ALOGV("mixer configuration change: %d activeTracks (%016llx) "
         "all16BitsStereoNoResample=%d, resampling=%d, volumeRamp=%d",
-        countActiveTracks, state->enabledTracks,
+        countActiveTracks, (unsigned long long)state->enabledTracks,
         all16BitsStereoNoResample, resampling, volumeRamp);
 
    state->hook(state, pts);
@@ -1249,11 +1272,11 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
     // track hooks for subsequent mixer process
     if (countActiveTracks > 0) {
         bool allMuted = true;
-        uint32_t en = state->enabledTracks;
+        uint64_t en = state->enabledTracks;
         while (en) {
-            const int i = 31 - __builtin_clz(en);
-            en &= ~(1<<i);
-            track_t& t = state->tracks[i];
+            const int i = 63 - __builtin_clzll(en);
+            en &= ~(1ULL << i);
+            track_t& t = *state->tracks[i];
             if (!t.doesResample() && t.volumeRL == 0) {
                 t.needs |= NEEDS_MUTE;
                 t.hook = track__nop;
@@ -1265,8 +1288,8 @@ void AudioMixer::process__validate(state_t* state, int64_t pts)
             state->hook = process__nop;
         } else if (all16BitsStereoNoResample) {
             if (countActiveTracks == 1) {
-                const int i = 31 - __builtin_clz(state->enabledTracks);
-                track_t& t = state->tracks[i];
+                const int i = 63 - __builtin_clzll(state->enabledTracks);
+                track_t& t = *state->tracks[i];
                 // Muted single tracks handled by allMuted above.
                 state->hook = getProcessHook(PROCESSTYPE_NORESAMPLEONETRACK,
                         t.mMixerChannelCount, t.mMixerInFormat, t.mMixerFormat);
@@ -1571,21 +1594,21 @@ void AudioMixer::track__16BitsMono(track_t* t, int32_t* out, size_t frameCount,
 void AudioMixer::process__nop(state_t* state, int64_t pts)
 {
     ALOGVV("process__nop\n");
-    uint32_t e0 = state->enabledTracks;
+    uint64_t e0 = state->enabledTracks;
     while (e0) {
         // process by group of tracks with same output buffer to
         // avoid multiple memset() on same buffer
-        uint32_t e1 = e0, e2 = e0;
-        int i = 31 - __builtin_clz(e1);
+        uint64_t e1 = e0, e2 = e0;
+        int i = 63 - __builtin_clzll(e1);
         {
-            track_t& t1 = state->tracks[i];
-            e2 &= ~(1<<i);
+            track_t& t1 = *state->tracks[i];
+            e2 &= ~(1ULL << i);
             while (e2) {
-                i = 31 - __builtin_clz(e2);
-                e2 &= ~(1<<i);
-                track_t& t2 = state->tracks[i];
+                i = 63 - __builtin_clzll(e2);
+                e2 &= ~(1ULL << i);
+                track_t& t2 = *state->tracks[i];
                 if (CC_UNLIKELY(t2.mainBuffer != t1.mainBuffer)) {
-                    e1 &= ~(1<<i);
+                    e1 &= ~(1ULL << i);
                 }
             }
             e0 &= ~(e1);
@@ -1595,10 +1618,10 @@ void AudioMixer::process__nop(state_t* state, int64_t pts)
         }
 
         while (e1) {
-            i = 31 - __builtin_clz(e1);
-            e1 &= ~(1<<i);
+            i = 63 - __builtin_clzll(e1);
+            e1 &= ~(1ULL << i);
             {
-                track_t& t3 = state->tracks[i];
+                track_t& t3 = *state->tracks[i];
                 size_t outFrames = state->frameCount;
                 while (outFrames) {
                     t3.buffer.frameCount = outFrames;
@@ -1621,12 +1644,12 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
     int32_t outTemp[BLOCKSIZE * MAX_NUM_CHANNELS] __attribute__((aligned(32)));
 
     // acquire each track's buffer
-    uint32_t enabledTracks = state->enabledTracks;
-    uint32_t e0 = enabledTracks;
+    uint64_t enabledTracks = state->enabledTracks;
+    uint64_t e0 = enabledTracks;
     while (e0) {
-        const int i = 31 - __builtin_clz(e0);
-        e0 &= ~(1<<i);
-        track_t& t = state->tracks[i];
+        const int i = 63 - __builtin_clzll(e0);
+        e0 &= ~(1ULL << i);
+        track_t& t = *state->tracks[i];
         t.buffer.frameCount = state->frameCount;
         t.bufferProvider->getNextBuffer(&t.buffer, pts);
         t.frameCount = t.buffer.frameCount;
@@ -1637,16 +1660,16 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
     while (e0) {
         // process by group of tracks with same output buffer to
         // optimize cache use
-        uint32_t e1 = e0, e2 = e0;
-        int j = 31 - __builtin_clz(e1);
-        track_t& t1 = state->tracks[j];
-        e2 &= ~(1<<j);
+        uint64_t e1 = e0, e2 = e0;
+        int j = 63 - __builtin_clzll(e1);
+        track_t& t1 = *state->tracks[j];
+        e2 &= ~(1ULL << j);
         while (e2) {
-            j = 31 - __builtin_clz(e2);
-            e2 &= ~(1<<j);
-            track_t& t2 = state->tracks[j];
+            j = 63 - __builtin_clzll(e2);
+            e2 &= ~(1ULL << j);
+            track_t& t2 = *state->tracks[j];
             if (CC_UNLIKELY(t2.mainBuffer != t1.mainBuffer)) {
-                e1 &= ~(1<<j);
+                e1 &= ~(1ULL << j);
             }
         }
         e0 &= ~(e1);
@@ -1657,9 +1680,9 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
             memset(outTemp, 0, sizeof(outTemp));
             e2 = e1;
             while (e2) {
-                const int i = 31 - __builtin_clz(e2);
-                e2 &= ~(1<<i);
-                track_t& t = state->tracks[i];
+                const int i = 63 - __builtin_clzll(e2);
+                e2 &= ~(1ULL << i);
+                track_t& t = *state->tracks[i];
                 size_t outFrames = BLOCKSIZE;
                 int32_t *aux = NULL;
                 if (CC_UNLIKELY(t.needs & NEEDS_AUX)) {
@@ -1669,8 +1692,8 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
                     // t.in == NULL can happen if the track was flushed just after having
                     // been enabled for mixing.
                    if (t.in == NULL) {
-                        enabledTracks &= ~(1<<i);
-                        e1 &= ~(1<<i);
+                        enabledTracks &= ~(1ULL << i);
+                        e1 &= ~(1ULL << i);
                         break;
                     }
                     size_t inFrames = (t.frameCount > outFrames)?outFrames:t.frameCount;
@@ -1692,8 +1715,8 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
                         t.bufferProvider->getNextBuffer(&t.buffer, outputPTS);
                         t.in = t.buffer.raw;
                         if (t.in == NULL) {
-                            enabledTracks &= ~(1<<i);
-                            e1 &= ~(1<<i);
+                            enabledTracks &= ~(1ULL << i);
+                            e1 &= ~(1ULL << i);
                             break;
                         }
                         t.frameCount = t.buffer.frameCount;
@@ -1714,9 +1737,9 @@ void AudioMixer::process__genericNoResampling(state_t* state, int64_t pts)
     // release each track's buffer
     e0 = enabledTracks;
     while (e0) {
-        const int i = 31 - __builtin_clz(e0);
-        e0 &= ~(1<<i);
-        track_t& t = state->tracks[i];
+        const int i = 63 - __builtin_clzll(e0);
+        e0 &= ~(1ULL << i);
+        track_t& t = *state->tracks[i];
         t.bufferProvider->releaseBuffer(&t.buffer);
     }
 }
@@ -1730,29 +1753,29 @@ void AudioMixer::process__genericResampling(state_t* state, int64_t pts)
     int32_t* const outTemp = state->outputTemp;
     size_t numFrames = state->frameCount;
 
-    uint32_t e0 = state->enabledTracks;
+    uint64_t e0 = state->enabledTracks;
     while (e0) {
         // process by group of tracks with same output buffer
         // to optimize cache use
-        uint32_t e1 = e0, e2 = e0;
-        int j = 31 - __builtin_clz(e1);
-        track_t& t1 = state->tracks[j];
-        e2 &= ~(1<<j);
+        uint64_t e1 = e0, e2 = e0;
+        int j = 63 - __builtin_clzll(e1);
+        track_t& t1 = *state->tracks[j];
+        e2 &= ~(1ULL << j);
         while (e2) {
-            j = 31 - __builtin_clz(e2);
-            e2 &= ~(1<<j);
-            track_t& t2 = state->tracks[j];
+            j = 63 - __builtin_clzll(e2);
+            e2 &= ~(1ULL << j);
+            track_t& t2 = *state->tracks[j];
             if (CC_UNLIKELY(t2.mainBuffer != t1.mainBuffer)) {
-                e1 &= ~(1<<j);
+                e1 &= ~(1ULL << j);
             }
         }
         e0 &= ~(e1);
         int32_t *out = t1.mainBuffer;
         memset(outTemp, 0, sizeof(*outTemp) * t1.mMixerChannelCount * state->frameCount);
         while (e1) {
-            const int i = 31 - __builtin_clz(e1);
-            e1 &= ~(1<<i);
-            track_t& t = state->tracks[i];
+            const int i = 63 - __builtin_clzll(e1);
+            e1 &= ~(1ULL << i);
+            track_t& t = *state->tracks[i];
             int32_t *aux = NULL;
             if (CC_UNLIKELY(t.needs & NEEDS_AUX)) {
                 aux = t.auxBuffer;
@@ -1805,9 +1828,9 @@ void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state,
     // one bit set.  The asserts below would verify this, but are commented out
     // since the whole point of this method is to optimize performance.
     //ALOG_ASSERT(0 != state->enabledTracks, "no tracks enabled");
-    const int i = 31 - __builtin_clz(state->enabledTracks);
-    //ALOG_ASSERT((1 << i) == state->enabledTracks, "more than 1 track enabled");
-    const track_t& t = state->tracks[i];
+    const int i = 63 - __builtin_clzll(state->enabledTracks);
+    //ALOG_ASSERT((1ULL << i) == state->enabledTracks, "more than 1 track enabled");
+    const track_t& t = *state->tracks[i];
 
     AudioBufferProvider::Buffer& b(t.buffer);
 
@@ -2048,9 +2071,9 @@ void AudioMixer::process_NoResampleOneTrack(state_t* state, int64_t pts)
 {
     ALOGVV("process_NoResampleOneTrack\n");
     // CLZ is faster than CTZ on ARM, though really not sure if true after 31 - clz.
-    const int i = 31 - __builtin_clz(state->enabledTracks);
-    ALOG_ASSERT((1 << i) == state->enabledTracks, "more than 1 track enabled");
-    track_t *t = &state->tracks[i];
+    const int i = 63 - __builtin_clzll(state->enabledTracks);
+    ALOG_ASSERT((1ULL << i) == state->enabledTracks, "more than 1 track enabled");
+    track_t *t = state->tracks[i];
     const uint32_t channels = t->mMixerChannelCount;
     TO* out = reinterpret_cast<TO*>(t->mainBuffer);
     TA* aux = reinterpret_cast<TA*>(t->auxBuffer);
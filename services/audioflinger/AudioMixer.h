@@ -49,9 +49,9 @@ public:
     /*virtual*/             ~AudioMixer();  // non-virtual saves a v-table, restore if sub-classed
 
 
-    // This mixer has a hard-coded upper limit of 32 active track inputs.
-    // Adding support for > 32 tracks would require more than simply changing this value.
-    static const uint32_t MAX_NUM_TRACKS = 32;
+    // This mixer has a hard-coded upper limit of 64 active track inputs,
+    // as track names are tracked in 64-bit masks.
+    static const uint32_t MAX_NUM_TRACKS = 64;
     // maximum number of channels supported by the mixer
 
     // This mixer has a hard-coded upper limit of 8 channels for output.
@@ -132,7 +132,7 @@ public:
     void        setBufferProvider(int name, AudioBufferProvider* bufferProvider);
     void        process(int64_t pts);
 
-    uint32_t    trackNames() const { return mTrackNames; }
+    uint64_t    trackNames() const { return mTrackNames; }
 
     size_t      getUnreleasedFrames(int name) const;
 
@@ -255,18 +255,22 @@ private:
 
     typedef void (*process_hook_t)(state_t* state, int64_t pts);
 
+    // alignment of each dynamically allocated track_t slot
+    static const size_t kTrackAlignment = 64;
+
     // pad to 32-bytes to fill cache line
     struct state_t {
-        uint32_t        enabledTracks;
-        uint32_t        needsChanged;
+        uint64_t        enabledTracks;
+        uint64_t        needsChanged;
         size_t          frameCount;
         process_hook_t  hook;   // one of process__*, never NULL
         int32_t         *outputTemp;
         int32_t         *resampleTemp;
         NBLog::Writer*  mLog;
         int32_t         reserved[1];
-        // FIXME allocate dynamically to save some memory when maxNumTracks < MAX_NUM_TRACKS
-        track_t         tracks[MAX_NUM_TRACKS] __attribute__((aligned(32)));
+        // Slots are allocated by getTrackName() on first use of a name and kept
+        // until the mixer is destroyed; NULL for names that were never used.
+        track_t*        tracks[MAX_NUM_TRACKS] __attribute__((aligned(32)));
     };
 
     // Base AudioBufferProvider class used for DownMixerBufferProvider, RemixBufferProvider,
@@ -376,11 +380,11 @@ private:
     };
 
     // bitmask of allocated track names, where bit 0 corresponds to TRACK0 etc.
-    uint32_t        mTrackNames;
+    uint64_t        mTrackNames;
 
     // bitmask of configured track names; ~0 if maxNumTracks == MAX_NUM_TRACKS,
     // but will have fewer bits set if maxNumTracks < MAX_NUM_TRACKS
-    const uint32_t  mConfiguredNames;
+    const uint64_t  mConfiguredNames;
 
     const uint32_t  mSampleRate;
 
@@ -392,7 +396,7 @@ private:
 
     // Call after changing either the enabled status of a track, or parameters of an enabled track.
     // OK to call more often than that, but unnecessary.
-    void invalidateState(uint32_t mask);
+    void invalidateState(uint64_t mask);
 
     bool setChannelMasks(int name,
             audio_channel_mask_t trackChannelMask, audio_channel_mask_t mixerChannelMask);
@@ -22,6 +22,8 @@
 #include <sys/types.h>
 #include <cutils/log.h>
 #include <cutils/properties.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
 #include <audio_utils/primitives.h>
 #include "AudioResampler.h"
 #include "AudioResamplerSinc.h"
@@ -34,7 +36,6 @@
 
 #ifdef SPEEX_RESAMPLER
 #include "AudioResamplerSpeex.h"
-#include <utils/threads.h>
 #endif
 
 #ifdef __arm__
@@ -308,6 +309,88 @@ AudioResampler* AudioResampler::create(audio_format_t format, int inChannelCount
     return resampler;
 }
 
+// Conversions passed to precomputeFilter(), the filters are designed one at a time
+// by precomputeThread(), which exits when there are none left.
+struct FilterRequest {
+    audio_format_t format;
+    int32_t inSampleRate;
+    int32_t outSampleRate;
+    AudioResampler::src_quality quality;
+};
+
+static pthread_mutex_t precomputeMutex = PTHREAD_MUTEX_INITIALIZER;
+static Vector<FilterRequest> precomputeRequests;
+static bool precomputeRunning = false;
+
+static void* precomputeThread(void* /* arg */)
+{
+    androidSetThreadPriority(0, ANDROID_PRIORITY_BACKGROUND);
+
+    pthread_mutex_lock(&precomputeMutex);
+    while (!precomputeRequests.isEmpty()) {
+        const FilterRequest request = precomputeRequests[0];
+        precomputeRequests.removeAt(0);
+        pthread_mutex_unlock(&precomputeMutex);
+
+        // same resampler types as AudioResampler::create()
+        if (request.format == AUDIO_FORMAT_PCM_FLOAT) {
+            AudioResamplerDyn<float, float, float>::precomputeFilter(
+                    request.quality, request.inSampleRate, request.outSampleRate);
+        } else if (request.quality == AudioResampler::DYN_HIGH_QUALITY) {
+            AudioResamplerDyn<int32_t, int16_t, int32_t>::precomputeFilter(
+                    request.quality, request.inSampleRate, request.outSampleRate);
+        } else {
+            AudioResamplerDyn<int16_t, int16_t, int32_t>::precomputeFilter(
+                    request.quality, request.inSampleRate, request.outSampleRate);
+        }
+
+        pthread_mutex_lock(&precomputeMutex);
+    }
+    precomputeRunning = false;
+    pthread_mutex_unlock(&precomputeMutex);
+    return NULL;
+}
+
+void AudioResampler::precomputeFilter(audio_format_t format, int32_t inSampleRate,
+        int32_t outSampleRate, src_quality quality)
+{
+    if (quality == DEFAULT_QUALITY) {
+        int ok = pthread_once(&once_control, init_routine);
+        if (ok != 0) {
+            ALOGE("%s pthread_once failed: %d", __func__, ok);
+        }
+        // the target quality of create(), before any CPU load throttling.
+        quality = defaultQuality == DEFAULT_QUALITY ? DYN_MED_QUALITY : defaultQuality;
+    }
+    if (quality != DYN_LOW_QUALITY && quality != DYN_MED_QUALITY
+            && quality != DYN_HIGH_QUALITY) {
+        return;
+    }
+
+    FilterRequest request;
+    request.format = format;
+    request.inSampleRate = inSampleRate;
+    request.outSampleRate = outSampleRate;
+    request.quality = quality;
+
+    pthread_mutex_lock(&precomputeMutex);
+    precomputeRequests.add(request);
+    if (!precomputeRunning) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        precomputeRunning = pthread_create(&thread, &attr, precomputeThread, NULL) == 0;
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_unlock(&precomputeMutex);
+}
+
+void AudioResampler::dumpFilterCache(int fd)
+{
+    DynFilterCache::dump(fd);
+}
+
 #ifdef SPEEX_RESAMPLER
 int32_t AudioResampler::checkRate(int32_t outRate, int32_t inRate) {
     static AudioResampler *resampler = NULL;
@@ -58,6 +58,15 @@ public:
     static AudioResampler* create(audio_format_t format, int inChannelCount,
             int32_t sampleRate, src_quality quality=DEFAULT_QUALITY);
 
+    // Designs the filter that create() would use for this conversion on a background
+    // thread, so that it is already in the filter cache when a track needs it.
+    // Does nothing for qualities that have no shared filters.
+    static void precomputeFilter(audio_format_t format, int32_t inSampleRate,
+            int32_t outSampleRate, src_quality quality=DEFAULT_QUALITY);
+
+    // Dumps the size and hit rate of the filter cache.
+    static void dumpFilterCache(int fd);
+
 #ifdef SPEEX_RESAMPLER
     static int32_t checkRate(int32_t outRate, int32_t inRate);
     virtual int32_t checkCRate(int32_t outRate, int32_t inRate) const;
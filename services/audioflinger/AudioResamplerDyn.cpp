@@ -18,6 +18,8 @@
 //#define LOG_NDEBUG 0
 
 #include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <dlfcn.h>
@@ -26,6 +28,7 @@
 #include <cutils/compiler.h>
 #include <cutils/properties.h>
 #include <utils/Debug.h>
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
 #include <audio_utils/primitives.h>
 
@@ -167,7 +170,7 @@ AudioResamplerDyn<TC, TI, TO>::AudioResamplerDyn(
         int inChannelCount, int32_t sampleRate, src_quality quality)
     : AudioResampler(inChannelCount, sampleRate, quality),
       mResampleFunc(0), mFilterSampleRate(0), mFilterQuality(DEFAULT_QUALITY),
-    mCoefBuffer(NULL)
+    mFilterBank(NULL)
 {
     mVolumeSimd[0] = mVolumeSimd[1] = 0;
     // The AudioResampler base class assumes we are always ready for 1:1 resampling.
@@ -180,7 +183,7 @@ AudioResamplerDyn<TC, TI, TO>::AudioResamplerDyn(
 template<typename TC, typename TI, typename TO>
 AudioResamplerDyn<TC, TI, TO>::~AudioResamplerDyn()
 {
-    free(mCoefBuffer);
+    DynFilterCache::release(mFilterBank);
 }
 
 template<typename TC, typename TI, typename TO>
@@ -209,70 +212,196 @@ template<typename T> T max(T a, T b) {return a > b ? a : b;}
 
 template<typename T> T absdiff(T a, T b) {return a > b ? a - b : b - a;}
 
+// recursive gcd. Using objdump, it appears the tail recursion is converted to a while loop.
+static int gcd(int n, int m)
+{
+    if (m == 0) {
+        return n;
+    }
+    return gcd(m, n % m);
+}
+
+static bool isClose(int32_t newSampleRate, int32_t prevSampleRate,
+        int32_t filterSampleRate, int32_t outSampleRate)
+{
+
+    // different upsampling ratios do not need a filter change.
+    if (filterSampleRate != 0
+            && filterSampleRate < outSampleRate
+            && newSampleRate < outSampleRate)
+        return true;
+
+    // check design criteria again if downsampling is detected.
+    int pdiff = absdiff(newSampleRate, prevSampleRate);
+    int adiff = absdiff(newSampleRate, filterSampleRate);
+
+    // allow up to 6% relative change increments.
+    // allow up to 12% absolute change increments (from filter design)
+    return pdiff < prevSampleRate>>4 && adiff < filterSampleRate>>3;
+}
+
+template<typename TC, typename TI, typename TO>
+uint64_t AudioResamplerDyn<TC, TI, TO>::filterKey(src_quality quality,
+        int inSampleRate, int outSampleRate)
+{
+    // the sample rates are reduced by their gcd, so they fit easily.
+    ALOG_ASSERT(inSampleRate < (1 << 24) && outSampleRate < (1 << 24));
+    const uint64_t coefType = is_same<TC, float>::value ? 2 : sizeof(TC) == sizeof(int32_t);
+    return coefType << 56 | static_cast<uint64_t>(quality) << 48
+            | static_cast<uint64_t>(inSampleRate) << 24 | outSampleRate;
+}
+
+// designs the filter for the sample rates reduced by their gcd.
 template<typename TC, typename TI, typename TO>
-void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
-        double stopBandAtten, int inSampleRate, int outSampleRate, double tbwCheat)
+DynFilterBank* AudioResamplerDyn<TC, TI, TO>::createKaiserFir(src_quality quality,
+        int inSampleRate, int outSampleRate)
 {
+    // Begin Kaiser Filter computation
+    //
+    // The quantization floor for S16 is about 96db - 10*log_10(#length) + 3dB.
+    // Keep the stop band attenuation no greater than 84-85dB for 32 length S16 filters
+    //
+    // For s32 we keep the stop band attenuation at the same as 16b resolution, about
+    // 96-98dB
+    //
+
+    double stopBandAtten;
+    double tbwCheat = 1.; // how much we "cheat" into aliasing
+    int halfLength;
+    if (quality == DYN_HIGH_QUALITY) {
+        // 32b coefficients, 64 length
+        stopBandAtten = 98.;
+        if (inSampleRate >= outSampleRate * 4) {
+            halfLength = 48;
+        } else if (inSampleRate >= outSampleRate * 2) {
+            halfLength = 40;
+        } else {
+            halfLength = 32;
+        }
+    } else if (quality == DYN_LOW_QUALITY) {
+        // 16b coefficients, 16-32 length
+        stopBandAtten = 80.;
+        if (inSampleRate >= outSampleRate * 4) {
+            halfLength = 24;
+        } else if (inSampleRate >= outSampleRate * 2) {
+            halfLength = 16;
+        } else {
+            halfLength = 8;
+        }
+        if (inSampleRate <= outSampleRate) {
+            tbwCheat = 1.05;
+        } else {
+            tbwCheat = 1.03;
+        }
+    } else { // DYN_MED_QUALITY
+        // 16b coefficients, 32-64 length
+        // note: > 64 length filters with 16b coefs can have quantization noise problems
+        stopBandAtten = 84.;
+        if (inSampleRate >= outSampleRate * 4) {
+            halfLength = 32;
+        } else if (inSampleRate >= outSampleRate * 2) {
+            halfLength = 24;
+        } else {
+            halfLength = 16;
+        }
+        if (inSampleRate <= outSampleRate) {
+            tbwCheat = 1.03;
+        } else {
+            tbwCheat = 1.01;
+        }
+    }
+
+    // determine the number of polyphases in the filterbank.
+    // for 16b, it is desirable to have 2^(16/2) = 256 phases.
+    // https://ccrma.stanford.edu/~jos/resample/Relation_Interpolation_Error_Quantization.html
+    //
+    // We are a bit more lax on this.
+
+    int phases = outSampleRate / gcd(outSampleRate, inSampleRate);
+
+    // TODO: Once dynamic sample rate change is an option, the code below
+    // should be modified to execute only when dynamic sample rate change is enabled.
+    //
+    // as above, #phases less than 63 is too few phases for accurate linear interpolation.
+    // we increase the phases to compensate, but more phases means more memory per
+    // filter and more time to compute the filter.
+    //
+    // if we know that the filter will be used for dynamic sample rate changes,
+    // that would allow us skip this part for fixed sample rate resamplers.
+    //
+    while (phases<63) {
+        phases *= 2; // this code only needed to support dynamic rate changes
+    }
+
+    if (phases>=256) {  // too many phases, always interpolate
+        phases = 127;
+    }
+
+    // create the filter
+    DynFilterBank* bank = new DynFilterBank;
+    bank->mKey = 0;
+    bank->mRefCount = 0;
+    bank->mLastUsed = 0;
+    bank->mL = phases;
+    bank->mHalfNumCoefs = halfLength;
+    bank->mSize = (phases+1)*halfLength*sizeof(TC);
+
     TC* buf = NULL;
     static const double atten = 0.9998;   // to avoid ripple overflow
     double fcr;
-    double tbw = firKaiserTbw(c.mHalfNumCoefs, stopBandAtten);
+    double tbw = firKaiserTbw(halfLength, stopBandAtten);
 
-    (void)posix_memalign(reinterpret_cast<void**>(&buf), 32, (c.mL+1)*c.mHalfNumCoefs*sizeof(TC));
+    (void)posix_memalign(reinterpret_cast<void**>(&buf), 32, bank->mSize);
     if (inSampleRate < outSampleRate) { // upsample
         fcr = max(0.5*tbwCheat - tbw/2, tbw/2);
     } else { // downsample
         fcr = max(0.5*tbwCheat*outSampleRate/inSampleRate - tbw/2, tbw/2);
     }
     // create and set filter
-    firKaiserGen(buf, c.mL, c.mHalfNumCoefs, stopBandAtten, fcr, atten);
-    c.mFirCoefs = buf;
-    if (mCoefBuffer) {
-        free(mCoefBuffer);
-    }
-    mCoefBuffer = buf;
+    firKaiserGen(buf, phases, halfLength, stopBandAtten, fcr, atten);
+    bank->mCoefs = buf;
 #ifdef DEBUG_RESAMPLER
     // print basic filter stats
     printf("L:%d  hnc:%d  stopBandAtten:%lf  fcr:%lf  atten:%lf  tbw:%lf\n",
-            c.mL, c.mHalfNumCoefs, stopBandAtten, fcr, atten, tbw);
+            phases, halfLength, stopBandAtten, fcr, atten, tbw);
     // test the filter and report results
-    double fp = (fcr - tbw/2)/c.mL;
-    double fs = (fcr + tbw/2)/c.mL;
+    double fp = (fcr - tbw/2)/phases;
+    double fs = (fcr + tbw/2)/phases;
     double passMin, passMax, passRipple;
     double stopMax, stopRipple;
-    testFir(buf, c.mL, c.mHalfNumCoefs, fp, fs, /*passSteps*/ 1000, /*stopSteps*/ 100000,
+    testFir(buf, phases, halfLength, fp, fs, /*passSteps*/ 1000, /*stopSteps*/ 100000,
             passMin, passMax, passRipple, stopMax, stopRipple);
     printf("passband(%lf, %lf): %.8lf %.8lf %.8lf\n", 0., fp, passMin, passMax, passRipple);
     printf("stopband(%lf, %lf): %.8lf %.3lf\n", fs, 0.5, stopMax, stopRipple);
 #endif
+    return bank;
 }
 
-// recursive gcd. Using objdump, it appears the tail recursion is converted to a while loop.
-static int gcd(int n, int m)
+template<typename TC, typename TI, typename TO>
+DynFilterBank* AudioResamplerDyn<TC, TI, TO>::acquireFilter(src_quality quality,
+        int inSampleRate, int outSampleRate)
 {
-    if (m == 0) {
-        return n;
+    // filters only depend on the conversion ratio.
+    const int divisor = gcd(outSampleRate, inSampleRate);
+    inSampleRate /= divisor;
+    outSampleRate /= divisor;
+
+    const uint64_t key = filterKey(quality, inSampleRate, outSampleRate);
+    DynFilterBank* bank = DynFilterCache::acquire(key);
+    if (bank == NULL) {
+        // designed without holding the cache lock, as it may take milliseconds.
+        bank = createKaiserFir(quality, inSampleRate, outSampleRate);
+        bank->mKey = key;
+        bank = DynFilterCache::add(bank);
     }
-    return gcd(m, n % m);
+    return bank;
 }
 
-static bool isClose(int32_t newSampleRate, int32_t prevSampleRate,
-        int32_t filterSampleRate, int32_t outSampleRate)
+template<typename TC, typename TI, typename TO>
+void AudioResamplerDyn<TC, TI, TO>::precomputeFilter(src_quality quality,
+        int32_t inSampleRate, int32_t outSampleRate)
 {
-
-    // different upsampling ratios do not need a filter change.
-    if (filterSampleRate != 0
-            && filterSampleRate < outSampleRate
-            && newSampleRate < outSampleRate)
-        return true;
-
-    // check design criteria again if downsampling is detected.
-    int pdiff = absdiff(newSampleRate, prevSampleRate);
-    int adiff = absdiff(newSampleRate, filterSampleRate);
-
-    // allow up to 6% relative change increments.
-    // allow up to 12% absolute change increments (from filter design)
-    return pdiff < prevSampleRate>>4 && adiff < filterSampleRate>>3;
+    DynFilterCache::release(acquireFilter(quality, inSampleRate, outSampleRate));
 }
 
 template<typename TC, typename TI, typename TO>
@@ -284,7 +413,6 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
     int32_t oldSampleRate = mInSampleRate;
     int32_t oldHalfNumCoefs = mConstants.mHalfNumCoefs;
     uint32_t oldPhaseWrapLimit = mConstants.mL << mConstants.mShift;
-    bool useS32 = false;
 
     mInSampleRate = inSampleRate;
 
@@ -295,95 +423,14 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
         mFilterSampleRate = inSampleRate;
         mFilterQuality = getQuality();
 
-        // Begin Kaiser Filter computation
-        //
-        // The quantization floor for S16 is about 96db - 10*log_10(#length) + 3dB.
-        // Keep the stop band attenuation no greater than 84-85dB for 32 length S16 filters
-        //
-        // For s32 we keep the stop band attenuation at the same as 16b resolution, about
-        // 96-98dB
-        //
-
-        double stopBandAtten;
-        double tbwCheat = 1.; // how much we "cheat" into aliasing
-        int halfLength;
-        if (mFilterQuality == DYN_HIGH_QUALITY) {
-            // 32b coefficients, 64 length
-            useS32 = true;
-            stopBandAtten = 98.;
-            if (inSampleRate >= mSampleRate * 4) {
-                halfLength = 48;
-            } else if (inSampleRate >= mSampleRate * 2) {
-                halfLength = 40;
-            } else {
-                halfLength = 32;
-            }
-        } else if (mFilterQuality == DYN_LOW_QUALITY) {
-            // 16b coefficients, 16-32 length
-            useS32 = false;
-            stopBandAtten = 80.;
-            if (inSampleRate >= mSampleRate * 4) {
-                halfLength = 24;
-            } else if (inSampleRate >= mSampleRate * 2) {
-                halfLength = 16;
-            } else {
-                halfLength = 8;
-            }
-            if (inSampleRate <= mSampleRate) {
-                tbwCheat = 1.05;
-            } else {
-                tbwCheat = 1.03;
-            }
-        } else { // DYN_MED_QUALITY
-            // 16b coefficients, 32-64 length
-            // note: > 64 length filters with 16b coefs can have quantization noise problems
-            useS32 = false;
-            stopBandAtten = 84.;
-            if (inSampleRate >= mSampleRate * 4) {
-                halfLength = 32;
-            } else if (inSampleRate >= mSampleRate * 2) {
-                halfLength = 24;
-            } else {
-                halfLength = 16;
-            }
-            if (inSampleRate <= mSampleRate) {
-                tbwCheat = 1.03;
-            } else {
-                tbwCheat = 1.01;
-            }
-        }
-
-        // determine the number of polyphases in the filterbank.
-        // for 16b, it is desirable to have 2^(16/2) = 256 phases.
-        // https://ccrma.stanford.edu/~jos/resample/Relation_Interpolation_Error_Quantization.html
-        //
-        // We are a bit more lax on this.
-
-        int phases = mSampleRate / gcd(mSampleRate, inSampleRate);
-
-        // TODO: Once dynamic sample rate change is an option, the code below
-        // should be modified to execute only when dynamic sample rate change is enabled.
-        //
-        // as above, #phases less than 63 is too few phases for accurate linear interpolation.
-        // we increase the phases to compensate, but more phases means more memory per
-        // filter and more time to compute the filter.
-        //
-        // if we know that the filter will be used for dynamic sample rate changes,
-        // that would allow us skip this part for fixed sample rate resamplers.
-        //
-        while (phases<63) {
-            phases *= 2; // this code only needed to support dynamic rate changes
-        }
+        // get the filter from the filter cache, designing it if needed.
+        DynFilterBank* bank = acquireFilter(mFilterQuality, inSampleRate, mSampleRate);
+        DynFilterCache::release(mFilterBank);
+        mFilterBank = bank;
 
-        if (phases>=256) {  // too many phases, always interpolate
-            phases = 127;
-        }
-
-        // create the filter
-        mConstants.set(phases, halfLength, inSampleRate, mSampleRate);
-        createKaiserFir(mConstants, stopBandAtten,
-                inSampleRate, mSampleRate, tbwCheat);
-    } // End Kaiser filter
+        mConstants.set(bank->mL, bank->mHalfNumCoefs, inSampleRate, mSampleRate);
+        mConstants.mFirCoefs = static_cast<const TC*>(bank->mCoefs);
+    }
 
     // update phase and state based on the new filter.
     const Constants& c(mConstants);
@@ -472,7 +519,7 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
 #ifdef DEBUG_RESAMPLER
     printf("channels:%d  %s  stride:%d  %s  coef:%d  shift:%d\n",
             mChannelCount, locked ? "locked" : "interpolated",
-            stride, useS32 ? "S32" : "S16", 2*c.mHalfNumCoefs, c.mShift);
+            stride, sizeof(TC) == sizeof(int32_t) ? "S32" : "S16", 2*c.mHalfNumCoefs, c.mShift);
 #endif
 }
 
@@ -612,6 +659,123 @@ resample_exit:
     mPhaseFraction = phaseFraction;
 }
 
+/* DynFilterCache
+ *
+ * The filter banks are kept by key in gFilterCache. Banks in use are never
+ * evicted; unused banks are evicted least recently used first.
+ */
+static pthread_mutex_t gFilterCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static KeyedVector<uint64_t, DynFilterBank*> gFilterCache;
+static uint32_t gFilterCacheClock;
+static uint32_t gFilterCacheHits;
+static uint32_t gFilterCacheMisses;
+
+/*static*/
+DynFilterBank* DynFilterCache::acquire(uint64_t key)
+{
+    DynFilterBank* bank = NULL;
+    pthread_mutex_lock(&gFilterCacheLock);
+    ssize_t index = gFilterCache.indexOfKey(key);
+    if (index >= 0) {
+        bank = gFilterCache.valueAt(index);
+        bank->mRefCount++;
+        bank->mLastUsed = ++gFilterCacheClock;
+        gFilterCacheHits++;
+    }
+    pthread_mutex_unlock(&gFilterCacheLock);
+    return bank;
+}
+
+/*static*/
+DynFilterBank* DynFilterCache::add(DynFilterBank* bank)
+{
+    pthread_mutex_lock(&gFilterCacheLock);
+    ssize_t index = gFilterCache.indexOfKey(bank->mKey);
+    if (index >= 0) {
+        free(bank->mCoefs);
+        delete bank;
+        bank = gFilterCache.valueAt(index);
+    } else {
+        gFilterCache.add(bank->mKey, bank);
+    }
+    bank->mRefCount++;
+    bank->mLastUsed = ++gFilterCacheClock;
+    gFilterCacheMisses++;
+    pthread_mutex_unlock(&gFilterCacheLock);
+    return bank;
+}
+
+/*static*/
+void DynFilterCache::release(DynFilterBank* bank)
+{
+    if (bank == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&gFilterCacheLock);
+    LOG_ALWAYS_FATAL_IF(bank->mRefCount <= 0, "filter bank %#llx released too often",
+            (unsigned long long)bank->mKey);
+    if (--bank->mRefCount == 0) {
+        evict_l();
+    }
+    pthread_mutex_unlock(&gFilterCacheLock);
+}
+
+/*static*/
+void DynFilterCache::evict_l()
+{
+    size_t unusedBytes = 0;
+    for (size_t i = 0; i < gFilterCache.size(); ++i) {
+        const DynFilterBank* bank = gFilterCache.valueAt(i);
+        if (bank->mRefCount == 0) {
+            unusedBytes += bank->mSize;
+        }
+    }
+    while (unusedBytes > kMaxUnusedBytes) {
+        ssize_t oldest = -1;
+        for (size_t i = 0; i < gFilterCache.size(); ++i) {
+            const DynFilterBank* bank = gFilterCache.valueAt(i);
+            if (bank->mRefCount == 0 && (oldest < 0 || static_cast<int32_t>(
+                    bank->mLastUsed - gFilterCache.valueAt(oldest)->mLastUsed) < 0)) {
+                oldest = i;
+            }
+        }
+        DynFilterBank* bank = gFilterCache.valueAt(oldest);
+        unusedBytes -= bank->mSize;
+        free(bank->mCoefs);
+        delete bank;
+        gFilterCache.removeItemsAt(oldest);
+    }
+}
+
+/*static*/
+void DynFilterCache::dump(int fd)
+{
+    static const char* const kCoefTypes[] = { "s16", "s32", "float" };
+
+    pthread_mutex_lock(&gFilterCacheLock);
+    size_t totalBytes = 0;
+    size_t unusedBytes = 0;
+    for (size_t i = 0; i < gFilterCache.size(); ++i) {
+        const DynFilterBank* bank = gFilterCache.valueAt(i);
+        totalBytes += bank->mSize;
+        if (bank->mRefCount == 0) {
+            unusedBytes += bank->mSize;
+        }
+    }
+    dprintf(fd, "Resampler filter cache: %zu filters, %zu bytes (%zu unused), "
+            "%u hits, %u misses\n", gFilterCache.size(), totalBytes, unusedBytes,
+            gFilterCacheHits, gFilterCacheMisses);
+    for (size_t i = 0; i < gFilterCache.size(); ++i) {
+        const DynFilterBank* bank = gFilterCache.valueAt(i);
+        // see AudioResamplerDyn::filterKey()
+        dprintf(fd, "  %u:%u quality %u %s: %d phases, %u coefs, %zu bytes, %d users\n",
+                (unsigned)(bank->mKey >> 24) & 0xffffff, (unsigned)bank->mKey & 0xffffff,
+                (unsigned)(bank->mKey >> 48) & 0xff, kCoefTypes[(bank->mKey >> 56) & 3],
+                bank->mL, 2*bank->mHalfNumCoefs, bank->mSize, bank->mRefCount);
+    }
+    pthread_mutex_unlock(&gFilterCacheLock);
+}
+
 /* instantiate templates used by AudioResampler::create */
 template class AudioResamplerDyn<float, float, float>;
 template class AudioResamplerDyn<int16_t, int16_t, int32_t>;
@@ -25,6 +25,43 @@
 
 namespace android {
 
+/* DynFilterBank
+ *
+ * A polyphase filter bank designed by AudioResamplerDyn. The filter only depends on the
+ * reduced conversion ratio, the quality and the coefficient type, so filter banks are kept
+ * in a process-wide cache and shared by reference between all resamplers that use them.
+ */
+struct DynFilterBank {
+    uint64_t mKey;              // see AudioResamplerDyn::filterKey()
+    int32_t mRefCount;          // number of resamplers using the filter
+    uint32_t mLastUsed;         // for evicting the least recently used unused filters
+    int mL;                     // interpolation phases in the filter.
+    unsigned int mHalfNumCoefs; // filter half #coefs
+    void* mCoefs;               // (mL + 1) * mHalfNumCoefs coefficients
+    size_t mSize;               // size of mCoefs in bytes
+};
+
+class DynFilterCache {
+public:
+    // Returns the filter bank stored under key with a reference added, or NULL.
+    static DynFilterBank* acquire(uint64_t key);
+
+    // Adds a newly designed filter bank and returns it with a reference added.
+    // If another thread added the same filter first, bank is deleted and the
+    // cached filter bank is returned instead.
+    static DynFilterBank* add(DynFilterBank* bank);
+
+    // Releases a reference. Unused filters stay cached, within kMaxUnusedBytes.
+    static void release(DynFilterBank* bank);
+
+    static void dump(int fd);
+
+private:
+    static const size_t kMaxUnusedBytes = 256 * 1024;
+
+    static void evict_l();
+};
+
 /* AudioResamplerDyn
  *
  * This class template is used for floating point and integer resamplers.
@@ -55,6 +92,10 @@ public:
     virtual void resample(int32_t* out, size_t outFrameCount,
             AudioBufferProvider* provider);
 
+    // Designs the filter for this conversion into the filter cache, if it is not there yet.
+    static void precomputeFilter(src_quality quality, int32_t inSampleRate,
+            int32_t outSampleRate);
+
 private:
 
     class Constants { // stores the filter constants.
@@ -107,8 +148,15 @@ private:
         size_t mStateCount; // size of state in units of TI.
     };
 
-    void createKaiserFir(Constants &c, double stopBandAtten,
-            int inSampleRate, int outSampleRate, double tbwCheat);
+    static uint64_t filterKey(src_quality quality, int inSampleRate, int outSampleRate);
+
+    static DynFilterBank* createKaiserFir(src_quality quality,
+            int inSampleRate, int outSampleRate);
+
+    // Returns the filter for this conversion from the filter cache, designing it on a miss.
+    // Must be released with DynFilterCache::release().
+    static DynFilterBank* acquireFilter(src_quality quality,
+            int inSampleRate, int outSampleRate);
 
     template<int CHANNELS, bool LOCKED, int STRIDE>
     void resample(TO* out, size_t outFrameCount, AudioBufferProvider* provider);
@@ -124,7 +172,7 @@ private:
      resample_ABP_t mResampleFunc;     // called function for resampling
             int32_t mFilterSampleRate; // designed filter sample rate.
         src_quality mFilterQuality;    // designed filter quality.
-              void* mCoefBuffer;       // if a filter is created, this is not null
+      DynFilterBank* mFilterBank;      // if a filter is acquired, this is not null
 };
 
 }; // namespace android
@@ -286,22 +286,41 @@ void AudioFlinger::EffectModule::updateState() {
     }
 }
 
-void AudioFlinger::EffectModule::process()
+// size in bytes of the audio buffer described by a buffer configuration
+static size_t bufferBytes(const buffer_config_t& config)
+{
+    return config.buffer.frameCount * audio_bytes_per_sample((audio_format_t)config.format) *
+            popcount(config.channels);
+}
+
+size_t AudioFlinger::EffectModule::process()
 {
     Mutex::Autolock _l(mLock);
 
     if (mState == DESTROYED || mEffectInterface == NULL ||
             mConfig.inputCfg.buffer.raw == NULL ||
             mConfig.outputCfg.buffer.raw == NULL) {
-        return;
+        return 0;
     }
 
+    size_t inBytes = bufferBytes(mConfig.inputCfg);
+    size_t outBytes = bufferBytes(mConfig.outputCfg);
+    size_t bytes = 0;
+
     if (isProcessEnabled()) {
+        // the engine reads the input and writes the output, reading it too when accumulating
+        bytes = inBytes + outBytes;
+        if (mConfig.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE) {
+            bytes += outBytes;
+        }
+
         // do 32 bit to 16 bit conversion for auxiliary effect input buffer
         if ((mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY) {
             ditherAndClamp(mConfig.inputCfg.buffer.s32,
                                         mConfig.inputCfg.buffer.s32,
                                         mConfig.inputCfg.buffer.frameCount/2);
+            // 32 bit samples read here and cleared after processing
+            bytes += 2 * mConfig.inputCfg.buffer.frameCount * sizeof(int32_t);
         }
 
 #ifdef HW_ACC_EFFECTS
@@ -346,8 +365,10 @@ void AudioFlinger::EffectModule::process()
             for (size_t i = 0; i < frameCnt; i++) {
                 out[i] = clamp16((int32_t)out[i] + (int32_t)in[i]);
             }
+            bytes = inBytes + 2 * outBytes;
         }
     }
+    return bytes;
 }
 
 void AudioFlinger::EffectModule::reset_l()
@@ -1479,12 +1500,15 @@ void AudioFlinger::EffectHandle::dumpToBuffer(char* buffer, size_t size)
 AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
                                         int sessionId)
     : mThread(thread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0), mTailBufferCount(0),
-      mOwnInBuffer(false), mVolumeCtrlIdx(-1), mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
+      mOwnInBuffer(false), mInBufferSilent(false), mVolumeCtrlIdx(-1),
+      mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
 #ifdef QCOM_DIRECTTRACK
-      mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX), mForceVolume(false), mIsForLPATrack(false)
+      mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX), mForceVolume(false), mIsForLPATrack(false),
 #else
-      mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX), mForceVolume(false)
+      mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX), mForceVolume(false),
 #endif
+      mCycleBytes(0), mLastCycleBytes(0), mMaxCycleBytes(0), mTotalCycleBytes(0),
+      mCycleCnt(0), mSilentCycleCnt(0)
 {
     mStrategy = AudioSystem::getStrategyForStream(AUDIO_STREAM_MUSIC);
     if (thread == NULL) {
@@ -1497,7 +1521,7 @@ AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
 AudioFlinger::EffectChain::~EffectChain()
 {
     if (mOwnInBuffer) {
-        delete mInBuffer;
+        free(mInBuffer);
     }
 
 }
@@ -1591,7 +1615,14 @@ void AudioFlinger::EffectChain::clearInputBuffer_l(sp<ThreadBase> thread)
     // (4 bytes frame size)
     const size_t frameSize =
             audio_bytes_per_sample(AUDIO_FORMAT_PCM_16_BIT) * min(FCC_2, thread->channelCount());
+
+    // nothing was written to the buffer since it was last cleared
+    if (mInBufferSilent) {
+        return;
+    }
     memset(mInBuffer, 0, thread->frameCount() * frameSize);
+    mCycleBytes += thread->frameCount() * frameSize;
+    mInBufferSilent = true;
 }
 
 // Must be called with EffectChain::mLock locked
@@ -1606,16 +1637,23 @@ void AudioFlinger::EffectChain::process_l()
             (mSessionId == AUDIO_SESSION_OUTPUT_STAGE);
     // never process effects when:
     // - on an OFFLOAD thread
-    // - no more tracks are on the session and the effect tail has been rendered
+    // - no track is active on the session and the effect tail has been rendered:
+    //   the input is silent and effects would only add silence to the output
     bool doProcess = (thread->type() != ThreadBase::OFFLOAD);
+    bool inputSilent = false;
     if (!isGlobalSession) {
         bool tracksOnSession = (trackCnt() != 0);
+        int32_t activeTracks = activeTrackCnt();
 
-        if (!tracksOnSession && mTailBufferCount == 0) {
+        if (activeTracks == 0 && mTailBufferCount == 0) {
             doProcess = false;
+            inputSilent = true;
+        } else if (activeTracks != 0) {
+            // the mixer wrote to the input buffer
+            mInBufferSilent = false;
         }
 
-        if (activeTrackCnt() == 0) {
+        if (activeTracks == 0) {
             // if no track is active and the effect tail has not been rendered,
             // the input buffer must be cleared here as the mixer process will not do it
             if (tracksOnSession || mTailBufferCount > 0) {
@@ -1625,6 +1663,9 @@ void AudioFlinger::EffectChain::process_l()
                 }
             }
         }
+    } else {
+        // the input of a global session is the thread mix buffer, written on every cycle
+        mInBufferSilent = false;
     }
 
     size_t size = mEffects.size();
@@ -1634,12 +1675,29 @@ void AudioFlinger::EffectChain::process_l()
     if (doProcess) {
 #endif
         for (size_t i = 0; i < size; i++) {
-            mEffects[i]->process();
+            size_t bytes = mEffects[i]->process();
+            if (bytes != 0) {
+                // insert effects process in place and auxiliary effects accumulate
+                // into the input buffer
+                mInBufferSilent = false;
+                mCycleBytes += bytes;
+            }
         }
+    } else if (inputSilent) {
+        // only count the cycles where the effects were really skipped
+        mSilentCycleCnt++;
     }
     for (size_t i = 0; i < size; i++) {
         mEffects[i]->updateState();
     }
+
+    mLastCycleBytes = mCycleBytes;
+    if (mCycleBytes > mMaxCycleBytes) {
+        mMaxCycleBytes = mCycleBytes;
+    }
+    mTotalCycleBytes += mCycleBytes;
+    mCycleCnt++;
+    mCycleBytes = 0;
 }
 
 // addEffect_l() must be called with PlaybackThread::mLock held
@@ -1918,6 +1976,14 @@ void AudioFlinger::EffectChain::dump(int fd, const Vector<String16>& args)
                 mOutBuffer,
                 mActiveTrackCnt);
         result.append(buffer);
+        result.append("\tBytes per cycle: last    avg     max     Silent cycles:\n");
+        snprintf(buffer, SIZE, "\t                 %-7zu %-7llu %-7zu %u/%u\n",
+                mLastCycleBytes,
+                mCycleCnt != 0 ? (unsigned long long)(mTotalCycleBytes / mCycleCnt) : 0ULL,
+                mMaxCycleBytes,
+                mSilentCycleCnt,
+                mCycleCnt);
+        result.append(buffer);
         write(fd, result.string(), result.size());
 
         for (size_t i = 0; i < numEffects; ++i) {
@@ -2176,7 +2242,6 @@ bool AudioFlinger::applyEffectsOn(void *token, int16_t *inBuffer,
             }
 
             int outFrameCount = (frameCount > DEAFULT_FRAME_COUNT ? DEAFULT_FRAME_COUNT: frameCount);
-            bool isEffectEnabled = false;
             for(i = 0; i < numEffects; i++) {
                 // If effect configuration is changed while applying effects do not process further
                 if(mIsEffectConfigChanged && !force) {
@@ -2190,24 +2255,16 @@ bool AudioFlinger::applyEffectsOn(void *token, int16_t *inBuffer,
                     mLPAEffectChain->unlock();
                     return false;
                 }
-                if(i == 0) {
-                    // For the first set input and output buffers different
-                    isEffectEnabled = effect->isProcessEnabled();
-                    effect->setInBuffer(pIn);
-                    effect->setOutBuffer(pOut);
-                } else {
-                    // For the remaining use previous effect's output buffer as input buffer
-                    effect->setInBuffer(pOut);
-                    effect->setOutBuffer(pOut);
-                }
+                // All effects process in place on the output buffer: the input is copied
+                // there once below instead of clearing the output and having the first
+                // effect accumulate into it.
+                effect->setInBuffer(pOut);
+                effect->setOutBuffer(pOut);
                 // true indicates that it is being applied on LPA output
                 effect->configure(true, mLPASampleRate, mLPANumChannels, outFrameCount);
             }
 
-            if(isEffectEnabled) {
-                // Clear the output buffer
-                memset(pOut, 0, (outFrameCount * mLPANumChannels * sizeof(int16_t)));
-            } else {
+            if(pIn != pOut) {
                 // Copy input buffer content to the output buffer
                 memcpy(pOut, pIn, (outFrameCount * mLPANumChannels * sizeof(int16_t)));
             }
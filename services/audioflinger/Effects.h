@@ -60,7 +60,8 @@ public:
     };
 
     int         id() const { return mId; }
-    void process();
+    // returns the number of audio buffer bytes read or written by the call
+    size_t process();
     void updateState();
     status_t command(uint32_t cmdCode,
                      uint32_t cmdSize,
@@ -313,6 +314,7 @@ public:
     void setInBuffer(int16_t *buffer, bool ownsBuffer = false) {
         mInBuffer = buffer;
         mOwnInBuffer = ownsBuffer;
+        mInBufferSilent = false;
     }
     int16_t *inBuffer() const {
         return mInBuffer;
@@ -329,7 +331,8 @@ public:
     int32_t trackCnt() const { return android_atomic_acquire_load(&mTrackCnt); }
 
     void incActiveTrackCnt() { android_atomic_inc(&mActiveTrackCnt);
-                               mTailBufferCount = mMaxTailBuffers; }
+                               mTailBufferCount = mMaxTailBuffers;
+                               mInBufferSilent = false; }
     void decActiveTrackCnt() { android_atomic_dec(&mActiveTrackCnt); }
     int32_t activeTrackCnt() const { return android_atomic_acquire_load(&mActiveTrackCnt); }
 
@@ -409,6 +412,7 @@ protected:
     int32_t mTailBufferCount;   // current effect tail buffer count
     int32_t mMaxTailBuffers;    // maximum effect tail buffers
     bool mOwnInBuffer;          // true if the chain owns its input buffer
+    bool mInBufferSilent;       // true while the input buffer is known to contain only zeros
     int mVolumeCtrlIdx;         // index of insert effect having control over volume
     uint32_t mLeftVolume;       // previous volume on left channel
     uint32_t mRightVolume;      // previous volume on right channel
@@ -424,4 +428,12 @@ protected:
     // Updated by updateSuspendedSessions_l() only.
     KeyedVector< int, sp<SuspendedEffectDesc> > mSuspendedEffects;
     volatile int32_t mForceVolume; // force next volume command because a new effect was enabled
+
+    // audio buffer bytes read or written by the chain, updated by process_l() for dump()
+    size_t mCycleBytes;         // bytes touched since the start of the current cycle
+    size_t mLastCycleBytes;     // bytes touched during the last cycle
+    size_t mMaxCycleBytes;      // largest number of bytes touched in a cycle
+    uint64_t mTotalCycleBytes;  // bytes touched since the chain was created
+    uint32_t mCycleCnt;         // number of cycles processed
+    uint32_t mSilentCycleCnt;   // number of cycles skipped because the input was silent
 };
@@ -22,6 +22,7 @@
 #include "Configuration.h"
 #include <linux/futex.h>
 #include <sys/syscall.h>
+#include <cutils/atomic.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 #include "FastThread.h"
@@ -51,9 +52,10 @@ FastThread::FastThread() : Thread(false /*canCallJava*/),
 #ifdef FAST_MIXER_STATISTICS
     // oldLoad
     oldLoadValid(false),
-    bounds(0),
-    full(false),
+#ifdef CPU_FREQUENCY_STATISTICS
     // tcu
+    oldCpukHz(0),
+#endif
 #endif
     coldGen(0),
     isWarm(false),
@@ -170,10 +172,6 @@ bool FastThread::threadLoop()
                 warmupCycles = 0;
                 sleepNs = -1;
                 coldGen = current->mColdGen;
-#ifdef FAST_MIXER_STATISTICS
-                bounds = 0;
-                full = false;
-#endif
                 oldTsValid = !clock_gettime(CLOCK_MONOTONIC, &oldTs);
                 timestampStatus = INVALID_OPERATION;
             } else {
@@ -270,14 +268,6 @@ bool FastThread::threadLoop()
                 }
 #ifdef FAST_MIXER_STATISTICS
                 if (isWarm) {
-                    // advance the FIFO queue bounds
-                    size_t i = bounds & (dumpState->mSamplingN - 1);
-                    bounds = (bounds & 0xFFFF0000) | ((bounds + 1) & 0xFFFF);
-                    if (full) {
-                        bounds += 0x10000;
-                    } else if (!(bounds & (dumpState->mSamplingN - 1))) {
-                        full = true;
-                    }
                     // compute the delta value of clock_gettime(CLOCK_MONOTONIC)
                     uint32_t monotonicNs = nsec;
                     if (sec > 0 && sec < 4) {
@@ -311,17 +301,31 @@ bool FastThread::threadLoop()
                     uint32_t kHz = tcu.getCpukHz(cpuNum);
                     kHz = (kHz << 4) | (cpuNum & 0xF);
 #endif
-                    // save values in FIFO queues for dumpsys
-                    // these stores #1, #2, #3 are not atomic with respect to each other,
-                    // or with respect to store #4 below
-                    dumpState->mMonotonicNs[i] = monotonicNs;
-                    dumpState->mLoadNs[i] = loadNs;
+                    // clear the histograms if a dump asked for it
+                    if (android_atomic_acquire_load(&dumpState->mResetStatistics) != 0) {
+                        dumpState->mMonotonicNs.clear();
+                        dumpState->mLoadNs.clear();
 #ifdef CPU_FREQUENCY_STATISTICS
-                    dumpState->mCpukHz[i] = kHz;
+                        dumpState->mCpukHz.clear();
+                        dumpState->mLoadKcycles.clear();
+#endif
+                        android_atomic_release_store(0, &dumpState->mResetStatistics);
+                    }
+                    // accumulate values in histograms for dumpsys
+                    // these updates are not atomic with respect to each other
+                    dumpState->mMonotonicNs.sample(monotonicNs);
+                    dumpState->mLoadNs.sample(loadNs);
+#ifdef CPU_FREQUENCY_STATISTICS
+                    // skip bad kHz samples
+                    if ((kHz & ~0xF) != 0) {
+                        dumpState->mCpukHz.sample(kHz >> 4);
+                        if (kHz == oldCpukHz) {
+                            dumpState->mLoadKcycles.sample((uint32_t)
+                                    (((uint64_t) loadNs * (kHz >> 4)) / 1000000));
+                        }
+                    }
+                    oldCpukHz = kHz;
 #endif
-                    // this store #4 is not atomic with respect to stores #1, #2, #3 above, but
-                    // the newest open & oldest closed halves are atomic with respect to each other
-                    dumpState->mBounds = bounds;
                     ATRACE_INT("cycle_ms", monotonicNs / 1000000);
                     ATRACE_INT("load_us", loadNs / 1000);
                 }
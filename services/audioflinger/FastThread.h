@@ -65,10 +65,9 @@ protected:
 #ifdef FAST_MIXER_STATISTICS
     struct timespec oldLoad;    // previous value of clock_gettime(CLOCK_THREAD_CPUTIME_ID)
     bool oldLoadValid;  // whether oldLoad is valid
-    uint32_t bounds;
-    bool full;          // whether we have collected at least mSamplingN samples
 #ifdef CPU_FREQUENCY_STATISTICS
     ThreadCpuUsage tcu;     // for reading the current CPU clock frequency in kHz
+    uint32_t oldCpukHz;     // previous CPU clock frequency in kHz, bits 0-3 are CPU#
 #endif
 #endif
     unsigned coldGen;   // last observed mColdGen
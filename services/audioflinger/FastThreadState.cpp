@@ -35,7 +35,7 @@ FastThreadDumpState::FastThreadDumpState() :
     /* mMeasuredWarmupTs({0, 0}), */
     mWarmupCycles(0)
 #ifdef FAST_MIXER_STATISTICS
-    , mSamplingN(1), mBounds(0)
+    , mResetStatistics(0)
 #endif
 {
     mMeasuredWarmupTs.tv_sec = 0;
@@ -46,4 +46,16 @@ FastThreadDumpState::~FastThreadDumpState()
 {
 }
 
+#ifdef FAST_MIXER_STATISTICS
+void FastThreadDumpState::mergeStatistics(const FastThreadDumpState& other)
+{
+    mMonotonicNs.merge(other.mMonotonicNs);
+    mLoadNs.merge(other.mLoadNs);
+#ifdef CPU_FREQUENCY_STATISTICS
+    mCpukHz.merge(other.mCpukHz);
+    mLoadKcycles.merge(other.mLoadKcycles);
+#endif
+}
+#endif
+
 }   // namespace android
@@ -20,6 +20,7 @@
 #include "Configuration.h"
 #include <stdint.h>
 #include <media/nbaio/NBLog.h>
+#include "LogLinearHistogram.h"
 
 namespace android {
 
@@ -61,24 +62,22 @@ struct FastThreadDumpState {
     uint32_t mWarmupCycles;     // number of loop cycles required to warmup
 
 #ifdef FAST_MIXER_STATISTICS
-    // Recently collected samples of per-cycle monotonic time, thread CPU time, and CPU frequency.
-    // kSamplingN is max size of sampling frame (statistics), and must be a power of 2 <= 0x8000.
-    // The sample arrays are virtually allocated based on this compile-time constant,
-    // but are only initialized and used based on the runtime parameter mSamplingN.
-    static const uint32_t kSamplingN = 0x8000;
-    // Corresponding runtime maximum size of sample arrays, must be a power of 2 <= kSamplingN.
-    uint32_t mSamplingN;
-    // The bounds define the interval of valid samples, and are represented as follows:
-    //      newest open (excluded) endpoint   = lower 16 bits of bounds, modulo N
-    //      oldest closed (included) endpoint = upper 16 bits of bounds, modulo N
-    // Number of valid samples is newest - oldest.
-    uint32_t mBounds;                   // bounds for mMonotonicNs, mThreadCpuNs, and mCpukHz
-    // The elements in the *Ns arrays are in units of nanoseconds <= 3999999999.
-    uint32_t mMonotonicNs[kSamplingN];  // delta monotonic (wall clock) time
-    uint32_t mLoadNs[kSamplingN];       // delta CPU load in time
+    // Distributions of per-cycle monotonic time, thread CPU time, and CPU frequency, collected
+    // since the thread was created or the statistics were last reset.  Each is a few Kbytes
+    // regardless of how long the thread runs.
+    // The *Ns histograms are in units of nanoseconds <= 3999999999.
+    LogLinearHistogram mMonotonicNs;    // delta monotonic (wall clock) time
+    LogLinearHistogram mLoadNs;         // delta CPU load in time
 #ifdef CPU_FREQUENCY_STATISTICS
-    uint32_t mCpukHz[kSamplingN];       // absolute CPU clock frequency in kHz, bits 0-3 are CPU#
+    LogLinearHistogram mCpukHz;         // absolute CPU clock frequency in kHz
+    LogLinearHistogram mLoadKcycles;    // CPU load in kilocycles, if frequency was unchanged
 #endif
+    // Set to non-zero by a dump to have the fast thread clear the histograms on its next
+    // cycle, which then sets it back to zero.  Accessed with android_atomic_*.
+    volatile int32_t mResetStatistics;
+
+    // Merges the histograms of other into these; should only be called on a stable copy.
+    void mergeStatistics(const FastThreadDumpState& other);
 #endif
 
 };  // struct FastThreadDumpState
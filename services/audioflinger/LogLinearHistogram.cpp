@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include "LogLinearHistogram.h"
+
+namespace android {
+
+void LogLinearHistogram::clear()
+{
+    memset(mBuckets, 0, sizeof(mBuckets));
+    mMaximum = 0;
+}
+
+void LogLinearHistogram::merge(const LogLinearHistogram& other)
+{
+    for (uint32_t i = 0; i < kNumBuckets; ++i) {
+        mBuckets[i] += other.mBuckets[i];
+    }
+    if (other.mMaximum > mMaximum) {
+        mMaximum = other.mMaximum;
+    }
+}
+
+uint64_t LogLinearHistogram::count() const
+{
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < kNumBuckets; ++i) {
+        count += mBuckets[i];
+    }
+    return count;
+}
+
+uint32_t LogLinearHistogram::percentile(double percent) const
+{
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    // the rank of the sample we are looking for, at least 1
+    double rank = total * percent / 100.0;
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < kNumBuckets; ++i) {
+        cumulative += mBuckets[i];
+        if (cumulative > 0 && cumulative >= rank) {
+            uint32_t bound = bucketUpperBound(i);
+            // the maximum is exact, so don't report beyond it
+            return bound < mMaximum ? bound : mMaximum;
+        }
+    }
+    return mMaximum;
+}
+
+/*static*/
+uint32_t LogLinearHistogram::bucketUpperBound(uint32_t index)
+{
+    if (index < kSubBuckets) {
+        return index;
+    }
+    uint32_t shift = index / kSubBuckets - 1;
+    uint32_t subBucket = index % kSubBuckets;
+    uint64_t lower = (uint64_t) (kSubBuckets + subBucket) << shift;
+    return (uint32_t) (lower + ((uint64_t) 1 << shift) - 1);
+}
+
+}   // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ANDROID_AUDIO_LOG_LINEAR_HISTOGRAM_H
+#define ANDROID_AUDIO_LOG_LINEAR_HISTOGRAM_H
+
+#include <stdint.h>
+
+namespace android {
+
+// A fixed-size histogram of 32-bit unsigned values with log-linear buckets: values below
+// kSubBuckets each have their own bucket, and every power of 2 above that is split into
+// kSubBuckets equal buckets, so any value is represented within 1/kSubBuckets (~6%).
+//
+// Like the dump state it is embedded in, it is POD with no locks or barriers.  sample() is
+// intended for a single writer such as a fast thread, and is wait-free.  The buckets are
+// 64-bit so they don't wrap on long-running threads.  Readers must work on a copy and
+// tolerate what a concurrent sample() leaves behind: the buckets and the maximum may be
+// slightly out of step, and on 32-bit CPUs a bucket copied while its low word carries is torn
+// and may be off by 2^32.  A carry needs 2^32 samples in one bucket, which at one sample per
+// millisecond is about 50 days, so the error is rare but a merge() keeps it.
+struct LogLinearHistogram {
+    LogLinearHistogram() { clear(); }
+
+    static const uint32_t kSubBucketBits = 4;
+    static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+    static const uint32_t kNumBuckets = (32 - kSubBucketBits + 1) * kSubBuckets;
+
+    void        clear();
+
+    // Adds the samples of other, e.g. to roll up intervals or combine threads.
+    void        merge(const LogLinearHistogram& other);
+
+    void        sample(uint32_t value) {
+                    mBuckets[bucketIndex(value)]++;
+                    if (value > mMaximum) {
+                        mMaximum = value;
+                    }
+                }
+
+    uint64_t    count() const;
+    uint32_t    maximum() const { return mMaximum; }
+
+    // Returns an upper bound of the value below which the given percentage (0 to 100) of the
+    // samples fall, accurate to the bucket width.  Returns 0 if there are no samples.
+    uint32_t    percentile(double percent) const;
+
+    static uint32_t bucketIndex(uint32_t value) {
+                    if (value < kSubBuckets) {
+                        return value;
+                    }
+                    uint32_t shift = (31 - __builtin_clz(value)) - kSubBucketBits;
+                    return (shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets);
+                }
+
+    // largest value that maps to the bucket at index
+    static uint32_t bucketUpperBound(uint32_t index);
+
+private:
+    uint64_t    mBuckets[kNumBuckets];
+    uint32_t    mMaximum;
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_LOG_LINEAR_HISTOGRAM_H
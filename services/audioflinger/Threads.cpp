@@ -1396,6 +1396,10 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
         mEffectBufferSize(0),
         mEffectBufferFormat(AUDIO_FORMAT_INVALID),
         mEffectBufferValid(false),
+        mMixerToSinkDirect(false),
+        mLastBytesCopied(0),
+        mTotalBytesCopied(0),
+        mNumMixPeriods(0),
         mSuspended(0), mBytesWritten(0),
         mActiveTracksGeneration(0),
         // mStreamTypes[] initialized in constructor body
@@ -1541,6 +1545,9 @@ void AudioFlinger::PlaybackThread::dumpInternals(int fd, const Vector<String16>&
     dprintf(fd, "  Sink buffer : %p\n", mSinkBuffer);
     dprintf(fd, "  Mixer buffer: %p\n", mMixerBuffer);
     dprintf(fd, "  Effect buffer: %p\n", mEffectBuffer);
+    dprintf(fd, "  Mixer to sink direct: %s\n", mMixerToSinkDirect ? "yes" : "no");
+    dprintf(fd, "  Bytes copied per period: last %zu, average %llu\n", mLastBytesCopied,
+            mNumMixPeriods > 0 ? (unsigned long long)(mTotalBytesCopied / mNumMixPeriods) : 0ULL);
     dprintf(fd, "  Fast track availMask=%#x\n", mFastTrackAvailMask);
 
     dumpBase(fd, args);
@@ -2497,9 +2504,11 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
         // Only one effect chain can be present in direct output thread and it uses
         // the sink buffer as input
         if (mType != DIRECT) {
-            size_t numSamples = mNormalFrameCount * mChannelCount;
-            buffer = new int16_t[numSamples];
-            memset(buffer, 0, numSamples * sizeof(int16_t));
+            // aligned like the sink and effect buffers so that effect engines can use
+            // vector loads on the chain input
+            size_t bufferSize = mNormalFrameCount * mChannelCount * sizeof(int16_t);
+            (void)posix_memalign((void **)&buffer, 32, bufferSize);
+            memset(buffer, 0, bufferSize);
             ALOGV("addEffectChain_l() creating new input buffer %p session %d", buffer, session);
             ownsBuffer = true;
         }
@@ -2825,13 +2834,18 @@ bool AudioFlinger::PlaybackThread::threadLoop()
             //
             // mMixerBufferValid is only set true by MixerThread::prepareTracks_l().
             // TODO use sleepTime == 0 as an additional condition.
+            mLastBytesCopied = 0;
+            mNumMixPeriods++;
             if (mMixerBufferValid) {
                 void *buffer = mEffectBufferValid ? mEffectBuffer : mSinkBuffer;
                 audio_format_t format = mEffectBufferValid ? mEffectBufferFormat : mFormat;
 
                 memcpy_by_audio_format(buffer, format, mMixerBuffer, mMixerBufferFormat,
                         mNormalFrameCount * mChannelCount);
+                mLastBytesCopied += mNormalFrameCount * mChannelCount
+                        * audio_bytes_per_sample(format);
             }
+            mTotalBytesCopied += mLastBytesCopied;
 
             mBytesRemaining = mCurrentWriteLength;
             if (isSuspended()) {
@@ -2878,6 +2892,8 @@ bool AudioFlinger::PlaybackThread::threadLoop()
             //ALOGV("writing effect buffer to sink buffer format %#x", mFormat);
             memcpy_by_audio_format(mSinkBuffer, mFormat, mEffectBuffer, mEffectBufferFormat,
                     mNormalFrameCount * mChannelCount);
+            mLastBytesCopied += mNormalFrameCount * mFrameSize;
+            mTotalBytesCopied += mNormalFrameCount * mFrameSize;
         }
 
         // enable changes in effect chain
@@ -3316,8 +3332,6 @@ ssize_t AudioFlinger::MixerThread::threadLoop_write()
 #endif
             }
             state->mCommand = FastMixerState::MIX_WRITE;
-            mFastMixerDumpState.increaseSamplingN(mAudioFlinger->isLowRamDevice() ?
-                    FastMixerDumpState::kSamplingNforLowRamDevice : FastMixerDumpState::kSamplingN);
             sq->end();
             sq->push(FastMixerStateQueue::BLOCK_UNTIL_PUSHED);
             if (kUseFastMixer == FastMixer_Dynamic) {
@@ -3510,6 +3524,11 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
     mMixerBufferValid = false;  // mMixerBuffer has no valid data until appropriate tracks found.
     mEffectBufferValid = false; // mEffectBuffer has no valid data until tracks found.
 
+    // With no effect chains, no track can be routed to an effect buffer, so the
+    // mixer may write the sink format directly instead of going through mMixerBuffer.
+    mMixerToSinkDirect = mMixerBufferEnabled && mEffectChains.isEmpty()
+            && (mFormat == AUDIO_FORMAT_PCM_16_BIT || mFormat == AUDIO_FORMAT_PCM_FLOAT);
+
     for (size_t i=0 ; i<count ; i++) {
         const sp<Track> t = mActiveTracks[i].promote();
         if (t == 0) {
@@ -3868,7 +3887,18 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
              * into it.
              *
              */
-            if (mMixerBufferEnabled
+            if (mMixerToSinkDirect
+                    && (track->mainBuffer() == mSinkBuffer
+                            || track->mainBuffer() == mMixerBuffer)) {
+                mAudioMixer->setParameter(
+                        name,
+                        AudioMixer::TRACK,
+                        AudioMixer::MIXER_FORMAT, (void *)mFormat);
+                mAudioMixer->setParameter(
+                        name,
+                        AudioMixer::TRACK,
+                        AudioMixer::MAIN_BUFFER, (void *)mSinkBuffer);
+            } else if (mMixerBufferEnabled
                     && (track->mainBuffer() == mSinkBuffer
                             || track->mainBuffer() == mMixerBuffer)) {
                 mAudioMixer->setParameter(
@@ -4215,12 +4245,32 @@ void AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>& ar
 
     PlaybackThread::dumpInternals(fd, args);
 
-    dprintf(fd, "  AudioMixer tracks: 0x%08x\n", mAudioMixer->trackNames());
+    dprintf(fd, "  AudioMixer tracks: %#llx\n",
+            (unsigned long long)mAudioMixer->trackNames());
 
     // Make a non-atomic copy of fast mixer dump state so it won't change underneath us
     const FastMixerDumpState copy(mFastMixerDumpState);
     copy.dump(fd);
 
+#ifdef FAST_MIXER_STATISTICS
+    // Roll the earlier intervals up with the current one
+    if (mFastMixerPastStatistics.mMonotonicNs.count() > 0) {
+        FastMixerDumpState total(copy);
+        total.mergeStatistics(mFastMixerPastStatistics);
+        total.dumpStatistics(fd, "Statistics since the thread started");
+    }
+
+    // "--reset-stats" starts a new statistics interval after this dump.  The cycles between
+    // the copy and the fast thread clearing its histograms are not counted in either interval.
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == String16("--reset-stats")) {
+            mFastMixerPastStatistics.mergeStatistics(copy);
+            android_atomic_release_store(1, &mFastMixerDumpState.mResetStatistics);
+            break;
+        }
+    }
+#endif
+
 #ifdef STATE_QUEUE_DUMP
     // Similar for state queue
     StateQueueObserverDump observerCopy = mStateQueueObserverDump;
@@ -5712,10 +5762,6 @@ reacquire_wakelock:
                     }
                 }
                 state->mCommand = FastCaptureState::READ_WRITE;
-#if 0   // FIXME
-                mFastCaptureDumpState.increaseSamplingN(mAudioFlinger->isLowRamDevice() ?
-                        FastCaptureDumpState::kSamplingNforLowRamDevice : FastMixerDumpState::kSamplingN);
-#endif
                 didModify = true;
             }
             audio_track_cblk_t *cblkOld = state->mCblk;
@@ -670,6 +670,19 @@ protected:
     // for any processing (including output processing).
     bool                            mEffectBufferValid;
 
+    // Set by MixerThread::prepareTracks_l() when no effect chain is attached and
+    // the sink format is one the mixer can produce directly (PCM 16 bit or float).
+    // Tracks then accumulate straight into mSinkBuffer, with clamping done in the
+    // mixer's final format conversion, and the mMixerBuffer to mSinkBuffer pass
+    // is skipped.
+    bool                            mMixerToSinkDirect;
+
+    // Bytes written by memcpy_by_audio_format() between the mixer, effect and
+    // sink buffers: during the last mix period, and in total over mNumMixPeriods.
+    size_t                          mLastBytesCopied;
+    uint64_t                        mTotalBytesCopied;
+    uint64_t                        mNumMixPeriods;
+
     // suspend count, > 0 means suspended.  While suspended, the thread continues to pull from
     // tracks and mix, but doesn't write to HAL.  A2DP and SCO HAL implementations can't handle
     // concurrent use of both of them, so Audio Policy Service suspends one of the threads to
@@ -889,6 +902,11 @@ private:
 
                 // contents are not guaranteed to be consistent, no locks required
                 FastMixerDumpState mFastMixerDumpState;
+#ifdef FAST_MIXER_STATISTICS
+                // fast mixer statistics of the intervals before the last reset, only
+                // accessed by dumpInternals()
+                FastThreadDumpState mFastMixerPastStatistics;
+#endif
 #ifdef STATE_QUEUE_DUMP
                 StateQueueObserverDump mStateQueueObserverDump;
                 StateQueueMutatorDump  mStateQueueMutatorDump;
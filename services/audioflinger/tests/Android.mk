@@ -34,6 +34,36 @@ LOCAL_MODULE_TAGS := tests
 
 include $(BUILD_EXECUTABLE)
 
+#
+# NBLog unit test and writer benchmark
+#
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libutils \
+	libcutils \
+	libstlport \
+	libnbaio
+
+LOCAL_STATIC_LIBRARIES := \
+	libgtest \
+	libgtest_main
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/gtest/include \
+	external/stlport/stlport
+
+LOCAL_SRC_FILES := \
+	nblog_tests.cpp
+
+LOCAL_MODULE := nblog_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_EXECUTABLE)
+
 #
 # audio mixer test tool
 #
@@ -15,7 +15,9 @@ mm
 echo "waiting for device"
 adb root && adb wait-for-device remount
 adb push $OUT/system/lib/libaudioresampler.so /system/lib
+adb push $OUT/system/lib/libnbaio.so /system/lib
 adb push $OUT/system/bin/resampler_tests /system/bin
+adb push $OUT/system/bin/nblog_tests /system/bin
 
 sh $ANDROID_BUILD_TOP/frameworks/av/services/audioflinger/tests/run_all_unit_tests.sh
 
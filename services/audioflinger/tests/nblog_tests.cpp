@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_nblog_tests"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <gtest/gtest.h>
+#include <media/nbaio/NBLog.h>
+
+using namespace android;
+
+static const size_t kLogSize = 64 * 1024;
+
+// Dumps everything logged so far into a string, without the timestamps.
+static std::string dumpLog(NBLog::Reader& reader)
+{
+    FILE *file = tmpfile();
+    reader.dump(fileno(file));
+    rewind(file);
+    std::string text;
+    char line[512];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        const char *body = strchr(line, ']');
+        text += body != NULL ? body + 2 : line;
+    }
+    fclose(file);
+    return text;
+}
+
+static double nsPerEntry(const struct timespec& start, const struct timespec& end, int entries)
+{
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / entries;
+}
+
+TEST(audioflinger_nblog, format_deferred_to_reader) {
+    void *shared = calloc(1, NBLog::Timeline::sharedSize(kLogSize));
+    NBLog::Writer writer(kLogSize, shared);
+    NBLog::Reader reader(kLogSize, shared);
+
+    writer.logFormat("underrun %d frames %u %#x %zu", -3, 4000000000u, 0xabcu, (size_t) 7);
+    writer.logFormat("%-6s|%5.2f|%c|%%|%lld", "mix", 3.14159, 'Q', -9000000000LL);
+    writer.logf("text %d", 7);
+
+    EXPECT_EQ("underrun -3 frames 4000000000 0xabc 7\n"
+              "mix   | 3.14|Q|%|-9000000000\n"
+              "text 7\n", dumpLog(reader));
+    free(shared);
+}
+
+// The format is read back from shared memory, so a width or precision too large
+// to be genuine leaves the rest of the entry unformatted.
+TEST(audioflinger_nblog, oversized_field_width) {
+    void *shared = calloc(1, NBLog::Timeline::sharedSize(kLogSize));
+    NBLog::Writer writer(kLogSize, shared);
+    NBLog::Reader reader(kLogSize, shared);
+
+    writer.logFormat("%64d|%d", 1, 2);
+    writer.logFormat("a %d %99999999999999999999d|%d", 1, 2, 3);
+    writer.logFormat("b %.1000f|%d", 1.0, 2);
+
+    EXPECT_EQ(std::string(63, ' ') + "1|2\n"
+              "a 1 %99999999999999999999d|%d\n"
+              "b %.1000f|%d\n", dumpLog(reader));
+    free(shared);
+}
+
+// Not a correctness test: reports the writer side cost of one entry,
+// formatted by the writer (logf) versus deferred to the reader (logFormat).
+TEST(audioflinger_nblog, writer_cost) {
+    void *shared = calloc(1, NBLog::Timeline::sharedSize(kLogSize));
+    NBLog::Writer writer(kLogSize, shared);
+    const int kEntries = 100000;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < kEntries; ++i) {
+        writer.logf("underrun %d frames at %.3f ms on %s", i, i * 0.5, "fast");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double textNs = nsPerEntry(start, end, kEntries);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < kEntries; ++i) {
+        writer.logFormat("underrun %d frames at %.3f ms on %s", i, i * 0.5, "fast");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double binaryNs = nsPerEntry(start, end, kEntries);
+
+    printf("logf: %.0f ns/entry, logFormat: %.0f ns/entry\n", textNs, binaryNs);
+    free(shared);
+}
@@ -291,6 +291,69 @@ TEST(audioflinger_resampler, bufferincrement_interpolatedphase_multi_float) {
     }
 }
 
+/* Filter cache test
+ *
+ * Resamplers with the same conversion ratio share their filter through the
+ * filter cache, so converting the same input at 22050:24000 and at 44100:48000
+ * must give identical output.
+ */
+void testSameRatio(size_t channels, bool useFloat,
+        enum android::AudioResampler::src_quality quality)
+{
+    const audio_format_t format = useFloat ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
+    std::vector<int> inputIncr;
+    SignalProvider provider;
+    if (useFloat) {
+        provider.setChirp<float>(channels, 0., 24000., 48000., 24.);
+    } else {
+        provider.setChirp<int16_t>(channels, 0., 24000., 48000., 24.);
+    }
+    provider.setIncr(inputIncr);
+
+    size_t outputFrames = ((int64_t) provider.getNumFrames() * 48000) / 44100;
+    size_t outputFrameSize = channels * (useFloat ? sizeof(float) : sizeof(int32_t));
+    size_t outputSize = outputFrameSize * outputFrames;
+    std::vector<size_t> outIncr;
+    outIncr.push_back(outputFrames);
+
+    void* reference = malloc(outputSize);
+    android::AudioResampler* resampler =
+            android::AudioResampler::create(format, channels, 48000, quality);
+    resampler->setSampleRate(44100);
+    resampler->setVolume(android::AudioResampler::UNITY_GAIN_FLOAT,
+            android::AudioResampler::UNITY_GAIN_FLOAT);
+    resample(channels, reference, outputFrames, outIncr, &provider, resampler);
+    delete resampler;
+
+    provider.reset();
+
+    void* test = malloc(outputSize);
+    resampler = android::AudioResampler::create(format, channels, 24000, quality);
+    resampler->setSampleRate(22050);
+    resampler->setVolume(android::AudioResampler::UNITY_GAIN_FLOAT,
+            android::AudioResampler::UNITY_GAIN_FLOAT);
+    resample(channels, test, outputFrames, outIncr, &provider, resampler);
+    delete resampler;
+
+    buffercmp(reference, test, outputFrameSize, outputFrames);
+
+    free(reference);
+    free(test);
+}
+
+TEST(audioflinger_resampler, filtercache_sameratio) {
+    static const enum android::AudioResampler::src_quality kQualityArray[] = {
+            android::AudioResampler::DYN_LOW_QUALITY,
+            android::AudioResampler::DYN_MED_QUALITY,
+            android::AudioResampler::DYN_HIGH_QUALITY,
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(kQualityArray); ++i) {
+        testSameRatio(2, false, kQualityArray[i]);
+        testSameRatio(2, true, kQualityArray[i]);
+    }
+}
+
 /* Simple aliasing test
  *
  * This checks stopband response of the chirp signal to make sure frequencies
@@ -9,3 +9,4 @@ echo "waiting for device"
 adb root && adb wait-for-device remount
 
 adb shell /system/bin/resampler_tests
+adb shell /system/bin/nblog_tests
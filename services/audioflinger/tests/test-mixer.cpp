@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <inttypes.h>
+#include <time.h>
 #include <math.h>
 #include <vector>
 #include <audio_utils/primitives.h>
@@ -36,11 +37,12 @@
 using namespace android;
 
 static void usage(const char* name) {
-    fprintf(stderr, "Usage: %s [-f] [-m] [-c channels]"
+    fprintf(stderr, "Usage: %s [-f] [-m] [-b] [-c channels]"
                     " [-s sample-rate] [-o <output-file>] [-a <aux-buffer-file>] [-P csv]"
                     " (<input-file> | <command>)+\n", name);
     fprintf(stderr, "    -f    enable floating point input track\n");
     fprintf(stderr, "    -m    enable floating point mixer output\n");
+    fprintf(stderr, "    -b    benchmark: report the mix cost per period and per track\n");
     fprintf(stderr, "    -c    number of mixer output channels\n");
     fprintf(stderr, "    -s    mixer sample-rate\n");
     fprintf(stderr, "    -o    <output-file> WAV file, pcm16 (or float if -m specified)\n");
@@ -83,6 +85,7 @@ int main(int argc, char* argv[]) {
     bool useInputFloat = false;
     bool useMixerFloat = false;
     bool useRamp = true;
+    bool benchmark = false;
     uint32_t outputSampleRate = 48000;
     uint32_t outputChannels = 2; // stereo for now
     std::vector<int> Pvalues;
@@ -91,7 +94,7 @@ int main(int argc, char* argv[]) {
     std::vector<int32_t> Names;
     std::vector<SignalProvider> Providers;
 
-    for (int ch; (ch = getopt(argc, argv, "fmc:s:o:a:P:")) != -1;) {
+    for (int ch; (ch = getopt(argc, argv, "fmbc:s:o:a:P:")) != -1;) {
         switch (ch) {
         case 'f':
             useInputFloat = true;
@@ -99,6 +102,9 @@ int main(int argc, char* argv[]) {
         case 'm':
             useMixerFloat = true;
             break;
+        case 'b':
+            benchmark = true;
+            break;
         case 'c':
             outputChannels = atoi(optarg);
             break;
@@ -275,6 +281,9 @@ int main(int argc, char* argv[]) {
     }
 
     // pump the mixer to process data.
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t periods = 0;
     size_t i;
     for (i = 0; i < outputFrames - mixerFrameCount; i += mixerFrameCount) {
         for (size_t j = 0; j < Names.size(); ++j) {
@@ -286,9 +295,20 @@ int main(int argc, char* argv[]) {
             }
         }
         mixer->process(AudioBufferProvider::kInvalidPTS);
+        periods++;
     }
     outputFrames = i; // reset output frames to the data actually produced.
 
+    if (benchmark && periods > 0) {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        const int64_t elapsedNs = (end.tv_sec - start.tv_sec) * 1000000000LL
+                + (end.tv_nsec - start.tv_nsec);
+        const double periodNs = (double)elapsedNs / periods;
+        printf("mixed %zu tracks, %zu periods of %zu frames: %.0f ns/period, %.0f ns/track\n",
+                Names.size(), periods, mixerFrameCount, periodNs, periodNs / Names.size());
+    }
+
     // write to files
     writeFile(outputFilename, outputAddr,
             outputSampleRate, outputChannels, outputFrames, useMixerFloat);
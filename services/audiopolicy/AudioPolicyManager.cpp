@@ -83,8 +83,13 @@
 // input streams is higher than this value
 #define MAX_VOICE_CALL_START_DELAY_MS 100
 
+#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <cutils/properties.h>
 #include <utils/Log.h>
@@ -873,6 +878,7 @@ void AudioPolicyManager::setPhoneState(audio_mode_t state)
             mStreams[AUDIO_STREAM_DTMF].mVolumeCurve[j] =
                     sVolumeProfiles[AUDIO_STREAM_VOICE_CALL][j];
         }
+        mStreams[AUDIO_STREAM_DTMF].updateVolumeTables();
     } else if (isStateInCall(oldState) && !isStateInCall(state)) {
         ALOGV("  Exiting call in setPhoneState()");
         // force routing command to audio hardware when exiting a call
@@ -882,6 +888,7 @@ void AudioPolicyManager::setPhoneState(audio_mode_t state)
             mStreams[AUDIO_STREAM_DTMF].mVolumeCurve[j] =
                     sVolumeProfiles[AUDIO_STREAM_DTMF][j];
         }
+        mStreams[AUDIO_STREAM_DTMF].updateVolumeTables();
     } else if (isStateInCall(state) && (state != oldState)) {
         ALOGV("  Switching between telephony and VoIP in setPhoneState()");
         // force routing command to audio hardware when switching between telephony and VoIP
@@ -1634,6 +1641,22 @@ audio_io_handle_t AudioPolicyManager::getOutputForDevice(
         flags = AUDIO_OUTPUT_FLAG_DEEP_BUFFER;
     }
 
+    // the mixed output chosen for the same request is reused as long as nothing that could
+    // change the choice happened since
+    const nsecs_t selectionStart = systemTime();
+    const audio_output_flags_t requestFlags = flags;
+    output = findRoutingDecision(device, stream, samplingRate, format, channelMask, flags);
+    if (output != AUDIO_IO_HANDLE_NONE) {
+        const nsecs_t selectionTime = systemTime() - selectionStart;
+        mRoutingCacheHits++;
+        mRoutingHitTime += selectionTime;
+        if (selectionTime > mRoutingMaxHitTime) {
+            mRoutingMaxHitTime = selectionTime;
+        }
+        ALOGV("getOutput() returns cached output %d", output);
+        return output;
+    }
+
     sp<IOProfile> profile;
 
     // skip direct output selection if the request can obviously be attached to a mixed output
@@ -1780,6 +1803,20 @@ non_direct_output:
         // at this stage we should ignore the DIRECT flag as no direct output could be found earlier
         flags = (audio_output_flags_t)(flags & ~AUDIO_OUTPUT_FLAG_DIRECT);
         output = selectOutput(outputs, flags, format);
+
+        // a failed attempt to open a direct output must be retried, and whether an offloaded
+        // track can be attached also depends on the enabled effects
+        if (output != AUDIO_IO_HANDLE_NONE && profile == 0 &&
+                (requestFlags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) == 0) {
+            addRoutingDecision(device, stream, samplingRate, format, channelMask, requestFlags,
+                               output);
+            const nsecs_t selectionTime = systemTime() - selectionStart;
+            mRoutingCacheMisses++;
+            mRoutingMissTime += selectionTime;
+            if (selectionTime > mRoutingMaxMissTime) {
+                mRoutingMaxMissTime = selectionTime;
+            }
+        }
     }
     ALOGW_IF((output == 0), "getOutput() could not find output for stream %d, samplingRate %d,"
             "format %d, channels %x, flags %x", stream, samplingRate, format, channelMask, flags);
@@ -1847,6 +1884,106 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
     return outputs[0];
 }
 
+audio_io_handle_t AudioPolicyManager::findRoutingDecision(audio_devices_t device,
+                                                          audio_stream_type_t stream,
+                                                          uint32_t samplingRate,
+                                                          audio_format_t format,
+                                                          audio_channel_mask_t channelMask,
+                                                          audio_output_flags_t flags)
+{
+    const uint32_t portGeneration = curAudioPortGeneration();
+
+    for (size_t i = 0; i < mRoutingDecisions.size(); i++) {
+        const RoutingDecision& decision = mRoutingDecisions[i];
+        if (decision.mRoutingGeneration != mRoutingGeneration ||
+                decision.mPortGeneration != portGeneration) {
+            // all decisions are made with the same generations
+            break;
+        }
+        if (decision.mDevice == device && decision.mStream == stream &&
+                decision.mSamplingRate == samplingRate && decision.mFormat == format &&
+                decision.mChannelMask == channelMask && decision.mFlags == flags) {
+            if (mOutputs.indexOfKey(decision.mOutput) < 0) {
+                break;
+            }
+            return decision.mOutput;
+        }
+    }
+    return AUDIO_IO_HANDLE_NONE;
+}
+
+void AudioPolicyManager::addRoutingDecision(audio_devices_t device,
+                                            audio_stream_type_t stream,
+                                            uint32_t samplingRate,
+                                            audio_format_t format,
+                                            audio_channel_mask_t channelMask,
+                                            audio_output_flags_t flags,
+                                            audio_io_handle_t output)
+{
+    RoutingDecision decision;
+    decision.mDevice = device;
+    decision.mStream = stream;
+    decision.mSamplingRate = samplingRate;
+    decision.mFormat = format;
+    decision.mChannelMask = channelMask;
+    decision.mFlags = flags;
+    decision.mOutput = output;
+    decision.mRoutingGeneration = mRoutingGeneration;
+    decision.mPortGeneration = curAudioPortGeneration();
+
+    if (!mRoutingDecisions.isEmpty() &&
+            (mRoutingDecisions[0].mRoutingGeneration != decision.mRoutingGeneration ||
+             mRoutingDecisions[0].mPortGeneration != decision.mPortGeneration)) {
+        mRoutingDecisions.clear();
+    } else if (mRoutingDecisions.size() >= MAX_ROUTING_DECISIONS) {
+        mRoutingDecisions.removeAt(0);
+    }
+    mRoutingDecisions.add(decision);
+}
+
+void AudioPolicyManager::invalidateRoutingDecisions()
+{
+    mRoutingGeneration++;
+    mRoutingDecisions.clear();
+}
+
+void AudioPolicyManager::dumpRoutingDecisions(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+
+    uint32_t lookups = mRoutingCacheHits + mRoutingCacheMisses;
+    snprintf(buffer, SIZE, "\nRouting decision cache: generation %u, %zu decisions\n",
+             mRoutingGeneration, mRoutingDecisions.size());
+    result.append(buffer);
+    snprintf(buffer, SIZE, " Hits: %u (%u%%), avg %.1f us, max %.1f us\n",
+             mRoutingCacheHits, lookups != 0 ? mRoutingCacheHits * 100 / lookups : 0,
+             mRoutingCacheHits != 0 ? mRoutingHitTime / 1000.0 / mRoutingCacheHits : 0.0,
+             mRoutingMaxHitTime / 1000.0);
+    result.append(buffer);
+    snprintf(buffer, SIZE, " Misses: %u, avg %.1f us, max %.1f us\n",
+             mRoutingCacheMisses,
+             mRoutingCacheMisses != 0 ? mRoutingMissTime / 1000.0 / mRoutingCacheMisses : 0.0,
+             mRoutingMaxMissTime / 1000.0);
+    result.append(buffer);
+
+    const uint32_t portGeneration = curAudioPortGeneration();
+    for (size_t i = 0; i < mRoutingDecisions.size(); i++) {
+        const RoutingDecision& decision = mRoutingDecisions[i];
+        if (decision.mRoutingGeneration != mRoutingGeneration ||
+                decision.mPortGeneration != portGeneration) {
+            break;
+        }
+        snprintf(buffer, SIZE, " - device %08x stream %d rate %u format %08x channels %08x"
+                 " flags %08x: output %d\n",
+                 decision.mDevice, decision.mStream, decision.mSamplingRate, decision.mFormat,
+                 decision.mChannelMask, decision.mFlags, decision.mOutput);
+        result.append(buffer);
+    }
+    write(fd, result.string(), result.size());
+}
+
 status_t AudioPolicyManager::startOutput(audio_io_handle_t output,
                                              audio_stream_type_t stream,
                                              audio_session_t session)
@@ -2635,10 +2772,12 @@ void AudioPolicyManager::initStreamVolume(audio_stream_type_t stream,
     }
     mStreams[stream].mIndexMin = indexMin;
     mStreams[stream].mIndexMax = indexMax;
+    mStreams[stream].updateVolumeTables();
     //FIXME: AUDIO_STREAM_ACCESSIBILITY volume follows AUDIO_STREAM_MUSIC for now
     if (stream == AUDIO_STREAM_MUSIC) {
         mStreams[AUDIO_STREAM_ACCESSIBILITY].mIndexMin = indexMin;
         mStreams[AUDIO_STREAM_ACCESSIBILITY].mIndexMax = indexMax;
+        mStreams[AUDIO_STREAM_ACCESSIBILITY].updateVolumeTables();
     }
 }
 
@@ -3183,6 +3322,8 @@ status_t AudioPolicyManager::dump(int fd)
         mAudioPatches[i]->dump(fd, 2, i);
     }
 
+    dumpRoutingDecisions(fd);
+
     return NO_ERROR;
 }
 
@@ -4019,9 +4160,18 @@ AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterfa
     mHdmiAudioDisabled(false), mHdmiAudioEvent(false),
     mPrevPhoneState(0),
     mPrimarySuspended (0), mFastSuspended(0),
-    mMultiChannelSuspended(0)
+    mMultiChannelSuspended(0),
+    mRoutingGeneration(1),
+    mRoutingCacheHits(0), mRoutingCacheMisses(0),
+    mRoutingHitTime(0), mRoutingMissTime(0),
+    mRoutingMaxHitTime(0), mRoutingMaxMissTime(0)
 {
+    nsecs_t startTime = systemTime();
     mUidCached = getuid();
+    mVolumeBatch.mActive = false;
+    mVolumeBatch.mOutput = 0;
+    mVolumeBatch.mHasMusicLimit = false;
+    mVolumeBatch.mMusicLimit = 1.0f;
     mpClientInterface = clientInterface;
 
     for (int i = 0; i < AUDIO_POLICY_FORCE_USE_CNT; i++) {
@@ -4035,6 +4185,7 @@ AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterfa
             defaultAudioPolicyConfig();
         }
     }
+    nsecs_t configTime = systemTime() - startTime;
     // mAvailableOutputDevices and mAvailableInputDevices now contain all attached devices
 
     // must be done after reading the policy
@@ -4224,6 +4375,9 @@ AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterfa
     mIsInputRequestOnProgress = false;
 #endif
 
+    ALOGI("AudioPolicyManager initialized in %.2f ms, configuration loaded in %.2f ms",
+          (systemTime() - startTime) / 1000000.0, configTime / 1000000.0);
+
 #ifdef AUDIO_POLICY_TEST
     if (mPrimaryOutput != 0) {
         AudioParameter outputCmd = AudioParameter();
@@ -5884,6 +6038,7 @@ void AudioPolicyManager::updateDevicesAndOutputs()
         mDeviceForStrategy[i] = getDeviceForStrategy((routing_strategy)i, false /*fromCache*/);
     }
     mPreviousOutputs = mOutputs;
+    invalidateRoutingDecisions();
 }
 
 uint32_t AudioPolicyManager::checkDeviceMuteStrategies(sp<AudioOutputDescriptor> outputDesc,
@@ -6526,6 +6681,20 @@ float AudioPolicyManager::volIndexToAmpl(audio_devices_t device, const StreamDes
         int indexInUi)
 {
     device_category deviceCategory = getDeviceCategory(device);
+
+    // use the amplitude precomputed by updateVolumeTables() when the index is in range
+    const Vector<float>& table = streamDesc.mVolumeTable[deviceCategory];
+    int tableIndex = indexInUi - streamDesc.mIndexMin;
+    if (tableIndex >= 0 && (size_t)tableIndex < table.size()) {
+        return table[tableIndex];
+    }
+    return computeVolIndexToAmpl(deviceCategory, streamDesc, indexInUi);
+}
+
+/* static */
+float AudioPolicyManager::computeVolIndexToAmpl(device_category deviceCategory,
+        const StreamDescriptor& streamDesc, int indexInUi)
+{
     const VolumeCurvePoint *curve = streamDesc.mVolumeCurve[deviceCategory];
 
     // the volume index in the UI is relative to the min and max volume indices for this stream type
@@ -6765,6 +6934,10 @@ void AudioPolicyManager::initializeVolumeCurves()
         mStreams[AUDIO_STREAM_ACCESSIBILITY].mVolumeCurve[DEVICE_CATEGORY_SPEAKER] =
                 sSpeakerMediaVolumeCurveDrc;
     }
+
+    for (int i = 0; i < AUDIO_STREAM_CNT; i++) {
+        mStreams[i].updateVolumeTables();
+    }
 }
 
 float AudioPolicyManager::computeVolume(audio_stream_type_t stream,
@@ -6773,11 +6946,10 @@ float AudioPolicyManager::computeVolume(audio_stream_type_t stream,
                                             audio_devices_t device)
 {
     float volume = 1.0;
-    sp<AudioOutputDescriptor> outputDesc = mOutputs.valueFor(output);
     StreamDescriptor &streamDesc = mStreams[stream];
 
     if (device == AUDIO_DEVICE_NONE) {
-        device = outputDesc->device();
+        device = mOutputs.valueFor(output)->device();
     }
 
     // if volume is not 0 (not muted), force media volume to max on digital output
@@ -6821,16 +6993,29 @@ float AudioPolicyManager::computeVolume(audio_stream_type_t stream,
         // just stopped
         if (isStreamActive(AUDIO_STREAM_MUSIC, SONIFICATION_HEADSET_MUSIC_DELAY) ||
                 mLimitRingtoneVolume) {
-            audio_devices_t musicDevice = getDeviceForStrategy(STRATEGY_MEDIA, true /*fromCache*/);
-            float musicVol = computeVolume(AUDIO_STREAM_MUSIC,
-                               mStreams[AUDIO_STREAM_MUSIC].getVolumeIndex(musicDevice),
-                               output,
-                               musicDevice);
-            float minVol = (musicVol > SONIFICATION_HEADSET_VOLUME_MIN) ?
+            // the limit does not depend on the sonification stream: compute it only once
+            // during an applyStreamVolumes() pass
+            bool inBatch = mVolumeBatch.mActive && mVolumeBatch.mOutput == output;
+            float minVol;
+            if (inBatch && mVolumeBatch.mHasMusicLimit) {
+                minVol = mVolumeBatch.mMusicLimit;
+            } else {
+                audio_devices_t musicDevice =
+                        getDeviceForStrategy(STRATEGY_MEDIA, true /*fromCache*/);
+                float musicVol = computeVolume(AUDIO_STREAM_MUSIC,
+                                   mStreams[AUDIO_STREAM_MUSIC].getVolumeIndex(musicDevice),
+                                   output,
+                                   musicDevice);
+                minVol = (musicVol > SONIFICATION_HEADSET_VOLUME_MIN) ?
                                 musicVol : SONIFICATION_HEADSET_VOLUME_MIN;
+                if (inBatch) {
+                    mVolumeBatch.mMusicLimit = minVol;
+                    mVolumeBatch.mHasMusicLimit = true;
+                }
+            }
             if (volume > minVol) {
                 volume = minVol;
-                ALOGV("computeVolume limiting volume to %f musicVol %f", minVol, musicVol);
+                ALOGV("computeVolume limiting volume to %f", minVol);
             }
         }
     }
@@ -6845,11 +7030,12 @@ status_t AudioPolicyManager::checkAndSetVolume(audio_stream_type_t stream,
                                                    int delayMs,
                                                    bool force)
 {
+    sp<AudioOutputDescriptor> outputDesc = mOutputs.valueFor(output);
 
     // do not change actual stream volume if the stream is muted
-    if (mOutputs.valueFor(output)->mMuteCount[stream] != 0) {
+    if (outputDesc->mMuteCount[stream] != 0) {
         ALOGVV("checkAndSetVolume() stream %d muted count %d",
-              stream, mOutputs.valueFor(output)->mMuteCount[stream]);
+              stream, outputDesc->mMuteCount[stream]);
         return NO_ERROR;
     }
 
@@ -6866,22 +7052,18 @@ status_t AudioPolicyManager::checkAndSetVolume(audio_stream_type_t stream,
     float volume = computeVolume(stream, index, output, device);
     // unit gain if rerouting to external policy
     if (device == AUDIO_DEVICE_OUT_REMOTE_SUBMIX) {
-        ssize_t index = mOutputs.indexOfKey(output);
-        if (index >= 0) {
-            sp<AudioOutputDescriptor> outputDesc = mOutputs.valueAt(index);
-            if (outputDesc->mPolicyMix != NULL) {
-                ALOGV("max gain when rerouting for output=%d", output);
-                volume = 1.0f;
-            }
+        if (outputDesc->mPolicyMix != NULL) {
+            ALOGV("max gain when rerouting for output=%d", output);
+            volume = 1.0f;
         }
 
     }
     // We actually change the volume if:
     // - the float value returned by computeVolume() changed
     // - the force flag is set
-    if (volume != mOutputs.valueFor(output)->mCurVolume[stream] ||
+    if (volume != outputDesc->mCurVolume[stream] ||
             force) {
-        mOutputs.valueFor(output)->mCurVolume[stream] = volume;
+        outputDesc->mCurVolume[stream] = volume;
         ALOGVV("checkAndSetVolume() for output %d stream %d, volume %f, delay %d", output, stream, volume, delayMs);
         // Force VOICE_CALL to track BLUETOOTH_SCO stream volume when bluetooth audio is
         // enabled
@@ -6929,6 +7111,11 @@ void AudioPolicyManager::applyStreamVolumes(audio_io_handle_t output,
 {
     ALOGVV("applyStreamVolumes() for output %d and device %x", output, device);
 
+    VolumeBatch previousBatch = mVolumeBatch;
+    mVolumeBatch.mActive = true;
+    mVolumeBatch.mOutput = output;
+    mVolumeBatch.mHasMusicLimit = false;
+
     for (int stream = 0; stream < AUDIO_STREAM_CNT; stream++) {
         if (stream == AUDIO_STREAM_PATCH) {
             continue;
@@ -6940,6 +7127,8 @@ void AudioPolicyManager::applyStreamVolumes(audio_io_handle_t output,
                           delayMs,
                           force);
     }
+
+    mVolumeBatch = previousBatch;
 }
 
 void AudioPolicyManager::setStrategyMute(routing_strategy strategy,
@@ -7363,6 +7552,18 @@ int AudioPolicyManager::StreamDescriptor::getVolumeIndex(audio_devices_t device)
     return mIndexCur.valueFor(device);
 }
 
+void AudioPolicyManager::StreamDescriptor::updateVolumeTables()
+{
+    for (int i = 0; i < DEVICE_CATEGORY_CNT; i++) {
+        mVolumeTable[i].clear();
+        mVolumeTable[i].setCapacity(mIndexMax - mIndexMin + 1);
+        for (int index = mIndexMin; index <= mIndexMax; index++) {
+            mVolumeTable[i].add(AudioPolicyManager::computeVolIndexToAmpl(
+                    (device_category)i, *this, index));
+        }
+    }
+}
+
 void AudioPolicyManager::StreamDescriptor::dump(int fd)
 {
     const size_t SIZE = 256;
@@ -9131,15 +9332,512 @@ void AudioPolicyManager::loadGlobalConfig(cnode *root, const sp<HwModule>& modul
     }
 }
 
+// --- audio_policy.conf binary cache
+//
+// The cache is a header followed by 32 bit words in native byte order:
+//  - modules: count, then name and HAL version of each
+//  - devices: count, then for each device referenced anywhere in the configuration its name,
+//    type, address, module index (or ~0), port capabilities and port configuration
+//  - for each module: declared devices, then output and input profiles with their name, port
+//    capabilities and supported devices
+//  - available output devices, available input devices, default output device, speaker DRC
+// Strings are a length followed by the characters packed in words.
+
+// "APCB"
+#define AUDIO_POLICY_CACHE_MAGIC 0x42435041
+#define AUDIO_POLICY_CACHE_VERSION 1
+
+// FNV-1a
+static uint32_t cacheChecksum(const void *data, size_t size, uint32_t checksum = 2166136261u)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    for (size_t i = 0; i < size; i++) {
+        checksum = (checksum ^ bytes[i]) * 16777619u;
+    }
+    return checksum;
+}
+
+struct audio_policy_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t configChecksum;    // checksum of the build fingerprint and configuration file
+    uint32_t dataWords;         // number of words following the header
+    uint32_t dataChecksum;      // checksum of the words following the header
+};
+
+static void writeCacheString(Vector<uint32_t>& data, const String8& str)
+{
+    size_t length = str.length();
+
+    data.add(length);
+    for (size_t i = 0; i < length; i += sizeof(uint32_t)) {
+        uint32_t word = 0;
+        memcpy(&word, str.string() + i, MIN(sizeof(uint32_t), length - i));
+        data.add(word);
+    }
+}
+
+static bool readCacheWord(const uint32_t **pos, const uint32_t *end, uint32_t *value)
+{
+    if (*pos >= end) {
+        return false;
+    }
+    *value = *(*pos)++;
+    return true;
+}
+
+static bool readCacheString(const uint32_t **pos, const uint32_t *end, String8 *str)
+{
+    uint32_t length;
+
+    if (!readCacheWord(pos, end, &length) ||
+            (length + sizeof(uint32_t) - 1) / sizeof(uint32_t) > (size_t)(end - *pos)) {
+        return false;
+    }
+    *str = String8((const char *)*pos, length);
+    *pos += (length + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    return true;
+}
+
+void AudioPolicyManager::writeCachedPort(Vector<uint32_t>& data, const sp<AudioPort>& port)
+{
+    data.add(port->mFlags);
+    data.add(port->mSamplingRates.size());
+    for (size_t i = 0; i < port->mSamplingRates.size(); i++) {
+        data.add(port->mSamplingRates[i]);
+    }
+    data.add(port->mChannelMasks.size());
+    for (size_t i = 0; i < port->mChannelMasks.size(); i++) {
+        data.add(port->mChannelMasks[i]);
+    }
+    data.add(port->mFormats.size());
+    for (size_t i = 0; i < port->mFormats.size(); i++) {
+        data.add(port->mFormats[i]);
+    }
+    data.add(port->mGains.size());
+    for (size_t i = 0; i < port->mGains.size(); i++) {
+        const sp<AudioGain>& gain = port->mGains[i];
+        data.add(gain->mIndex);
+        data.add(gain->mGain.mode);
+        data.add(gain->mGain.channel_mask);
+        data.add(gain->mGain.min_value);
+        data.add(gain->mGain.max_value);
+        data.add(gain->mGain.default_value);
+        data.add(gain->mGain.step_value);
+        data.add(gain->mGain.min_ramp_ms);
+        data.add(gain->mGain.max_ramp_ms);
+    }
+}
+
+bool AudioPolicyManager::readCachedPort(const uint32_t **pos, const uint32_t *end,
+                                        const sp<AudioPort>& port)
+{
+    uint32_t count, value;
+
+    if (!readCacheWord(pos, end, &port->mFlags) || !readCacheWord(pos, end, &count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readCacheWord(pos, end, &value)) {
+            return false;
+        }
+        port->mSamplingRates.add(value);
+    }
+    if (!readCacheWord(pos, end, &count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readCacheWord(pos, end, &value)) {
+            return false;
+        }
+        port->mChannelMasks.add((audio_channel_mask_t)value);
+    }
+    if (!readCacheWord(pos, end, &count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readCacheWord(pos, end, &value)) {
+            return false;
+        }
+        port->mFormats.add((audio_format_t)value);
+    }
+    if (!readCacheWord(pos, end, &count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t values[9];
+        for (size_t j = 0; j < ARRAY_SIZE(values); j++) {
+            if (!readCacheWord(pos, end, &values[j])) {
+                return false;
+            }
+        }
+        sp<AudioGain> gain = new AudioGain(values[0], port->mUseInChannelMask);
+        gain->mGain.mode = (audio_gain_mode_t)values[1];
+        gain->mGain.channel_mask = (audio_channel_mask_t)values[2];
+        gain->mGain.min_value = values[3];
+        gain->mGain.max_value = values[4];
+        gain->mGain.default_value = values[5];
+        gain->mGain.step_value = values[6];
+        gain->mGain.min_ramp_ms = values[7];
+        gain->mGain.max_ramp_ms = values[8];
+        port->mGains.add(gain);
+    }
+    return true;
+}
+
+void AudioPolicyManager::addCachedDevices(Vector< sp<DeviceDescriptor> >& devices,
+                                          const DeviceVector& deviceVector)
+{
+    for (size_t i = 0; i < deviceVector.size(); i++) {
+        size_t j;
+        for (j = 0; j < devices.size(); j++) {
+            if (devices[j] == deviceVector[i]) {
+                break;
+            }
+        }
+        if (j == devices.size()) {
+            devices.add(deviceVector[i]);
+        }
+    }
+}
+
+void AudioPolicyManager::writeCachedDevices(Vector<uint32_t>& data,
+                                            const Vector< sp<DeviceDescriptor> >& devices,
+                                            const DeviceVector& deviceVector)
+{
+    data.add(deviceVector.size());
+    for (size_t i = 0; i < deviceVector.size(); i++) {
+        size_t j;
+        for (j = 0; j < devices.size(); j++) {
+            if (devices[j] == deviceVector[i]) {
+                break;
+            }
+        }
+        data.add(j);
+    }
+}
+
+bool AudioPolicyManager::readCachedDevices(const uint32_t **pos, const uint32_t *end,
+                                           const Vector< sp<DeviceDescriptor> >& devices,
+                                           DeviceVector& deviceVector)
+{
+    uint32_t count, index;
+
+    if (!readCacheWord(pos, end, &count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readCacheWord(pos, end, &index) || index >= devices.size()) {
+            return false;
+        }
+        deviceVector.add(devices[index]);
+    }
+    return true;
+}
+
+status_t AudioPolicyManager::loadAudioPolicyCache(const char *path, uint32_t configChecksum)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ALOGV("loadAudioPolicyCache() no cache %s", path);
+        return -errno;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(audio_policy_cache_header)) {
+        close(fd);
+        return BAD_VALUE;
+    }
+    void *cache = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (cache == MAP_FAILED) {
+        return -errno;
+    }
+
+    status_t status = readAudioPolicyCache(cache, st.st_size, configChecksum);
+    munmap(cache, st.st_size);
+
+    ALOGW_IF(status != NO_ERROR, "loadAudioPolicyCache() ignoring stale or invalid cache %s",
+             path);
+    return status;
+}
+
+status_t AudioPolicyManager::readAudioPolicyCache(const void *cache, size_t size,
+                                                  uint32_t configChecksum)
+{
+    const audio_policy_cache_header *header = (const audio_policy_cache_header *)cache;
+
+    if (header->magic != AUDIO_POLICY_CACHE_MAGIC ||
+            header->version != AUDIO_POLICY_CACHE_VERSION ||
+            header->configChecksum != configChecksum ||
+            header->dataWords != (size - sizeof(*header)) / sizeof(uint32_t)) {
+        return BAD_VALUE;
+    }
+    const uint32_t *pos = (const uint32_t *)(header + 1);
+    const uint32_t *end = pos + header->dataWords;
+    if (cacheChecksum(pos, header->dataWords * sizeof(uint32_t)) != header->dataChecksum) {
+        return BAD_VALUE;
+    }
+
+    // nothing is applied before the whole cache has been read
+    Vector < sp<HwModule> > modules;
+    Vector < sp<DeviceDescriptor> > devices;
+    DeviceVector availableOutputDevices;
+    DeviceVector availableInputDevices;
+    uint32_t count, value;
+    String8 name;
+
+    if (!readCacheWord(&pos, end, &count)) {
+        return BAD_VALUE;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readCacheString(&pos, end, &name) || !readCacheWord(&pos, end, &value)) {
+            return BAD_VALUE;
+        }
+        sp<HwModule> module = new HwModule(name.string());
+        module->mHalVersion = value;
+        modules.add(module);
+    }
+
+    if (!readCacheWord(&pos, end, &count)) {
+        return BAD_VALUE;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t type, moduleIndex;
+        String8 address;
+        if (!readCacheString(&pos, end, &name) || !readCacheWord(&pos, end, &type) ||
+                !readCacheString(&pos, end, &address) ||
+                !readCacheWord(&pos, end, &moduleIndex)) {
+            return BAD_VALUE;
+        }
+        sp<DeviceDescriptor> device = new DeviceDescriptor(name, type);
+        device->mAddress = address;
+        if (moduleIndex != ~0u) {
+            if (moduleIndex >= modules.size()) {
+                return BAD_VALUE;
+            }
+            device->mModule = modules[moduleIndex];
+        }
+        if (!readCachedPort(&pos, end, device)) {
+            return BAD_VALUE;
+        }
+
+        uint32_t config[6 + ARRAY_SIZE(device->mGain.values)];
+        for (size_t j = 0; j < ARRAY_SIZE(config); j++) {
+            if (!readCacheWord(&pos, end, &config[j])) {
+                return BAD_VALUE;
+            }
+        }
+        device->mSamplingRate = config[0];
+        device->mFormat = (audio_format_t)config[1];
+        device->mChannelMask = (audio_channel_mask_t)config[2];
+        device->mGain.index = config[3];
+        device->mGain.mode = (audio_gain_mode_t)config[4];
+        device->mGain.channel_mask = (audio_channel_mask_t)config[5];
+        for (size_t j = 0; j < ARRAY_SIZE(device->mGain.values); j++) {
+            device->mGain.values[j] = config[6 + j];
+        }
+        if (!readCacheWord(&pos, end, &device->mGain.ramp_duration_ms)) {
+            return BAD_VALUE;
+        }
+        devices.add(device);
+    }
+
+    for (size_t i = 0; i < modules.size(); i++) {
+        const sp<HwModule>& module = modules[i];
+        if (!readCachedDevices(&pos, end, devices, module->mDeclaredDevices)) {
+            return BAD_VALUE;
+        }
+        for (int role = AUDIO_PORT_ROLE_SOURCE; role <= AUDIO_PORT_ROLE_SINK; role++) {
+            if (!readCacheWord(&pos, end, &count)) {
+                return BAD_VALUE;
+            }
+            for (uint32_t j = 0; j < count; j++) {
+                if (!readCacheString(&pos, end, &name)) {
+                    return BAD_VALUE;
+                }
+                sp<IOProfile> profile = new IOProfile(name, (audio_port_role_t)role, module);
+                if (!readCachedPort(&pos, end, profile) ||
+                        !readCachedDevices(&pos, end, devices, profile->mSupportedDevices)) {
+                    return BAD_VALUE;
+                }
+                if (role == AUDIO_PORT_ROLE_SOURCE) {
+                    module->mOutputProfiles.add(profile);
+                } else {
+                    module->mInputProfiles.add(profile);
+                }
+            }
+        }
+    }
+
+    uint32_t defaultOutputDevice, speakerDrcEnabled;
+    if (!readCachedDevices(&pos, end, devices, availableOutputDevices) ||
+            !readCachedDevices(&pos, end, devices, availableInputDevices) ||
+            !readCacheWord(&pos, end, &defaultOutputDevice) ||
+            defaultOutputDevice >= devices.size() ||
+            !readCacheWord(&pos, end, &speakerDrcEnabled) ||
+            pos != end) {
+        return BAD_VALUE;
+    }
+
+    for (size_t i = 0; i < modules.size(); i++) {
+        mHwModules.add(modules[i]);
+    }
+    for (size_t i = 0; i < availableOutputDevices.size(); i++) {
+        mAvailableOutputDevices.add(availableOutputDevices[i]);
+    }
+    for (size_t i = 0; i < availableInputDevices.size(); i++) {
+        mAvailableInputDevices.add(availableInputDevices[i]);
+    }
+    mDefaultOutputDevice = devices[defaultOutputDevice];
+    mSpeakerDrcEnabled = speakerDrcEnabled != 0;
+
+    return NO_ERROR;
+}
+
+void AudioPolicyManager::saveAudioPolicyCache(const char *path, uint32_t configChecksum)
+{
+    Vector < sp<DeviceDescriptor> > devices;
+    Vector<uint32_t> data;
+
+    for (size_t i = 0; i < mHwModules.size(); i++) {
+        const sp<HwModule>& module = mHwModules[i];
+        addCachedDevices(devices, module->mDeclaredDevices);
+        for (size_t j = 0; j < module->mOutputProfiles.size(); j++) {
+            addCachedDevices(devices, module->mOutputProfiles[j]->mSupportedDevices);
+        }
+        for (size_t j = 0; j < module->mInputProfiles.size(); j++) {
+            addCachedDevices(devices, module->mInputProfiles[j]->mSupportedDevices);
+        }
+    }
+    addCachedDevices(devices, mAvailableOutputDevices);
+    addCachedDevices(devices, mAvailableInputDevices);
+    size_t defaultOutputDevice;
+    for (defaultOutputDevice = 0; defaultOutputDevice < devices.size(); defaultOutputDevice++) {
+        if (devices[defaultOutputDevice] == mDefaultOutputDevice) {
+            break;
+        }
+    }
+    if (defaultOutputDevice == devices.size()) {
+        devices.add(mDefaultOutputDevice);
+    }
+
+    data.add(mHwModules.size());
+    for (size_t i = 0; i < mHwModules.size(); i++) {
+        writeCacheString(data, String8(mHwModules[i]->mName));
+        data.add(mHwModules[i]->mHalVersion);
+    }
+
+    data.add(devices.size());
+    for (size_t i = 0; i < devices.size(); i++) {
+        const sp<DeviceDescriptor>& device = devices[i];
+        uint32_t moduleIndex = ~0u;
+        if (device->mModule != 0) {
+            for (moduleIndex = 0; moduleIndex < mHwModules.size(); moduleIndex++) {
+                if (mHwModules[moduleIndex] == device->mModule) {
+                    break;
+                }
+            }
+            if (moduleIndex == mHwModules.size()) {
+                // declared by a module that failed to load, it cannot be restored as is
+                ALOGW("saveAudioPolicyCache() device %s has no module, not saving %s",
+                      device->mName.string(), path);
+                return;
+            }
+        }
+        writeCacheString(data, device->mName);
+        data.add(device->mDeviceType);
+        writeCacheString(data, device->mAddress);
+        data.add(moduleIndex);
+        writeCachedPort(data, device);
+        data.add(device->mSamplingRate);
+        data.add(device->mFormat);
+        data.add(device->mChannelMask);
+        data.add(device->mGain.index);
+        data.add(device->mGain.mode);
+        data.add(device->mGain.channel_mask);
+        for (size_t j = 0; j < ARRAY_SIZE(device->mGain.values); j++) {
+            data.add(device->mGain.values[j]);
+        }
+        data.add(device->mGain.ramp_duration_ms);
+    }
+
+    for (size_t i = 0; i < mHwModules.size(); i++) {
+        const sp<HwModule>& module = mHwModules[i];
+        writeCachedDevices(data, devices, module->mDeclaredDevices);
+        data.add(module->mOutputProfiles.size());
+        for (size_t j = 0; j < module->mOutputProfiles.size(); j++) {
+            writeCacheString(data, module->mOutputProfiles[j]->mName);
+            writeCachedPort(data, module->mOutputProfiles[j]);
+            writeCachedDevices(data, devices, module->mOutputProfiles[j]->mSupportedDevices);
+        }
+        data.add(module->mInputProfiles.size());
+        for (size_t j = 0; j < module->mInputProfiles.size(); j++) {
+            writeCacheString(data, module->mInputProfiles[j]->mName);
+            writeCachedPort(data, module->mInputProfiles[j]);
+            writeCachedDevices(data, devices, module->mInputProfiles[j]->mSupportedDevices);
+        }
+    }
+
+    writeCachedDevices(data, devices, mAvailableOutputDevices);
+    writeCachedDevices(data, devices, mAvailableInputDevices);
+    data.add(defaultOutputDevice);
+    data.add(mSpeakerDrcEnabled);
+
+    audio_policy_cache_header header;
+    header.magic = AUDIO_POLICY_CACHE_MAGIC;
+    header.version = AUDIO_POLICY_CACHE_VERSION;
+    header.configChecksum = configChecksum;
+    header.dataWords = data.size();
+    header.dataChecksum = cacheChecksum(data.array(), data.size() * sizeof(uint32_t));
+
+    // the cache is written to a temporary file first so that a partially written cache is
+    // never used
+    String8 tmpPath = String8::format("%s.tmp", path);
+    int fd = open(tmpPath.string(), O_WRONLY | O_CREAT | O_TRUNC, 0640);
+    if (fd < 0) {
+        ALOGW("saveAudioPolicyCache() cannot create %s: %s", tmpPath.string(), strerror(errno));
+        return;
+    }
+    ssize_t dataSize = data.size() * sizeof(uint32_t);
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+            write(fd, data.array(), dataSize) == dataSize;
+    close(fd);
+    if (!ok || rename(tmpPath.string(), path) < 0) {
+        ALOGW("saveAudioPolicyCache() cannot write %s: %s", path, strerror(errno));
+        unlink(tmpPath.string());
+        return;
+    }
+    ALOGV("saveAudioPolicyCache() saved %zu bytes to %s", sizeof(header) + dataSize, path);
+}
+
 status_t AudioPolicyManager::loadAudioPolicyConfig(const char *path)
 {
     cnode *root;
     char *data;
+    unsigned int size;
+    nsecs_t startTime = systemTime();
 
-    data = (char *)load_file(path, NULL);
+    data = (char *)load_file(path, &size);
     if (data == NULL) {
         return -ENODEV;
     }
+
+    // the path is part of the checksum so that the cache of the vendor configuration is not
+    // used for the system one and vice versa, and the build fingerprint so that a cache
+    // written by an older build of this code is not used after an OTA
+    char fingerprint[PROPERTY_VALUE_MAX];
+    property_get("ro.build.fingerprint", fingerprint, "");
+    uint32_t configChecksum = cacheChecksum(path, strlen(path));
+    configChecksum = cacheChecksum(fingerprint, strlen(fingerprint), configChecksum);
+    configChecksum = cacheChecksum(data, size, configChecksum);
+    if (loadAudioPolicyCache(AUDIO_POLICY_CACHE_FILE, configChecksum) == NO_ERROR) {
+        free(data);
+        ALOGI("loadAudioPolicyConfig() loaded %s from %s in %.2f ms\n", path,
+              AUDIO_POLICY_CACHE_FILE, (systemTime() - startTime) / 1000000.0);
+        return NO_ERROR;
+    }
+
     root = config_node("", "");
     config_load(root, data);
 
@@ -9150,7 +9848,10 @@ status_t AudioPolicyManager::loadAudioPolicyConfig(const char *path)
     free(root);
     free(data);
 
-    ALOGI("loadAudioPolicyConfig() loaded %s\n", path);
+    ALOGI("loadAudioPolicyConfig() loaded %s in %.2f ms\n", path,
+          (systemTime() - startTime) / 1000000.0);
+
+    saveAudioPolicyCache(AUDIO_POLICY_CACHE_FILE, configChecksum);
 
     return NO_ERROR;
 }
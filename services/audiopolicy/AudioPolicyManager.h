@@ -553,6 +553,8 @@ protected:
             StreamDescriptor();
 
             int getVolumeIndex(audio_devices_t device);
+            // recompute mVolumeTable after a change of mVolumeCurve, mIndexMin or mIndexMax
+            void updateVolumeTables();
             void dump(int fd);
 
             int mIndexMin;      // min volume index
@@ -561,6 +563,8 @@ protected:
             bool mCanBeMuted;   // true is the stream can be muted
 
             const VolumeCurvePoint *mVolumeCurve[DEVICE_CATEGORY_CNT];
+            // amplitude for each index from mIndexMin to mIndexMax, per device category
+            Vector<float> mVolumeTable[DEVICE_CATEGORY_CNT];
         };
 
         // stream descriptor used for volume control
@@ -800,6 +804,28 @@ protected:
         status_t loadAudioPolicyConfig(const char *path);
         void defaultAudioPolicyConfig(void);
 
+        //
+        // Binary image of the parsed audio_policy.conf (AUDIO_POLICY_CACHE_FILE), written after
+        // the configuration file was parsed and used instead of parsing it again as long as
+        // the checksum of the configuration file and build fingerprint matches configChecksum.
+        //
+        status_t loadAudioPolicyCache(const char *path, uint32_t configChecksum);
+        status_t readAudioPolicyCache(const void *cache, size_t size, uint32_t configChecksum);
+        void saveAudioPolicyCache(const char *path, uint32_t configChecksum);
+        // capabilities and gains of an audio port, the name is stored by the caller
+        static void writeCachedPort(Vector<uint32_t>& data, const sp<AudioPort>& port);
+        static bool readCachedPort(const uint32_t **pos, const uint32_t *end,
+                                   const sp<AudioPort>& port);
+        // devices are stored as indexes in the list of all devices of the configuration
+        static void addCachedDevices(Vector< sp<DeviceDescriptor> >& devices,
+                                     const DeviceVector& deviceVector);
+        static void writeCachedDevices(Vector<uint32_t>& data,
+                                       const Vector< sp<DeviceDescriptor> >& devices,
+                                       const DeviceVector& deviceVector);
+        static bool readCachedDevices(const uint32_t **pos, const uint32_t *end,
+                                      const Vector< sp<DeviceDescriptor> >& devices,
+                                      DeviceVector& deviceVector);
+
 
         uid_t mUidCached;
         AudioPolicyClientInterface *mpClientInterface;  // audio policy client interface
@@ -917,6 +943,8 @@ protected:
 private:
         static float volIndexToAmpl(audio_devices_t device, const StreamDescriptor& streamDesc,
                 int indexInUi);
+        static float computeVolIndexToAmpl(device_category deviceCategory,
+                const StreamDescriptor& streamDesc, int indexInUi);
         static bool isVirtualInputDevice(audio_devices_t device);
         uint32_t nextUniqueId();
         uint32_t nextAudioPortGeneration();
@@ -945,6 +973,63 @@ private:
                 audio_channel_mask_t channelMask,
                 audio_output_flags_t flags,
                 const audio_offload_info_t *offloadInfo);
+
+        // mixed output selected by getOutputForDevice() for a given set of request parameters.
+        // The attributes of getOutputForAttr() are resolved into the device, stream and flags
+        // before the lookup. A decision is only valid for the routing and audio port
+        // generations it was made with.
+        struct RoutingDecision {
+            audio_devices_t mDevice;
+            audio_stream_type_t mStream;
+            uint32_t mSamplingRate;
+            audio_format_t mFormat;
+            audio_channel_mask_t mChannelMask;
+            audio_output_flags_t mFlags;
+            audio_io_handle_t mOutput;
+            uint32_t mRoutingGeneration;
+            uint32_t mPortGeneration;
+        };
+        static const size_t MAX_ROUTING_DECISIONS = 32;
+        // returns the cached output for these parameters or AUDIO_IO_HANDLE_NONE
+        audio_io_handle_t findRoutingDecision(audio_devices_t device,
+                                              audio_stream_type_t stream,
+                                              uint32_t samplingRate,
+                                              audio_format_t format,
+                                              audio_channel_mask_t channelMask,
+                                              audio_output_flags_t flags);
+        void addRoutingDecision(audio_devices_t device,
+                                audio_stream_type_t stream,
+                                uint32_t samplingRate,
+                                audio_format_t format,
+                                audio_channel_mask_t channelMask,
+                                audio_output_flags_t flags,
+                                audio_io_handle_t output);
+        // discards all routing decisions. Must be called every time a condition that affects
+        // the device or output choice changes: connected device, phone state, force use...
+        // Opening and closing outputs is covered by the audio port generation.
+        void invalidateRoutingDecisions();
+        void dumpRoutingDecisions(int fd);
+
+        Vector<RoutingDecision> mRoutingDecisions;
+        uint32_t mRoutingGeneration;
+        uint32_t mRoutingCacheHits;
+        uint32_t mRoutingCacheMisses;
+        nsecs_t mRoutingHitTime;        // total output selection time of cache hits
+        nsecs_t mRoutingMissTime;       // total output selection time of cache misses
+        nsecs_t mRoutingMaxHitTime;
+        nsecs_t mRoutingMaxMissTime;
+
+        // applyStreamVolumes() applies all streams of an output in one pass: the sonification
+        // limit derived from the music volume is computed once for the pass instead of once
+        // per stream.
+        struct VolumeBatch {
+            bool mActive;               // an applyStreamVolumes() pass is in progress
+            audio_io_handle_t mOutput;  // output the pass applies to
+            bool mHasMusicLimit;        // mMusicLimit is valid
+            float mMusicLimit;          // sonification volume limit
+        };
+        VolumeBatch mVolumeBatch;
+
         // internal function to derive a stream type value from audio attributes
         audio_stream_type_t streamTypefromAttributesInt(const audio_attributes_t *attr);
         // Used for voip + voice concurrency usecase
@@ -27,6 +27,8 @@
 
 #define AUDIO_POLICY_CONFIG_FILE "/system/etc/audio_policy.conf"
 #define AUDIO_POLICY_VENDOR_CONFIG_FILE "/vendor/etc/audio_policy.conf"
+// parsed configuration saved by the policy manager to speed up the next start
+#define AUDIO_POLICY_CACHE_FILE "/data/misc/audio/audio_policy_conf.bin"
 
 // global configuration
 #define GLOBAL_CONFIG_TAG "global_configuration"